@@ -429,6 +429,19 @@ fat_write_fat_entry(struct fat_hdr *h,
    }
 }
 
+/*
+ * Writes `value` in the entry for cluster 'clusterN' in all the FATs.
+ */
+void
+fat_set_fat_entry(struct fat_hdr *h,
+                  enum fat_type ft,
+                  u32 clusterN,
+                  u32 value)
+{
+   for (u32 fatN = 0; fatN < h->BPB_NumFATs; fatN++)
+      fat_write_fat_entry(h, ft, fatN, clusterN, value);
+}
+
 u32 fat_get_first_data_sector(struct fat_hdr *hdr)
 {
    u32 RootDirSectors = fat_get_root_dir_sectors(hdr);
@@ -847,6 +860,75 @@ fat_get_first_free_cluster_off(struct fat_hdr *hdr)
    return (ff_sector + 1) * hdr->BPB_BytsPerSec;
 }
 
+/*
+ * Returns the end (exclusive) of the range of clusters entirely contained in
+ * the first `size` bytes of the partition. Clusters out of that range cannot
+ * be used when the partition is loaded only partially in memory.
+ */
+u32
+fat_get_clusters_end_in_size(struct fat_hdr *hdr, size_t size)
+{
+   const u32 count = fat_get_cluster_count(hdr);
+   const size_t data_off =
+      (size_t)fat_get_first_data_sector(hdr) * hdr->BPB_BytsPerSec;
+
+   if (size <= data_off)
+      return 2;
+
+   return 2 + (u32)MIN((size - data_off) / fat_get_cluster_size(hdr), count);
+}
+
+/*
+ * Fills `bitmap` (one bit per cluster, 1 = free) with the free clusters in
+ * the range [2, clu_end), by scanning the first FAT. Returns the number of
+ * free clusters found.
+ */
+u32
+fat_build_free_clusters_bitmap(struct fat_hdr *hdr,
+                               enum fat_type ft,
+                               ulong *bitmap,
+                               u32 clu_end)
+{
+   u32 free_count = 0;
+
+   for (u32 clu = 2; clu < clu_end; clu++) {
+
+      if (!fat_read_fat_entry(hdr, ft, 0, clu)) {
+         bitmap[clu / NBITS] |= (1UL << (clu % NBITS));
+         free_count++;
+      }
+   }
+
+   return free_count;
+}
+
+/*
+ * Updates the free cluster count and the next free cluster hint in the FSInfo
+ * sector. It does nothing on FAT16 or if the FSInfo sector is not valid.
+ */
+void fat_update_fsinfo(struct fat_hdr *hdr, u32 free_count, u32 next_free)
+{
+   struct fat32_header2 *h32 = (struct fat32_header2 *)(hdr + 1);
+   struct fat32_fsinfo *fsi;
+
+   if (fat_get_type(hdr) != fat32_type)
+      return;
+
+   if (!h32->BPB_FSInfo || h32->BPB_FSInfo >= hdr->BPB_RsvdSecCnt)
+      return;
+
+   fsi = (void *)((u8 *)hdr + h32->BPB_FSInfo * hdr->BPB_BytsPerSec);
+
+   if (fsi->FSI_LeadSig != FAT_FSI_LEAD_SIG ||
+       fsi->FSI_StrucSig != FAT_FSI_STRUC_SIG)
+   {
+      return;
+   }
+
+   fsi->FSI_Free_Count = free_count;
+   fsi->FSI_Nxt_Free = next_free;
+}
+
 u32
 fat_calculate_used_bytes(struct fat_hdr *hdr)
 {
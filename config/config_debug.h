@@ -19,6 +19,8 @@
 
 /* disabled by default */
 #cmakedefine01 PANIC_SHOW_REGS
+#cmakedefine01 KRN_LOCK_STATS
+#cmakedefine01 KRN_LAT_TRACER
 
 
 /*
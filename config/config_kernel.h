@@ -48,3 +48,5 @@
 #define WTH_MAX_PRIO_QUEUE_SIZE                    32
 #define WTH_KB_QUEUE_SIZE                          32
 #define WTH_SERIAL_QUEUE_SIZE                      32
+#define WTH_KTIMERS_QUEUE_SIZE                      4
+#define WTH_PRINTK_QUEUE_SIZE                       4
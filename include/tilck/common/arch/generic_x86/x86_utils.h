@@ -9,6 +9,10 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/arch/generic_x86/asm_consts.h>
 
+#ifdef __TILCK_KERNEL__
+   #include <tilck_gen_headers/config_debug.h>
+#endif
+
 /*
  * HACK: include directly <ia32intrin.h> because <x86intrin.h> includes too much
  * stuff like FPU-related funcs which don't compile on x86_64 because we have
@@ -234,18 +238,32 @@ static ALWAYS_INLINE bool are_interrupts_enabled(void)
    return !!(get_eflags() & EFLAGS_IF);
 }
 
+/*
+ * Hooks of the IRQs-off latency tracer (see lat_tracer.h), called only on the
+ * enabled -> disabled transitions and vice versa.
+ */
+#if defined(__TILCK_KERNEL__) && KRN_LAT_TRACER
+   void irqsoff_trace_begin(void);
+   void irqsoff_trace_end(void);
+#else
+   static ALWAYS_INLINE void irqsoff_trace_begin(void) { }
+   static ALWAYS_INLINE void irqsoff_trace_end(void) { }
+#endif
+
 static ALWAYS_INLINE void disable_interrupts(ulong *const var)
 {
    *var = get_eflags();
 
    if (*var & EFLAGS_IF) {
       disable_interrupts_forced();
+      irqsoff_trace_begin();
    }
 }
 
 static ALWAYS_INLINE void enable_interrupts(const ulong *const var)
 {
    if (*var & EFLAGS_IF) {
+      irqsoff_trace_end();
       enable_interrupts_forced();
    }
 }
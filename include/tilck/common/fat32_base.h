@@ -60,6 +60,21 @@ struct fat32_header2 {
 
 } PACKED;
 
+#define FAT_FSI_LEAD_SIG      0x41615252
+#define FAT_FSI_STRUC_SIG     0x61417272
+
+struct fat32_fsinfo {
+
+   u32 FSI_LeadSig;
+   u8 FSI_Reserved1[480];
+   u32 FSI_StrucSig;
+   u32 FSI_Free_Count;  // last known free cluster count, 0xFFFFFFFF = unknown
+   u32 FSI_Nxt_Free;    // hint: where to start looking for free clusters
+   u8 FSI_Reserved2[12];
+   u32 FSI_TrailSig;
+
+} PACKED;
+
 /*
  * Special flags in DIR_NTRes telling us if the base part or the extention of
  * a short name is entirely in lower case.
@@ -144,6 +159,12 @@ fat_write_fat_entry(struct fat_hdr *h,
                     u32 clusterN,
                     u32 value);
 
+void
+fat_set_fat_entry(struct fat_hdr *h,
+                  enum fat_type ft,
+                  u32 clusterN,
+                  u32 value);
+
 u32 fat_get_first_data_sector(struct fat_hdr *hdr);
 u32 fat_get_cluster_count(struct fat_hdr *hdr);
 
@@ -212,6 +233,13 @@ static inline bool fat_is_end_of_clusterchain(enum fat_type ft, u32 val)
             : val >= 0x0FFFFFF0 && val != 0x0FFFFFF7;
 }
 
+/* The value marking the end of a cluster chain, when writing the FAT */
+static inline u32 fat_get_eoc_value(enum fat_type ft)
+{
+   ASSERT(ft == fat16_type || ft == fat32_type);
+   return ft == fat16_type ? 0xFFFF : 0x0FFFFFFF;
+}
+
 static inline bool fat_is_bad_cluster(enum fat_type ft, u32 val)
 {
    ASSERT(ft == fat16_type || ft == fat32_type);
@@ -276,6 +304,15 @@ fat_search_entry(struct fat_hdr *hdr,
 size_t fat_get_file_size(struct fat_entry *entry);
 u32 fat_get_first_free_cluster_off(struct fat_hdr *hdr);
 u32 fat_calculate_used_bytes(struct fat_hdr *hdr);
+u32 fat_get_clusters_end_in_size(struct fat_hdr *hdr, size_t size);
+
+u32
+fat_build_free_clusters_bitmap(struct fat_hdr *hdr,
+                               enum fat_type ft,
+                               ulong *bitmap,
+                               u32 clu_end);
+
+void fat_update_fsinfo(struct fat_hdr *hdr, u32 free_count, u32 next_free);
 void fat_compact_clusters(struct fat_hdr *hdr);
 bool fat_is_first_data_sector_aligned(struct fat_hdr *hdr, u32 page_size);
 void fat_align_first_data_sector(struct fat_hdr *hdr, u32 page_size);
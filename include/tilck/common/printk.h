@@ -23,6 +23,7 @@
       int vsnprintk(char *buf, size_t size, const char *fmt, va_list args);
       int snprintk(char *buf, size_t size, const char *fmt, ...);
       void printk_flush_ringbuf(void);
+      void init_printk_flusher(void);
 
    #else
 
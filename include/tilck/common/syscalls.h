@@ -17,9 +17,18 @@ enum tilck_cmd {
    TILCK_CMD_TRACING_TOOL        = 7,
    TILCK_CMD_PS_TOOL             = 8,
    TILCK_CMD_DEBUGGER_TOOL       = 9,
+   TILCK_CMD_PROFILER            = 10,
 
    /* Number of elements in the enum */
-   TILCK_CMD_COUNT               = 10,
+   TILCK_CMD_COUNT               = 11,
+};
+
+/* Sub-commands of TILCK_CMD_PROFILER */
+enum tilck_prof_cmd {
+
+   TILCK_PROF_START              = 0,     /* arg: sampling rate in Hz */
+   TILCK_PROF_STOP               = 1,
+   TILCK_PROF_RESET              = 2,
 };
 
 #if defined(__x86_64__)
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Layout of the memory exposed by /dev/trace, shared by the tracing module
+ * and by its user space consumers (see `dp -c`).
+ *
+ * The device memory starts with a header of TRACE_DEV_HDR_SIZE bytes,
+ * followed by a ring of `max_events` raw `struct trace_event` records. The
+ * kernel writes the events at `head` and the consumer drains them by moving
+ * `tail`. Both are free-running counters: the i-th event is at offset:
+ *
+ *    hdr_size + (i & (max_events - 1)) * event_size
+ *
+ * The offsets of the fields in `struct trace_event` and the names of the
+ * syscalls are exported too, in order to allow decoding the records offline
+ * without knowing the kernel's build configuration.
+ */
+
+#define TRACE_DEV_PATH                     "/dev/trace"
+#define TRACE_DEV_MAGIC                    0x544b4c54 /* "TLKT" */
+#define TRACE_DEV_VERSION                  3
+#define TRACE_DEV_HDR_SIZE                 (16 * KB)
+#define TRACE_DEV_SYS_NAME_LEN             32
+
+struct trace_dev_hdr {
+
+   u32 magic;
+   u32 version;
+   u32 hdr_size;              /* offset of the first event in the ring */
+   u32 event_size;            /* sizeof(struct trace_event) */
+   u32 max_events;            /* capacity of the ring: always a power of 2 */
+   u32 ulong_size;            /* sizeof(ulong) in the kernel */
+   u32 printk_buf_size;       /* size of the printk events' buffer */
+
+   /* Offsets of the fields in `struct trace_event` */
+   u32 off_type;
+   u32 off_tid;
+   u32 off_sys_time;
+   u32 off_sys;
+   u32 off_retval;
+   u32 off_args;
+   u32 off_printk_level;
+   u32 off_printk_buf;
+   u32 off_signum;
+   u32 off_sched_other_tid;
+   u32 off_sched_state;
+   u32 off_sched_func;
+   u32 off_sched_arg;
+
+   /* Table of `sys_names_count` names, TRACE_DEV_SYS_NAME_LEN bytes each */
+   u32 sys_names_off;
+   u32 sys_names_count;
+
+   volatile u32 head;         /* next event to write: updated by the kernel */
+   volatile u32 tail;         /* next event to read: updated by the consumer */
+   volatile u32 dropped;      /* events dropped because the ring was full */
+   volatile u32 buf_dropped;  /* events dropped by the tracing buffers */
+};
@@ -38,6 +38,7 @@ struct x86_arch_proc_members {
 
 struct x86_arch_task_members {
    u16 fpu_regs_size;
+   u16 tls_gdt_entry; /* Per-thread TLS entry in gdt (CLONE_SETTLS), if > 0 */
    void *aligned_fpu_regs;
 };
 
@@ -72,3 +73,8 @@ static ALWAYS_INLINE void *regs_get_ip(regs_t *r)
 {
    return TO_PTR(r->eip);
 }
+
+static ALWAYS_INLINE void regs_set_user_stack_ptr(regs_t *r, ulong sp)
+{
+   r->useresp = sp;
+}
@@ -62,3 +62,8 @@ static ALWAYS_INLINE void *regs_get_ip(regs_t *r)
 {
    return TO_PTR(r->rip);
 }
+
+static ALWAYS_INLINE void regs_set_user_stack_ptr(regs_t *r, ulong sp)
+{
+   NOT_IMPLEMENTED();
+}
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Boot-time profiler. It measures with the TSC, available since the very
+ * beginning, the duration of the initialization steps in kmain() and in
+ * do_async_init(), including the init callback of each module. The steps
+ * nest: the root one, "boot", goes from the entry of kmain() to the moment
+ * right before running init. When the kernel is booted with `-boot_prof`,
+ * the profile is printed by boot_prof_done().
+ */
+
+#define BOOT_PROF_MAX_STEPS                           64
+
+struct boot_prof_step {
+
+   const char *name;
+   u32 depth;                    /* 0 for the root step */
+   u64 start;                    /* TSC cycles since the start of the boot */
+   u64 cycles;                   /* 0 if the step is still running */
+};
+
+/* Begin a step and return its index, or -1 if there's no room for it */
+int boot_prof_begin(const char *name);
+void boot_prof_end(int step);
+
+void boot_prof_start(void);      /* first thing in kmain() */
+void boot_prof_done(void);       /* right before running init */
+
+/*
+ * Copy the steps in `buf` (at most `max`) and return their number. Returns 0
+ * until the boot is done.
+ */
+u32 boot_prof_get_steps(struct boot_prof_step *buf, u32 max);
+
+/* Convert TSC cycles to microseconds, 0 if the TSC rate is not known yet */
+u64 boot_prof_cycles_to_us(u64 cycles);
+
+#define BOOT_STEP(func)                                                 \
+   do {                                                                 \
+      int __bp_step = boot_prof_begin(#func);                           \
+      func();                                                           \
+      boot_prof_end(__bp_step);                                         \
+   } while (0)
@@ -10,6 +10,7 @@ extern const char *cmd_args[MAX_CMD_ARGS];
 extern void (*self_test_to_run)(void);
 
 extern long kopt_ttys;
+extern long kopt_prof_hz;
 extern bool kopt_sercon;
 extern bool kopt_sched_alive_thread;
 extern bool kopt_noacpi;
@@ -23,5 +24,8 @@ extern bool kopt_panic_mmap;
 extern bool kopt_big_scroll_buf;
 extern bool kopt_ps2_log;
 extern bool kopt_ps2_selftest;
+extern bool kopt_initrd_rw;
+extern bool kopt_sys_stats;
+extern bool kopt_boot_prof;
 
 void parse_kernel_cmdline(const char *cmdline);
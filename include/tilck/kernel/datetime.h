@@ -29,6 +29,7 @@ static inline bool is_leap_year(u32 year)
 }
 
 u64 get_sys_time(void);
+u64 get_sys_time_hr(void);
 s64 get_timestamp(void);
 void init_system_time(void);
 int clock_get_second_drift(void);
@@ -39,6 +40,7 @@ u64 timespec_to_ticks(const struct k_timespec64 *tp);
 void real_time_get_timespec(struct k_timespec64 *tp);
 void monotonic_time_get_timespec(struct k_timespec64 *tp);
 void clock_get_resync_stats(struct clock_resync_stats *s);
+int do_clock_gettime(clockid_t clk_id, struct k_timespec64 *tp);
 
 static ALWAYS_INLINE struct k_timespec32
 to_k_timespec32(struct k_timespec64 tp)
@@ -54,6 +56,22 @@ to_k_timespec32(struct k_timespec64 tp)
    return res;
 }
 
+static ALWAYS_INLINE void
+itimerspec32_to_64(const struct k_itimerspec32 *in, struct k_itimerspec64 *out)
+{
+   out->it_interval.tv_sec = in->it_interval.tv_sec;
+   out->it_interval.tv_nsec = in->it_interval.tv_nsec;
+   out->it_value.tv_sec = in->it_value.tv_sec;
+   out->it_value.tv_nsec = in->it_value.tv_nsec;
+}
+
+static ALWAYS_INLINE void
+itimerspec64_to_32(const struct k_itimerspec64 *in, struct k_itimerspec32 *out)
+{
+   out->it_interval = to_k_timespec32(in->it_interval);
+   out->it_value = to_k_timespec32(in->it_value);
+}
+
 #ifdef BITS32
    #define to_stat_timespec(tp)  to_k_timespec32(tp)
 #else
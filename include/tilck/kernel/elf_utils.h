@@ -18,4 +18,7 @@ ulong find_addr_of_symbol(const char *searched_sym);
 const char *find_sym_at_addr(ulong vaddr, long *off, u32 *sym_size);
 const char *find_sym_at_addr_safe(ulong vaddr, long *off, u32 *sym_size);
 
+/* Write in `buf` the return address `ra` as "func+off", or as a pointer */
+void get_ret_addr_str(void *ra, char *buf, size_t buf_sz);
+
 int foreach_symbol(int (*cb)(struct elf_symbol_info *, void *), void *arg);
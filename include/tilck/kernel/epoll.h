@@ -0,0 +1,6 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+
+void epoll_on_handle_close(fs_handle h);
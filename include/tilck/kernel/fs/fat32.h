@@ -6,17 +6,69 @@
 #include <tilck/common/fat32_base.h>
 
 #include <tilck/kernel/sync.h>
+#include <tilck/kernel/rwlock.h>
+#include <tilck/kernel/list.h>
+#include <tilck/kernel/bintree.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/fs/vfs_base.h>
 
+/*
+ * A contiguous run of clusters of a file: the `len` clusters starting at `clu`
+ * hold the clusters [file_clu, file_clu + len) of the file.
+ */
+struct fat_extent {
+
+   u32 file_clu;
+   u32 clu;
+   u32 len;
+};
+
+/*
+ * In-memory state of a FAT file, used only when the partition is mounted r/w.
+ * It caches file's cluster chain as an extent map and holds the changes not
+ * yet written back to the FAT and to the dir entry: those are deferred until
+ * the next fsync() or syncfs() call. Objects are shared by all the handles
+ * of the same file and stay alive while dirty, even after the last close.
+ */
+struct fat_inode {
+
+   REF_COUNTED_OBJECT;
+
+   struct bintree_node node;
+   struct list_node dirty_node;
+   struct rwlock_wp rwlock;
+
+   struct fat_entry *e;          /* the dir entry of the file (tree's key) */
+   struct fat_extent *extents;   /* sorted by `file_clu` */
+   u32 extents_count;
+   u32 extents_cap;
+   u32 clusters_count;           /* sum of the extents' `len` */
+   u32 synced_clusters;          /* leading clusters already linked in FAT */
+   u32 fsize;                    /* file size, up-to-date */
+   bool dirty;
+
+   struct list mappings_list;    /* see fat_unmap_past_eof_mappings() */
+};
+
 struct fat_fs_device_data {
 
    struct fat_hdr *hdr; /* vaddr of the beginning of the FAT partition */
+   size_t rd_size;
    enum fat_type type;
    u32 cluster_size;
    u32 root_cluster;
    bool mmap_support;
 
+   /* Members used only when mounted r/w */
+   struct rwlock_wp rwlock;      /* fs-level lock */
+   ulong *free_bitmap;           /* one bit per cluster, 1 = free */
+   u32 clu_end;                  /* clusters >= clu_end are not in memory */
+   u32 free_count;               /* number of bits set in `free_bitmap` */
+   u32 next_free;                /* where to start looking for free clusters */
+   bool freed_clusters;          /* clusters freed since the last syncfs() */
+   struct fat_inode *inodes_root;
+   struct list dirty_list;
+
    /*
     * A pointer to root directory's entries. Notice that this isn't a random
     * choice: the first entry in the root directory the is "Volume ID" entry,
@@ -37,6 +89,7 @@ struct fatfs_handle {
 
    /* fs-specific members */
    struct fat_entry *e;
+   struct fat_inode *fi;         /* NULL on read-only mounts */
    u32 curr_cluster;
 };
 
@@ -48,6 +101,27 @@ void fat_umount_ramdisk(struct mnt_fs *fs);
 struct datetime
 fat_datetime_to_regular_datetime(u16 date, u16 time, u8 timetenth);
 
+/* Write support (r/w mounts only), see fat32_rw.c */
+int fat_rw_init(struct fat_fs_device_data *d);
+void fat_rw_destroy(struct fat_fs_device_data *d);
+int fat_get_inode_obj(struct fat_fs_device_data *d,
+                      struct fat_entry *e,
+                      struct fat_inode **out);
+void fat_put_inode_obj(struct fat_fs_device_data *d, struct fat_inode *fi);
+u32 fat_inode_get_cluster(struct fat_inode *fi, u32 file_clu);
+u32 fat_get_file_size_rw(struct fat_fs_device_data *d, struct fat_entry *e);
+int fat_inode_truncate(struct fat_fs_device_data *d,
+                       struct fat_inode *fi,
+                       offt len);
+void fat_flush_inode(struct fat_fs_device_data *d, struct fat_inode *fi);
+void fat_unmap_past_eof_mappings(struct fat_inode *fi, size_t len);
+void fat_syncfs(struct mnt_fs *fs);
+ssize_t fat_write_int(struct fatfs_handle *h,
+                      const struct iovec *iov,
+                      int iovcnt,
+                      offt *pos,
+                      bool user);
+
 /*
  * On FAT, there are no inodes and dir entries. Just dir entries.
  * Therefore, what is called `inode` in VFS will be a `entry` here.
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/sys_types.h>
+
+struct mnt_fs *ramfs_create(void);
+
+int
+ramfs_create_unnamed_file(struct mnt_fs *fs,
+                          mode_t mode,
+                          u32 seals,
+                          fs_handle *out);
+
+int ramfs_get_seals(fs_handle h);
+int ramfs_add_seals(fs_handle h, u32 seals);
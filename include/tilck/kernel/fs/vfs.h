@@ -35,6 +35,7 @@ typedef int     (*func_getdents)  (fs_handle, get_dents_func_cb, void *);
 typedef int     (*func_unlink)    (struct vfs_path *p);
 typedef int     (*func_mkdir)     (struct vfs_path *p, mode_t);
 typedef int     (*func_rmdir)     (struct vfs_path *p);
+typedef int     (*func_mknod)     (struct vfs_path *p, mode_t);
 typedef int     (*func_symlink)   (const char *, struct vfs_path *);
 typedef int     (*func_readlink)  (struct vfs_path *, char *);
 typedef int     (*func_chmod)     (struct mnt_fs *, vfs_inode_ptr_t, mode_t);
@@ -94,12 +95,21 @@ typedef int            (*func_on_dup_cb)    (fs_handle);
 
 typedef ssize_t        (*func_readv)        (fs_handle,
                                              const struct iovec *,
-                                             int);
+                                             int,
+                                             offt *);
 
 typedef ssize_t        (*func_writev)       (fs_handle,
                                              const struct iovec *,
-                                             int);
+                                             int,
+                                             offt *);
+
+typedef ssize_t        (*func_copy_range)   (fs_handle,
+                                             offt *,
+                                             fs_handle,
+                                             offt *,
+                                             size_t);
 
+typedef int            (*func_fallocate)    (fs_handle, int, offt, offt);
 typedef int            (*func_fsync)        (fs_handle);
 typedef void           (*func_syncfs)       (struct mnt_fs *);
 
@@ -131,6 +141,7 @@ struct fs_ops {
    func_stat stat;
    func_mkdir mkdir;
    func_rmdir rmdir;
+   func_mknod mknod;
    func_symlink symlink;
    func_readlink readlink;
    func_trunc truncate;
@@ -167,6 +178,8 @@ struct file_ops {
 
    func_readv readv;                   /* if NULL, emulated in non-atomic way */
    func_writev writev;                 /* if NULL, emulated in non-atomic way */
+   func_copy_range copy_range;         /* if NULL, emulated with read/write */
+   func_fallocate fallocate;           /* if NULL -> -EOPNOTSUPP */
 
    func_handle_fault handle_fault;     /* if NULL -> false     */
 
@@ -192,6 +205,7 @@ int vfs_open(const char *path, fs_handle *out, int flags, mode_t mode);
 int vfs_unlink(const char *path);
 int vfs_mkdir(const char *path, mode_t mode);
 int vfs_rmdir(const char *path);
+int vfs_mknod(const char *path, mode_t mode);
 int vfs_truncate(const char *path, offt length);
 int vfs_symlink(const char *target, const char *linkpath);
 int vfs_readlink(const char *path, char *buf);
@@ -208,6 +222,7 @@ int vfs_getdents64(fs_handle h, struct linux_dirent64 *dirp, u32 bs);
 int vfs_fchmod(fs_handle h, mode_t mode);
 int vfs_futimens(fs_handle h, const struct k_timespec64 times[2]);
 int vfs_fsync(fs_handle h);
+int vfs_fallocate(fs_handle h, int mode, offt off, offt len);
 int vfs_fdatasync(fs_handle h);
 offt vfs_seek(fs_handle h, offt off, int whence);
 
@@ -224,6 +239,14 @@ ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt);
 ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt);
 ssize_t vfs_pread(fs_handle h, void *buf, size_t buf_size, offt off);
 ssize_t vfs_pwrite(fs_handle h, void *buf, size_t buf_size, offt off);
+ssize_t vfs_preadv(fs_handle h, const struct iovec *iov, int iovcnt, offt off);
+ssize_t vfs_pwritev(fs_handle h, const struct iovec *iov, int iovcnt, offt off);
+
+ssize_t vfs_copy_data(fs_handle in, offt *in_pos,
+                      fs_handle out, offt *out_pos, size_t len);
+
+ssize_t vfs_copy_file_range(fs_handle in, offt *in_pos,
+                            fs_handle out, offt *out_pos, size_t len);
 
 int vfs_exlock_noblock(struct mnt_fs *fs, vfs_inode_ptr_t i);
 int vfs_exunlock(struct mnt_fs *fs, vfs_inode_ptr_t i);
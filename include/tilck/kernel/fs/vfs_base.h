@@ -33,6 +33,7 @@ enum vfs_entry_type {
    VFS_CHAR_DEV   = 4,
    VFS_BLOCK_DEV  = 5,
    VFS_PIPE       = 6,
+   VFS_SOCKET     = 7,
 };
 
 
@@ -116,15 +117,16 @@ struct fs_handle_base {
 #define VFS_SPFL_NO_USER_COPY                  (1 << 0)
 #define VFS_SPFL_MMAP_SUPPORTED                (1 << 1)
 #define VFS_SPFL_NO_LF                         (1 << 2)
+#define VFS_SPFL_EPOLL                         (1 << 3) /* in an epoll set */
 
 /*
  * vfs_mmap()'s flags
  *
  * By default the mmap() function (called by vfs_mmap) is expected to both do
  * the actual memory-map and to register the user mapping in inode's
- * mappings_list (not all file-systems do that, e.g. ramfs does, fat doesn't).
- * For more about where the mappings_list play a role in ramfs, see the func
- * ramfs_unmap_past_eof_mappings().
+ * mappings_list (not all file-systems do that, e.g. ramfs does, fat does it
+ * only on r/w mounts). For more about where the mappings_list play a role in
+ * ramfs, see the func ramfs_unmap_past_eof_mappings().
  *
  * However, in certain contexts, like partial un-mapping we might want to just
  * register the new user-mapping, without actually doing it. That's where the
@@ -141,6 +143,7 @@ bool vfs_handle_fault(struct user_mapping *um, void *va, bool p, bool rw);
 int vfs_dup(fs_handle h, fs_handle *dup_h);
 void vfs_close(fs_handle h);
 fs_handle get_fs_handle(int fd);
+int install_fs_handle(fs_handle h, int fd_flags);
 
 static ALWAYS_INLINE bool
 is_mmap_supported(fs_handle h)
@@ -0,0 +1,6 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+int futex_wake_addr(void *uaddr, int n);
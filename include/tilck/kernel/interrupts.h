@@ -15,6 +15,16 @@ static ALWAYS_INLINE bool in_irq(void)
    return atomic_load_explicit(&__in_irq_count, mo_relaxed) > 0;
 }
 
+/*
+ * Registers of the context interrupted by the current IRQ. Valid only in IRQ
+ * context (see in_irq()).
+ */
+static ALWAYS_INLINE regs_t *get_irq_regs(void)
+{
+   extern regs_t *__irq_regs;
+   return __irq_regs;
+}
+
 #if KRN_TRACK_NESTED_INTERR
    void check_not_in_irq_handler(void);
    void check_in_irq_handler(void);
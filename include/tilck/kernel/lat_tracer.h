@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * IRQs-off and preemption-off latency tracer, compiled-in only when
+ * KRN_LAT_TRACER is enabled.
+ *
+ * The tracer measures in TSC cycles the sections delimited by the transitions
+ * of disable_interrupts() / enable_interrupts() and disable_preemption() /
+ * enable_preemption(), and keeps the LAT_TRACER_TOP worst ones, identified by
+ * their start and end call sites. The IRQs-off sections still open when the
+ * scheduler switches to another task end there, because the next task runs
+ * with its own interrupts state. IRQs disabled by the CPU on interrupt entry
+ * are not traced.
+ */
+
+#define LAT_TRACER_TOP                                  16
+
+enum lat_kind {
+   lat_irqsoff,
+   lat_preemptoff,
+   lat_kinds_count,
+};
+
+struct lat_section {
+   void *start_site;
+   void *end_site;
+   u64 max_cycles;
+};
+
+struct lat_tracer_stats {
+
+   u64 sections;              /* number of sections measured */
+   u64 tot_cycles;            /* time spent in all of them */
+
+   u32 top_count;
+   struct lat_section top[LAT_TRACER_TOP];  /* not sorted */
+};
+
+/* Hooks for enable_preemption() and switch_to_task(), see also sched.h */
+void preemptoff_trace_end_at(void *site);
+void irqsoff_trace_on_task_switch(void);
+
+/*
+ * Copy the stats of the given kind in `out`. All zero when KRN_LAT_TRACER is
+ * disabled.
+ */
+void lat_tracer_get_stats(enum lat_kind k, struct lat_tracer_stats *out);
+void lat_tracer_reset(void);
+
+/* Writes in `buf` the call site `site` as "func+off" */
+void lat_tracer_get_site_name(void *site, char *buf, size_t sz);
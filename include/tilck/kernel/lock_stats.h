@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/sync.h>
+
+/*
+ * Lock contention stats, compiled-in only when KRN_LOCK_STATS is enabled.
+ *
+ * The stats are aggregated per lock class: all the locks having the same name
+ * (see LOCK_STATS_NAME(), to be used after the lock's init function) or, for
+ * the unnamed ones, initialized at the same call site, belong to the same
+ * class. For example, all the pipe mutexes. Statically initialized locks get
+ * their class from the call site of their first lock operation.
+ *
+ * For each class, the kernel counts the acquisitions and the contentions (the
+ * acquisitions that had to wait) and measures in TSC cycles the time spent
+ * waiting and the time the lock was held. Hold times are measured only for the
+ * exclusive locks: kmutex and rwlock_wp's exlock. Semaphores and shared locks
+ * have no owner.
+ */
+
+#define LOCK_STATS_MAX_CLASSES                     128
+
+enum lock_type {
+   lock_type_kmutex,
+   lock_type_rwlock_wp,
+   lock_type_ksem,
+};
+
+struct lock_class {
+
+   const char *name;          /* NULL for the classes identified by `site` */
+   void *site;
+   enum lock_type type;
+
+   u32 acquisitions;
+   u32 contentions;
+   u64 wait_cycles;
+   u64 max_wait_cycles;
+   u64 hold_cycles;
+   u64 max_hold_cycles;
+};
+
+#if KRN_LOCK_STATS
+
+   #define LOCK_STATS_NAME(lock, type, n)                      \
+      lock_stats_set_name(&(lock)->ls, lock_type_##type, (n))
+
+   #define LOCK_STATS_CALLER()                                 \
+      __builtin_extract_return_addr(__builtin_return_address(0))
+
+   void lock_stats_set_name(struct lock_stat *ls,
+                            enum lock_type t,
+                            const char *name);
+
+   void lock_stats_init(struct lock_stat *ls, enum lock_type t, void *site);
+   u64 lock_stats_wait_begin(void);
+
+   void lock_stats_acquired(struct lock_stat *ls,
+                            enum lock_type t,
+                            void *site,
+                            u64 wait_start);
+
+   void lock_stats_released(struct lock_stat *ls);
+
+#else
+
+   #define LOCK_STATS_NAME(lock, type, n)          do { } while (0)
+
+#endif
+
+/*
+ * Copy the stats of up to `max` lock classes in `buf` and return how many
+ * they are. Always 0 when KRN_LOCK_STATS is disabled.
+ */
+u32 lock_stats_get_classes(struct lock_class *buf, u32 max);
+void lock_stats_reset(void);
+
+/* Writes in `buf` the name of the class or its call site as "func+off" */
+void lock_stats_get_class_name(struct lock_class *c, char *buf, size_t sz);
+const char *lock_stats_get_type_str(enum lock_type t);
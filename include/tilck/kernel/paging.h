@@ -93,6 +93,7 @@ void invalidate_page(ulong vaddr);
 void set_page_rw(pdir_t *pdir, void *vaddr, bool rw);
 void retain_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
 void release_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
+u32 get_pageframe_ref_count_at(pdir_t *pdir, void *vaddr);
 
 static ALWAYS_INLINE pdir_t *get_kernel_pdir(void)
 {
@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/list.h>
+
+/*
+ * Kernel performance objects: named counters, gauges and histograms, grouped
+ * by subsystem and exported all together by the sysfs module, in /syst/perf.
+ *
+ *    counter: number of events since boot, never decreasing (e.g. IRQs)
+ *    gauge:   a value that can go both up and down (e.g. pending jobs)
+ *    hist:    up to PERF_MAX_VALUES counts, one per bucket
+ *
+ * An object either points to its u32 values with `vals` or reads them with its
+ * `get` callback. In both cases, the values are read with the interrupts
+ * disabled. The objects defined with the DEF_PERF_* macros are registered by a
+ * constructor, before kmain() runs.
+ */
+
+#define PERF_MAX_VALUES                               32
+
+enum perf_type {
+   perf_counter,
+   perf_gauge,
+   perf_hist,
+};
+
+struct perf_obj {
+
+   struct list_node node;
+   const char *group;            /* e.g. "irq", a directory in /syst/perf */
+   const char *name;             /* unique in its group */
+   enum perf_type type;
+   u32 count;                    /* number of values: 1, unless a histogram */
+
+   const u32 *vals;              /* the values, when `get` is NULL */
+   void (*get)(struct perf_obj *o, u64 *vals);
+};
+
+/*
+ * Register a perf object. Returns -EEXIST if its group has already an object
+ * with the same name. Must not be called by IRQ handlers.
+ */
+int perf_register(struct perf_obj *o);
+
+/*
+ * Call `cb` on every perf object, sorted by group and name, with preemption
+ * disabled. Stops when `cb` returns != 0 and returns that value.
+ */
+int perf_for_each(int (*cb)(struct perf_obj *, void *), void *arg);
+
+/* Read the values of `o` in `vals`, an array of at least `o->count` elems */
+void perf_read(struct perf_obj *o, u64 *vals);
+
+const char *perf_get_type_str(enum perf_type t);
+
+#define DEF_PERF_OBJ(_type, _group, _name, _count, _vals, _get)           \
+                                                                          \
+   static struct perf_obj perf_##_group##_##_name;                        \
+                                                                          \
+   __attribute__((constructor))                                           \
+   static void __register_perf_##_group##_##_name(void)                   \
+   {                                                                      \
+      DEBUG_CHECKED_SUCCESS(!perf_register(&perf_##_group##_##_name));    \
+   }                                                                      \
+                                                                          \
+   static struct perf_obj perf_##_group##_##_name = {                     \
+      .group = #_group,                                                   \
+      .name = #_name,                                                     \
+      .type = perf_##_type,                                               \
+      .count = _count,                                                    \
+      .vals = _vals,                                                      \
+      .get = _get,                                                        \
+   }
+
+#define DEF_PERF_COUNTER(group, name, var)                                \
+   DEF_PERF_OBJ(counter, group, name, 1, &(var), NULL)
+
+#define DEF_PERF_COUNTER_FUNC(group, name, func)                          \
+   DEF_PERF_OBJ(counter, group, name, 1, NULL, &func)
+
+#define DEF_PERF_GAUGE(group, name, var)                                  \
+   DEF_PERF_OBJ(gauge, group, name, 1, &(var), NULL)
+
+#define DEF_PERF_GAUGE_FUNC(group, name, func)                            \
+   DEF_PERF_OBJ(gauge, group, name, 1, NULL, &func)
+
+#define DEF_PERF_HIST(group, name, arr)                                   \
+   DEF_PERF_OBJ(hist, group, name, ARRAY_SIZE(arr), arr, NULL)
@@ -1,11 +1,45 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #pragma once
-#define PIPE_BUF_SIZE   4096
+#define PIPE_BUF_SIZE                 4096   /* default capacity of a pipe */
+#define PIPE_DEF_MAX_SIZE      (1024 * 1024)   /* default for pipe_max_size */
 
 struct pipe;
 
+/* Max capacity settable with F_SETPIPE_SZ (tunable via sysfs) */
+extern ulong pipe_max_size;
+
 struct pipe *create_pipe(void);
 void destroy_pipe(struct pipe *p);
 fs_handle pipe_create_read_handle(struct pipe *p);
 fs_handle pipe_create_write_handle(struct pipe *p);
+
+bool is_pipe_read_end(fs_handle h);
+bool is_pipe_write_end(fs_handle h);
+
+int pipe_set_size(fs_handle h, ulong size);
+int pipe_get_size(fs_handle h);
+
+ssize_t
+pipe_vmsplice(fs_handle h, const struct iovec *iov, int iovcnt, bool nonblock);
+
+ssize_t
+pipe_splice_from(fs_handle pipe_wh,
+                 fs_handle src,
+                 offt *pos,
+                 size_t len,
+                 bool nonblock);
+
+ssize_t
+pipe_splice_to(fs_handle pipe_rh,
+               fs_handle dst,
+               offt *pos,
+               size_t len,
+               bool nonblock);
+
+ssize_t
+pipe_tee(fs_handle in_rh,
+         fs_handle out_wh,
+         size_t len,
+         bool nonblock,
+         bool consume);
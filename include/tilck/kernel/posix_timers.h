@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+struct process;
+
+/*
+ * Delete all the POSIX timers of `pi` (exit, execve). The ITIMER_REAL timer
+ * survives execve(), so the caller can ask to keep it.
+ */
+void posix_timers_delete_all(struct process *pi, bool keep_itimer);
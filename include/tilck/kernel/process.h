@@ -48,6 +48,8 @@ struct process {
    struct mappings_info *mi;
 
    struct list children;
+   struct list threads;                   /* all the tasks of this process */
+   int threads_count;
 
    void *proc_tty;
    bool did_call_execve;
@@ -55,8 +57,10 @@ struct process {
    bool vforked;                 /* after vfork(), before execve() */
    bool inherited_mmap_heap;
    bool did_set_tty_medium_raw;
-
-   int *set_child_tid;                    /* NOTE: this is an user pointer */
+   bool killing_threads;         /* exit_group() or execve() in progress */
+   bool group_exit;              /* exit_group() or fatal signal */
+   s32 group_exit_wstatus;       /* valid only when group_exit is true */
+   int vfork_parent_tid;         /* valid only when vforked is true */
 
    struct kmutex fslock;                  /* protects `handles` and `cwd` */
    mode_t umask;
@@ -66,6 +70,8 @@ struct process {
 
    struct locked_file *elf;
    fs_handle handles[MAX_HANDLES];        /* just a small fixed-size array */
+   struct list shm_list;                  /* SysV shm attachments, see shm.c */
+   struct list timers_list;               /* see posix_timers.c */
 
    /*
     * The purpose of having this opaque `arch_fields` member here is to avoid
@@ -118,6 +124,11 @@ task_is_parent(struct task *parent, struct task *child)
 }
 
 int do_fork(bool vfork);
+int do_clone(ulong flags,
+             void *newsp,
+             int *parent_tid,
+             void *tls,
+             int *child_tid);
 void handle_vforked_child_move_on(struct process *pi);
 int first_execve(const char *abs_path, const char *const *argv);
 
@@ -142,12 +153,16 @@ bool arch_specific_new_task_setup(struct task *ti, struct task *parent);
 void arch_specific_free_task(struct task *ti);
 void arch_specific_new_proc_setup(struct process *pi, struct process *parent);
 void arch_specific_free_proc(struct process *pi);
+int arch_setup_task_tls(struct task *ti, struct task *parent, void *u_tls);
 void wake_up_tasks_waiting_on(struct task *ti, enum wakeup_reason r);
 void init_process_lists(struct process *pi);
 
 void process_set_cwd2_nolock(struct vfs_path *tp);
 void process_set_cwd2_nolock_raw(struct process *pi, struct vfs_path *tp);
 void terminate_process(int exit_code, int term_sig);
+void terminate_thread(int exit_code);
+void process_kill_other_threads(void);
+void process_wait_other_threads(void);
 void close_cloexec_handles(struct process *pi);
 int setup_sig_handler(struct task *ti,
                       enum sig_state sig_state,
@@ -35,6 +35,8 @@ struct user_mapping *process_get_user_mapping(void *vaddr);
 void remove_all_file_mappings(struct process *pi);
 struct mappings_info *
 duplicate_mappings_info(struct process *new_pi, struct mappings_info *mi);
+long do_mmap(void *addr, size_t len, int prot,
+             int flags, fs_handle h, size_t pgoffset);
 
 
 /* Internal functions */
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Timer-driven sampling profiler. Every `TIMER_HZ / hz` ticks, the timer IRQ
+ * handler records the interrupted instruction pointer along with the return
+ * addresses found by walking the frame pointers of the interrupted kernel
+ * code. Identical stacks are aggregated in a per-boot table, which can be
+ * exported as "folded stacks" (see prof_get_folded()), the input format of
+ * flamegraph.pl. Samples taken while running in user space are all counted
+ * under the "[user]" stack.
+ */
+
+#define PROF_MAX_FRAMES                          16
+
+extern long prof_hz;            /* current sampling rate, 0 if stopped */
+extern ulong prof_samples;      /* number of samples taken */
+extern ulong prof_lost;         /* samples lost because the table was full */
+extern u32 __prof_period;       /* ticks between two samples, 0 if stopped */
+
+void prof_timer_tick(void);
+
+int prof_start(long hz);
+void prof_stop(void);
+void prof_reset(void);
+
+/*
+ * Write the folded stacks ("func1;func2;func3 count" lines, callers first)
+ * into `buf`, without ever truncating a line. Returns the number of bytes
+ * written. With a NULL `buf`, returns the size needed to contain them all.
+ */
+size_t prof_get_folded(char *buf, size_t buf_sz);
+
+int sys_tilck_prof(int cmd, long arg);
+void init_profiler(void);
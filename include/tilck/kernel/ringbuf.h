@@ -33,6 +33,37 @@ inline void ringbuf_reset(struct ringbuf *rb)
    rb->read_pos = rb->write_pos = rb->elems = 0;
 }
 
+/*
+ * In-place access for byte ring buffers (elem_size == 1): get a pointer to the
+ * largest contiguous chunk that can be written (or read) directly and then
+ * commit the number of bytes actually produced (or consumed).
+ */
+inline size_t ringbuf_get_write_chunk(struct ringbuf *rb, u8 **ptr)
+{
+   *ptr = rb->buf + rb->write_pos;
+   return MIN(rb->max_elems - rb->elems, rb->max_elems - rb->write_pos);
+}
+
+inline size_t ringbuf_get_read_chunk(struct ringbuf *rb, u8 **ptr)
+{
+   *ptr = rb->buf + rb->read_pos;
+   return MIN(rb->elems, rb->max_elems - rb->read_pos);
+}
+
+inline void ringbuf_commit_write(struct ringbuf *rb, size_t n)
+{
+   ASSERT(n <= rb->max_elems - rb->elems);
+   rb->write_pos = (u32)((rb->write_pos + n) % rb->max_elems);
+   rb->elems += (u32)n;
+}
+
+inline void ringbuf_commit_read(struct ringbuf *rb, size_t n)
+{
+   ASSERT(n <= rb->elems);
+   rb->read_pos = (u32)((rb->read_pos + n) % rb->max_elems);
+   rb->elems -= (u32)n;
+}
+
 void ringbuf_init(struct ringbuf *rb, size_t elems, size_t elem_size, void *b);
 void ringbuf_destory(struct ringbuf *rb);
 bool ringbuf_write_elem(struct ringbuf *rb, void *elem_ptr);
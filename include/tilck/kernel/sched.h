@@ -12,6 +12,7 @@
 #include <tilck/kernel/signal.h>
 
 #include <tilck_gen_headers/config_sched.h>
+#include <tilck_gen_headers/config_debug.h>
 
 #define TIME_SLICE_TICKS (TIMER_HZ / 25)
 
@@ -44,6 +45,22 @@ struct sched_ticks {
    u64 vruntime;        /* a brutal approx. of Linux's vruntime */
 };
 
+/*
+ * Log2 histogram of scheduling latencies, in microseconds: the bucket 0 counts
+ * the latencies < 1 us, while the i-th bucket counts the ones in the range
+ * [2^(i-1), 2^i) us. The last bucket counts everything above that.
+ */
+#define SCHED_LAT_BUCKETS                   24
+
+struct sched_lat_hist {
+   u32 cnt[SCHED_LAT_BUCKETS];
+};
+
+struct sched_lat_stats {
+   struct sched_lat_hist wakeup_lat;   /* wakeup -> running */
+   struct sched_lat_hist rq_wait;      /* runnable (any reason) -> running */
+};
+
 STATIC_ASSERT(sizeof(enum sig_state) == 1);
 
 struct task {
@@ -80,11 +97,14 @@ struct task {
    struct list_node runnable_node;
    struct list_node wakeup_timer_node;
    struct list_node siblings_node;    /* nodes in parent's pi's children list */
+   struct list_node threads_node;     /* node in pi's threads list */
 
    struct list tasks_waiting_list;    /* tasks waiting this task to end */
 
    s32 wstatus;                       /* waitpid's wstatus  */
    struct sched_ticks ticks;          /* scheduler counters */
+   u64 runnable_since;                /* sys time of the -> RUNNABLE change */
+   struct sched_lat_stats *lat;       /* per-task latency histograms */
 
    void *kernel_stack;
    void *args_copybuf;
@@ -109,9 +129,15 @@ struct task {
    /* Trace the syscalls of this task (requires debugpanel) */
    bool traced;
 
+   /* Per-task buffer of trace events (see modules/tracing) */
+   void *trace_buf;
+
    /* The task was sleeping on a timer and has just been woken up */
    bool timer_ready;
 
+   /* The task became runnable after sleeping (see `runnable_since`) */
+   bool woken_up;
+
    /* The current sa_mask has been altered by sigsuspend() */
    bool in_sigsuspend;
 
@@ -121,6 +147,9 @@ struct task {
    /* Kernel thread name, NULL for user tasks */
    const char *kthread_name;
 
+   /* Set by set_tid_address() or CLONE_CHILD_CLEARTID (user pointer) */
+   int *clear_child_tid;
+
    /* Pending signals bitset */
    ulong sa_pending[K_SIGACTION_MASK_WORDS];
 
@@ -144,6 +173,10 @@ extern struct task *idle_task;
 extern struct list runnable_tasks_list;
 extern const char *const task_state_str[5];
 
+/* System-wide latency histograms, including the tasks already dead */
+extern struct sched_lat_hist sched_wakeup_lat;
+extern struct sched_lat_hist sched_rq_wait;
+
 #define KTH_ALLOC_BUFS                       (1 << 0)
 #define KTH_WORKER_THREAD                    (1 << 1)
 
@@ -177,15 +210,35 @@ static ALWAYS_INLINE bool need_reschedule(void)
    return (bool) atomic_load_explicit(&__need_resched, mo_relaxed);
 }
 
+static ALWAYS_INLINE int get_preempt_disable_count(void)
+{
+   extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+   return atomic_load_explicit(&__disable_preempt, mo_relaxed);
+}
+
+/*
+ * Hooks of the preemption-off latency tracer (see lat_tracer.h), called while
+ * the disable count is 1, so that nested IRQs cannot cause other transitions.
+ */
+void preemptoff_trace_begin(void);
+void preemptoff_trace_end(void);
+
 static ALWAYS_INLINE void disable_preemption(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
-   atomic_fetch_add_explicit(&__disable_preempt, 1, mo_relaxed);
+   int oldval = atomic_fetch_add_explicit(&__disable_preempt, 1, mo_relaxed);
+
+   if (KRN_LAT_TRACER && !oldval)
+      preemptoff_trace_begin();
 }
 
 static ALWAYS_INLINE void enable_preemption_nosched(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+
+   if (KRN_LAT_TRACER && get_preempt_disable_count() == 1)
+      preemptoff_trace_end();
+
    atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
 }
 
@@ -201,12 +254,6 @@ static ALWAYS_INLINE void force_enable_preemption(void)
    atomic_store_explicit(&__disable_preempt, 0, mo_relaxed);
 }
 
-static ALWAYS_INLINE int get_preempt_disable_count(void)
-{
-   extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
-   return atomic_load_explicit(&__disable_preempt, mo_relaxed);
-}
-
 static ALWAYS_INLINE bool is_preemption_enabled(void)
 {
    return !get_preempt_disable_count();
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+struct process;
+
+void init_shm(void);
+
+/*
+ * Duplicate the SysV shm attachments of the current process into `pi`, a
+ * child being forked. Called with preemption disabled.
+ */
+int shm_fork_attachments(struct process *pi);
+
+/* Detach all the SysV shm segments attached to `pi` (exit, execve) */
+void shm_detach_all(struct process *pi);
@@ -7,6 +7,11 @@
 #include <signal.h>                   // system header
 #include <asm-generic/signal-defs.h>  // system header
 
+struct task;
+struct kcond;
+
+extern struct kcond signalfd_cond;
+
 #define SIG_FL_PROCESS     (1 << 0)
 #define SIG_FL_FAULT       (1 << 1)
 
@@ -27,6 +32,10 @@ int send_signal2(int pid, int tid, int signum, int flags);
 bool process_signals(void *curr, enum sig_state new_sig_state, void *regs);
 void drop_all_pending_signals(void *curr);
 void reset_all_custom_signal_handlers(void *curr);
+int set_temp_sigmask(const sigset_t *u_mask, size_t sigsetsize, ulong *saved);
+void restore_temp_sigmask(const ulong *saved, int syscall_rc);
+int dequeue_pending_signal(struct task *ti, const ulong *set);
+bool is_any_signal_pending_in(struct task *ti, const ulong *set);
 
 static inline int send_signal(int tid, int signum, int flags)
 {
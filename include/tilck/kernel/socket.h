@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/list.h>
+
+#include <sys/socket.h>   // system header
+
+#define UNIX_SOCK_BUF_SIZE    (16 * 1024)  /* stream sockets' receive buffer */
+#define UNIX_DGRAM_QUEUE_SIZE (16 * 1024)  /* max bytes queued on dgram socks */
+#define UNIX_MAX_BACKLOG              64   /* max pending connections */
+#define UNIX_SCM_MAX_FD               16   /* max fds in a SCM_RIGHTS message */
+
+/*
+ * File handles in flight, passed with SCM_RIGHTS. The handles are dup-ed from
+ * the sender's ones and installed in the receiver's handle table.
+ */
+struct unix_rights {
+
+   struct list_node node;
+   u64 pos;            /* stream sockets: position of the first byte */
+   int cnt;
+   fs_handle handles[UNIX_SCM_MAX_FD];
+};
+
+/* A send or a receive operation, with the data in a kernel buffer */
+struct unix_msg {
+
+   u8 *buf;
+   size_t len;
+   int flags;                     /* MSG_* flags */
+   int out_flags;                 /* MSG_TRUNC, MSG_CTRUNC on receive */
+
+   struct k_sockaddr_un *addr;    /* send: dest. (or NULL), recv: source */
+   int addr_len;
+
+   struct unix_rights *rights;    /* send: consumed if queued, recv: out */
+};
+
+bool is_unix_socket(fs_handle h);
+int unix_sock_type(fs_handle h);
+
+int unix_create(int type, int flags, fs_handle *out);
+int unix_socketpair(int type, int flags, fs_handle out[2]);
+int unix_bind(fs_handle h, const struct k_sockaddr_un *addr, int addr_len);
+int unix_connect(fs_handle h, const struct k_sockaddr_un *addr);
+int unix_listen(fs_handle h, int backlog);
+
+int
+unix_accept(fs_handle h,
+            int flags,
+            fs_handle *out,
+            struct k_sockaddr_un *peer_addr,
+            int *peer_addr_len);
+
+int
+unix_getname(fs_handle h,
+             bool peer,
+             struct k_sockaddr_un *addr,
+             int *addr_len);
+
+ssize_t unix_send(fs_handle h, struct unix_msg *m);
+ssize_t unix_recv(fs_handle h, struct unix_msg *m);
+int unix_shutdown(fs_handle h, int how);
+int unix_getsockopt(fs_handle h, int opt, int *val);
+
+struct unix_rights *unix_alloc_rights(void);
+void unix_free_rights(struct unix_rights *r);
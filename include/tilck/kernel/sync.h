@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #pragma once
+#include <tilck_gen_headers/config_debug.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/atomics.h>
@@ -19,7 +20,8 @@ enum wo_type {
    /* Special "meta-object" types */
 
    WOBJ_MWO_WAITER, /* struct multi_obj_waiter */
-   WOBJ_MWO_ELEM    /* a pointer to this wobj is castable to mwobj_elem */
+   WOBJ_MWO_ELEM,   /* a pointer to this wobj is castable to mwobj_elem */
+   WOBJ_KCOND_CB    /* a pointer to this wobj is castable to kcond_cb */
 };
 
 #define NO_EXTRA                 0
@@ -109,6 +111,20 @@ void mobj_waiter_set(struct multi_obj_waiter *w,
 
 void prepare_to_wait_on_multi_obj(struct multi_obj_waiter *w);
 
+#if KRN_LOCK_STATS
+
+/*
+ * Per-lock link to the stats of its lock class (see lock_stats.h), embedded
+ * in the kernel locks when KRN_LOCK_STATS is enabled.
+ */
+struct lock_stat {
+
+   struct lock_class *cls;       /* NULL until the first init/lock */
+   u64 acquired_at;              /* TSC of the last exclusive acquisition */
+};
+
+#endif
+
 /*
  * The semaphore implementation used for locking in kernel mode.
  */
@@ -118,6 +134,10 @@ struct ksem {
    int max;
    volatile int counter;
    struct list wait_list;
+
+#if KRN_LOCK_STATS
+   struct lock_stat ls;
+#endif
 };
 
 #define KSEM_NO_MAX                             -1
@@ -151,6 +171,10 @@ struct kmutex {
    u32 num_waiters;
    u32 max_num_waiters;
 #endif
+
+#if KRN_LOCK_STATS
+   struct lock_stat ls;
+#endif
 };
 
 #define STATIC_KMUTEX_INIT(m, fl)                 \
@@ -205,3 +229,23 @@ void kcond_signal_one(struct kcond *c);
 void kcond_signal_all(struct kcond *c);
 bool kcond_wait(struct kcond *c, struct kmutex *m, u32 timeout_ticks);
 bool kcond_is_anyone_waiting(struct kcond *c);
+
+/*
+ * Callback registered on a kcond's wait list, instead of a sleeping task.
+ * When the condition is signalled, `func` is called with preemption disabled
+ * and the callback stays registered until kcond_unregister_cb() is called.
+ * Used by objects like epoll, which need to know about state changes of many
+ * streams without having a task waiting on each of them.
+ */
+
+struct kcond_cb;
+typedef void (*kcond_cb_func)(struct kcond_cb *);
+
+struct kcond_cb {
+
+   struct wait_obj wobj;
+   kcond_cb_func func;
+};
+
+void kcond_register_cb(struct kcond *c, struct kcond_cb *cb, kcond_cb_func f);
+void kcond_unregister_cb(struct kcond_cb *cb);
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Per-syscall statistics, collected by handle_syscall() when the kernel has
+ * been booted with the `-sys_stats` option. The latencies are measured in TSC
+ * cycles, from the syscall entry to its exit: therefore, they include the time
+ * spent sleeping or waiting for other tasks. Syscalls that never return (e.g.
+ * a successful execve()) are not accounted.
+ *
+ * Log2 histogram: the bucket 0 counts the syscalls that took < 1 cycle (none,
+ * in practice), while the i-th bucket counts the ones that took a number of
+ * cycles in the range [2^(i-1), 2^i). The last bucket counts everything above.
+ */
+
+#define SYS_STATS_BUCKETS                             32
+
+struct syscall_stats {
+
+   u32 calls;
+   u32 errors;                   /* calls that returned -errno */
+   u64 tot_cycles;
+   u64 max_cycles;
+   u32 hist[SYS_STATS_BUCKETS];
+};
+
+/* Array of MAX_SYSCALLS elements, NULL when the stats are disabled */
+extern struct syscall_stats *sys_stats;
+
+/* Called by handle_syscall() with preemption disabled */
+void sys_stats_account(u32 sn, long rc, u64 cycles);
+
+void sys_stats_get(u32 sn, struct syscall_stats *s);
+void sys_stats_reset(void);
+
+/* Name of the syscall without the "sys_" prefix, or NULL */
+const char *sys_stats_get_name(u32 sn);
+
+void init_sys_stats(void);
@@ -115,6 +115,174 @@ struct k_timespec64 {
    long tv_nsec;
 };
 
+struct k_itimerspec32 {
+
+   struct k_timespec32 it_interval;
+   struct k_timespec32 it_value;
+};
+
+struct k_itimerspec64 {
+
+   struct k_timespec64 it_interval;
+   struct k_timespec64 it_value;
+};
+
+/*
+ * Argument of setitimer() and getitimer(). Like k_timeval, it suffers from the
+ * Y2038 bug on 32-bit systems.
+ */
+struct k_itimerval {
+
+   struct k_timeval it_interval;
+   struct k_timeval it_value;
+};
+
+/*
+ * The leading part of the sigevent struct, as seen by the Linux kernel. The
+ * user struct is padded to 64 bytes, but nothing after the thread ID is used.
+ */
+struct k_sigevent {
+
+   ulong sigev_value;
+   int sigev_signo;
+   int sigev_notify;
+   int sigev_notify_thread_id;             /* SIGEV_THREAD_ID only */
+};
+
+/*
+ * The record read from a signalfd, as defined by Linux. It's padded to 128
+ * bytes and has the same layout on all the architectures.
+ */
+struct k_signalfd_siginfo {
+
+   u32 ssi_signo;
+   s32 ssi_errno;
+   s32 ssi_code;
+   u32 ssi_pid;
+   u32 ssi_uid;
+   s32 ssi_fd;
+   u32 ssi_tid;
+   u32 ssi_band;
+   u32 ssi_overrun;
+   u32 ssi_trapno;
+   s32 ssi_status;
+   s32 ssi_int;
+   u64 ssi_ptr;
+   u64 ssi_utime;
+   u64 ssi_stime;
+   u64 ssi_addr;
+   u16 ssi_addr_lsb;
+   u16 __pad2;
+   s32 ssi_syscall;
+   u64 ssi_call_addr;
+   u32 ssi_arch;
+   u8 __pad[28];
+};
+
+STATIC_ASSERT(sizeof(struct k_signalfd_siginfo) == 128);
+
+/*
+ * Argument of clone3(). Newer kernels might add fields at the end: the user
+ * passes the size of the struct it knows.
+ */
+struct k_clone_args {
+
+   u64 flags;
+   u64 pidfd;
+   u64 child_tid;
+   u64 parent_tid;
+   u64 exit_signal;
+   u64 stack;
+   u64 stack_size;
+   u64 tls;
+   u64 set_tid;
+   u64 set_tid_size;
+   u64 cgroup;
+};
+
+#define CLONE_ARGS_SIZE_VER0                   64  /* up to `tls` */
+
+/*
+ * Socket structs, as seen by the Linux kernel. Note: glibc and libmusl define
+ * `struct msghdr` differently on 64-bit systems, while the kernel ABI always
+ * uses `long` for the lengths.
+ */
+struct k_sockaddr_un {
+
+   u16 sun_family;
+   char sun_path[108];
+};
+
+struct k_msghdr {
+
+   void *msg_name;
+   int msg_namelen;
+   struct iovec *msg_iov;
+   ulong msg_iovlen;
+   void *msg_control;
+   ulong msg_controllen;
+   u32 msg_flags;
+};
+
+struct k_cmsghdr {
+
+   ulong cmsg_len;
+   int cmsg_level;
+   int cmsg_type;
+};
+
+#define K_CMSG_ALIGN(len)   (((len) + sizeof(ulong) - 1) & ~(sizeof(ulong) - 1))
+#define K_CMSG_HDR_SIZE          K_CMSG_ALIGN(sizeof(struct k_cmsghdr))
+
+/*
+ * SysV IPC structs, in their IPC_64 version (the only one used by libmusl).
+ */
+struct k_ipc64_perm {
+
+   s32 key;
+   u32 uid;
+   u32 gid;
+   u32 cuid;
+   u32 cgid;
+#ifdef BITS32
+   u16 mode;
+   u16 __pad1;
+#else
+   u32 mode;
+#endif
+   u16 seq;
+   u16 __pad2;
+   ulong __unused1;
+   ulong __unused2;
+};
+
+struct k_shmid64_ds {
+
+   struct k_ipc64_perm shm_perm;
+   size_t shm_segsz;
+#ifdef BITS32
+   ulong shm_atime;
+   ulong shm_atime_high;
+   ulong shm_dtime;
+   ulong shm_dtime_high;
+   ulong shm_ctime;
+   ulong shm_ctime_high;
+#else
+   long shm_atime;
+   long shm_dtime;
+   long shm_ctime;
+#endif
+   s32 shm_cpid;
+   s32 shm_lpid;
+   ulong shm_nattch;
+   ulong __unused4;
+   ulong __unused5;
+};
+
+#ifdef BITS32
+   STATIC_ASSERT(sizeof(struct k_shmid64_ds) == 84);
+#endif
+
 #ifdef BITS32
 
 /*
@@ -199,6 +367,112 @@ struct k_stat64 {
    #define O_PATH __O_PATH
 #endif
 
+#ifndef SPLICE_F_MOVE
+   #define SPLICE_F_MOVE          1
+   #define SPLICE_F_NONBLOCK      2
+   #define SPLICE_F_MORE          4
+   #define SPLICE_F_GIFT          8
+#endif
+
+#ifndef FALLOC_FL_KEEP_SIZE
+   #define FALLOC_FL_KEEP_SIZE    1
+   #define FALLOC_FL_PUNCH_HOLE   2
+#endif
+
+#ifndef FUTEX_WAIT
+   #define FUTEX_WAIT                0
+   #define FUTEX_WAKE                1
+   #define FUTEX_FD                  2
+   #define FUTEX_REQUEUE             3
+   #define FUTEX_CMP_REQUEUE         4
+   #define FUTEX_WAKE_OP             5
+   #define FUTEX_WAIT_BITSET         9
+   #define FUTEX_WAKE_BITSET        10
+   #define FUTEX_PRIVATE_FLAG      128
+   #define FUTEX_CLOCK_REALTIME    256
+   #define FUTEX_CMD_MASK    (~(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME))
+   #define FUTEX_BITSET_MATCH_ANY  0xffffffff
+
+   #define FUTEX_OP_SET              0  /* *(int *)UADDR2 = OPARG;     */
+   #define FUTEX_OP_ADD              1  /* *(int *)UADDR2 += OPARG;    */
+   #define FUTEX_OP_OR               2  /* *(int *)UADDR2 |= OPARG;    */
+   #define FUTEX_OP_ANDN             3  /* *(int *)UADDR2 &= ~OPARG;   */
+   #define FUTEX_OP_XOR              4  /* *(int *)UADDR2 ^= OPARG;    */
+   #define FUTEX_OP_OPARG_SHIFT      8  /* Use (1 << OPARG) as OPARG   */
+
+   #define FUTEX_OP_CMP_EQ           0
+   #define FUTEX_OP_CMP_NE           1
+   #define FUTEX_OP_CMP_LT           2
+   #define FUTEX_OP_CMP_LE           3
+   #define FUTEX_OP_CMP_GT           4
+   #define FUTEX_OP_CMP_GE           5
+#endif
+
+#ifndef CLONE_VM
+   #define CSIGNAL                0x000000ff
+   #define CLONE_VM               0x00000100
+   #define CLONE_FS               0x00000200
+   #define CLONE_FILES            0x00000400
+   #define CLONE_SIGHAND          0x00000800
+   #define CLONE_PTRACE           0x00002000
+   #define CLONE_VFORK            0x00004000
+   #define CLONE_PARENT           0x00008000
+   #define CLONE_THREAD           0x00010000
+   #define CLONE_SYSVSEM          0x00040000
+   #define CLONE_SETTLS           0x00080000
+   #define CLONE_PARENT_SETTID    0x00100000
+   #define CLONE_CHILD_CLEARTID   0x00200000
+   #define CLONE_DETACHED         0x00400000
+   #define CLONE_CHILD_SETTID     0x01000000
+#endif
+
+#ifndef EFD_SEMAPHORE
+   #define EFD_SEMAPHORE          1
+   #define EFD_CLOEXEC            O_CLOEXEC
+   #define EFD_NONBLOCK           O_NONBLOCK
+#endif
+
+#ifndef TFD_TIMER_ABSTIME
+   #define TFD_TIMER_ABSTIME         1
+   #define TFD_TIMER_CANCEL_ON_SET   2
+   #define TFD_CLOEXEC               O_CLOEXEC
+   #define TFD_NONBLOCK              O_NONBLOCK
+#endif
+
+#ifndef SFD_CLOEXEC
+   #define SFD_CLOEXEC               O_CLOEXEC
+   #define SFD_NONBLOCK              O_NONBLOCK
+#endif
+
+#ifndef SIGEV_THREAD_ID
+   #define SIGEV_THREAD_ID           4
+#endif
+
+#ifndef F_SETPIPE_SZ
+   #define F_SETPIPE_SZ        1031
+   #define F_GETPIPE_SZ        1032
+#endif
+
+#ifndef F_ADD_SEALS
+   #define F_ADD_SEALS         1033
+   #define F_GET_SEALS         1034
+
+   #define F_SEAL_SEAL         0x0001  /* prevent adding further seals */
+   #define F_SEAL_SHRINK       0x0002  /* prevent file from shrinking */
+   #define F_SEAL_GROW         0x0004  /* prevent file from growing */
+   #define F_SEAL_WRITE        0x0008  /* prevent writes */
+#endif
+
+#ifndef F_SEAL_FUTURE_WRITE
+   #define F_SEAL_FUTURE_WRITE 0x0010  /* prevent future writes while mapped */
+#endif
+
+#ifndef MFD_CLOEXEC
+   #define MFD_CLOEXEC         0x0001
+   #define MFD_ALLOW_SEALING   0x0002
+   #define MFD_HUGETLB         0x0004
+#endif
+
 #define FCNTL_CHANGEABLE_FL (         \
    O_APPEND      |                    \
    O_ASYNC       |                    \
@@ -13,6 +13,8 @@
 
 #include <tilck/mods/tracing.h>
 
+struct epoll_event;
+
 #ifdef __SYSCALLS_C__
 
    #define CREATE_STUB_SYSCALL_IMPL(name)                          \
@@ -74,7 +76,7 @@ int sys_getuid16(void);
 
 CREATE_STUB_SYSCALL_IMPL(sys_stime32)
 CREATE_STUB_SYSCALL_IMPL(sys_ptrace)
-CREATE_STUB_SYSCALL_IMPL(sys_alarm)
+int sys_alarm(u32 seconds);
 CREATE_STUB_SYSCALL_IMPL(sys_oldfstat)
 
 int sys_pause(void);
@@ -174,8 +176,13 @@ CREATE_STUB_SYSCALL_IMPL(sys_ioperm)
 int sys_socketcall(int call, ulong *args);
 
 CREATE_STUB_SYSCALL_IMPL(sys_syslog)
-CREATE_STUB_SYSCALL_IMPL(sys_setitimer)
-CREATE_STUB_SYSCALL_IMPL(sys_getitimer)
+
+int sys_setitimer(int which,
+                  const struct k_itimerval *u_val,
+                  struct k_itimerval *u_old);
+
+int sys_getitimer(int which, struct k_itimerval *u_val);
+
 CREATE_STUB_SYSCALL_IMPL(sys_newstat)
 CREATE_STUB_SYSCALL_IMPL(sys_newlstat)
 CREATE_STUB_SYSCALL_IMPL(sys_newfstat)
@@ -188,12 +195,18 @@ int sys_wait4(int pid, int *u_wstatus, int options, void *u_rusage);
 
 CREATE_STUB_SYSCALL_IMPL(sys_swapoff)
 CREATE_STUB_SYSCALL_IMPL(sys_sysinfo)
-CREATE_STUB_SYSCALL_IMPL(sys_ipc)
+
+int
+sys_ipc(u32 call, int first, ulong second, ulong third, void *ptr, long fifth);
 
 int sys_fsync(int fd);
 CREATE_STUB_SYSCALL_IMPL(sys_sigreturn);
 
-CREATE_STUB_SYSCALL_IMPL(sys_clone)
+int sys_clone(ulong flags,
+              void *newsp,
+              int *parent_tid,
+              void *tls,
+              int *child_tid);
 CREATE_STUB_SYSCALL_IMPL(sys_setdomainname)
 
 int sys_newuname(struct utsname *buf);
@@ -292,7 +305,8 @@ int sys_getcwd(char *buf, size_t size);
 CREATE_STUB_SYSCALL_IMPL(sys_capget)
 CREATE_STUB_SYSCALL_IMPL(sys_capset)
 CREATE_STUB_SYSCALL_IMPL(sys_sigaltstack)
-CREATE_STUB_SYSCALL_IMPL(sys_sendfile)
+
+int sys_sendfile(int out_fd, int in_fd, long *u_offset, size_t count);
 
 int sys_vfork(void);
 
@@ -354,9 +368,12 @@ CREATE_STUB_SYSCALL_IMPL(sys_lremovexattr)
 CREATE_STUB_SYSCALL_IMPL(sys_fremovexattr)
 
 int sys_tkill(int tid, int sig);
+int sys_sendfile64(int out_fd, int in_fd, s64 *u_offset, size_t count);
+
+int sys_futex_time32(u32 *uaddr, int op, u32 val,
+                     const struct k_timespec32 *user_timeout,
+                     u32 *uaddr2, u32 val3);
 
-CREATE_STUB_SYSCALL_IMPL(sys_sendfile64)
-CREATE_STUB_SYSCALL_IMPL(sys_futex_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_sched_setaffinity)
 CREATE_STUB_SYSCALL_IMPL(sys_sched_getaffinity)
 
@@ -373,19 +390,30 @@ CREATE_STUB_SYSCALL_IMPL(sys_ia32_fadvise64)
 NORETURN int sys_exit_group(int status);
 
 CREATE_STUB_SYSCALL_IMPL(sys_lookup_dcookie)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_create)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_ctl)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_wait)
+
+int sys_epoll_create(int size);
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *u_event);
+int sys_epoll_wait(int epfd,
+                   struct epoll_event *u_events,
+                   int max,
+                   int timeout);
+
 CREATE_STUB_SYSCALL_IMPL(sys_remap_file_pages)
 
 // TODO: complete the implementation when thread creation is implemented.
 int sys_set_tid_address(int *tidptr);
 
-CREATE_STUB_SYSCALL_IMPL(sys_timer_create)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_settime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_gettime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_getoverrun)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_delete)
+int sys_timer_create(clockid_t clk, struct k_sigevent *u_sev, int *u_id);
+
+int sys_timer_settime32(int id,
+                        int flags,
+                        const struct k_itimerspec32 *u_val,
+                        struct k_itimerspec32 *u_old);
+
+int sys_timer_gettime32(int id, struct k_itimerspec32 *u_val);
+int sys_timer_getoverrun(int id);
+int sys_timer_delete(int id);
+
 CREATE_STUB_SYSCALL_IMPL(sys_clock_settime32)
 
 int sys_clock_gettime32(clockid_t clk_id, struct k_timespec32 *tp);
@@ -440,33 +468,57 @@ CREATE_STUB_SYSCALL_IMPL(sys_ppoll)
 CREATE_STUB_SYSCALL_IMPL(sys_unshare)
 CREATE_STUB_SYSCALL_IMPL(sys_set_robust_list)
 CREATE_STUB_SYSCALL_IMPL(sys_get_robust_list)
-CREATE_STUB_SYSCALL_IMPL(sys_splice)
+
+int sys_splice(int fd_in, s64 *u_off_in, int fd_out, s64 *u_off_out,
+               size_t len, u32 flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_ia32_sync_file_range)
-CREATE_STUB_SYSCALL_IMPL(sys_tee)
-CREATE_STUB_SYSCALL_IMPL(sys_vmsplice)
+
+int sys_tee(int fd_in, int fd_out, size_t len, u32 flags);
+int sys_vmsplice(int fd, const struct iovec *u_iov, int nr_segs, u32 flags);
+int sys_copy_file_range(int fd_in, s64 *u_off_in, int fd_out, s64 *u_off_out,
+                        size_t len, u32 flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_move_pages)
 CREATE_STUB_SYSCALL_IMPL(sys_getcpu)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_pwait)
+
+int sys_epoll_pwait(int epfd,
+                    struct epoll_event *u_events,
+                    int max,
+                    int timeout,
+                    const sigset_t *u_mask,
+                    size_t sigsetsize);
 
 int sys_utimensat_time32(int dirfd, const char *u_path,
                          const struct k_timespec32 times[2], int flags);
 
-CREATE_STUB_SYSCALL_IMPL(sys_signalfd)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_create)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd)
-CREATE_STUB_SYSCALL_IMPL(sys_fallocate)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime32)
-CREATE_STUB_SYSCALL_IMPL(sys_signalfd4)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd2)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_create1)
+int sys_signalfd(int fd, const sigset_t *u_mask, size_t sizemask);
+int sys_timerfd_create(int clk, int flags);
+int sys_eventfd(u32 initval);
+int sys_fallocate(int fd, int mode, s64 offset, s64 len);
+
+int sys_timerfd_settime32(int fd,
+                          int flags,
+                          const struct k_itimerspec32 *u_val,
+                          struct k_itimerspec32 *u_old);
+
+int sys_timerfd_gettime32(int fd, struct k_itimerspec32 *u_val);
+
+int sys_signalfd4(int fd, const sigset_t *u_mask, size_t sizemask, int flags);
+int sys_eventfd2(u32 initval, int flags);
+int sys_epoll_create1(int flags);
 CREATE_STUB_SYSCALL_IMPL(sys_dup3)
 
 int sys_pipe2(int u_pipefd[2], int flags);
 
 CREATE_STUB_SYSCALL_IMPL(sys_inotify_init1)
-CREATE_STUB_SYSCALL_IMPL(sys_preadv)
-CREATE_STUB_SYSCALL_IMPL(sys_pwritev)
+
+int sys_preadv(int fd, const struct iovec *iov, int iovcnt,
+               ulong pos_l, ulong pos_h);
+
+int sys_pwritev(int fd, const struct iovec *iov, int iovcnt,
+                ulong pos_l, ulong pos_h);
+
 CREATE_STUB_SYSCALL_IMPL(sys_rt_tgsigqueueinfo)
 CREATE_STUB_SYSCALL_IMPL(sys_perf_event_open)
 CREATE_STUB_SYSCALL_IMPL(sys_recvmmsg_time32)
@@ -491,28 +543,42 @@ CREATE_STUB_SYSCALL_IMPL(sys_sched_getattr)
 CREATE_STUB_SYSCALL_IMPL(sys_renameat2)
 CREATE_STUB_SYSCALL_IMPL(sys_seccomp)
 CREATE_STUB_SYSCALL_IMPL(sys_getrandom)
-CREATE_STUB_SYSCALL_IMPL(sys_memfd_create)
+
+int sys_memfd_create(const char *u_name, u32 flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_bpf)
 CREATE_STUB_SYSCALL_IMPL(sys_execveat)
-CREATE_STUB_SYSCALL_IMPL(sys_socket)
-CREATE_STUB_SYSCALL_IMPL(sys_socketpair)
-CREATE_STUB_SYSCALL_IMPL(sys_bind)
-CREATE_STUB_SYSCALL_IMPL(sys_connect)
-CREATE_STUB_SYSCALL_IMPL(sys_listen)
-CREATE_STUB_SYSCALL_IMPL(sys_accept4)
-CREATE_STUB_SYSCALL_IMPL(sys_getsockopt)
-CREATE_STUB_SYSCALL_IMPL(sys_setsockopt)
-CREATE_STUB_SYSCALL_IMPL(sys_getsockname)
-CREATE_STUB_SYSCALL_IMPL(sys_getpeername)
-CREATE_STUB_SYSCALL_IMPL(sys_sendto)
-CREATE_STUB_SYSCALL_IMPL(sys_sendmsg)
-CREATE_STUB_SYSCALL_IMPL(sys_recvfrom)
-CREATE_STUB_SYSCALL_IMPL(sys_recvmsg)
-CREATE_STUB_SYSCALL_IMPL(sys_shutdown)
+
+int sys_socket(int family, int type, int protocol);
+int sys_socketpair(int family, int type, int protocol, int u_sv[2]);
+int sys_bind(int fd, const void *u_addr, int addrlen);
+int sys_connect(int fd, const void *u_addr, int addrlen);
+int sys_listen(int fd, int backlog);
+int sys_accept4(int fd, void *u_addr, int *u_addrlen, int flags);
+
+int sys_getsockopt(int fd, int level, int optname,
+                   void *u_optval, int *u_optlen);
+
+int sys_setsockopt(int fd, int level, int optname,
+                   const void *u_optval, int optlen);
+
+int sys_getsockname(int fd, void *u_addr, int *u_addrlen);
+int sys_getpeername(int fd, void *u_addr, int *u_addrlen);
+
+int sys_sendto(int fd, const void *u_buf, size_t len, int flags,
+               const void *u_addr, int addrlen);
+
+int sys_sendmsg(int fd, const struct k_msghdr *u_msg, int flags);
+
+int sys_recvfrom(int fd, void *u_buf, size_t len, int flags,
+                 void *u_addr, int *u_addrlen);
+
+int sys_recvmsg(int fd, struct k_msghdr *u_msg, int flags);
+int sys_shutdown(int fd, int how);
+
 CREATE_STUB_SYSCALL_IMPL(sys_userfaultfd)
 CREATE_STUB_SYSCALL_IMPL(sys_membarrier)
 CREATE_STUB_SYSCALL_IMPL(sys_mlock2)
-CREATE_STUB_SYSCALL_IMPL(sys_copy_file_range)
 CREATE_STUB_SYSCALL_IMPL(sys_preadv2)
 CREATE_STUB_SYSCALL_IMPL(sys_pwritev2)
 CREATE_STUB_SYSCALL_IMPL(sys_pkey_mprotect)
@@ -525,10 +591,12 @@ CREATE_STUB_SYSCALL_IMPL(sys_rseq)
 
 CREATE_STUB_SYSCALL_IMPL(sys_semget)
 CREATE_STUB_SYSCALL_IMPL(sys_semctl)
-CREATE_STUB_SYSCALL_IMPL(sys_shmget)
-CREATE_STUB_SYSCALL_IMPL(sys_shmctl)
-CREATE_STUB_SYSCALL_IMPL(sys_shmat)
-CREATE_STUB_SYSCALL_IMPL(sys_shmdt)
+
+int sys_shmget(key_t key, size_t size, int shmflg);
+int sys_shmctl(int shmid, int cmd, struct k_shmid64_ds *u_buf);
+long sys_shmat(int shmid, void *u_addr, int shmflg);
+int sys_shmdt(const void *u_addr);
+
 CREATE_STUB_SYSCALL_IMPL(sys_msgget)
 CREATE_STUB_SYSCALL_IMPL(sys_msgsnd)
 CREATE_STUB_SYSCALL_IMPL(sys_msgrcv)
@@ -542,10 +610,21 @@ CREATE_STUB_SYSCALL_IMPL(sys_clock_adjtime)
 int sys_clock_getres(clockid_t clk_id, struct k_timespec64 *user_res);
 
 CREATE_STUB_SYSCALL_IMPL(sys_clock_nanosleep)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_gettime)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_settime)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime)
+
+int sys_timer_gettime(int id, struct k_itimerspec64 *u_val);
+
+int sys_timer_settime(int id,
+                      int flags,
+                      const struct k_itimerspec64 *u_val,
+                      struct k_itimerspec64 *u_old);
+
+int sys_timerfd_gettime(int fd, struct k_itimerspec64 *u_val);
+
+int sys_timerfd_settime(int fd,
+                        int flags,
+                        const struct k_itimerspec64 *u_val,
+                        struct k_itimerspec64 *u_old);
+
 CREATE_STUB_SYSCALL_IMPL(sys_utimensat)
 CREATE_STUB_SYSCALL_IMPL(sys_pselect6_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_ppoll_time32)
@@ -555,7 +634,11 @@ CREATE_STUB_SYSCALL_IMPL(sys_mq_timedsend)
 CREATE_STUB_SYSCALL_IMPL(sys_mq_timedreceive)
 CREATE_STUB_SYSCALL_IMPL(sys_semtimedop)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigtimedwait)
-CREATE_STUB_SYSCALL_IMPL(sys_futex)
+
+int sys_futex(u32 *uaddr, int op, u32 val,
+              const struct k_timespec64 *user_timeout,
+              u32 *uaddr2, u32 val3);
+
 CREATE_STUB_SYSCALL_IMPL(sys_sched_rr_get_interval)
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_send_signal)
 CREATE_STUB_SYSCALL_IMPL(sys_io_uring_setup)
@@ -568,7 +651,7 @@ CREATE_STUB_SYSCALL_IMPL(sys_fsconfig)
 CREATE_STUB_SYSCALL_IMPL(sys_fsmount)
 CREATE_STUB_SYSCALL_IMPL(sys_fspick)
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_open)
-CREATE_STUB_SYSCALL_IMPL(sys_clone3)
+int sys_clone3(struct k_clone_args *user_args, size_t size);
 CREATE_STUB_SYSCALL_IMPL(sys_close_range)
 CREATE_STUB_SYSCALL_IMPL(sys_openat2)
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_getfd)
@@ -3,6 +3,7 @@
 #pragma once
 #include <tilck_gen_headers/config_sched.h>
 #include <tilck/common/basic_defs.h>
+#include <tilck/kernel/list.h>
 
 void kernel_sleep(u64 ticks);  /* sleep for `ticks` timer ticks (jiffies) */
 void kernel_sleep_ms(u64 ms);  /* sleep for `ms` milliseconds */
@@ -16,3 +17,50 @@ ms_to_ticks(u64 ms)
 
 u64 get_ticks(void);
 void init_timer(void);
+
+/*
+ * Kernel timers: unlike the per-task wakeup timer, they don't need a sleeping
+ * task. Armed timers are kept in a list sorted by expiration time, so that the
+ * timer IRQ handler has to look only at its head. When a timer expires, the
+ * IRQ handler just counts the expiration, re-arms the timer if it's periodic
+ * and queues it for the `ktimers` worker thread, which later calls `func` with
+ * the number of expirations since its last call, with preemption enabled.
+ */
+
+struct ktimer;
+typedef void (*ktimer_func)(struct ktimer *t, u64 expirations);
+
+struct ktimer {
+
+   struct list_node node;        /* node in the armed timers list */
+   struct list_node exp_node;    /* node in the expired timers list */
+   u64 expire;                   /* absolute expiration time, in ticks */
+   u64 interval;                 /* re-arm period in ticks, 0 for one-shot */
+   u64 count;                    /* expirations not passed to `func` yet */
+   ktimer_func func;             /* can be NULL */
+   bool armed;
+   bool running;                 /* `func` is running right now */
+};
+
+struct k_itimerspec64;
+
+void ktimer_init(struct ktimer *t, ktimer_func func);
+void ktimer_start(struct ktimer *t, u64 expire, u64 interval);
+void ktimer_stop(struct ktimer *t);
+bool ktimer_get(struct ktimer *t, u64 *rem, u64 *interval);
+
+/* Stop the timer and wait for its `func` to return, if it's running */
+void ktimer_destroy(struct ktimer *t);
+
+/*
+ * Helpers for the POSIX-like interfaces (timerfd, timer_settime): arm or
+ * disarm the timer as described by `val` on the `clk` clock and return its
+ * previous value in `old`, if not NULL.
+ */
+int ktimer_settime(struct ktimer *t,
+                   int clk,
+                   bool abs_time,
+                   const struct k_itimerspec64 *val,
+                   struct k_itimerspec64 *old);
+
+void ktimer_gettime(struct ktimer *t, struct k_itimerspec64 *val);
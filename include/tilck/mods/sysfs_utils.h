@@ -104,6 +104,29 @@
 #define SYSOBJ_CONF_PROP_PAIR(name)                                       \
    &prop_##name, &conf_##name
 
+/*
+ * Helpers for the files listing a variable number of objects (e.g. tasks),
+ * entirely loaded at open (see get_buf_sz): their size is computed before
+ * loading them and, in the meanwhile, new objects might appear. Therefore,
+ * get_buf_sz() leaves room for SYSFS_LINES_SLACK lines more than the current
+ * content (`sz` bytes) and load() stops adding lines when one more might not
+ * fit anymore.
+ */
+
+#define SYSFS_LINES_SLACK                                         16
+
+static ALWAYS_INLINE offt
+sysfs_buf_sz_with_slack(size_t sz, size_t line_max)
+{
+   return (offt)(sz + SYSFS_LINES_SLACK * line_max);
+}
+
+static ALWAYS_INLINE bool
+sysfs_buf_has_room(size_t buf_sz, size_t used, size_t line_max)
+{
+   return buf_sz - used >= line_max;
+}
+
 /* Common property types */
 
 struct sysfs_buffer {
@@ -116,6 +139,7 @@ extern const struct sysobj_prop_type sysobj_ptype_ro_string_literal;
 extern const struct sysobj_prop_type sysobj_ptype_ro_ulong_literal;
 extern const struct sysobj_prop_type sysobj_ptype_ro_ulong_hex_literal;
 extern const struct sysobj_prop_type sysobj_ptype_ulong;
+extern const struct sysobj_prop_type sysobj_ptype_rw_ulong;
 extern const struct sysobj_prop_type sysobj_ptype_ro_ulong;
 extern const struct sysobj_prop_type sysobj_ptype_long;
 extern const struct sysobj_prop_type sysobj_ptype_ro_long;
@@ -9,6 +9,13 @@
 #define NO_SLOT                           -1
 #define TRACED_SYSCALLS_STR_LEN         128u
 
+/*
+ * Max time the readers wait in read_trace_event() before checking again the
+ * buffers: it's also the max delay of the scheduler events, which do not wake
+ * up the readers (see enqueue_sched_event()).
+ */
+#define TRACE_READ_TIMEOUT_MS            50
+
 enum trace_event_type {
    te_invalid,
    te_sys_enter,
@@ -16,6 +23,11 @@ enum trace_event_type {
    te_printk,
    te_signal_delivered,
    te_killed,
+   te_sched_switch,
+   te_sched_wakeup,
+   te_timer_wakeup,
+   te_wth_job_start,
+   te_wth_job_end,
 };
 
 struct syscall_event_data {
@@ -50,6 +62,13 @@ struct signal_event_data {
    int signum;
 };
 
+struct sched_event_data {
+   int other_tid;  /* switch: the next task. wakeup: the waker (0 in IRQs) */
+   int state;      /* switch: state of the previous task */
+   ulong func;     /* wth jobs: the job function */
+   ulong arg;      /* wth jobs: its argument */
+};
+
 struct trace_event {
 
    enum trace_event_type type;
@@ -61,6 +80,7 @@ struct trace_event {
       struct syscall_event_data sys_ev;
       struct printk_event_data p_ev;
       struct signal_event_data sig_ev;
+      struct sched_event_data sched_ev;
    };
 };
 
@@ -150,6 +170,9 @@ struct syscall_info {
 void
 init_tracing(void);
 
+void
+init_tracing_dev(void);
+
 bool
 read_trace_event(struct trace_event *e, u32 timeout_ticks);
 
@@ -183,6 +206,15 @@ trace_signal_delivered_int(int target_tid, int signum);
 void
 trace_task_killed_int(int signum);
 
+void
+trace_sched_switch_int(struct task *prev, struct task *next);
+
+void
+trace_sched_wakeup_int(struct task *ti, bool timer);
+
+void
+trace_wth_job_int(bool start, void *func, void *arg);
+
 const char *
 tracing_get_syscall_name(u32 n);
 
@@ -220,6 +252,10 @@ set_traced_syscalls(const char *str);
 int
 tracing_get_in_buffer_events_count(void);
 
+/* Events lost since boot because a tracing buffer was full */
+u32
+tracing_get_dropped_events_count(void);
+
 extern const struct syscall_info *tracing_metadata;
 extern const struct sys_param_type ptype_int;
 extern const struct sys_param_type ptype_voidp;
@@ -341,3 +377,33 @@ tracing_set_printk_lvl(int lvl)
    if (MOD_tracing && UNLIKELY(tracing_is_enabled())) {                        \
       trace_task_killed_int(signum);                                           \
    }
+
+#define trace_sched_switch(prev, next)                                         \
+   if (MOD_tracing && UNLIKELY(tracing_is_enabled())) {                        \
+      if (UNLIKELY((prev)->traced || (next)->traced))                          \
+         trace_sched_switch_int(prev, next);                                   \
+   }
+
+#define trace_sched_wakeup(ti)                                                 \
+   if (MOD_tracing && UNLIKELY(tracing_is_enabled())) {                        \
+      if (UNLIKELY((ti)->traced))                                              \
+         trace_sched_wakeup_int(ti, false);                                    \
+   }
+
+#define trace_timer_wakeup(ti)                                                 \
+   if (MOD_tracing && UNLIKELY(tracing_is_enabled())) {                        \
+      if (UNLIKELY((ti)->traced))                                              \
+         trace_sched_wakeup_int(ti, true);                                     \
+   }
+
+#define trace_wth_job_start(func, arg)                                         \
+   if (MOD_tracing && UNLIKELY(tracing_is_enabled())) {                        \
+      if (UNLIKELY(get_curr_task()->traced))                                   \
+         trace_wth_job_int(true, func, arg);                                   \
+   }
+
+#define trace_wth_job_end(func, arg)                                           \
+   if (MOD_tracing && UNLIKELY(tracing_is_enabled())) {                        \
+      if (UNLIKELY(get_curr_task()->traced))                                   \
+         trace_wth_job_int(false, func, arg);                                  \
+   }
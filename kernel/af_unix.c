@@ -0,0 +1,1266 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/socket.h>
+
+/*
+ * AF_UNIX sockets, stream and datagram.
+ *
+ * Stream sockets work like a pair of pipes: each end has its own receive
+ * buffer (a byte ring buffer) and two conditions, `rcond` for the readers
+ * and `wcond` for the writers of the *other* end, waiting for space in the
+ * buffer. Datagram sockets have a queue of messages instead.
+ *
+ * poll() and epoll, instead, wait for a socket to become writable on its own
+ * `wcond`, because they pick the condition once and the socket might not be
+ * connected yet. Therefore, when a receive buffer drains, the own `wcond` of
+ * the sockets writing to it is signaled too (see unix_signal_writers()).
+ *
+ * Binding a socket creates a socket node (S_IFSOCK) in the file system: the
+ * bound sockets are found by (st_dev, st_ino) of their node, which stay
+ * unique even after the node is unlinked. Only sockets with open handles can
+ * be found: the registry does not retain them.
+ *
+ * The whole state of all the sockets is protected by a single mutex. Each
+ * socket is retained by its handles, by its connected peer and, while waiting
+ * to be accepted, by the accept queue of the listening socket.
+ */
+
+enum unix_state {
+
+   US_UNCONNECTED,
+   US_LISTENING,
+   US_CONNECTED,
+};
+
+struct unix_dgram {
+
+   struct list_node node;
+   struct unix_rights *rights;
+   struct k_sockaddr_un from;
+   int from_len;
+   size_t len;
+   u8 data[];
+};
+
+struct unix_sock {
+
+   KOBJ_BASE_FIELDS
+
+   int type;                        /* SOCK_STREAM or SOCK_DGRAM */
+   enum unix_state state;
+   int handles;                     /* open file handles */
+
+   bool dead;                       /* all the handles have been closed */
+   bool peer_closed;                /* the peer closed all its handles */
+   bool shut_rd;
+   bool shut_wr;
+
+   struct unix_sock *peer;          /* retained */
+
+   /* Datagram sockets: the sockets connected to us (and socketpair peer) */
+   struct list senders;
+   struct list_node sender_node;
+
+   /* Local address: set by bind() or, for accepted sockets, by connect() */
+   struct k_sockaddr_un addr;
+   int addr_len;
+
+   /* Bound sockets */
+   bool bound;
+   u64 b_dev;
+   u64 b_ino;
+   struct list_node bound_node;
+
+   /* Listening sockets */
+   struct list accept_q;
+   struct list_node accept_node;
+   int backlog;
+   int pending;
+
+   /* Stream sockets: received data */
+   struct ringbuf rb;
+   u64 rx_written;                  /* total bytes written in `rb` */
+   u64 rx_read;                     /* total bytes read from `rb` */
+   struct list rights_q;
+
+   /* Datagram sockets: received messages */
+   struct list dgram_q;
+   size_t dgram_bytes;
+
+   struct kcond rcond;              /* data, connections or hang-up */
+   struct kcond wcond;              /* space in the receive buffer */
+};
+
+static struct kmutex unix_mutex = STATIC_KMUTEX_INIT(unix_mutex, 0);
+static struct list bound_list = STATIC_LIST_INIT(bound_list);
+
+STATIC_ASSERT(SOCK_NONBLOCK == O_NONBLOCK);
+
+static const struct file_ops static_ops_unix_sock;
+
+static ALWAYS_INLINE struct unix_sock *to_sock(fs_handle h)
+{
+   return (void *)((struct kfs_handle *)h)->kobj;
+}
+
+static ALWAYS_INLINE bool is_nonblock(fs_handle h, int flags)
+{
+   struct kfs_handle *kh = h;
+   return (kh->fl_flags & O_NONBLOCK) || (flags & MSG_DONTWAIT);
+}
+
+bool is_unix_socket(fs_handle h)
+{
+   struct fs_handle_base *hb = h;
+   return hb->fops == &static_ops_unix_sock;
+}
+
+int unix_sock_type(fs_handle h)
+{
+   return to_sock(h)->type;
+}
+
+struct unix_rights *unix_alloc_rights(void)
+{
+   struct unix_rights *r;
+
+   if ((r = kzalloc_obj(struct unix_rights)))
+      list_node_init(&r->node);
+
+   return r;
+}
+
+void unix_free_rights(struct unix_rights *r)
+{
+   if (!r)
+      return;
+
+   for (int i = 0; i < r->cnt; i++) {
+      if (r->handles[i])
+         vfs_close(r->handles[i]);
+   }
+
+   kfree_obj(r, struct unix_rights);
+}
+
+static void unix_free_rights_list(struct list *l)
+{
+   struct unix_rights *r, *tmp;
+
+   list_for_each(r, tmp, l, node) {
+      list_remove(&r->node);
+      unix_free_rights(r);
+   }
+}
+
+static void unix_destroy_sock(struct unix_sock *s)
+{
+   ASSERT(!s->peer);
+   ASSERT(!s->bound);
+   ASSERT(list_is_empty(&s->accept_q));
+   ASSERT(list_is_empty(&s->rights_q));
+   ASSERT(list_is_empty(&s->dgram_q));
+   ASSERT(list_is_empty(&s->senders));
+
+   if (s->rb.buf)
+      kfree2(s->rb.buf, UNIX_SOCK_BUF_SIZE);
+
+   ringbuf_destory(&s->rb);
+   kcond_destory(&s->wcond);
+   kcond_destory(&s->rcond);
+   kfree_obj(s, struct unix_sock);
+}
+
+static void unix_release(struct unix_sock *s)
+{
+   if (!release_obj(s))
+      unix_destroy_sock(s);
+}
+
+/*
+ * Called when there's more room in the receive buffer (or queue) of `s`, or
+ * when `s` dies: wake up both the blocked writers and the pollers of the
+ * sockets writing to `s`.
+ */
+static void unix_signal_writers(struct unix_sock *s)
+{
+   struct unix_sock *w, *tmp;
+
+   kcond_signal_all(&s->wcond);
+
+   if (s->type == SOCK_STREAM) {
+
+      if (s->peer)
+         kcond_signal_all(&s->peer->wcond);
+
+   } else {
+
+      list_for_each(w, tmp, &s->senders, sender_node)
+         kcond_signal_all(&w->wcond);
+   }
+}
+
+/*
+ * Called when the last handle of `s` is closed: hang up the peer and the
+ * pending connections and unbind. The in-flight file handles are moved to
+ * `dead_rights` and must be closed by the caller, after releasing the lock.
+ */
+static void unix_sock_close(struct unix_sock *s, struct list *dead_rights)
+{
+   struct unix_sock *n, *ntmp;
+   struct unix_dgram *m, *mtmp;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&unix_mutex));
+
+   s->dead = true;
+
+   if (s->bound) {
+      list_remove(&s->bound_node);
+      s->bound = false;
+   }
+
+   list_for_each(n, ntmp, &s->accept_q, accept_node) {
+      list_remove(&n->accept_node);
+      unix_sock_close(n, dead_rights);
+      unix_release(n);
+   }
+
+   s->pending = 0;
+
+   if (s->peer) {
+
+      struct unix_sock *p = s->peer;
+
+      if (s->type == SOCK_DGRAM)
+         list_remove(&s->sender_node);
+
+      if (p->peer == s) {
+         p->peer_closed = true;
+         kcond_signal_all(&p->rcond);
+         kcond_signal_all(&p->wcond);
+      }
+
+      s->peer = NULL;
+      unix_release(p);
+   }
+
+   list_for_each(m, mtmp, &s->dgram_q, node) {
+
+      list_remove(&m->node);
+
+      if (m->rights)
+         list_add_tail(dead_rights, &m->rights->node);
+
+      kfree2(m, sizeof(struct unix_dgram) + m->len);
+   }
+
+   while (!list_is_empty(&s->rights_q)) {
+      struct unix_rights *r;
+      r = list_first_obj(&s->rights_q, struct unix_rights, node);
+      list_remove(&r->node);
+      list_add_tail(dead_rights, &r->node);
+   }
+
+   s->dgram_bytes = 0;
+   kcond_signal_all(&s->rcond);
+   unix_signal_writers(s);
+}
+
+static void unix_on_handle_dup(fs_handle h)
+{
+   kmutex_lock(&unix_mutex);
+   {
+      to_sock(h)->handles++;
+   }
+   kmutex_unlock(&unix_mutex);
+}
+
+static void unix_on_handle_close(fs_handle h)
+{
+   struct unix_sock *s = to_sock(h);
+   struct list dead_rights;
+
+   list_init(&dead_rights);
+
+   kmutex_lock(&unix_mutex);
+   {
+      ASSERT(s->handles > 0);
+
+      if (!--s->handles)
+         unix_sock_close(s, &dead_rights);
+   }
+   kmutex_unlock(&unix_mutex);
+
+   /* Closing the handles might close other sockets: do it without the lock */
+   unix_free_rights_list(&dead_rights);
+}
+
+static struct unix_sock *unix_create_sock(int type)
+{
+   struct unix_sock *s;
+   void *buf = NULL;
+
+   if (type == SOCK_STREAM) {
+      if (!(buf = kmalloc(UNIX_SOCK_BUF_SIZE)))
+         return NULL;
+   }
+
+   if (!(s = (void *)kzalloc_obj(struct unix_sock))) {
+
+      if (buf)
+         kfree2(buf, UNIX_SOCK_BUF_SIZE);
+
+      return NULL;
+   }
+
+   s->destory_obj = (void *)&unix_destroy_sock;
+   s->on_handle_close = &unix_on_handle_close;
+   s->on_handle_dup = &unix_on_handle_dup;
+   s->type = type;
+   s->state = US_UNCONNECTED;
+   list_node_init(&s->bound_node);
+   list_node_init(&s->accept_node);
+   list_init(&s->accept_q);
+   list_init(&s->rights_q);
+   list_init(&s->dgram_q);
+   list_init(&s->senders);
+   list_node_init(&s->sender_node);
+   kcond_init(&s->rcond);
+   kcond_init(&s->wcond);
+
+   if (buf)
+      ringbuf_init(&s->rb, UNIX_SOCK_BUF_SIZE, 1, buf);
+
+   return s;
+}
+
+static fs_handle unix_new_handle(struct unix_sock *s, int flags)
+{
+   fs_handle h;
+
+   h = kfs_create_new_handle(&static_ops_unix_sock,
+                             (void *)s,
+                             O_RDWR | (flags & SOCK_NONBLOCK));
+
+   if (h) {
+      kmutex_lock(&unix_mutex);
+      {
+         s->handles++;
+      }
+      kmutex_unlock(&unix_mutex);
+   }
+
+   return h;
+}
+
+static void unix_connect_pair(struct unix_sock *a, struct unix_sock *b)
+{
+   a->peer = b;
+   b->peer = a;
+   retain_obj(a);
+   retain_obj(b);
+   a->state = US_CONNECTED;
+   b->state = US_CONNECTED;
+
+   if (a->type == SOCK_DGRAM) {
+      /* Each end sends to the other one: see unix_dgram_connect() */
+      list_add_tail(&b->senders, &a->sender_node);
+      list_add_tail(&a->senders, &b->sender_node);
+   }
+}
+
+int unix_create(int type, int flags, fs_handle *out)
+{
+   struct unix_sock *s;
+   fs_handle h;
+
+   if (type != SOCK_STREAM && type != SOCK_DGRAM)
+      return -EINVAL;
+
+   if (!(s = unix_create_sock(type)))
+      return -ENOMEM;
+
+   if (!(h = unix_new_handle(s, flags))) {
+      unix_destroy_sock(s);
+      return -ENOMEM;
+   }
+
+   *out = h;
+   return 0;
+}
+
+int unix_socketpair(int type, int flags, fs_handle out[2])
+{
+   struct unix_sock *a, *b;
+   int rc;
+
+   if ((rc = unix_create(type, flags, &out[0])))
+      return rc;
+
+   if ((rc = unix_create(type, flags, &out[1]))) {
+      vfs_close(out[0]);
+      return rc;
+   }
+
+   a = to_sock(out[0]);
+   b = to_sock(out[1]);
+
+   kmutex_lock(&unix_mutex);
+   {
+      unix_connect_pair(a, b);
+   }
+   kmutex_unlock(&unix_mutex);
+   return 0;
+}
+
+int unix_bind(fs_handle h, const struct k_sockaddr_un *addr, int addr_len)
+{
+   struct unix_sock *s = to_sock(h);
+   const char *path = addr->sun_path;
+   struct k_stat64 st;
+   int rc;
+
+   kmutex_lock(&unix_mutex);
+   {
+      rc = s->addr_len ? -EINVAL : 0;
+   }
+   kmutex_unlock(&unix_mutex);
+
+   if (rc)
+      return rc;
+
+   rc = vfs_mknod(path, S_IFSOCK | (0777 & ~get_curr_proc()->umask));
+
+   if (rc)
+      return rc == -EEXIST ? -EADDRINUSE : rc;
+
+   if ((rc = vfs_stat64(path, &st, true)))
+      return rc;
+
+   kmutex_lock(&unix_mutex);
+
+   if (s->addr_len) {
+      /* Another thread bound the socket in the meanwhile */
+      kmutex_unlock(&unix_mutex);
+      vfs_unlink(path);
+      return -EINVAL;
+   }
+
+   s->addr = *addr;
+   s->addr_len = addr_len;
+   s->b_dev = st.st_dev;
+   s->b_ino = st.st_ino;
+   s->bound = true;
+   list_add_tail(&bound_list, &s->bound_node);
+
+   kmutex_unlock(&unix_mutex);
+   return 0;
+}
+
+/* Find the socket bound to `path` and retain it */
+static int unix_find(const char *path, struct unix_sock **out)
+{
+   struct unix_sock *pos, *s = NULL;
+   struct k_stat64 st;
+   int rc;
+
+   if ((rc = vfs_stat64(path, &st, true)))
+      return rc;
+
+   if (!S_ISSOCK(st.st_mode))
+      return -ECONNREFUSED;
+
+   kmutex_lock(&unix_mutex);
+   {
+      list_for_each_ro(pos, &bound_list, bound_node) {
+         if (pos->b_dev == st.st_dev && pos->b_ino == st.st_ino) {
+            s = pos;
+            retain_obj(s);
+            break;
+         }
+      }
+   }
+   kmutex_unlock(&unix_mutex);
+
+   if (!s)
+      return -ECONNREFUSED;
+
+   *out = s;
+   return 0;
+}
+
+static int
+unix_stream_connect(struct unix_sock *c, struct unix_sock *t, bool nonblock)
+{
+   struct unix_sock *n;
+   int rc = 0;
+
+   /* The server-side socket, to be returned by accept() */
+   if (!(n = unix_create_sock(SOCK_STREAM)))
+      return -ENOMEM;
+
+   kmutex_lock(&unix_mutex);
+
+   while (true) {
+
+      if (c->state == US_CONNECTED) {
+         rc = -EISCONN;
+         break;
+      }
+
+      if (c->state == US_LISTENING) {
+         rc = -EINVAL;
+         break;
+      }
+
+      if (t->type != SOCK_STREAM) {
+         rc = -EPROTOTYPE;
+         break;
+      }
+
+      if (t->dead || t->state != US_LISTENING) {
+         rc = -ECONNREFUSED;
+         break;
+      }
+
+      if (t->pending < t->backlog)
+         break;
+
+      if (nonblock) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      /* Wait for accept() to make room in the backlog */
+      kcond_wait(&t->wcond, &unix_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   if (!rc) {
+
+      n->addr = t->addr;
+      n->addr_len = t->addr_len;
+      unix_connect_pair(c, n);
+
+      retain_obj(n);
+      list_add_tail(&t->accept_q, &n->accept_node);
+      t->pending++;
+
+      kcond_signal_all(&t->rcond);
+      kcond_signal_all(&c->wcond);
+   }
+
+   kmutex_unlock(&unix_mutex);
+
+   if (rc)
+      unix_destroy_sock(n);
+
+   return rc;
+}
+
+static int unix_dgram_connect(struct unix_sock *s, struct unix_sock *t)
+{
+   int rc = 0;
+
+   kmutex_lock(&unix_mutex);
+
+   if (t->type != SOCK_DGRAM) {
+      rc = -EPROTOTYPE;
+   } else if (t->dead) {
+      rc = -ECONNREFUSED;
+   } else if (s->peer) {
+      /* Changing the default destination is not supported */
+      rc = -EISCONN;
+   } else {
+      retain_obj(t);
+      s->peer = t;
+      s->state = US_CONNECTED;
+      list_add_tail(&t->senders, &s->sender_node);
+      kcond_signal_all(&s->wcond);
+   }
+
+   kmutex_unlock(&unix_mutex);
+   return rc;
+}
+
+int unix_connect(fs_handle h, const struct k_sockaddr_un *addr)
+{
+   struct unix_sock *s = to_sock(h);
+   struct unix_sock *t;
+   int rc;
+
+   if ((rc = unix_find(addr->sun_path, &t)))
+      return rc;
+
+   if (s->type == SOCK_STREAM)
+      rc = unix_stream_connect(s, t, is_nonblock(h, 0));
+   else
+      rc = unix_dgram_connect(s, t);
+
+   unix_release(t);
+   return rc;
+}
+
+int unix_listen(fs_handle h, int backlog)
+{
+   struct unix_sock *s = to_sock(h);
+   int rc = 0;
+
+   kmutex_lock(&unix_mutex);
+
+   if (s->type != SOCK_STREAM) {
+      rc = -EOPNOTSUPP;
+   } else if (s->state == US_CONNECTED || !s->bound) {
+      rc = -EINVAL; /* Note: auto-bind is not supported */
+   } else {
+      s->state = US_LISTENING;
+      s->backlog = CLAMP(backlog, 1, UNIX_MAX_BACKLOG);
+      kcond_signal_all(&s->wcond);
+   }
+
+   kmutex_unlock(&unix_mutex);
+   return rc;
+}
+
+static void
+unix_get_addr(struct unix_sock *s, struct k_sockaddr_un *addr, int *addr_len)
+{
+   *addr = s->addr;
+   *addr_len = s->addr_len;
+
+   /* Unnamed sockets have just the family */
+   if (!s->addr_len) {
+      addr->sun_family = AF_UNIX;
+      *addr_len = sizeof(addr->sun_family);
+   }
+}
+
+int
+unix_accept(fs_handle h,
+            int flags,
+            fs_handle *out,
+            struct k_sockaddr_un *peer_addr,
+            int *peer_addr_len)
+{
+   struct unix_sock *s = to_sock(h);
+   struct list dead_rights;
+   struct unix_sock *n = NULL;
+   fs_handle nh;
+   int rc = 0;
+
+   list_init(&dead_rights);
+   kmutex_lock(&unix_mutex);
+
+   while (true) {
+
+      if (s->type != SOCK_STREAM) {
+         rc = -EOPNOTSUPP;
+         break;
+      }
+
+      if (s->state != US_LISTENING) {
+         rc = -EINVAL;
+         break;
+      }
+
+      if (!list_is_empty(&s->accept_q)) {
+         n = list_first_obj(&s->accept_q, struct unix_sock, accept_node);
+         list_remove(&n->accept_node);
+         s->pending--;
+         kcond_signal_all(&s->wcond);
+         break;
+      }
+
+      if (is_nonblock(h, 0)) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      kcond_wait(&s->rcond, &unix_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   if (n)
+      unix_get_addr(n->peer, peer_addr, peer_addr_len);
+
+   kmutex_unlock(&unix_mutex);
+
+   if (rc)
+      return rc;
+
+   if (!(nh = unix_new_handle(n, flags))) {
+
+      kmutex_lock(&unix_mutex);
+      {
+         unix_sock_close(n, &dead_rights);
+      }
+      kmutex_unlock(&unix_mutex);
+
+      unix_free_rights_list(&dead_rights);
+      rc = -ENOMEM;
+
+   } else {
+      *out = nh;
+   }
+
+   /* Drop the reference of the accept queue */
+   unix_release(n);
+   return rc;
+}
+
+int
+unix_getname(fs_handle h,
+             bool peer,
+             struct k_sockaddr_un *addr,
+             int *addr_len)
+{
+   struct unix_sock *s = to_sock(h);
+   int rc = 0;
+
+   kmutex_lock(&unix_mutex);
+
+   if (peer && !s->peer)
+      rc = -ENOTCONN;
+   else
+      unix_get_addr(peer ? s->peer : s, addr, addr_len);
+
+   kmutex_unlock(&unix_mutex);
+   return rc;
+}
+
+static bool unix_rd_eof(struct unix_sock *s)
+{
+   return s->shut_rd || s->peer_closed || (s->peer && s->peer->shut_wr);
+}
+
+static bool unix_wr_broken(struct unix_sock *s)
+{
+   return s->shut_wr || s->peer_closed || s->peer->shut_rd;
+}
+
+static ssize_t
+unix_stream_send(struct unix_sock *s, struct unix_msg *m, bool nonblock)
+{
+   struct unix_sock *p;
+   size_t tot = 0;
+   ssize_t rc = 0;
+
+   if (m->addr)
+      return s->state == US_CONNECTED ? -EISCONN : -EOPNOTSUPP;
+
+   kmutex_lock(&unix_mutex);
+
+   while (tot < m->len) {
+
+      if (s->state != US_CONNECTED) {
+         rc = -ENOTCONN;
+         break;
+      }
+
+      p = s->peer;
+
+      if (unix_wr_broken(s)) {
+
+         if (!(m->flags & MSG_NOSIGNAL))
+            send_signal(get_curr_pid(), SIGPIPE, true);
+
+         rc = -EPIPE;
+         break;
+      }
+
+      if (!ringbuf_is_full(&p->rb)) {
+
+         size_t n;
+
+         if (m->rights) {
+            /* The handles go with the first byte of this message */
+            m->rights->pos = p->rx_written;
+            list_add_tail(&p->rights_q, &m->rights->node);
+            m->rights = NULL;
+         }
+
+         n = ringbuf_write_bytes(&p->rb, m->buf + tot, m->len - tot);
+         p->rx_written += n;
+         tot += n;
+         kcond_signal_all(&p->rcond);
+         continue;
+      }
+
+      if (nonblock) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      /* Wait for the peer to make room in its receive buffer */
+      kcond_wait(&p->wcond, &unix_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   kmutex_unlock(&unix_mutex);
+   return tot > 0 ? (ssize_t)tot : rc;
+}
+
+static ssize_t
+unix_dgram_send(struct unix_sock *s, struct unix_msg *m, bool nonblock)
+{
+   struct unix_sock *t = NULL;
+   struct unix_dgram *d;
+   ssize_t rc = 0;
+
+   if (m->len > UNIX_DGRAM_QUEUE_SIZE)
+      return -EMSGSIZE;
+
+   if (m->addr && (rc = unix_find(m->addr->sun_path, &t)))
+      return rc;
+
+   if (!(d = kmalloc(sizeof(struct unix_dgram) + m->len))) {
+      rc = -ENOMEM;
+      goto out;
+   }
+
+   list_node_init(&d->node);
+   memcpy(d->data, m->buf, m->len);
+   d->len = m->len;
+   d->rights = NULL;
+
+   kmutex_lock(&unix_mutex);
+
+   if (!t) {
+
+      if (!(t = s->peer)) {
+         kmutex_unlock(&unix_mutex);
+         rc = -ENOTCONN;
+         goto out;
+      }
+
+      retain_obj(t);
+   }
+
+   d->from = s->addr;
+   d->from_len = s->addr_len;
+
+   while (true) {
+
+      if (t->type != SOCK_DGRAM) {
+         rc = -EPROTOTYPE;
+         break;
+      }
+
+      if (s->shut_wr) {
+
+         if (!(m->flags & MSG_NOSIGNAL))
+            send_signal(get_curr_pid(), SIGPIPE, true);
+
+         rc = -EPIPE;
+         break;
+      }
+
+      if (t->dead || t->shut_rd) {
+         rc = -ECONNREFUSED;
+         break;
+      }
+
+      if (list_is_empty(&t->dgram_q) ||
+          t->dgram_bytes + m->len <= UNIX_DGRAM_QUEUE_SIZE)
+      {
+         d->rights = m->rights;
+         m->rights = NULL;
+         list_add_tail(&t->dgram_q, &d->node);
+         t->dgram_bytes += d->len;
+         kcond_signal_all(&t->rcond);
+         rc = (ssize_t)d->len;
+         d = NULL;
+         break;
+      }
+
+      if (nonblock) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      kcond_wait(&t->wcond, &unix_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   kmutex_unlock(&unix_mutex);
+
+out:
+   if (d)
+      kfree2(d, sizeof(struct unix_dgram) + d->len);
+
+   if (t)
+      unix_release(t);
+
+   return rc;
+}
+
+ssize_t unix_send(fs_handle h, struct unix_msg *m)
+{
+   struct unix_sock *s = to_sock(h);
+   const bool nonblock = is_nonblock(h, m->flags);
+
+   if (s->type == SOCK_STREAM)
+      return unix_stream_send(s, m, nonblock);
+
+   return unix_dgram_send(s, m, nonblock);
+}
+
+/* Copy up to `len` bytes from the ring buffer, without consuming them */
+static size_t unix_rb_peek(struct ringbuf *rb, u8 *buf, size_t len)
+{
+   const size_t n1 = MIN(len, ringbuf_get_elems(rb));
+   const size_t c1 = MIN(n1, rb->max_elems - rb->read_pos);
+
+   memcpy(buf, rb->buf + rb->read_pos, c1);
+   memcpy(buf + c1, rb->buf, n1 - c1);
+   return n1;
+}
+
+static ssize_t
+unix_stream_recv(struct unix_sock *s, struct unix_msg *m, bool nonblock)
+{
+   const bool peek = !!(m->flags & MSG_PEEK);
+   struct unix_rights *r;
+   size_t len = m->len;
+   ssize_t rc = 0;
+
+   kmutex_lock(&unix_mutex);
+
+   while (true) {
+
+      if (!ringbuf_is_empty(&s->rb))
+         break;
+
+      if (s->state != US_CONNECTED) {
+         rc = -ENOTCONN;
+         goto out;
+      }
+
+      if (unix_rd_eof(s))
+         goto out; /* EOF */
+
+      if (nonblock) {
+         rc = -EAGAIN;
+         goto out;
+      }
+
+      kcond_wait(&s->rcond, &unix_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         goto out;
+      }
+   }
+
+   /*
+    * The handles passed with SCM_RIGHTS are received with the first byte they
+    * were sent with, and a read never crosses the beginning of the data having
+    * handles attached.
+    */
+   if (!list_is_empty(&s->rights_q)) {
+
+      r = list_first_obj(&s->rights_q, struct unix_rights, node);
+
+      if (r->pos == s->rx_read && !peek) {
+
+         list_remove(&r->node);
+         m->rights = r;
+
+         if (!list_is_empty(&s->rights_q))
+            r = list_first_obj(&s->rights_q, struct unix_rights, node);
+         else
+            r = NULL;
+      }
+
+      if (r && r->pos > s->rx_read)
+         len = MIN(len, (size_t)(r->pos - s->rx_read));
+   }
+
+   if (peek) {
+      rc = (ssize_t)unix_rb_peek(&s->rb, m->buf, len);
+   } else {
+      rc = (ssize_t)ringbuf_read_bytes(&s->rb, m->buf, len);
+      s->rx_read += (size_t)rc;
+      unix_signal_writers(s);
+   }
+
+out:
+   kmutex_unlock(&unix_mutex);
+   return rc;
+}
+
+static ssize_t
+unix_dgram_recv(struct unix_sock *s, struct unix_msg *m, bool nonblock)
+{
+   struct unix_dgram *d = NULL;
+   ssize_t rc = 0;
+   size_t n;
+
+   kmutex_lock(&unix_mutex);
+
+   while (list_is_empty(&s->dgram_q)) {
+
+      if (s->shut_rd || s->peer_closed)
+         goto out; /* EOF */
+
+      if (nonblock) {
+         rc = -EAGAIN;
+         goto out;
+      }
+
+      kcond_wait(&s->rcond, &unix_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         goto out;
+      }
+   }
+
+   d = list_first_obj(&s->dgram_q, struct unix_dgram, node);
+   n = MIN(m->len, d->len);
+   memcpy(m->buf, d->data, n);
+   rc = (ssize_t)n;
+
+   if (d->len > m->len) {
+
+      m->out_flags |= MSG_TRUNC;
+
+      if (m->flags & MSG_TRUNC)
+         rc = (ssize_t)d->len; /* Return the real length of the datagram */
+   }
+
+   *m->addr = d->from;
+   m->addr_len = d->from_len;
+
+   if (!(m->flags & MSG_PEEK)) {
+      list_remove(&d->node);
+      s->dgram_bytes -= d->len;
+      m->rights = d->rights;
+      unix_signal_writers(s);
+   } else {
+      d = NULL;
+   }
+
+out:
+   kmutex_unlock(&unix_mutex);
+
+   if (d)
+      kfree2(d, sizeof(struct unix_dgram) + d->len);
+
+   return rc;
+}
+
+ssize_t unix_recv(fs_handle h, struct unix_msg *m)
+{
+   struct unix_sock *s = to_sock(h);
+   const bool nonblock = is_nonblock(h, m->flags);
+   struct k_sockaddr_un unused;
+
+   if (!m->addr)
+      m->addr = &unused;
+
+   if (!m->len && s->type == SOCK_STREAM)
+      return 0;
+
+   if (s->type == SOCK_STREAM)
+      return unix_stream_recv(s, m, nonblock);
+
+   return unix_dgram_recv(s, m, nonblock);
+}
+
+int unix_shutdown(fs_handle h, int how)
+{
+   struct unix_sock *s = to_sock(h);
+   int rc = 0;
+
+   if (how != SHUT_RD && how != SHUT_WR && how != SHUT_RDWR)
+      return -EINVAL;
+
+   kmutex_lock(&unix_mutex);
+
+   if (s->state != US_CONNECTED) {
+
+      rc = -ENOTCONN;
+
+   } else {
+
+      if (how != SHUT_WR)
+         s->shut_rd = true;
+
+      if (how != SHUT_RD)
+         s->shut_wr = true;
+
+      kcond_signal_all(&s->rcond);
+      kcond_signal_all(&s->wcond);
+      kcond_signal_all(&s->peer->rcond);
+      kcond_signal_all(&s->peer->wcond);
+   }
+
+   kmutex_unlock(&unix_mutex);
+   return rc;
+}
+
+int unix_getsockopt(fs_handle h, int opt, int *val)
+{
+   struct unix_sock *s = to_sock(h);
+
+   switch (opt) {
+
+      case SO_TYPE:
+         *val = s->type;
+         break;
+
+      case SO_DOMAIN:
+         *val = AF_UNIX;
+         break;
+
+      case SO_PROTOCOL:
+      case SO_ERROR:
+         *val = 0;
+         break;
+
+      case SO_ACCEPTCONN:
+         *val = s->state == US_LISTENING;
+         break;
+
+      case SO_SNDBUF:
+      case SO_RCVBUF:
+         *val = s->type == SOCK_STREAM
+            ? UNIX_SOCK_BUF_SIZE
+            : UNIX_DGRAM_QUEUE_SIZE;
+         break;
+
+      default:
+         return -ENOPROTOOPT;
+   }
+
+   return 0;
+}
+
+static ssize_t unix_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct unix_msg m = { .buf = (u8 *)buf, .len = size };
+   ssize_t rc = unix_recv(h, &m);
+
+   /* Handles passed with SCM_RIGHTS are discarded by plain reads */
+   unix_free_rights(m.rights);
+   return rc;
+}
+
+static ssize_t unix_write(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct unix_msg m = { .buf = (u8 *)buf, .len = size };
+   return unix_send(h, &m);
+}
+
+static int unix_read_ready(fs_handle h)
+{
+   struct unix_sock *s = to_sock(h);
+   bool ret;
+
+   kmutex_lock(&unix_mutex);
+
+   if (s->state == US_LISTENING)
+      ret = !list_is_empty(&s->accept_q);
+   else if (s->type == SOCK_DGRAM)
+      ret = !list_is_empty(&s->dgram_q) || s->shut_rd || s->peer_closed;
+   else if (s->state == US_CONNECTED)
+      ret = !ringbuf_is_empty(&s->rb) || unix_rd_eof(s);
+   else
+      ret = false;
+
+   kmutex_unlock(&unix_mutex);
+   return ret;
+}
+
+static int unix_write_ready(fs_handle h)
+{
+   struct unix_sock *s = to_sock(h);
+   struct unix_sock *p;
+   bool ret;
+
+   kmutex_lock(&unix_mutex);
+
+   p = s->peer;
+
+   if (s->type == SOCK_DGRAM)
+      ret = !p || p->dead || p->dgram_bytes < UNIX_DGRAM_QUEUE_SIZE;
+   else if (s->state == US_CONNECTED)
+      ret = unix_wr_broken(s) || !ringbuf_is_full(&p->rb);
+   else
+      ret = false;
+
+   kmutex_unlock(&unix_mutex);
+   return ret;
+}
+
+static int unix_except_ready(fs_handle h)
+{
+   struct unix_sock *s = to_sock(h);
+   int ret = 0;
+
+   kmutex_lock(&unix_mutex);
+
+   if (s->type == SOCK_STREAM) {
+
+      if (s->state == US_UNCONNECTED || s->peer_closed)
+         ret |= POLLHUP;
+
+      if (s->shut_rd && s->shut_wr)
+         ret |= POLLHUP;
+   }
+
+   kmutex_unlock(&unix_mutex);
+   return ret;
+}
+
+static struct kcond *unix_get_rready_cond(fs_handle h)
+{
+   return &to_sock(h)->rcond;
+}
+
+static struct kcond *unix_get_wready_cond(fs_handle h)
+{
+   /* See unix_signal_writers() */
+   return &to_sock(h)->wcond;
+}
+
+static const struct file_ops static_ops_unix_sock =
+{
+   .read = unix_read,
+   .write = unix_write,
+   .read_ready = unix_read_ready,
+   .write_ready = unix_write_ready,
+   .except_ready = unix_except_ready,
+   .get_rready_cond = unix_get_rready_cond,
+   .get_wready_cond = unix_get_wready_cond,
+   .get_except_cond = unix_get_rready_cond,
+};
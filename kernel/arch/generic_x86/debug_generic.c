@@ -12,6 +12,7 @@ int debug_qemu_turn_off_machine(void)
    if (!in_hypervisor())
       return -ENXIO;
 
+   printk_flush_ringbuf();    /* don't lose the last messages */
    outb(0xf4, 0x00);
    return -EIO;
 }
@@ -11,6 +11,7 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/perf.h>
 
 #include "pic.h"
 
@@ -36,6 +37,17 @@ struct list irq_handlers_lists[16] = {
 u32 unhandled_irq_count[256];
 u32 spur_irq_count;
 
+static void perf_get_unhandled(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = 0;
+
+   for (int i = 0; i < ARRAY_SIZE(unhandled_irq_count); i++)
+      vals[0] += unhandled_irq_count[i];
+}
+
+DEF_PERF_COUNTER(irq, spurious, spur_irq_count);
+DEF_PERF_COUNTER_FUNC(irq, unhandled, perf_get_unhandled);
+
 void idt_set_entry(u8 num, void *handler, u16 sel, u8 flags);
 
 /* This installs a custom IRQ handler for the given IRQ */
@@ -57,6 +57,16 @@ void release_pageframes_mapped_at(pdir_t *pdir, void *vaddrp, size_t len)
    }
 }
 
+u32 get_pageframe_ref_count_at(pdir_t *pdir, void *vaddrp)
+{
+   ulong paddr;
+
+   if (get_mapping2(pdir, vaddrp, &paddr) < 0)
+      return 0;
+
+   return pf_ref_count_get(paddr);
+}
+
 void invalidate_page(ulong vaddr)
 {
    invalidate_page_hw(vaddr);
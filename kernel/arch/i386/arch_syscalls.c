@@ -15,6 +15,7 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/sys_stats.h>
 #include <tilck/mods/tracing.h>
 
 #include "idt_int.h"
@@ -587,6 +588,7 @@ static void do_syscall(regs_t *r)
 void handle_syscall(regs_t *r)
 {
    const u32 sn = r->eax;
+   const u64 start = UNLIKELY(sys_stats != NULL) ? RDTSC() : 0;
 
    /*
     * In case of a sysenter syscall, the eflags are saved in kernel mode after
@@ -606,6 +608,9 @@ void handle_syscall(regs_t *r)
       else
          do_special_syscall(r);
 
+      if (UNLIKELY(sys_stats != NULL))
+         sys_stats_account(sn, (long)r->eax, RDTSC() - start);
+
    } else {
 
       unknown_syscall_int(r, sn);
@@ -381,6 +381,85 @@ static void gdt_set_slot(struct process *pi, u16 slot, u16 gdt_index)
    get_proc_arch_fields(pi)->gdt_entries[slot] = gdt_index;
 }
 
+static inline bool is_user_desc_empty(struct user_desc *dc)
+{
+   return dc->flags == USER_DESC_FLAGS_EMPTY && !dc->base_addr && !dc->limit;
+}
+
+static void user_desc_to_gdt_entry(struct user_desc *dc, struct gdt_entry *e)
+{
+   gdt_set_entry(e, dc->base_addr, dc->limit, 0, 0);
+   e->s = 1;
+   e->dpl = 3;
+   e->d = dc->seg_32bit;
+   e->type |= (dc->contents << 2);
+   e->type |= !dc->read_exec_only ? GDT_ACCESS_RW : 0;
+   e->g = dc->limit_in_pages;
+   e->avl = dc->useable;
+   e->p = !dc->seg_not_present;
+}
+
+static int gdt_add_entry_or_expand(struct gdt_entry *e)
+{
+   int rc = gdt_add_entry(e);
+
+   if (rc < 0) {
+
+      if ((rc = gdt_expand()) < 0)
+         return rc;
+
+      rc = gdt_add_entry(e);
+      ASSERT(rc >= 0);
+   }
+
+   return rc;
+}
+
+/*
+ * Called by clone() when creating a new thread. With CLONE_SETTLS, `u_tls`
+ * points to an user_desc describing the TLS segment of the new thread: on
+ * Linux, the per-thread TLS entries are reloaded in the GDT at every context
+ * switch, while here the GDT is shared by all the tasks. Therefore, each
+ * thread gets its own GDT entry (ignoring desc->entry_number) and its GS
+ * register is updated to point to it. Without CLONE_SETTLS, the new task
+ * keeps using the TLS entry of its parent, if any.
+ */
+int arch_setup_task_tls(struct task *ti, struct task *parent, void *u_tls)
+{
+   arch_task_members_t *arch = get_task_arch_fields(ti);
+   arch_task_members_t *parent_arch = get_task_arch_fields(parent);
+   struct gdt_entry e = {0};
+   struct user_desc dc;
+   int rc;
+
+   ASSERT(arch->tls_gdt_entry == 0);
+
+   if (!u_tls) {
+
+      if (parent_arch->tls_gdt_entry) {
+         gdt_entry_inc_ref_count(parent_arch->tls_gdt_entry);
+         arch->tls_gdt_entry = parent_arch->tls_gdt_entry;
+      }
+
+      return 0;
+   }
+
+   if (copy_from_user(&dc, u_tls, sizeof(struct user_desc)))
+      return -EFAULT;
+
+   if (is_user_desc_empty(&dc))
+      return -EINVAL;
+
+   user_desc_to_gdt_entry(&dc, &e);
+
+   if ((rc = gdt_add_entry_or_expand(&e)) < 0)
+      return -ENOMEM;
+
+   arch->tls_gdt_entry = (u16)rc;
+   ti->state_regs->gs = X86_SELECTOR((u32)rc, TABLE_GDT, 3);
+   return 0;
+}
+
 int sys_set_thread_area(void *arg)
 {
    int rc = 0;
@@ -395,16 +474,8 @@ int sys_set_thread_area(void *arg)
 
    disable_preemption();
 
-   if (!(dc.flags == USER_DESC_FLAGS_EMPTY && !dc.base_addr && !dc.limit)) {
-      gdt_set_entry(&e, dc.base_addr, dc.limit, 0, 0);
-      e.s = 1;
-      e.dpl = 3;
-      e.d = dc.seg_32bit;
-      e.type |= (dc.contents << 2);
-      e.type |= !dc.read_exec_only ? GDT_ACCESS_RW : 0;
-      e.g = dc.limit_in_pages;
-      e.avl = dc.useable;
-      e.p = !dc.seg_not_present;
+   if (!is_user_desc_empty(&dc)) {
+      user_desc_to_gdt_entry(&dc, &e);
    } else {
       /* The user passed an empty descriptor: entry_number cannot be -1 */
       if (dc.entry_number == INVALID_ENTRY_NUM) {
@@ -422,21 +493,16 @@ int sys_set_thread_area(void *arg)
          goto out;
       }
 
-      dc.entry_number = (u32)gdt_add_entry(&e);
-
-      if (dc.entry_number == INVALID_ENTRY_NUM) {
-
-         rc = gdt_expand();
+      rc = gdt_add_entry_or_expand(&e);
 
-         if (rc < 0) {
-            rc = -ESRCH;
-            goto out;
-         }
-
-         dc.entry_number = (u32)gdt_add_entry(&e);
-         ASSERT(dc.entry_number != INVALID_ENTRY_NUM);
+      if (rc < 0) {
+         rc = -ESRCH;
+         goto out;
       }
 
+      dc.entry_number = (u32)rc;
+      rc = 0;
+
       gdt_set_slot(get_curr_proc(), (u16)slot, (u16)dc.entry_number);
       goto out;
    }
@@ -199,7 +199,7 @@ void handle_page_fault_int(regs_t *r)
       get_curr_proc()->debug_cmdline
    );
 
-   send_signal(get_curr_tid(), sig, SIG_FL_PROCESS | SIG_FL_FAULT);
+   send_signal2(get_curr_pid(), get_curr_tid(), sig, SIG_FL_FAULT);
 }
 
 bool is_mapped(pdir_t *pdir, void *vaddrp)
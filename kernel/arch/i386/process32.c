@@ -21,6 +21,7 @@
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/vdso.h>
+#include <tilck/kernel/lat_tracer.h>
 
 #include <tilck/mods/tracing.h>
 
@@ -664,6 +665,9 @@ switch_to_task(struct task *ti)
     */
    ASSERT(state->eflags & EFLAGS_IF);
 
+   if (ti != curr)
+      trace_sched_switch(curr, ti);
+
    /* Do as much as possible work before disabling the interrupts */
    task_change_state_idempotent(ti, TASK_STATE_RUNNING);
    ti->ticks.timeslice = 0;
@@ -694,6 +698,10 @@ switch_to_task(struct task *ti)
 
    /* From here until the end, we have to be as fast as possible */
    disable_interrupts_forced();
+
+   if (KRN_LAT_TRACER)
+      irqsoff_trace_on_task_switch(); /* the next task has its own IF state */
+
    switch_to_task_pop_nested_interrupts();
    enable_preemption_nosched();
    ASSERT(is_preemption_enabled());
@@ -717,15 +725,29 @@ sys_set_tid_address(int *tidptr)
     * is not valid, we'll send SIGSEGV to the just created thread.
     */
 
-   get_curr_proc()->set_child_tid = tidptr;
+   get_curr_task()->clear_child_tid = tidptr;
    return get_curr_task()->tid;
 }
 
+static void
+release_task_tls_entry(arch_task_members_t *arch)
+{
+   if (arch->tls_gdt_entry) {
+      gdt_clear_entry(arch->tls_gdt_entry);
+      arch->tls_gdt_entry = 0;
+   }
+}
+
 bool
 arch_specific_new_task_setup(struct task *ti, struct task *parent)
 {
    arch_task_members_t *arch = get_task_arch_fields(ti);
 
+   if (!parent) {
+      /* execve(): the TLS entry created by clone() is not valid anymore */
+      release_task_tls_entry(arch);
+   }
+
    if (FORK_NO_COW) {
 
       if (parent) {
@@ -779,6 +801,7 @@ void
 arch_specific_free_task(struct task *ti)
 {
    arch_task_members_t *arch = get_task_arch_fields(ti);
+   release_task_tls_entry(arch);
    aligned_kfree2(arch->aligned_fpu_regs, arch->fpu_regs_size);
    arch->aligned_fpu_regs = NULL;
    arch->fpu_regs_size = 0;
@@ -800,8 +823,6 @@ arch_specific_new_proc_setup(struct process *pi, struct process *parent)
    for (int i = 0; i < ARRAY_SIZE(arch->gdt_entries); i++)
       if (arch->gdt_entries[i])
          gdt_entry_inc_ref_count(arch->gdt_entries[i]);
-
-   pi->set_child_tid = NULL;
 }
 
 void
@@ -825,7 +846,7 @@ arch_specific_free_proc(struct process *pi)
 static void
 handle_fatal_error(regs_t *r, int signum)
 {
-   send_signal(get_curr_tid(), signum, SIG_FL_PROCESS | SIG_FL_FAULT);
+   send_signal2(get_curr_pid(), get_curr_tid(), signum, SIG_FL_FAULT);
 }
 
 /* General protection fault handler */
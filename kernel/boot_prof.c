@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/boot_prof.h>
+#include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/timer.h>
+
+/*
+ * The steps are recorded only by kmain() and then by the do_async_init()
+ * kthread, one after the other: no locking is needed. Once the boot is done,
+ * the table does not change anymore.
+ */
+
+static struct boot_prof_step steps[BOOT_PROF_MAX_STEPS];
+static u32 steps_count;
+static u32 curr_depth;
+static u64 boot_tsc;
+static bool boot_done;
+
+int boot_prof_begin(const char *name)
+{
+   struct boot_prof_step *s;
+
+   if (boot_done || steps_count == ARRAY_SIZE(steps))
+      return -1;
+
+   s = &steps[steps_count];
+   s->name = name;
+   s->depth = curr_depth++;
+   s->cycles = 0;
+   s->start = RDTSC() - boot_tsc;
+   return (int)steps_count++;
+}
+
+void boot_prof_end(int step)
+{
+   const u64 now = RDTSC() - boot_tsc;
+
+   if (step < 0)
+      return;
+
+   ASSERT((u32)step < steps_count);
+   ASSERT(curr_depth > 0);
+
+   steps[step].cycles = MAX(now - steps[step].start, 1ull);
+   curr_depth--;
+}
+
+void boot_prof_start(void)
+{
+   boot_tsc = RDTSC();
+   boot_prof_begin("boot");
+}
+
+u64 boot_prof_cycles_to_us(u64 cycles)
+{
+   extern u32 __tsc_per_tick;
+   const u64 tsc_per_sec = (u64)__tsc_per_tick * TIMER_HZ;
+
+   if (!tsc_per_sec)
+      return 0;
+
+   return cycles * 1000000 / tsc_per_sec;
+}
+
+static void boot_prof_dump(void)
+{
+   struct boot_prof_step *s;
+
+   printk("Boot profile:\n");
+   printk(NO_PREFIX "    start [us]   duration [us]   step\n");
+
+   for (u32 i = 0; i < steps_count; i++) {
+
+      s = &steps[i];
+
+      printk(NO_PREFIX "%13" PRIu64 " %15" PRIu64 "   %*s%s\n",
+             boot_prof_cycles_to_us(s->start),
+             boot_prof_cycles_to_us(s->cycles),
+             (int)(2 * s->depth), "",
+             s->name);
+   }
+}
+
+void boot_prof_done(void)
+{
+   boot_prof_end(0);
+   boot_done = true;
+
+   if (kopt_boot_prof)
+      boot_prof_dump();
+}
+
+u32 boot_prof_get_steps(struct boot_prof_step *buf, u32 max)
+{
+   u32 n;
+
+   if (!boot_done)
+      return 0;
+
+   n = MIN(max, steps_count);
+   memcpy(buf, steps, n * sizeof(steps[0]));
+   return n;
+}
@@ -139,6 +139,7 @@ ALL_KOPTS_BEGIN
    /*          name              ,alias, type, default            */
    DEFINE_KOPT(ttys              ,     , long, TTY_COUNT)
    DEFINE_KOPT(selftest          ,     , wordstr, NULL)
+   DEFINE_KOPT(prof_hz           ,     , long, 0)
 
    DEFINE_KOPT(sched_alive_thread, sat , bool, false)
    DEFINE_KOPT(sercon            ,     , bool, !MOD_console)
@@ -153,6 +154,9 @@ ALL_KOPTS_BEGIN
    DEFINE_KOPT(big_scroll_buf    , bb  , bool, TERM_BIG_SCROLL_BUF)
    DEFINE_KOPT(ps2_log           , plg , bool, PS2_VERBOSE_DEBUG_LOG)
    DEFINE_KOPT(ps2_selftest      , pse , bool, PS2_DO_SELFTEST)
+   DEFINE_KOPT(initrd_rw         , irw , bool, false)
+   DEFINE_KOPT(sys_stats         ,     , bool, false)
+   DEFINE_KOPT(boot_prof         ,     , bool, false)
 
 ALL_KOPTS_END
 
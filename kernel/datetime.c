@@ -11,6 +11,7 @@
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/perf.h>
 
 #define FULL_RESYNC_MAX_ATTEMPTS       10
 
@@ -52,6 +53,17 @@ static int adj_cnt;              /* adjustments count (temporary, gets reset) */
 /* lifetime statistics about re-syncs */
 static struct clock_resync_stats clock_rstats;
 
+DEF_PERF_COUNTER(clock, full_resyncs,
+                 clock_rstats.full_resync_count);
+DEF_PERF_COUNTER(clock, full_resync_fails,
+                 clock_rstats.full_resync_fail_count);
+DEF_PERF_COUNTER(clock, full_resync_ok,
+                 clock_rstats.full_resync_success_count);
+DEF_PERF_COUNTER(clock, drift_gt_1s,
+                 clock_rstats.full_resync_abs_drift_gt_1);
+DEF_PERF_COUNTER(clock, multi_sec_resyncs,
+                 clock_rstats.multi_second_resync_count);
+
 // Regular value
 u32 clock_drift_adj_loop_delay = 600 * TIMER_HZ;
 
@@ -433,6 +445,32 @@ u64 get_sys_time(void)
    return ts;
 }
 
+u64 get_sys_time_hr(void)
+{
+   extern u64 __tick_tsc;
+   extern u32 __tsc_per_tick;
+
+   u64 ts, delta = 0;
+   u32 tpt;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      ts = __time_ns;
+
+      if ((tpt = __tsc_per_tick))
+         delta = RDTSC() - __tick_tsc;
+   }
+   enable_interrupts(&var);
+
+   if (!tpt)
+      return ts;
+
+   /* Never go beyond the next tick, in order to keep the time monotonic */
+   delta = MIN(delta, (u64)tpt - 1);
+   return ts + delta * __tick_duration / tpt;
+}
+
 s64 get_timestamp(void)
 {
    const u64 ts = get_sys_time();
@@ -545,6 +583,7 @@ do_clock_gettime(clockid_t clk_id, struct k_timespec64 *tp)
       case CLOCK_MONOTONIC:
       case CLOCK_MONOTONIC_COARSE:
       case CLOCK_MONOTONIC_RAW:
+      case CLOCK_BOOTTIME:
          monotonic_time_get_timespec(tp);
          break;
 
@@ -571,6 +610,7 @@ do_clock_getres(clockid_t clk_id, struct k_timespec64 *res)
       case CLOCK_MONOTONIC:
       case CLOCK_MONOTONIC_COARSE:
       case CLOCK_MONOTONIC_RAW:
+      case CLOCK_BOOTTIME:
       case CLOCK_PROCESS_CPUTIME_ID:
       case CLOCK_THREAD_CPUTIME_ID:
 
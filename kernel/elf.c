@@ -5,6 +5,7 @@
 
 #include <tilck/common/string_util.h>
 #include <tilck/common/utils.h>
+#include <tilck/common/printk.h>
 
 #include <tilck/kernel/elf_loader.h>
 #include <tilck/kernel/paging.h>
@@ -607,6 +608,21 @@ find_sym_at_addr_safe(ulong vaddr, long *offset, u32 *sym_size)
    return sym_name;
 }
 
+void get_ret_addr_str(void *ra, char *buf, size_t buf_sz)
+{
+   const char *sym;
+   long off;
+   u32 sym_size;
+
+   /* Resolve the call instruction before `ra`: it might be a NORETURN call */
+   sym = find_sym_at_addr((ulong)ra - 1, &off, &sym_size);
+
+   if (sym)
+      snprintk(buf, buf_sz, "%s+%#lx", sym, (ulong)off + 1);
+   else
+      snprintk(buf, buf_sz, "%p", ra);
+}
+
 static Elf_Shdr *kernel_elf_get_section(const char *section_name)
 {
    Elf_Ehdr *h = (Elf_Ehdr*)(KERNEL_PA_TO_VA(KERNEL_PADDR));
@@ -0,0 +1,555 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_userlim.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/bintree.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/epoll.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+
+#include <sys/epoll.h>  // system header
+
+/*
+ * epoll
+ * -------
+ *
+ * Each epoll object has a persistent interest set (a bintree of epoll items,
+ * keyed by fd) and a ready list. When an item is added, a callback is
+ * registered (see kcond_register_cb()) on each of the kconds of its handle:
+ * when one of them is signalled, the callback just moves the item to the ready
+ * list and wakes up the waiters. Therefore, epoll_wait() never scans the whole
+ * interest set: it only checks the items on the ready list, which might not be
+ * actually ready anymore (conds are signalled for many reasons).
+ *
+ * In level-triggered mode (the default) a reported item stays on the ready
+ * list, in order to be checked again by the next epoll_wait() call; in
+ * edge-triggered mode (EPOLLET), it's removed and re-added only by the next
+ * signal. Items with EPOLLONESHOT get disabled after the first event, until
+ * they're re-armed by EPOLL_CTL_MOD.
+ *
+ * Locking: all the interest sets are protected by `epoll_mutex`, while the
+ * ready lists are protected by disabling the preemption, because the callbacks
+ * run in the context of whoever signals the kcond, with preemption disabled.
+ *
+ * Limitations: epoll objects cannot be nested and, because in Tilck dup()
+ * creates a new handle, closing any handle registered in an epoll set removes
+ * it from the set, even if other handles exist for the same file.
+ */
+
+#define EPOLL_COND_CNT                                 3
+#define EPOLL_SUPPORTED_EVENTS                                    \
+   (EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLET | EPOLLONESHOT)
+
+struct epoll;
+struct epoll_item;
+
+struct epoll_item_cb {
+
+   struct kcond_cb kcb;
+   struct epoll_item *item;
+};
+
+struct epoll_item {
+
+   struct bintree_node node;        /* node in the interest set */
+   struct list_node ready_node;     /* node in the ready list */
+   struct list_node all_node;       /* node in the global `epoll_items` list */
+
+   struct epoll *ep;
+   fs_handle h;
+   long fd;                         /* key in the interest set */
+   u32 events;
+   u64 data;
+
+   bool ready;                      /* ready_node is in a list */
+   bool disabled;                   /* EPOLLONESHOT item already reported */
+
+   struct epoll_item_cb cbs[EPOLL_COND_CNT];
+};
+
+struct epoll {
+
+   KOBJ_BASE_FIELDS
+
+   struct epoll_item *items;        /* root of the interest set */
+   struct list ready_list;
+   struct kcond wait_cond;
+};
+
+static struct kmutex epoll_mutex = STATIC_KMUTEX_INIT(epoll_mutex, 0);
+static struct list epoll_items = STATIC_LIST_INIT(epoll_items);
+static const struct file_ops static_ops_epoll;
+
+static bool is_epoll_handle(fs_handle h)
+{
+   struct fs_handle_base *hb = h;
+   return hb->fops == &static_ops_epoll;
+}
+
+/* Called by kcond_signal_one() and kcond_signal_all(), preemption disabled */
+static void epoll_item_cb(struct kcond_cb *kcb)
+{
+   struct epoll_item *it = CONTAINER_OF(kcb, struct epoll_item_cb, kcb)->item;
+   ASSERT(!is_preemption_enabled());
+
+   if (it->ready || it->disabled)
+      return;
+
+   it->ready = true;
+   list_add_tail(&it->ep->ready_list, &it->ready_node);
+   kcond_signal_all(&it->ep->wait_cond);
+}
+
+static void epoll_item_arm(struct epoll_item *it)
+{
+   struct kcond *conds[EPOLL_COND_CNT] = {
+      it->events & EPOLLIN ? vfs_get_rready_cond(it->h) : NULL,
+      it->events & EPOLLOUT ? vfs_get_wready_cond(it->h) : NULL,
+      vfs_get_except_cond(it->h),
+   };
+
+   for (int i = 0; i < EPOLL_COND_CNT; i++) {
+
+      it->cbs[i].item = it;
+
+      if (conds[i])
+         kcond_register_cb(conds[i], &it->cbs[i].kcb, &epoll_item_cb);
+   }
+}
+
+static void epoll_item_disarm(struct epoll_item *it)
+{
+   for (int i = 0; i < EPOLL_COND_CNT; i++) {
+      if (it->cbs[i].kcb.func)
+         kcond_unregister_cb(&it->cbs[i].kcb);
+   }
+}
+
+/* Put the item on the ready list, in order to be checked by epoll_wait() */
+static void epoll_item_queue(struct epoll_item *it)
+{
+   disable_preemption();
+   {
+      it->disabled = false;
+
+      if (!it->ready) {
+         it->ready = true;
+         list_add_tail(&it->ep->ready_list, &it->ready_node);
+      }
+   }
+   enable_preemption();
+   kcond_signal_all(&it->ep->wait_cond);
+}
+
+static void epoll_item_destroy(struct epoll_item *it)
+{
+   struct epoll *ep = it->ep;
+   ASSERT(kmutex_is_curr_task_holding_lock(&epoll_mutex));
+
+   epoll_item_disarm(it);
+
+   disable_preemption();
+   {
+      if (it->ready)
+         list_remove(&it->ready_node);
+   }
+   enable_preemption();
+
+   bintree_remove_ptr(&ep->items, it, struct epoll_item, node, fd);
+   list_remove(&it->all_node);
+   kfree_obj(it, struct epoll_item);
+}
+
+static u32 epoll_item_poll(struct epoll_item *it)
+{
+   u32 revents = 0;
+   int rc;
+
+   if ((it->events & EPOLLIN) && vfs_read_ready(it->h))
+      revents |= EPOLLIN;
+
+   if ((it->events & EPOLLOUT) && vfs_write_ready(it->h))
+      revents |= EPOLLOUT;
+
+   if ((rc = vfs_except_ready(it->h)))
+      revents |= rc > 0 ? (u32)rc & (EPOLLERR | EPOLLHUP) : EPOLLERR;
+
+   return revents;
+}
+
+/*
+ * Fill `evs` with up to `max` events, checking only the items on the ready
+ * list. Returns the number of events.
+ */
+static int
+epoll_harvest(struct epoll *ep, struct epoll_event *evs, int max)
+{
+   struct epoll_item *it, *temp;
+   struct list lt_list;
+   u32 revents;
+   int cnt = 0;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&epoll_mutex));
+   list_init(&lt_list);
+
+   while (cnt < max) {
+
+      disable_preemption();
+      {
+         it = NULL;
+
+         if (!list_is_empty(&ep->ready_list)) {
+            it = list_first_obj(&ep->ready_list, struct epoll_item, ready_node);
+            list_remove(&it->ready_node);
+            it->ready = false;
+         }
+      }
+      enable_preemption();
+
+      if (!it)
+         break;
+
+      /*
+       * NOTE: the readiness checks can sleep: in the meanwhile, a callback
+       * might re-add the item on the ready list. That's fine.
+       */
+      if (it->disabled || !(revents = epoll_item_poll(it)))
+         continue; /* Not ready: drop it until its conds get signalled */
+
+      evs[cnt++] = (struct epoll_event) {
+         .events = revents,
+         .data.u64 = it->data,
+      };
+
+      disable_preemption();
+      {
+         if (it->events & EPOLLONESHOT) {
+
+            it->disabled = true;
+
+         } else if (!(it->events & EPOLLET) && !it->ready) {
+
+            /* Level-triggered: check it again in the next epoll_wait() */
+            it->ready = true;
+            list_add_tail(&lt_list, &it->ready_node);
+         }
+      }
+      enable_preemption();
+   }
+
+   disable_preemption();
+   {
+      list_for_each(it, temp, &lt_list, ready_node) {
+         list_remove(&it->ready_node);
+         list_add_tail(&ep->ready_list, &it->ready_node);
+      }
+   }
+   enable_preemption();
+   return cnt;
+}
+
+static int
+epoll_wait_int(struct epoll *ep, struct epoll_event *evs, int max, int timeout)
+{
+   struct task *curr = get_curr_task();
+   const u64 deadline = get_ticks() + MAX(ms_to_ticks((u64)timeout), 1ull);
+   u64 now = 0;
+   int rc;
+
+   kmutex_lock(&epoll_mutex);
+
+   while (true) {
+
+      if ((rc = epoll_harvest(ep, evs, max)) > 0 || !timeout)
+         break;
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+
+      if (timeout > 0 && (now = get_ticks()) >= deadline)
+         break;
+
+      disable_preemption();
+
+      if (!list_is_empty(&ep->ready_list)) {
+         enable_preemption();
+         continue;
+      }
+
+      prepare_to_wait_on(WOBJ_KCOND,
+                         &ep->wait_cond,
+                         NO_EXTRA,
+                         &ep->wait_cond.wait_list);
+
+      /*
+       * Set the timer on each iteration, because kcond_signal_int() cancels
+       * it when waking us up.
+       */
+      if (timeout > 0)
+         task_set_wakeup_timer(curr, (u32)MIN(deadline - now, (u64)INT32_MAX));
+
+      kmutex_unlock(&epoll_mutex);
+      enter_sleep_wait_state();
+
+      /* In case of timeout or signal, we're still on the wait list */
+      wait_obj_reset(&curr->wobj);
+      task_cancel_wakeup_timer(curr);
+      kmutex_lock(&epoll_mutex);
+   }
+
+   kmutex_unlock(&epoll_mutex);
+   return rc;
+}
+
+static int epoll_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct epoll *ep = (void *)kh->kobj;
+   bool ret;
+
+   disable_preemption();
+   {
+      ret = !list_is_empty(&ep->ready_list);
+   }
+   enable_preemption();
+   return ret;
+}
+
+static struct kcond *epoll_get_rready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct epoll *ep = (void *)kh->kobj;
+   return &ep->wait_cond;
+}
+
+static const struct file_ops static_ops_epoll =
+{
+   .read_ready = epoll_read_ready,
+   .get_rready_cond = epoll_get_rready_cond,
+};
+
+static void destroy_epoll(struct epoll *ep)
+{
+   kmutex_lock(&epoll_mutex);
+   {
+      while (ep->items)
+         epoll_item_destroy(ep->items);
+   }
+   kmutex_unlock(&epoll_mutex);
+
+   kcond_destory(&ep->wait_cond);
+   kfree_obj(ep, struct epoll);
+}
+
+static struct epoll *create_epoll(void)
+{
+   struct epoll *ep;
+
+   if (!(ep = (void *)kzalloc_obj(struct epoll)))
+      return NULL;
+
+   ep->destory_obj = (void *)&destroy_epoll;
+   list_init(&ep->ready_list);
+   kcond_init(&ep->wait_cond);
+   return ep;
+}
+
+/*
+ * Called by vfs_close() for handles having the VFS_SPFL_EPOLL flag: remove
+ * the handle from all the epoll sets it has been registered in.
+ */
+void epoll_on_handle_close(fs_handle h)
+{
+   struct epoll_item *it, *temp;
+
+   kmutex_lock(&epoll_mutex);
+   {
+      list_for_each(it, temp, &epoll_items, all_node) {
+         if (it->h == h)
+            epoll_item_destroy(it);
+      }
+   }
+   kmutex_unlock(&epoll_mutex);
+}
+
+int sys_epoll_create1(int flags)
+{
+   struct epoll *ep;
+   fs_handle h;
+   int fd;
+
+   if (flags & ~EPOLL_CLOEXEC)
+      return -EINVAL;
+
+   if (!(ep = create_epoll()))
+      return -ENOMEM;
+
+   if (!(h = kfs_create_new_handle(&static_ops_epoll, (void *)ep, O_RDWR))) {
+      destroy_epoll(ep);
+      return -ENOMEM;
+   }
+
+   fd = install_fs_handle(h, flags & EPOLL_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (fd < 0)
+      vfs_close(h); /* Destroys also the epoll object */
+
+   return fd;
+}
+
+int sys_epoll_create(int size)
+{
+   if (size <= 0)
+      return -EINVAL;
+
+   return sys_epoll_create1(0);
+}
+
+static int
+epoll_ctl_int(struct epoll *ep, int op, int fd, fs_handle h, u32 events, u64 d)
+{
+   struct fs_handle_base *hb = h;
+   struct epoll_item *it;
+
+   it = bintree_find_ptr(ep->items, fd, struct epoll_item, node, fd);
+
+   switch (op) {
+
+      case EPOLL_CTL_ADD:
+
+         if (it)
+            return -EEXIST;
+
+         if (!(it = kzalloc_obj(struct epoll_item)))
+            return -ENOMEM;
+
+         bintree_node_init(&it->node);
+         list_node_init(&it->ready_node);
+         it->ep = ep;
+         it->h = h;
+         it->fd = fd;
+         it->events = events;
+         it->data = d;
+
+         bintree_insert_ptr(&ep->items, it, struct epoll_item, node, fd);
+         list_add_tail(&epoll_items, &it->all_node);
+         hb->spec_flags |= VFS_SPFL_EPOLL;
+         epoll_item_arm(it);
+         epoll_item_queue(it);
+         return 0;
+
+      case EPOLL_CTL_MOD:
+
+         if (!it)
+            return -ENOENT;
+
+         epoll_item_disarm(it);
+         it->events = events;
+         it->data = d;
+         epoll_item_arm(it);
+         epoll_item_queue(it);
+         return 0;
+
+      case EPOLL_CTL_DEL:
+
+         if (!it)
+            return -ENOENT;
+
+         epoll_item_destroy(it);
+         return 0;
+
+      default:
+         return -EINVAL;
+   }
+}
+
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *u_event)
+{
+   struct epoll_event ev = {0};
+   struct kfs_handle *eh;
+   fs_handle h;
+   int rc;
+
+   if (!(eh = get_fs_handle(epfd)) || !(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if (!is_epoll_handle(eh) || is_epoll_handle(h))
+      return -EINVAL; /* NOTE: nested epoll sets are not supported */
+
+   if (op != EPOLL_CTL_DEL && copy_from_user(&ev, u_event, sizeof(ev)))
+      return -EFAULT;
+
+   if (!vfs_get_rready_cond(h) &&
+       !vfs_get_wready_cond(h) &&
+       !vfs_get_except_cond(h))
+   {
+      return -EPERM; /* Like Linux with regular files: always ready */
+   }
+
+   ev.events &= EPOLL_SUPPORTED_EVENTS;
+
+   kmutex_lock(&epoll_mutex);
+   {
+      rc = epoll_ctl_int((void *)eh->kobj, op, fd, h, ev.events, ev.data.u64);
+   }
+   kmutex_unlock(&epoll_mutex);
+   return rc;
+}
+
+int sys_epoll_wait(int epfd, struct epoll_event *u_events, int max, int timeout)
+{
+   struct task *curr = get_curr_task();
+   struct epoll_event *evs = curr->args_copybuf;
+   struct kfs_handle *eh;
+   int rc;
+
+   STATIC_ASSERT(ARGS_COPYBUF_SIZE >= 16 * sizeof(struct epoll_event));
+
+   if (!(eh = get_fs_handle(epfd)))
+      return -EBADF;
+
+   if (!is_epoll_handle(eh) || max <= 0)
+      return -EINVAL;
+
+   /* Return at most as many events as the copy buffer can hold */
+   max = MIN(max, (int)(ARGS_COPYBUF_SIZE / sizeof(struct epoll_event)));
+   rc = epoll_wait_int((void *)eh->kobj, evs, max, timeout);
+
+   if (rc > 0) {
+      if (copy_to_user(u_events, evs, sizeof(struct epoll_event) * (u32)rc))
+         return -EFAULT;
+   }
+
+   return rc;
+}
+
+int sys_epoll_pwait(int epfd,
+                    struct epoll_event *u_events,
+                    int max,
+                    int timeout,
+                    const sigset_t *u_mask,
+                    size_t sigsetsize)
+{
+   ulong saved_mask[K_SIGACTION_MASK_WORDS];
+   int rc;
+
+   if (!u_mask)
+      return sys_epoll_wait(epfd, u_events, max, timeout);
+
+   if ((rc = set_temp_sigmask(u_mask, sigsetsize, saved_mask)))
+      return rc;
+
+   rc = sys_epoll_wait(epfd, u_events, max, timeout);
+   restore_temp_sigmask(saved_mask, rc);
+   return rc;
+}
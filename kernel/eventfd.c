@@ -0,0 +1,221 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/syscalls.h>
+
+/*
+ * eventfd: a 64-bit counter with the file interface. Compared to a pipe used
+ * just for wake-ups, it has no data buffer and a write is just an addition
+ * to the counter.
+ */
+
+#define EVENTFD_MAX_COUNT                    (~0ull - 1)
+#define EVENTFD_ALL_FLAGS      (EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE)
+
+struct eventfd {
+
+   KOBJ_BASE_FIELDS
+
+   u64 count;
+   bool semaphore;
+   struct kmutex mutex;
+   struct kcond rcond;                /* count > 0 */
+   struct kcond wcond;                /* count < EVENTFD_MAX_COUNT */
+};
+
+static ssize_t eventfd_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   ssize_t rc = sizeof(u64);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+
+   while (!e->count) {
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         goto out;
+      }
+
+      kcond_wait(&e->rcond, &e->mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         goto out;
+      }
+   }
+
+   val = e->semaphore ? 1 : e->count;
+   e->count -= val;
+   memcpy(buf, &val, sizeof(val));
+   kcond_signal_all(&e->wcond);
+
+out:
+   kmutex_unlock(&e->mutex);
+   return rc;
+}
+
+static ssize_t eventfd_write(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   ssize_t rc = sizeof(u64);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   memcpy(&val, buf, sizeof(val));
+
+   if (val > EVENTFD_MAX_COUNT)
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+
+   while (e->count > EVENTFD_MAX_COUNT - val) {
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         goto out;
+      }
+
+      kcond_wait(&e->wcond, &e->mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         goto out;
+      }
+   }
+
+   e->count += val;
+
+   if (val)
+      kcond_signal_all(&e->rcond);
+
+out:
+   kmutex_unlock(&e->mutex);
+   return rc;
+}
+
+static int eventfd_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->count > 0;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static int eventfd_write_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->count < EVENTFD_MAX_COUNT;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static struct kcond *eventfd_get_rready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   return &e->rcond;
+}
+
+static struct kcond *eventfd_get_wready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   return &e->wcond;
+}
+
+static const struct file_ops static_ops_eventfd =
+{
+   .read = eventfd_read,
+   .write = eventfd_write,
+   .read_ready = eventfd_read_ready,
+   .write_ready = eventfd_write_ready,
+   .get_rready_cond = eventfd_get_rready_cond,
+   .get_wready_cond = eventfd_get_wready_cond,
+};
+
+static void destroy_eventfd(struct eventfd *e)
+{
+   kcond_destory(&e->wcond);
+   kcond_destory(&e->rcond);
+   kmutex_destroy(&e->mutex);
+   kfree_obj(e, struct eventfd);
+}
+
+static struct eventfd *create_eventfd(u64 initval, bool semaphore)
+{
+   struct eventfd *e;
+
+   if (!(e = (void *)kzalloc_obj(struct eventfd)))
+      return NULL;
+
+   e->destory_obj = (void *)&destroy_eventfd;
+   e->count = initval;
+   e->semaphore = semaphore;
+   kmutex_init(&e->mutex, 0);
+   kcond_init(&e->rcond);
+   kcond_init(&e->wcond);
+   return e;
+}
+
+int sys_eventfd2(u32 initval, int flags)
+{
+   struct eventfd *e;
+   fs_handle h;
+   int fd;
+
+   if (flags & ~EVENTFD_ALL_FLAGS)
+      return -EINVAL;
+
+   if (!(e = create_eventfd(initval, !!(flags & EFD_SEMAPHORE))))
+      return -ENOMEM;
+
+   h = kfs_create_new_handle(&static_ops_eventfd,
+                             (void *)e,
+                             O_RDWR | (flags & EFD_NONBLOCK));
+
+   if (!h) {
+      destroy_eventfd(e);
+      return -ENOMEM;
+   }
+
+   fd = install_fs_handle(h, flags & EFD_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (fd < 0)
+      vfs_close(h); /* Destroys also the eventfd object */
+
+   return fd;
+}
+
+int sys_eventfd(u32 initval)
+{
+   return sys_eventfd2(initval, 0);
+}
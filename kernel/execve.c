@@ -11,6 +11,10 @@
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/fs/flock.h>
+#include <tilck/kernel/shm.h>
+#include <tilck/kernel/posix_timers.h>
 
 static const char *const default_env[] =
 {
@@ -322,6 +326,38 @@ handle_noexec(struct elf_program_info *pinfo, const char *path)
       terminate_process(0, term_sig);
 }
 
+/*
+ * After a successful load of the new program, all the other threads of the
+ * process have to go away, because its address space is going to be replaced.
+ */
+static int
+execve_kill_other_threads(struct process *pi)
+{
+   int rc = 0;
+
+   disable_preemption();
+   {
+      if (pi->killing_threads)
+         rc = -EINTR;            /* the process is exiting: give up */
+      else if (pi->threads_count > 1)
+         pi->killing_threads = true;
+   }
+   enable_preemption();
+
+   if (rc || !pi->killing_threads)
+      return rc;
+
+   disable_preemption();
+   {
+      process_kill_other_threads();
+   }
+   enable_preemption();
+
+   process_wait_other_threads();
+   pi->killing_threads = false;
+   return 0;
+}
+
 static int
 do_execve_int(struct execve_ctx *ctx, const char *path, const char *const *argv)
 {
@@ -342,6 +378,28 @@ do_execve_int(struct execve_ctx *ctx, const char *path, const char *const *argv)
       return rc;
    }
 
+   if (LIKELY(ctx->curr_user_task != NULL)) {
+
+      if ((rc = execve_kill_other_threads(ctx->curr_user_task->pi))) {
+
+         pdir_destroy(pinfo.pdir);
+
+         if (pinfo.lf)
+            release_subsys_flock(pinfo.lf);
+
+         return rc;
+      }
+
+      /*
+       * Like the other threads, the SysV shm attachments cannot survive
+       * execve(): detach them before setup_process() destroys the old
+       * address space. The same applies to the POSIX timers, but not to the
+       * ITIMER_REAL timer.
+       */
+      shm_detach_all(ctx->curr_user_task->pi);
+      posix_timers_delete_all(ctx->curr_user_task->pi, true);
+   }
+
    disable_preemption();
    {
       rc = setup_process(&pinfo,
@@ -403,6 +461,9 @@ int sys_execve(const char *user_filename,
    struct task *curr = get_curr_task();
    ASSERT(curr != NULL);
 
+   if (!is_main_thread(curr))
+      return -EINVAL;  /* not supported: the main thread represents the pid */
+
    if ((rc = execve_get_path(user_filename, &path)))
       return rc;
 
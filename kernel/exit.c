@@ -13,6 +13,10 @@
 #include <tilck/kernel/paging_hw.h>
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/futex.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/shm.h>
+#include <tilck/kernel/posix_timers.h>
 
 #include <tilck/mods/tracing.h>
 
@@ -202,30 +206,40 @@ switch_stack_free_mem_and_schedule(void)
 
 
 /*
- * NOTE: this code ASSUMES that user processes have a _single_ thread:
- *
- *    process = task = thread
- *
- * TODO: re-design this function when thread support is introduced.
- *
- * NOTE: the kernel "process" has multiple threads (kthreads), but they cannot
- * be signalled nor killed.
+ * Like switch_stack_free_mem_and_schedule(), but for a thread which is not
+ * the main one: nobody will wait for it with waitpid(), so we also have to
+ * remove it from the scheduler here, as kthread_exit() does.
  */
-void terminate_process(int exit_code, int term_sig)
+NORETURN static NO_INLINE void
+switch_stack_free_mem_remove_and_schedule(void)
 {
-   struct task *const ti = get_curr_task();
-   struct process *const pi = ti->pi;
-   struct task *parent;
-   const bool vforked = pi->vforked;
+   /* WARNING: DO NOT USE ANY STACK VARIABLES HERE */
+   ASSERT_CURR_TASK_STATE(TASK_STATE_ZOMBIE);
 
-   ASSERT(ti->state != TASK_STATE_ZOMBIE);
-   ASSERT(!is_kernel_thread(ti));
-   ASSERT(is_preemption_enabled());
+   /* WARNING: the following call discards the whole stack! */
+   switch_to_initial_kernel_stack();
 
-   if (term_sig)
-      trace_task_killed(term_sig);
+   /* Free the heap allocations used, including the kernel stack */
+   free_mem_for_zombie_task(get_curr_task());
 
-   disable_preemption();
+   /* Remove the task from the scheduler and free its struct */
+   remove_task(get_curr_task());
+
+   disable_interrupts_forced();
+   {
+      set_curr_task(kernel_process);
+   }
+   enable_interrupts_forced();
+   do_schedule();
+
+   /* Reassure the compiler that we won't return */
+   NOT_REACHED();
+}
+
+static void
+task_prepare_for_exit(struct task *ti)
+{
+   ASSERT(!is_preemption_enabled());
 
    if (ti->wobj.type != WOBJ_NONE) {
 
@@ -249,18 +263,128 @@ void terminate_process(int exit_code, int term_sig)
    /* Drop the any pending signals and prevent new from being enqueued */
    drop_all_pending_signals(ti);
    ti->nested_sig_handlers = -1;
+}
+
+/*
+ * Terminate the current thread, which must NOT be the main thread of its
+ * process. The process's resources (memory, handles etc.) are untouched.
+ */
+NORETURN static void
+exit_thread(void)
+{
+   struct task *const ti = get_curr_task();
+   struct process *const pi = ti->pi;
+   int *const clear_child_tid = ti->clear_child_tid;
+   int zero = 0;
+
+   ASSERT(!is_main_thread(ti));
+   ASSERT(is_preemption_enabled());
+
+   disable_preemption();
+   {
+      task_prepare_for_exit(ti);
+   }
+   enable_preemption();
+
+   if (clear_child_tid) {
+
+      /*
+       * CLONE_CHILD_CLEARTID: write 0 at the given address and wake up one
+       * waiter on it. That's what pthread_join() waits for. Errors are
+       * ignored, as on Linux.
+       */
+
+      if (!copy_to_user(clear_child_tid, &zero, sizeof(zero)))
+         futex_wake_addr(clear_child_tid, 1);
+   }
+
+   disable_preemption();
+
+   /* OK, from now on the preemption won't be enabled until the end */
+   task_change_state(ti, TASK_STATE_ZOMBIE);
+
+   call_on_task_exit_callbacks();
+   task_free_all_kernel_allocs(ti);
+
+   list_remove(&ti->threads_node);
+   pi->threads_count--;
+
+   /* Wake-up the tasks waiting on this thread (e.g. a dying main thread) */
+   wake_up_tasks_waiting_on(ti, task_died);
+   switch_stack_free_mem_remove_and_schedule();
+}
+
+/*
+ * Terminate the whole process (exit_group() or a fatal signal). In case of
+ * multiple threads, the first one getting here kills all the others. The
+ * non-main threads just exit, while the main thread waits for all of them
+ * before releasing the resources of the process.
+ *
+ * NOTE: the kernel "process" has multiple threads (kthreads), but they cannot
+ * be signalled nor killed.
+ */
+void terminate_process(int exit_code, int term_sig)
+{
+   struct task *const ti = get_curr_task();
+   struct process *const pi = ti->pi;
+   struct task *parent;
+   const bool vforked = pi->vforked;
+
+   ASSERT(ti->state != TASK_STATE_ZOMBIE);
+   ASSERT(!is_kernel_thread(ti));
+   ASSERT(is_preemption_enabled());
+
+   if (term_sig)
+      trace_task_killed(term_sig);
+
+   disable_preemption();
+
+   if (pi->threads_count > 1 || !is_main_thread(ti)) {
+
+      if (!pi->killing_threads) {
+         pi->killing_threads = true;
+         pi->group_exit = true;
+         pi->group_exit_wstatus = EXITCODE(exit_code, term_sig);
+         process_kill_other_threads();
+      }
+
+      if (!is_main_thread(ti)) {
+         enable_preemption();
+         exit_thread();
+      }
+
+      task_prepare_for_exit(ti);
+      enable_preemption();
+      {
+         process_wait_other_threads();
+      }
+      disable_preemption();
+
+   } else {
+
+      task_prepare_for_exit(ti);
+   }
 
    /*
     * Close all the handles, keeping the preemption enabled while doing so.
     */
    enable_preemption();
    {
+      posix_timers_delete_all(pi, false);
+      shm_detach_all(pi);
       close_all_handles();
    }
    disable_preemption();
 
    /* OK, from now on the preemption won't be enabled until the end */
    task_change_state(ti, TASK_STATE_ZOMBIE);
+
+   if (pi->group_exit) {
+      /* The thread which started the group exit decided the exit status */
+      exit_code = pi->group_exit_wstatus >> 8;
+      term_sig = pi->group_exit_wstatus & 0xff;
+   }
+
    ti->wstatus = EXITCODE(exit_code, term_sig);
    parent = get_task(pi->parent_pid);
 
@@ -337,3 +461,33 @@ void terminate_process(int exit_code, int term_sig)
 
    switch_stack_free_mem_and_schedule();
 }
+
+/*
+ * exit() of a single thread: the process terminates only when its last thread
+ * exits. The main thread cannot just go away, because it represents the
+ * whole process: it waits for the other threads and then terminates the
+ * process with its own exit code.
+ */
+void terminate_thread(int exit_code)
+{
+   struct task *const ti = get_curr_task();
+   struct process *const pi = ti->pi;
+
+   ASSERT(is_preemption_enabled());
+
+   if (!is_main_thread(ti))
+      exit_thread();
+
+   if (pi->threads_count > 1) {
+
+      disable_preemption();
+      {
+         /* Process-wide signals will be delivered to the other threads */
+         task_prepare_for_exit(ti);
+      }
+      enable_preemption();
+      process_wait_other_threads();
+   }
+
+   terminate_process(exit_code, 0);
+}
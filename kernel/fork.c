@@ -9,6 +9,8 @@
 #include <tilck/kernel/paging.h>
 #include <tilck/kernel/paging_hw.h>
 #include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/shm.h>
 
 static int fork_dup_all_handles(struct process *pi)
 {
@@ -52,11 +54,25 @@ static int fork_dup_all_handles(struct process *pi)
       }
    }
 
+   /* The handles of the SysV shm attachments are not in the handle table */
+   if (!pi->vforked && shm_fork_attachments(pi) < 0) {
+
+      enable_preemption();
+      {
+         for (u32 i = 0; i < MAX_HANDLES; i++) {
+            if (pi->handles[i])
+               vfs_close(pi->handles[i]);
+         }
+      }
+      disable_preemption();
+      return -ENOMEM;
+   }
+
    return 0;
 }
 
 // Returns child's pid
-int do_fork(bool vfork)
+static int do_fork_int(bool vfork, void *newsp)
 {
    int pid;
    int rc = -EAGAIN;
@@ -104,6 +120,12 @@ int do_fork(bool vfork)
    *child->state_regs = *curr->state_regs; // copy parent's regs_t
    set_return_register(child->state_regs, 0);
 
+   if (newsp)
+      regs_set_user_stack_ptr(child->state_regs, (ulong)newsp);
+
+   /* The child keeps using the TLS segment of the parent: cannot fail */
+   arch_setup_task_tls(child, curr, NULL);
+
    // Make the parent to get child's pid as return value.
    set_return_register(curr->state_regs, (ulong) child->tid);
 
@@ -170,3 +192,138 @@ out:
    enable_preemption();
    return rc;
 }
+
+int do_fork(bool vfork)
+{
+   return do_fork_int(vfork, NULL);
+}
+
+#define CLONE_THREAD_FLAGS                                                 \
+   (CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD)
+
+#define CLONE_THREAD_OPT_FLAGS                                             \
+   (                                                                       \
+      CLONE_SYSVSEM | CLONE_SETTLS | CLONE_PARENT_SETTID |                 \
+      CLONE_CHILD_CLEARTID | CLONE_CHILD_SETTID | CLONE_DETACHED           \
+   )
+
+/*
+ * Create a new thread in the current process. The new task shares everything
+ * with the other threads: the address space (pdir), the handles, the cwd and
+ * the signal handlers, because all of them live in `struct process`.
+ */
+static int
+do_clone_thread(ulong flags,
+                void *newsp,
+                int *parent_tid,
+                void *tls,
+                int *child_tid)
+{
+   struct task *curr = get_curr_task();
+   struct process *pi = curr->pi;
+   struct task *child = NULL;
+   void *u_tls = (flags & CLONE_SETTLS) ? tls : NULL;
+   int tid, rc = -EAGAIN;
+
+   if ((flags & CLONE_THREAD_FLAGS) != CLONE_THREAD_FLAGS)
+      return -EINVAL;    /* partial sharing is not supported */
+
+   if (flags & ~(CLONE_THREAD_FLAGS | CLONE_THREAD_OPT_FLAGS | CSIGNAL))
+      return -EINVAL;
+
+   disable_preemption();
+   ASSERT_TASK_STATE(curr->state, TASK_STATE_RUNNING);
+
+   if (pi->killing_threads || pi->vforked)
+      goto out;          /* NOTE: rc is already set to -EAGAIN */
+
+   if ((tid = create_new_pid()) < 0)
+      goto out;
+
+   if (!(child = allocate_new_thread(pi, tid, true))) {
+      rc = -ENOMEM;
+      goto out;
+   }
+
+   child->state = TASK_STATE_RUNNABLE;
+   child->running_in_kernel = false;
+   task_info_reset_kernel_stack(child);
+
+   child->state_regs--; // make room for a regs_t struct in child's stack
+   *child->state_regs = *curr->state_regs; // copy parent's regs_t
+   set_return_register(child->state_regs, 0);
+
+   if (newsp)
+      regs_set_user_stack_ptr(child->state_regs, (ulong)newsp);
+
+   /* The signal mask is per-thread and it's inherited from the parent */
+   memcpy(child->sa_mask, curr->sa_mask, sizeof(curr->sa_mask));
+
+   if ((rc = arch_setup_task_tls(child, curr, u_tls)))
+      goto err;
+
+   if (flags & CLONE_PARENT_SETTID) {
+      if (copy_to_user(parent_tid, &tid, sizeof(tid))) {
+         rc = -EFAULT;
+         goto err;
+      }
+   }
+
+   if (flags & CLONE_CHILD_SETTID) {
+      if (copy_to_user(child_tid, &tid, sizeof(tid))) {
+         rc = -EFAULT;
+         goto err;
+      }
+   }
+
+   if (flags & CLONE_CHILD_CLEARTID)
+      child->clear_child_tid = child_tid;
+
+   list_add_tail(&pi->threads, &child->threads_node);
+   pi->threads_count++;
+   add_task(child);
+
+   enable_preemption();
+   return tid;
+
+err:
+   child->state = TASK_STATE_ZOMBIE;
+   free_common_task_allocs(child);
+   free_task(child);
+
+out:
+   enable_preemption();
+   return rc;
+}
+
+// Returns child's tid
+int do_clone(ulong flags,
+             void *newsp,
+             int *parent_tid,
+             void *tls,
+             int *child_tid)
+{
+   const int exit_sig = (int)(flags & CSIGNAL);
+
+   if (flags & CLONE_THREAD)
+      return do_clone_thread(flags, newsp, parent_tid, tls, child_tid);
+
+   /*
+    * Without CLONE_THREAD, only the cases equivalent to fork() and vfork()
+    * are supported. That covers the use of clone() made by libmusl for
+    * fork() and posix_spawn().
+    */
+
+   if (exit_sig && exit_sig != SIGCHLD)
+      return -EINVAL;
+
+   flags &= ~CSIGNAL;
+
+   if (!flags)
+      return do_fork_int(false, newsp);
+
+   if (flags == CLONE_VFORK || flags == (CLONE_VFORK | CLONE_VM))
+      return do_fork_int(true, newsp);
+
+   return -EINVAL;
+}
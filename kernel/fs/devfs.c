@@ -14,6 +14,7 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/rwlock.h>
+#include <tilck/kernel/lock_stats.h>
 #include <tilck/kernel/paging.h>
 
 #include <dirent.h> // system header
@@ -483,6 +484,7 @@ static const struct fs_ops static_fsops_devfs =
    .unlink = NULL,
    .mkdir = NULL,
    .rmdir = NULL,
+   .mknod = NULL,
    .truncate = NULL,
    .stat = devfs_stat,
    .chmod = NULL,
@@ -522,6 +524,7 @@ create_devfs(void)
    d->root_dir.inode = devfs_get_next_inode(d);
    list_init(&d->root_dir.files_list);
    rwlock_wp_init(&d->rwlock, false);
+   LOCK_STATS_NAME(&d->rwlock, rwlock_wp, "devfs fs");
    d->wrt_time = (time_t)get_timestamp();
 
    return fs;
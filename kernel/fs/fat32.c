@@ -9,6 +9,7 @@
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/user.h>
+#include <tilck/kernel/fs/flock.h>
 
 #include <dirent.h> // system header
 
@@ -32,25 +33,55 @@ fat_fs_walk_generic(struct fat_fs_device_data *d,
                      : fat_get_first_cluster(e));
 }
 
-STATIC ssize_t
-fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
+/*
+ * Return the cluster containing the byte at offset `off` in the file, by
+ * walking its cluster chain from the beginning. Used by the positional reads,
+ * which cannot rely on the handle's cached `curr_cluster`.
+ */
+static u32
+fat_get_cluster_at_off(struct fat_fs_device_data *d,
+                       struct fat_entry *e,
+                       offt off)
 {
-   struct fatfs_handle *h = (struct fatfs_handle *) handle;
-   struct fat_fs_device_data *d = h->fs->device_data;
-   offt fsize = (offt)h->e->DIR_FileSize;
-   offt written_to_buf = 0;
+   u32 cluster = fat_get_first_cluster(e);
+   offt n = off / (offt)d->cluster_size;
 
-   if (pos != &h->h_fpos) {
+   for (; n > 0; n--) {
 
-      /*
-       * We don't support pread() for this filesystem, at the moment.
-       * TODO: make fat32 support pread64().
-       */
-      return -EPERM;
+      u32 fatval = fat_read_fat_entry(d->hdr, d->type, 0, cluster);
+
+      if (fat_is_end_of_clusterchain(d->type, fatval))
+         break;
+
+      ASSERT(!fat_is_bad_cluster(d->type, fatval));
+      cluster = fatval;
    }
 
-   if (h->e->directory)
-      return -EISDIR;
+   return cluster;
+}
+
+/*
+ * Read file's data into a vector of buffers, walking the cluster chain and the
+ * iovecs together. When `user` is true, the buffers are in user space.
+ *
+ * On r/w mounts, the FAT might not be up-to-date (see fat32_rw.c): the file's
+ * clusters are found using the extent map in `h->fi` instead.
+ */
+static ssize_t
+fat_read_nolock(struct fatfs_handle *h,
+                const struct iovec *iov,
+                int iovcnt,
+                offt *pos,
+                bool user)
+{
+   struct fat_fs_device_data *d = h->fs->device_data;
+   struct fat_inode *fi = h->fi;
+   const bool use_handle_pos = (pos == &h->h_fpos) && !fi;
+   offt fsize = fi ? (offt)fi->fsize : (offt)h->e->DIR_FileSize;
+   ssize_t tot_read = 0;
+   size_t iov_off = 0;
+   u32 cluster;
+   int i = 0;
 
    if (*pos >= fsize) {
 
@@ -61,34 +92,71 @@ fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
       return 0;
    }
 
-   do {
+   if (fi)
+      cluster = fat_inode_get_cluster(fi, (u32)(*pos / d->cluster_size));
+   else if (use_handle_pos)
+      cluster = h->curr_cluster;
+   else
+      cluster = fat_get_cluster_at_off(d, h->e, *pos);
 
-      char *data = fat_get_pointer_to_cluster_data(d->hdr, h->curr_cluster);
+   while (i < iovcnt && *pos < fsize) {
 
       const offt file_rem       = fsize - *pos;
-      const offt buf_rem        = (offt)bufsize - written_to_buf;
+      const offt iov_rem        = (offt)(iov[i].iov_len - iov_off);
       const offt cluster_off    = *pos % (offt)d->cluster_size;
       const offt cluster_rem    = (offt)d->cluster_size - cluster_off;
-      const offt to_read        = MIN3(cluster_rem, buf_rem, file_rem);
+      const offt to_read        = MIN3(cluster_rem, iov_rem, file_rem);
+      char *dest = (char *)iov[i].iov_base + iov_off;
+      char *data;
+
+      if (!iov_rem) {
+         i++;
+         iov_off = 0;
+         continue;
+      }
+
+      ASSERT(to_read > 0);
+      data = fat_get_pointer_to_cluster_data(d->hdr, cluster) + cluster_off;
+
+      if (user) {
+
+         if (copy_to_user(dest, data, (size_t)to_read)) {
+
+            if (!tot_read)
+               tot_read = -EFAULT;
+
+            break;
+         }
+
+      } else {
 
-      ASSERT(to_read >= 0);
+         memcpy(dest, data, (size_t)to_read);
+      }
 
-      memcpy(buf + written_to_buf, data + cluster_off, (size_t)to_read);
-      written_to_buf += to_read;
+      tot_read += (ssize_t)to_read;
+      iov_off += (size_t)to_read;
       *pos += to_read;
 
       if (to_read < cluster_rem) {
 
          /*
-          * We read less than cluster_rem because the buf was not big enough
-          * or because the file was not big enough. In either case, we cannot
-          * continue.
+          * We read less than cluster_rem because the buffer was not big enough
+          * or because the file was not big enough. In the first case, we'll
+          * continue with the next buffer, in the same cluster.
           */
-         break;
+         continue;
+      }
+
+      if (fi) {
+
+         if (*pos < fsize)
+            cluster = fat_inode_get_cluster(fi, (u32)(*pos / d->cluster_size));
+
+         continue;
       }
 
       // find the next cluster
-      u32 fatval = fat_read_fat_entry(d->hdr, d->type, 0, h->curr_cluster);
+      u32 fatval = fat_read_fat_entry(d->hdr, d->type, 0, cluster);
 
       if (fat_is_end_of_clusterchain(d->type, fatval)) {
          ASSERT(*pos == fsize);
@@ -98,11 +166,49 @@ fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
       // we do not expect BAD CLUSTERS
       ASSERT(!fat_is_bad_cluster(d->type, fatval));
 
-      h->curr_cluster = fatval; // go reading the new cluster in the chain.
+      cluster = fatval; // go reading the new cluster in the chain.
+   }
 
-   } while (true);
+   if (use_handle_pos)
+      h->curr_cluster = cluster;
+
+   return tot_read;
+}
+
+static ssize_t
+fat_read_int(struct fatfs_handle *h,
+             const struct iovec *iov,
+             int iovcnt,
+             offt *pos,
+             bool user)
+{
+   ssize_t rc;
+
+   if (h->e->directory)
+      return -EISDIR;
+
+   if (!h->fi)
+      return fat_read_nolock(h, iov, iovcnt, pos, user);
 
-   return (ssize_t)written_to_buf;
+   rwlock_wp_shlock(&h->fi->rwlock);
+   {
+      rc = fat_read_nolock(h, iov, iovcnt, pos, user);
+   }
+   rwlock_wp_shunlock(&h->fi->rwlock);
+   return rc;
+}
+
+STATIC ssize_t
+fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
+{
+   struct iovec iov = { .iov_base = buf, .iov_len = bufsize };
+   return fat_read_int(handle, &iov, 1, pos, false);
+}
+
+STATIC ssize_t
+fat_readv(fs_handle handle, const struct iovec *iov, int iovcnt, offt *pos)
+{
+   return fat_read_int(handle, iov, iovcnt, pos, true);
 }
 
 
@@ -126,6 +232,12 @@ fat_seek_forward(fs_handle handle, offt dist)
    if (dist == 0)
       return h->h_fpos;
 
+   if (h->fi) {
+      /* r/w mounts: the clusters are looked up in the extent map */
+      h->h_fpos += dist;
+      return h->h_fpos;
+   }
+
    if (h->h_fpos + dist > fsize) {
       /* Allow, like Linux does, to seek past the end of a file. */
       h->h_fpos += dist;
@@ -247,7 +359,7 @@ fat_seek(fs_handle handle, offt off, int whence)
             break;
 
          struct fatfs_handle *h = (struct fatfs_handle *) handle;
-         off = (offt) h->e->DIR_FileSize + off;
+         off = (offt)(h->fi ? h->fi->fsize : h->e->DIR_FileSize) + off;
 
          if (off < 0)
             return -EINVAL;
@@ -319,7 +431,9 @@ STATIC int fat_stat(struct mnt_fs *fs,
    statbuf->st_uid = 0; /* root */
    statbuf->st_gid = 0; /* root */
    statbuf->st_rdev = 0; /* device ID, if a special file */
-   statbuf->st_size = e->DIR_FileSize;
+   statbuf->st_size = (fs->flags & VFS_FS_RW)
+      ? fat_get_file_size_rw(fs->device_data, e)
+      : e->DIR_FileSize;
    statbuf->st_blksize = 4096;
    statbuf->st_blocks = statbuf->st_size / 512;
 
@@ -409,48 +523,85 @@ static int fat_getdents(fs_handle h, get_dents_func_cb cb, void *arg)
 
 STATIC void fat_exclusive_lock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_exlock(&d->rwlock);
 }
 
 STATIC void fat_exclusive_unlock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_exunlock(&d->rwlock);
 }
 
 STATIC void fat_shared_lock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_shlock(&d->rwlock);
 }
 
 STATIC void fat_shared_unlock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_shunlock(&d->rwlock);
 }
 
 STATIC ssize_t fat_write(fs_handle handle, char *buf, size_t len, offt *pos)
 {
    struct fatfs_handle *h = (struct fatfs_handle *) handle;
-   struct mnt_fs *fs = h->fs;
+   struct iovec iov = { .iov_base = buf, .iov_len = len };
 
    if (h->e->directory)
       return -EISDIR;
 
-   if (!(fs->flags & VFS_FS_RW))
+   if (!(h->fs->flags & VFS_FS_RW))
+      return -EBADF; /* read-only file system: can't write */
+
+   return fat_write_int(h, &iov, 1, pos, false);
+}
+
+STATIC ssize_t
+fat_writev(fs_handle handle, const struct iovec *iov, int iovcnt, offt *pos)
+{
+   struct fatfs_handle *h = (struct fatfs_handle *) handle;
+
+   if (h->e->directory)
+      return -EISDIR;
+
+   if (!(h->fs->flags & VFS_FS_RW))
       return -EBADF; /* read-only file system: can't write */
 
-   NOT_IMPLEMENTED();
+   return fat_write_int(h, iov, iovcnt, pos, true);
+}
+
+static int fat_fsync(fs_handle handle)
+{
+   struct fatfs_handle *h = (struct fatfs_handle *) handle;
+
+   if (!h->fi)
+      return 0;
+
+   rwlock_wp_exlock(&h->fi->rwlock);
+   {
+      fat_flush_inode(h->fs->device_data, h->fi);
+   }
+   rwlock_wp_exunlock(&h->fi->rwlock);
+   return 0;
 }
 
 STATIC int fat_ioctl(fs_handle h, ulong request, void *arg)
@@ -461,13 +612,40 @@ STATIC int fat_ioctl(fs_handle h, ulong request, void *arg)
 static const struct file_ops static_ops_fat =
 {
    .read = fat_read,
+   .readv = fat_readv,
+   .writev = fat_writev,
    .seek = fat_seek,
    .write = fat_write,
+   .sync = fat_fsync,
+   .datasync = fat_fsync,
    .ioctl = fat_ioctl,
    .mmap = fat_mmap,
    .munmap = fat_munmap,
 };
 
+/*
+ * On r/w mounts, all the handles of a regular file share a fat_inode object.
+ */
+static int
+fat_open_rw(struct mnt_fs *fs, struct fatfs_handle *h, int fl)
+{
+   struct fat_fs_device_data *d = fs->device_data;
+   int rc;
+
+   if ((rc = fat_get_inode_obj(d, h->e, &h->fi)))
+      return rc;
+
+   if (fl & O_TRUNC) {
+      if ((rc = fat_inode_truncate(d, h->fi, 0))) {
+         fat_put_inode_obj(d, h->fi);
+         h->fi = NULL;
+         return rc;
+      }
+   }
+
+   return 0;
+}
+
 STATIC int
 fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
 {
@@ -476,6 +654,9 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    struct fat_fs_path *fp = (struct fat_fs_path *)&p->fs_path;
    struct fat_entry *e = fp->entry;
    struct fat_fs_device_data *d = fs->device_data;
+   struct locked_file *lf = NULL;
+   const bool is_file = e && !e->directory && !e->volume_id;
+   int rc;
 
    if (!e) {
 
@@ -483,6 +664,9 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
          if (fl & O_CREAT)
             return -EROFS;
 
+      if (fl & O_CREAT)
+         return -EPERM; /* creating new dir entries is not supported */
+
       return -ENOENT;
    }
 
@@ -493,12 +677,43 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
       if (fl & (O_WRONLY | O_RDWR))
          return -EROFS;
 
-   if (!(h = vfs_create_new_handle(fs, &static_ops_fat)))
+   if (!is_file && (fl & (O_WRONLY | O_RDWR)))
+      return -EISDIR;
+
+   if ((fl & O_TRUNC) && !(fl & (O_WRONLY | O_RDWR)))
+      return -EINVAL;
+
+   if (is_file && (fl & (O_WRONLY | O_RDWR))) {
+      if ((rc = acquire_subsys_flock(fs, e, SUBSYS_VFS, &lf)))
+         return rc;
+   }
+
+   if (!(h = vfs_create_new_handle(fs, &static_ops_fat))) {
+
+      if (lf)
+         release_subsys_flock(lf);
+
       return -ENOMEM;
+   }
 
    h->e = e;
    h->h_fpos = 0;
    h->curr_cluster = fat_get_first_cluster(e);
+   h->fi = NULL;
+   h->lf = lf;
+
+   if (is_file && (fs->flags & VFS_FS_RW)) {
+
+      if ((rc = fat_open_rw(fs, h, fl))) {
+
+         vfs_free_handle(h);
+
+         if (lf)
+            release_subsys_flock(lf);
+
+         return rc;
+      }
+   }
 
    if (d->mmap_support)
       h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
@@ -507,6 +722,45 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    return 0;
 }
 
+static void fat_on_close(fs_handle handle)
+{
+   struct fatfs_handle *h = handle;
+
+   if (h->fi)
+      fat_put_inode_obj(h->fs->device_data, h->fi);
+}
+
+static int fat_on_dup(fs_handle new_handle)
+{
+   struct fatfs_handle *h = new_handle;
+
+   if (h->fi)
+      retain_obj(h->fi);
+
+   return 0;
+}
+
+static int fat_truncate(struct mnt_fs *fs, vfs_inode_ptr_t i, offt len)
+{
+   struct fat_fs_device_data *d = fs->device_data;
+   struct fat_entry *e = i;
+   struct fat_inode *fi;
+   int rc;
+
+   if (!(fs->flags & VFS_FS_RW))
+      return -EROFS;
+
+   if (e->directory || e->volume_id)
+      return -EISDIR;
+
+   if ((rc = fat_get_inode_obj(d, e, &fi)))
+      return rc;
+
+   rc = fat_inode_truncate(d, fi, len);
+   fat_put_inode_obj(d, fi);
+   return rc;
+}
+
 static inline void
 fat_get_root_entry(struct fat_fs_device_data *d, struct fat_fs_path *fp)
 {
@@ -578,19 +832,18 @@ static vfs_inode_ptr_t fat_get_inode(fs_handle h)
    return ((struct fatfs_handle *)h)->e;
 }
 
+/*
+ * Dir entries cannot be removed (see fat32_rw.c), so they never need to be
+ * ref-counted, not even on r/w mounts. The per-file state used for writing
+ * is ref-counted by the file handles, see fat_open() and fat_on_close().
+ */
 static int fat_retain_inode(struct mnt_fs *fs, vfs_inode_ptr_t inode)
 {
-   if (fs->flags & VFS_FS_RW)
-      NOT_IMPLEMENTED();
-
    return 1;
 }
 
 static int fat_release_inode(struct mnt_fs *fs, vfs_inode_ptr_t inode)
 {
-   if (fs->flags & VFS_FS_RW)
-      NOT_IMPLEMENTED();
-
    return 1;
 }
 
@@ -598,11 +851,14 @@ static const struct fs_ops static_fsops_fat =
 {
    .get_inode = fat_get_inode,
    .open = fat_open,
+   .on_close = fat_on_close,
+   .on_dup_cb = fat_on_dup,
    .getdents = fat_getdents,
    .unlink = NULL,
    .mkdir = NULL,
    .rmdir = NULL,
-   .truncate = NULL,
+   .mknod = NULL,
+   .truncate = fat_truncate,
    .stat = fat_stat,
    .chmod = NULL,
    .get_entry = fat_get_entry,
@@ -610,6 +866,7 @@ static const struct fs_ops static_fsops_fat =
    .link = NULL,
    .retain_inode = fat_retain_inode,
    .release_inode = fat_release_inode,
+   .syncfs = fat_syncfs,
 
    .fs_exlock = fat_exclusive_lock,
    .fs_exunlock = fat_exclusive_unlock,
@@ -622,25 +879,34 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
    struct fat_fs_device_data *d;
    struct mnt_fs *fs;
 
-   if (flags & VFS_FS_RW)
-      panic("fat_mount_ramdisk: r/w mode is NOT currently supported");
-
    d = kzalloc_obj(struct fat_fs_device_data);
 
    if (!d)
       return NULL;
 
    d->hdr = (struct fat_hdr *) vaddr;
+   d->rd_size = rd_size;
    d->type = fat_get_type(d->hdr);
    d->cluster_size = d->hdr->BPB_SecPerClus * d->hdr->BPB_BytsPerSec;
    d->root_dir_entries = fat_get_rootdir(d->hdr, d->type, &d->root_cluster);
 
+   if (flags & VFS_FS_RW) {
+      if (fat_rw_init(d)) {
+         kfree_obj(d, struct fat_fs_device_data);
+         return NULL;
+      }
+   }
+
    fs = create_fs_obj("fat",
                       &static_fsops_fat,
                       d,
                       flags | VFS_FS_RQ_DE_SKIP);
 
    if (!fs) {
+
+      if (flags & VFS_FS_RW)
+         fat_rw_destroy(d);
+
       kfree_obj(d, struct fat_fs_device_data);
       return NULL;
    }
@@ -653,6 +919,11 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
 
 void fat_umount_ramdisk(struct mnt_fs *fs)
 {
+   if (fs->flags & VFS_FS_RW) {
+      vfs_syncfs(fs);
+      fat_rw_destroy(fs->device_data);
+   }
+
    kfree_obj(fs->device_data, struct fat_fs_device_data);
    destory_fs_obj(fs);
 }
@@ -2,6 +2,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
 
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/paging.h>
@@ -93,7 +94,7 @@ int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size)
    return 0;
 }
 
-int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+static int fat_mmap_int(struct user_mapping *um, pdir_t *pdir)
 {
    struct fatfs_handle *fh = um->h;
    struct fat_fs_device_data *d = fh->fs->device_data;
@@ -101,18 +102,10 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    const size_t off_end = off_begin + um->len;
    ulong vaddr = um->vaddr, off = 0;
    size_t mapped_cnt, tot_mapped_cnt = 0;
-   u32 clu;
-
-   if (!d->mmap_support)
-      return -ENODEV; /* We do NOT support mmap for this "superblock" */
+   u32 clu = fat_get_first_cluster(fh->e);
 
-   if (fh->e->directory)
-      return -EACCES;
-
-   if (flags & VFS_MM_DONT_MMAP)
-      return 0;
-
-   clu = fat_get_first_cluster(fh->e);
+   if (!clu)
+      return 0; /* empty file: no clusters to map */
 
    do {
 
@@ -182,6 +175,75 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    return 0;
 }
 
+int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   struct fatfs_handle *fh = um->h;
+   struct fat_fs_device_data *d = fh->fs->device_data;
+   int rc;
+
+   if (!d->mmap_support)
+      return -ENODEV; /* We do NOT support mmap for this "superblock" */
+
+   if (fh->e->directory)
+      return -EACCES;
+
+   if (flags & VFS_MM_DONT_MMAP)
+      goto register_mapping;
+
+   if (!fh->fi)
+      return fat_mmap_int(um, pdir);
+
+   /*
+    * On r/w mounts, the cluster chain in the FAT might be outdated: flush the
+    * pending changes of the file before walking it.
+    */
+   rwlock_wp_exlock(&fh->fi->rwlock);
+   {
+      fat_flush_inode(d, fh->fi);
+      rc = fat_mmap_int(um, pdir);
+
+      if (!rc && !(flags & VFS_MM_DONT_REGISTER))
+         list_add_tail(&fh->fi->mappings_list, &um->inode_node);
+   }
+   rwlock_wp_exunlock(&fh->fi->rwlock);
+   return rc;
+
+register_mapping:
+   /* Only r/w mounts need the mappings: files cannot shrink otherwise */
+   if (fh->fi && !(flags & VFS_MM_DONT_REGISTER))
+      list_add_tail(&fh->fi->mappings_list, &um->inode_node);
+
+   return 0;
+}
+
+/*
+ * Called when the file shrinks to `len` bytes, before freeing its clusters:
+ * unmap from all the user mappings the pages past the new EOF, as the clusters
+ * might be reused by other files. See ramfs_unmap_past_eof_mappings().
+ */
+void fat_unmap_past_eof_mappings(struct fat_inode *fi, size_t len)
+{
+   const size_t rlen = pow2_round_up_at(len, PAGE_SIZE);
+   struct user_mapping *um;
+   ulong va;
+
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(um, &fi->mappings_list, inode_node) {
+
+      if (um->off + um->len <= rlen)
+         continue;
+
+      const ulong voff = rlen >= um->off ? rlen - um->off : 0;
+      const ulong vend = um->vaddr + um->len;
+
+      for (va = um->vaddr + voff; va < vend; va += PAGE_SIZE) {
+         unmap_page_permissive(um->pi->pdir, (void *)va, false);
+         invalidate_page(va);
+      }
+   }
+}
+
 int fat_munmap(struct user_mapping *um, void *vaddrp, size_t len)
 {
    struct fatfs_handle *fh = um->h;
@@ -0,0 +1,772 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/fs/fat32.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/lock_stats.h>
+
+/*
+ * Write support for FAT ramdisks
+ * ---------------------------------
+ *
+ * The FAT partition lives entirely in memory, so writing file's data is just
+ * a memcpy(). The metadata is what makes writes on FAT expensive: finding a
+ * free cluster means scanning the FAT and finding the N-th cluster of a file
+ * means walking its cluster chain. Therefore, on r/w mounts:
+ *
+ *    - free clusters are tracked by an in-memory bitmap, built once at mount
+ *      time. Allocating a cluster is O(1) when the cluster right after the
+ *      last one of the file is free (the typical case).
+ *
+ *    - each open file has a `struct fat_inode` caching its cluster chain as
+ *      an extent map (contiguous runs of clusters) which is used by both the
+ *      read and the write paths.
+ *
+ *    - the changes to the FAT and to file's dir entry (first cluster, size,
+ *      write time) are deferred until fat_flush_inode() is called by fsync()
+ *      or by syncfs(). At that point, only the FAT entries of the clusters
+ *      appended after the last flush are written.
+ *
+ * NOTE: only existing files can be written, truncated or extended: creating
+ * or removing dir entries is not supported.
+ */
+
+#define FAT_MAX_FILE_SIZE   ((offt)MIN((u64)0xFFFFFFFFu, (u64)OFFT_MAX))
+
+static inline u32 fat_bitmap_words(struct fat_fs_device_data *d)
+{
+   return (u32)div_round_up(d->clu_end, NBITS);
+}
+
+int fat_rw_init(struct fat_fs_device_data *d)
+{
+   d->clu_end = fat_get_clusters_end_in_size(d->hdr, d->rd_size);
+   d->free_bitmap = kzalloc_array_obj(ulong, fat_bitmap_words(d));
+
+   if (!d->free_bitmap)
+      return -ENOMEM;
+
+   d->free_count = fat_build_free_clusters_bitmap(d->hdr,
+                                                  d->type,
+                                                  d->free_bitmap,
+                                                  d->clu_end);
+   d->next_free = 2;
+   d->inodes_root = NULL;
+   rwlock_wp_init(&d->rwlock, false);
+   LOCK_STATS_NAME(&d->rwlock, rwlock_wp, "fat32 fs");
+   list_init(&d->dirty_list);
+   return 0;
+}
+
+static void fat_destroy_inode_obj(struct fat_inode *fi)
+{
+   ASSERT(list_is_empty(&fi->mappings_list));
+
+   if (fi->extents)
+      kfree_array_obj(fi->extents, struct fat_extent, fi->extents_cap);
+
+   rwlock_wp_destroy(&fi->rwlock);
+   kfree_obj(fi, struct fat_inode);
+}
+
+void fat_rw_destroy(struct fat_fs_device_data *d)
+{
+   struct fat_inode *fi;
+
+   while ((fi = d->inodes_root)) {
+      ASSERT(get_ref_count(fi) == 0);
+
+      bintree_remove_ptr(&d->inodes_root,
+                         fi,
+                         struct fat_inode,
+                         node,
+                         e);
+
+      fat_destroy_inode_obj(fi);
+   }
+
+   rwlock_wp_destroy(&d->rwlock);
+   kfree_array_obj(d->free_bitmap, ulong, fat_bitmap_words(d));
+   d->free_bitmap = NULL;
+}
+
+/* ------------------------ Free clusters bitmap ---------------------------- */
+
+static inline bool fat_is_cluster_free(struct fat_fs_device_data *d, u32 clu)
+{
+   if (clu < 2 || clu >= d->clu_end)
+      return false;
+
+   return !!(d->free_bitmap[clu / NBITS] & (1UL << (clu % NBITS)));
+}
+
+/*
+ * Find a free cluster, starting from `start` and wrapping around at the end.
+ * Returns 0 when there are no free clusters.
+ */
+static u32 fat_find_free_cluster(struct fat_fs_device_data *d, u32 start)
+{
+   const u32 words = fat_bitmap_words(d);
+   const u32 first_w = start / NBITS;
+   ulong val;
+   u32 w;
+
+   ASSERT(!is_preemption_enabled());
+
+   for (u32 n = 0; n <= words; n++) {
+
+      w = (first_w + n) % words;
+      val = d->free_bitmap[w];
+
+      if (!n && (start % NBITS))
+         val &= ~make_bitmask(start % NBITS); /* skip the bits before start */
+
+      if (val)
+         return w * NBITS + get_first_set_bit_index_l(val);
+   }
+
+   return 0;
+}
+
+/*
+ * Allocate a free cluster, preferring `hint` (typically the cluster right
+ * after the last one of a file) if it's free. Returns 0 if the disk is full.
+ */
+static u32 fat_alloc_cluster(struct fat_fs_device_data *d, u32 hint)
+{
+   u32 clu = 0;
+
+   disable_preemption();
+   {
+      if (fat_is_cluster_free(d, hint))
+         clu = hint;
+      else if (d->free_count)
+         clu = fat_find_free_cluster(d, d->next_free);
+
+      if (clu) {
+
+         ASSERT(fat_is_cluster_free(d, clu));
+         d->free_bitmap[clu / NBITS] &= ~(1UL << (clu % NBITS));
+         d->free_count--;
+         d->next_free = clu + 1 < d->clu_end ? clu + 1 : 2;
+      }
+   }
+   enable_preemption();
+   return clu;
+}
+
+static void
+fat_free_clusters(struct fat_fs_device_data *d, u32 clu, u32 count)
+{
+   disable_preemption();
+   {
+      for (u32 c = clu; c < clu + count; c++) {
+         ASSERT(!fat_is_cluster_free(d, c));
+         d->free_bitmap[c / NBITS] |= (1UL << (c % NBITS));
+      }
+
+      d->free_count += count;
+      d->freed_clusters = true;
+   }
+   enable_preemption();
+}
+
+/* --------------------------- Extent map ----------------------------------- */
+
+static void
+fat_inode_mark_dirty(struct fat_fs_device_data *d, struct fat_inode *fi)
+{
+   ASSERT(rwlock_wp_holding_exlock(&fi->rwlock));
+
+   if (fi->dirty)
+      return;
+
+   disable_preemption();
+   {
+      fi->dirty = true;
+      list_add_tail(&d->dirty_list, &fi->dirty_node);
+   }
+   enable_preemption();
+}
+
+static int fat_inode_append_cluster(struct fat_inode *fi, u32 clu)
+{
+   struct fat_extent *last = NULL;
+
+   if (fi->extents_count)
+      last = &fi->extents[fi->extents_count - 1];
+
+   if (last && last->clu + last->len == clu) {
+
+      /* Typical case: the new cluster is contiguous with the last one */
+      last->len++;
+      fi->clusters_count++;
+      return 0;
+   }
+
+   if (fi->extents_count == fi->extents_cap) {
+
+      const u32 new_cap = fi->extents_cap ? fi->extents_cap * 2 : 4;
+      struct fat_extent *new_ext;
+
+      if (!(new_ext = kalloc_array_obj(struct fat_extent, new_cap)))
+         return -ENOMEM;
+
+      if (fi->extents) {
+
+         memcpy(new_ext,
+                fi->extents,
+                sizeof(struct fat_extent) * fi->extents_count);
+
+         kfree_array_obj(fi->extents, struct fat_extent, fi->extents_cap);
+      }
+
+      fi->extents = new_ext;
+      fi->extents_cap = new_cap;
+   }
+
+   fi->extents[fi->extents_count++] = (struct fat_extent) {
+      .file_clu = fi->clusters_count,
+      .clu = clu,
+      .len = 1,
+   };
+
+   fi->clusters_count++;
+   return 0;
+}
+
+/*
+ * Return the cluster holding the `file_clu`-th cluster of the file.
+ */
+u32 fat_inode_get_cluster(struct fat_inode *fi, u32 file_clu)
+{
+   u32 lo = 0, hi = fi->extents_count;
+
+   ASSERT(file_clu < fi->clusters_count);
+
+   while (hi - lo > 1) {
+
+      const u32 mid = lo + (hi - lo) / 2;
+
+      if (fi->extents[mid].file_clu <= file_clu)
+         lo = mid;
+      else
+         hi = mid;
+   }
+
+   ASSERT(file_clu - fi->extents[lo].file_clu < fi->extents[lo].len);
+   return fi->extents[lo].clu + (file_clu - fi->extents[lo].file_clu);
+}
+
+static int
+fat_inode_load_extents(struct fat_fs_device_data *d, struct fat_inode *fi)
+{
+   const u32 max_clusters = fat_get_cluster_count(d->hdr);
+   u32 clu = fat_get_first_cluster(fi->e);
+   int rc;
+
+   if (!clu)
+      return 0; /* empty file */
+
+   do {
+
+      if (fi->clusters_count >= max_clusters)
+         return -EIO; /* loop in the cluster chain: corrupted partition */
+
+      if ((rc = fat_inode_append_cluster(fi, clu)))
+         return rc;
+
+      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+      // we do not expect BAD CLUSTERS
+      ASSERT(!fat_is_bad_cluster(d->type, clu));
+
+   } while (!fat_is_end_of_clusterchain(d->type, clu));
+
+   return 0;
+}
+
+/*
+ * Make the file have at least `count` clusters. In case of failure, the file
+ * keeps all the clusters allocated so far.
+ */
+static int
+fat_inode_grow(struct fat_fs_device_data *d, struct fat_inode *fi, u32 count)
+{
+   while (fi->clusters_count < count) {
+
+      u32 hint = 0, clu;
+
+      if (fi->extents_count) {
+         struct fat_extent *last = &fi->extents[fi->extents_count - 1];
+         hint = last->clu + last->len;
+      }
+
+      if (!(clu = fat_alloc_cluster(d, hint)))
+         return -ENOSPC;
+
+      if (fat_inode_append_cluster(fi, clu)) {
+         fat_free_clusters(d, clu, 1);
+         return -ENOMEM;
+      }
+   }
+
+   return 0;
+}
+
+static void
+fat_inode_shrink(struct fat_fs_device_data *d, struct fat_inode *fi, u32 count)
+{
+   if (fi->clusters_count <= count)
+      return;
+
+   while (fi->clusters_count > count) {
+
+      struct fat_extent *last = &fi->extents[fi->extents_count - 1];
+      const u32 n = MIN(last->len, fi->clusters_count - count);
+
+      fat_free_clusters(d, last->clu + last->len - n, n);
+      last->len -= n;
+      fi->clusters_count -= n;
+
+      if (!last->len)
+         fi->extents_count--;
+   }
+
+   fi->synced_clusters = MIN(fi->synced_clusters, count);
+   fat_inode_mark_dirty(d, fi);
+}
+
+/* ---------------------- The fat_inode objects ----------------------------- */
+
+static inline struct fat_inode *
+fat_lookup_inode_obj(struct fat_fs_device_data *d, struct fat_entry *e)
+{
+   return bintree_find_ptr(d->inodes_root, e, struct fat_inode, node, e);
+}
+
+/*
+ * Get the (retained) fat_inode object for the entry `e`, creating it if it
+ * doesn't exist.
+ */
+int
+fat_get_inode_obj(struct fat_fs_device_data *d,
+                  struct fat_entry *e,
+                  struct fat_inode **out)
+{
+   struct fat_inode *fi, *fi2;
+   int rc;
+
+   disable_preemption();
+   {
+      if ((fi = fat_lookup_inode_obj(d, e)))
+         retain_obj(fi);
+   }
+   enable_preemption();
+
+   if (fi) {
+      *out = fi;
+      return 0;
+   }
+
+   if (!(fi = kzalloc_obj(struct fat_inode)))
+      return -ENOMEM;
+
+   bintree_node_init(&fi->node);
+   list_node_init(&fi->dirty_node);
+   list_init(&fi->mappings_list);
+   rwlock_wp_init(&fi->rwlock, false);
+   LOCK_STATS_NAME(&fi->rwlock, rwlock_wp, "fat32 inode");
+   fi->e = e;
+   fi->fsize = e->DIR_FileSize;
+
+   if ((rc = fat_inode_load_extents(d, fi))) {
+      fat_destroy_inode_obj(fi);
+      return rc;
+   }
+
+   fi->synced_clusters = fi->clusters_count;
+
+   disable_preemption();
+   {
+      if ((fi2 = fat_lookup_inode_obj(d, e))) {
+
+         /* Somebody else created it in the meanwhile */
+         retain_obj(fi2);
+
+      } else {
+
+         bintree_insert_ptr(&d->inodes_root, fi, struct fat_inode, node, e);
+         retain_obj(fi);
+      }
+   }
+   enable_preemption();
+
+   if (fi2) {
+      fat_destroy_inode_obj(fi);
+      fi = fi2;
+   }
+
+   *out = fi;
+   return 0;
+}
+
+/*
+ * Release a fat_inode object. Objects with pending changes are not destroyed
+ * when their ref-count drops to 0: that happens after they're flushed.
+ */
+void fat_put_inode_obj(struct fat_fs_device_data *d, struct fat_inode *fi)
+{
+   bool destroy = false;
+
+   disable_preemption();
+   {
+      if (!release_obj(fi) && !fi->dirty) {
+
+         bintree_remove_ptr(&d->inodes_root,
+                            fi,
+                            struct fat_inode,
+                            node,
+                            e);
+
+         destroy = true;
+      }
+   }
+   enable_preemption();
+
+   if (destroy)
+      fat_destroy_inode_obj(fi);
+}
+
+u32 fat_get_file_size_rw(struct fat_fs_device_data *d, struct fat_entry *e)
+{
+   struct fat_inode *fi;
+   u32 fsize;
+
+   disable_preemption();
+   {
+      fi = fat_lookup_inode_obj(d, e);
+      fsize = fi ? fi->fsize : e->DIR_FileSize;
+   }
+   enable_preemption();
+   return fsize;
+}
+
+/* ----------------------------- Write-back --------------------------------- */
+
+static void fat_set_write_time(struct fat_entry *e)
+{
+   struct datetime dt;
+
+   if (timestamp_to_datetime(get_timestamp(), &dt) || dt.year < 1980)
+      return;
+
+   e->DIR_WrtDate = (u16)((dt.year - 1980) << 9 | dt.month << 5 | dt.day);
+   e->DIR_WrtTime = (u16)(dt.hour << 11 | dt.min << 5 | dt.sec / 2);
+}
+
+/*
+ * Write back to the FAT and to the dir entry the changes of the file `fi`. The
+ * FAT entries of the clusters unchanged since the last flush are not touched.
+ */
+void fat_flush_inode(struct fat_fs_device_data *d, struct fat_inode *fi)
+{
+   struct fat_entry *e = fi->e;
+   u32 prev = 0;
+
+   ASSERT(rwlock_wp_holding_exlock(&fi->rwlock));
+
+   if (!fi->dirty)
+      return;
+
+   if (fi->synced_clusters > 0)
+      prev = fat_inode_get_cluster(fi, fi->synced_clusters - 1);
+
+   for (u32 i = fi->synced_clusters; i < fi->clusters_count; i++) {
+
+      const u32 clu = fat_inode_get_cluster(fi, i);
+
+      if (prev)
+         fat_set_fat_entry(d->hdr, d->type, prev, clu);
+
+      prev = clu;
+   }
+
+   if (prev)
+      fat_set_fat_entry(d->hdr, d->type, prev, fat_get_eoc_value(d->type));
+
+   fat_set_first_cluster(e, fi->clusters_count ? fi->extents[0].clu : 0);
+   e->DIR_FileSize = fi->fsize;
+   e->archive = 1;
+   fat_set_write_time(e);
+   fi->synced_clusters = fi->clusters_count;
+
+   disable_preemption();
+   {
+      list_remove(&fi->dirty_node);
+      fi->dirty = false;
+   }
+   enable_preemption();
+}
+
+/*
+ * Clear the FAT entries of the clusters freed since the last sync. That has
+ * to be done before flushing the files because a freed cluster might already
+ * belong to another file: in that case, its bit won't be set in the bitmap.
+ */
+static void fat_flush_freed_clusters(struct fat_fs_device_data *d)
+{
+   bool freed;
+
+   disable_preemption();
+   {
+      freed = d->freed_clusters;
+      d->freed_clusters = false;
+   }
+   enable_preemption();
+
+   if (!freed)
+      return;
+
+   for (u32 clu = 2; clu < d->clu_end; clu++) {
+
+      if (!fat_is_cluster_free(d, clu))
+         continue;
+
+      if (fat_read_fat_entry(d->hdr, d->type, 0, clu))
+         fat_set_fat_entry(d->hdr, d->type, clu, 0);
+   }
+}
+
+void fat_syncfs(struct mnt_fs *fs)
+{
+   struct fat_fs_device_data *d = fs->device_data;
+   struct fat_inode *fi;
+
+   rwlock_wp_exlock(&d->rwlock);
+
+   fat_flush_freed_clusters(d);
+
+   while (true) {
+
+      disable_preemption();
+      {
+         fi = NULL;
+
+         if (!list_is_empty(&d->dirty_list)) {
+            fi = list_first_obj(&d->dirty_list, struct fat_inode, dirty_node);
+            retain_obj(fi);
+         }
+      }
+      enable_preemption();
+
+      if (!fi)
+         break;
+
+      rwlock_wp_exlock(&fi->rwlock);
+      {
+         fat_flush_inode(d, fi);
+      }
+      rwlock_wp_exunlock(&fi->rwlock);
+      fat_put_inode_obj(d, fi);
+   }
+
+   fat_update_fsinfo(d->hdr, d->free_count, d->next_free);
+   rwlock_wp_exunlock(&d->rwlock);
+}
+
+/* ------------------------ Write and truncate ------------------------------ */
+
+static void
+fat_inode_zero_range(struct fat_fs_device_data *d,
+                     struct fat_inode *fi,
+                     offt from,
+                     offt to)
+{
+   const offt cs = (offt)d->cluster_size;
+
+   while (from < to) {
+
+      const offt clu_off = from % cs;
+      const offt n = MIN(cs - clu_off, to - from);
+      const u32 clu = fat_inode_get_cluster(fi, (u32)(from / cs));
+      char *data = fat_get_pointer_to_cluster_data(d->hdr, clu);
+
+      bzero(data + clu_off, (size_t)n);
+      from += n;
+   }
+}
+
+/*
+ * Set file's size to `len`, allocating and zeroing clusters or freeing them.
+ */
+static int
+fat_inode_set_size(struct fat_fs_device_data *d,
+                   struct fat_inode *fi,
+                   offt len)
+{
+   const offt old_size = fi->fsize;
+   const u32 clusters = (u32)div_round_up64((u64)len, d->cluster_size);
+   int rc;
+
+   ASSERT(rwlock_wp_holding_exlock(&fi->rwlock));
+
+   if (len < 0)
+      return -EINVAL;
+
+   if (len > FAT_MAX_FILE_SIZE)
+      return -EFBIG;
+
+   if (len == old_size)
+      return 0;
+
+   if (len < old_size) {
+
+      /* The freed clusters might be reused by other files: unmap them */
+      disable_preemption();
+      {
+         fat_unmap_past_eof_mappings(fi, (size_t)len);
+      }
+      enable_preemption();
+      fat_inode_shrink(d, fi, clusters);
+
+   } else {
+
+      if ((rc = fat_inode_grow(d, fi, clusters))) {
+         fat_inode_shrink(d, fi, (u32)div_round_up(fi->fsize, d->cluster_size));
+         return rc;
+      }
+
+      fat_inode_zero_range(d, fi, old_size, len);
+   }
+
+   fi->fsize = (u32)len;
+   fat_inode_mark_dirty(d, fi);
+   return 0;
+}
+
+int fat_inode_truncate(struct fat_fs_device_data *d,
+                       struct fat_inode *fi,
+                       offt len)
+{
+   int rc;
+
+   rwlock_wp_exlock(&fi->rwlock);
+   {
+      rc = fat_inode_set_size(d, fi, len);
+   }
+   rwlock_wp_exunlock(&fi->rwlock);
+   return rc;
+}
+
+/*
+ * Write data from a vector of buffers into the file. When `user` is true, the
+ * buffers are in user space.
+ */
+ssize_t
+fat_write_int(struct fatfs_handle *h,
+              const struct iovec *iov,
+              int iovcnt,
+              offt *pos,
+              bool user)
+{
+   struct fat_fs_device_data *d = h->fs->device_data;
+   struct fat_inode *fi = h->fi;
+   const offt cs = (offt)d->cluster_size;
+   ssize_t tot = 0;
+   size_t len = 0, iov_off = 0;
+   offt end, max_len;
+   int i = 0, rc;
+
+   for (int j = 0; j < iovcnt; j++)
+      len += iov[j].iov_len;
+
+   rwlock_wp_exlock(&fi->rwlock);
+
+   if (h->fl_flags & O_APPEND)
+      *pos = fi->fsize;
+
+   if (*pos >= FAT_MAX_FILE_SIZE) {
+      tot = len ? -EFBIG : 0;
+      goto out;
+   }
+
+   max_len = FAT_MAX_FILE_SIZE - *pos;
+   end = *pos + (offt)MIN((u64)len, (u64)max_len);
+
+   if (end <= *pos)
+      goto out;
+
+   if ((rc = fat_inode_grow(d, fi, (u32)div_round_up64((u64)end, (u64)cs)))) {
+
+      /* Write as much as possible */
+      end = MIN(end, (offt)fi->clusters_count * cs);
+
+      if (end <= *pos) {
+         tot = rc;
+         goto out;
+      }
+   }
+
+   if (*pos > (offt)fi->fsize) {
+
+      /* Writing past the end: fill the gap with zeros */
+      fat_inode_zero_range(d, fi, fi->fsize, *pos);
+   }
+
+   while (*pos < end && i < iovcnt) {
+
+      const offt iov_rem = (offt)(iov[i].iov_len - iov_off);
+      const offt clu_off = *pos % cs;
+      const offt n = MIN3(cs - clu_off, iov_rem, end - *pos);
+      const u32 clu = fat_inode_get_cluster(fi, (u32)(*pos / cs));
+      char *data = (char *)fat_get_pointer_to_cluster_data(d->hdr, clu);
+      char *src = (char *)iov[i].iov_base + iov_off;
+
+      if (!iov_rem) {
+         i++;
+         iov_off = 0;
+         continue;
+      }
+
+      if (user) {
+
+         if (copy_from_user(data + clu_off, src, (size_t)n)) {
+
+            if (!tot)
+               tot = -EFAULT;
+
+            break;
+         }
+
+      } else {
+
+         memcpy(data + clu_off, src, (size_t)n);
+      }
+
+      tot += (ssize_t)n;
+      iov_off += (size_t)n;
+      *pos += n;
+   }
+
+   if (tot > 0 && *pos > (offt)fi->fsize)
+      fi->fsize = (u32)*pos;
+
+   /* Free the clusters (if any) we allocated but didn't use */
+   fat_inode_shrink(d, fi, (u32)div_round_up(fi->fsize, d->cluster_size));
+
+   if (tot > 0)
+      fat_inode_mark_dirty(d, fi);
+
+out:
+   rwlock_wp_exunlock(&fi->rwlock);
+   return tot;
+}
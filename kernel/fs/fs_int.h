@@ -24,3 +24,6 @@ struct vfs_resolve_int_ctx {
    struct vfs_path paths[RESOLVE_STACK_SIZE];    /* vfs paths stack */
    char sym_paths[RESOLVE_STACK_SIZE][MAX_PATH]; /* symlinks paths stack */
 };
+
+int
+copy_iov_from_user(const struct iovec *u_iov, int u_iovcnt, struct iovec **out);
@@ -6,6 +6,7 @@
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/fs/ramfs.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/fault_resumable.h>
@@ -14,6 +15,8 @@
 
 #include <fcntl.h>      // system header
 
+#include "fs_int.h"
+
 static inline bool is_fd_in_valid_range(int fd)
 {
    return IN_RANGE(fd, 0, MAX_HANDLES);
@@ -57,6 +60,28 @@ fs_handle get_fs_handle(int fd)
    return handle;
 }
 
+/*
+ * Install `h`, a handle created without open() (e.g. the handle of an epoll
+ * object), in the lowest free slot of the current process' handles table.
+ * Returns the new fd or -EMFILE: in that case, the caller still owns `h`.
+ */
+int install_fs_handle(fs_handle h, int fd_flags)
+{
+   struct task *curr = get_curr_task();
+   struct fs_handle_base *hb = h;
+   int fd;
+
+   kmutex_lock(&curr->pi->fslock);
+   {
+      if ((fd = get_free_handle_num(curr->pi)) >= 0) {
+         hb->fd_flags |= fd_flags;
+         curr->pi->handles[fd] = h;
+      }
+   }
+   kmutex_unlock(&curr->pi->fslock);
+   return fd >= 0 ? fd : -EMFILE;
+}
+
 
 int sys_open(const char *u_path, int flags, mode_t mode)
 {
@@ -231,6 +256,16 @@ int sys_write(int fd, const void *u_buf, size_t count)
 
       ret = (int)vfs_write(h, (void *)u_buf, count);
 
+   } else if (is_pipe_write_end(h)) {
+
+      /*
+       * Pipes copy the data straight from the user buffer, skipping
+       * `io_copybuf`: to the ring or, when a reader is blocked on the pipe,
+       * directly to the reader's buffer.
+       */
+      struct iovec iov = { .iov_base = (void *)u_buf, .iov_len = count };
+      ret = (int)vfs_writev(h, &iov, 1);
+
    } else {
 
       count = MIN(count, IO_COPYBUF_SIZE);
@@ -334,12 +369,16 @@ static bool iov_len_overflow(const struct iovec *iov, int iovcnt)
    return false;
 }
 
-int sys_writev(int fd, const struct iovec *u_iov, int u_iovcnt)
+/*
+ * Copy the user iovec array into `curr->args_copybuf` and validate it.
+ * Returns 0 on success or a negative errno value.
+ */
+int
+copy_iov_from_user(const struct iovec *u_iov, int u_iovcnt, struct iovec **out)
 {
    struct task *curr = get_curr_task();
    struct iovec *iov = (void *)curr->args_copybuf;
    const u32 iovcnt = (u32) u_iovcnt;
-   fs_handle handle;
 
    if (u_iovcnt <= 0)
       return -EINVAL;
@@ -353,6 +392,29 @@ int sys_writev(int fd, const struct iovec *u_iov, int u_iovcnt)
    if (iov_len_overflow(iov, u_iovcnt))
       return -EINVAL;
 
+   *out = iov;
+   return 0;
+}
+
+/*
+ * Build the 64-bit offset passed to preadv() and pwritev() as two longs.
+ * Like Linux, on 64-bit architectures `pos_l` holds the whole offset.
+ */
+static inline s64 pos_from_hilo(ulong pos_h, ulong pos_l)
+{
+   const u32 half = NBITS / 2;
+   return (s64)((((u64)pos_h << half) << half) | pos_l);
+}
+
+int sys_writev(int fd, const struct iovec *u_iov, int u_iovcnt)
+{
+   struct iovec *iov;
+   fs_handle handle;
+   int rc;
+
+   if ((rc = copy_iov_from_user(u_iov, u_iovcnt, &iov)))
+      return rc;
+
    if (!(handle = get_fs_handle(fd)))
       return -EBADF;
 
@@ -361,27 +423,57 @@ int sys_writev(int fd, const struct iovec *u_iov, int u_iovcnt)
 
 int sys_readv(int fd, const struct iovec *u_iov, int u_iovcnt)
 {
-   struct task *curr = get_curr_task();
-   struct iovec *iov = (void *)curr->args_copybuf;
-   const u32 iovcnt = (u32) u_iovcnt;
+   struct iovec *iov;
    fs_handle handle;
+   int rc;
 
-   if (u_iovcnt <= 0)
-      return -EINVAL;
+   if ((rc = copy_iov_from_user(u_iov, u_iovcnt, &iov)))
+      return rc;
 
-   if (sizeof(struct iovec) * iovcnt > ARGS_COPYBUF_SIZE)
+   if (!(handle = get_fs_handle(fd)))
+      return -EBADF;
+
+   return (int)vfs_readv(handle, iov, u_iovcnt);
+}
+
+int sys_preadv(int fd, const struct iovec *u_iov, int u_iovcnt,
+               ulong pos_l, ulong pos_h)
+{
+   const s64 off = pos_from_hilo(pos_h, pos_l);
+   struct iovec *iov;
+   fs_handle handle;
+   int rc;
+
+   if (off < 0 || off > OFFT_MAX)
       return -EINVAL;
 
-   if (copy_from_user(iov, u_iov, sizeof(struct iovec) * iovcnt))
-      return -EFAULT;
+   if ((rc = copy_iov_from_user(u_iov, u_iovcnt, &iov)))
+      return rc;
 
-   if (iov_len_overflow(iov, u_iovcnt))
+   if (!(handle = get_fs_handle(fd)))
+      return -EBADF;
+
+   return (int)vfs_preadv(handle, iov, u_iovcnt, (offt)off);
+}
+
+int sys_pwritev(int fd, const struct iovec *u_iov, int u_iovcnt,
+                ulong pos_l, ulong pos_h)
+{
+   const s64 off = pos_from_hilo(pos_h, pos_l);
+   struct iovec *iov;
+   fs_handle handle;
+   int rc;
+
+   if (off < 0 || off > OFFT_MAX)
       return -EINVAL;
 
+   if ((rc = copy_iov_from_user(u_iov, u_iovcnt, &iov)))
+      return rc;
+
    if (!(handle = get_fs_handle(fd)))
       return -EBADF;
 
-   return (int)vfs_readv(handle, iov, u_iovcnt);
+   return (int)vfs_pwritev(handle, iov, u_iovcnt, (offt)off);
 }
 
 static int
@@ -534,6 +626,22 @@ int sys_ia32_ftruncate64(int fd, s64 len)
    return vfs_ftruncate(h, (offt)len);
 }
 
+int sys_fallocate(int fd, int mode, s64 offset, s64 len)
+{
+   fs_handle h;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if (offset < 0 || len <= 0)
+      return -EINVAL;
+
+   if (offset > OFFT_MAX || len > OFFT_MAX)
+      return -EFBIG;
+
+   return vfs_fallocate(h, mode, (offt)offset, (offt)len);
+}
+
 int sys_llseek(int fd, size_t off_hi, size_t off_low, u64 *u_result, u32 whence)
 {
    const s64 off64 = (s64)(((u64)off_hi << 32) | off_low);
@@ -792,6 +900,23 @@ int sys_fcntl64(int fd, int cmd, int arg)
       case F_GETFL:
          return hb->fl_flags;
 
+      case F_ADD_SEALS:
+         return ramfs_add_seals(hb, (u32)arg);
+
+      case F_GET_SEALS:
+         return ramfs_get_seals(hb);
+
+      case F_SETPIPE_SZ:
+      case F_GETPIPE_SZ:
+
+         if (!is_pipe_read_end(hb) && !is_pipe_write_end(hb))
+            return -EBADF;
+
+         if (cmd == F_SETPIPE_SZ)
+            return pipe_set_size(hb, (ulong)arg);
+
+         return pipe_get_size(hb);
+
       default:
          printk("fcntl64: Ignored unknown cmd %d\n", cmd);
    }
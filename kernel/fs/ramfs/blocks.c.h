@@ -20,16 +20,42 @@ static struct ramfs_block *ramfs_new_block(offt page)
    /* Init the block object */
    bintree_node_init(&b->node);
    b->offset = page;
+   b->shared = false;
    return b;
 }
 
-static void ramfs_destroy_block(struct ramfs_block *b)
+static void ramfs_block_release_page(struct ramfs_block *b)
 {
-   /* Release the pageframe used by this block */
-   release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+   size_t size = PAGE_SIZE;
+
+   disable_preemption();
+   {
+      /*
+       * The page might be shared with other blocks (see ramfs_copy_range()):
+       * free it only if this is the last reference.
+       */
+      const bool last_ref =
+         get_pageframe_ref_count_at(get_kernel_pdir(), b->vaddr) <= 1;
+
+      /* Release the pageframe used by this block */
+      release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+
+      /*
+       * Free the memory pointed by this block. NOTE: the page might be part
+       * of a bigger chunk (see ramfs_alloc_block_run()): allow splitting it.
+       */
+      if (last_ref)
+         general_kfree(b->vaddr,
+                       &size,
+                       KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP);
+   }
+   enable_preemption();
+   b->vaddr = NULL;
+}
 
-   /* Free the memory pointed by this block */
-   kfree2(b->vaddr, PAGE_SIZE);
+static void ramfs_destroy_block(struct ramfs_block *b)
+{
+   ramfs_block_release_page(b);
 
    /* Free the memory used by the block object itself */
    kfree_obj(b, struct ramfs_block);
@@ -49,6 +75,109 @@ ramfs_append_new_block(struct ramfs_inode *inode, struct ramfs_block *block)
    inode->blocks_count++;
 }
 
+static void
+ramfs_remove_block(struct ramfs_inode *inode, struct ramfs_block *block)
+{
+   bintree_remove_ptr(&inode->blocks_tree_root,
+                      block,
+                      struct ramfs_block,
+                      node,
+                      offset);
+
+   ramfs_destroy_block(block);
+   inode->blocks_count--;
+}
+
+static inline struct ramfs_block *
+ramfs_find_block(struct ramfs_inode *inode, offt page)
+{
+   return bintree_find_ptr(inode->blocks_tree_root,
+                           page,
+                           struct ramfs_block,
+                           node,
+                           offset);
+}
+
+/*
+ * Blocks of different inodes can share the same page after a copy_file_range()
+ * call: ramfs_share_block() marks all of them as `shared`. Because shared pages
+ * are never memory-mapped (see ramfs_mmap_pages()), the page's ref-count of a
+ * marked block tells us if it's still shared, even when other blocks of the
+ * same inode are mapped. The mark is dropped once the other references are
+ * gone.
+ */
+static bool ramfs_block_is_shared(struct ramfs_block *b)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (!b->shared)
+      return false;
+
+   if (get_pageframe_ref_count_at(get_kernel_pdir(), b->vaddr) <= 1)
+      b->shared = false;
+
+   return b->shared;
+}
+
+/*
+ * Copy-on-write: give the block a private copy of its page, if it's shared.
+ */
+static int ramfs_block_unshare(struct ramfs_block *b)
+{
+   void *vaddr;
+   int rc = 0;
+
+   disable_preemption();
+   {
+      if (!ramfs_block_is_shared(b))
+         goto out;
+
+      if (!(vaddr = kmalloc(PAGE_SIZE))) {
+         rc = -ENOMEM;
+         goto out;
+      }
+
+      memcpy(vaddr, b->vaddr, PAGE_SIZE);
+      retain_pageframes_mapped_at(get_kernel_pdir(), vaddr, PAGE_SIZE);
+      release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+      b->vaddr = vaddr;
+      b->shared = false;
+   }
+out:
+   enable_preemption();
+   return rc;
+}
+
+/*
+ * Get the block at `page` ready for writing: create it, if it does not exist,
+ * or un-share its page otherwise. Returns NULL in case of out-of-memory.
+ */
+static struct ramfs_block *
+ramfs_get_block_for_write(struct ramfs_inode *i, offt page)
+{
+   struct ramfs_block *b;
+
+   b = bintree_find_ptr(i->blocks_tree_root,
+                        page,
+                        struct ramfs_block,
+                        node,
+                        offset);
+
+   if (!b) {
+
+      if (!(b = ramfs_new_block(page)))
+         return NULL;
+
+      ramfs_append_new_block(i, b);
+      return b;
+   }
+
+   if (ramfs_block_unshare(b))
+      return NULL;
+
+   return b;
+}
+
 static int ramfs_inode_extend(struct ramfs_inode *i, offt new_len)
 {
    ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
@@ -57,3 +186,102 @@ static int ramfs_inode_extend(struct ramfs_inode *i, offt new_len)
    i->fsize = new_len;
    return 0;
 }
+
+/*
+ * Allocate `count` new blocks starting at `page`, all of them missing in the
+ * inode. When possible, the pages are taken from a single physically-contiguous
+ * chunk, using a multi-step allocation with PAGE_SIZE sub-blocks: that way each
+ * page can still be freed on its own by ramfs_block_release_page().
+ */
+static int
+ramfs_alloc_block_run(struct ramfs_inode *i, offt page, size_t count)
+{
+   size_t size = count << PAGE_SHIFT;
+   struct ramfs_block *b;
+   char *vaddr = NULL;
+
+   if (count > 1)
+      vaddr = general_kmalloc(&size, KMALLOC_FL_MULTI_STEP | PAGE_SIZE);
+
+   if (!vaddr) {
+
+      /* Slow path: allocate the pages one by one */
+      for (size_t k = 0; k < count; k++, page += PAGE_SIZE) {
+
+         if (!(b = ramfs_new_block(page)))
+            return -ENOSPC;
+
+         ramfs_append_new_block(i, b);
+      }
+
+      return 0;
+   }
+
+   ASSERT(size == count << PAGE_SHIFT);
+   bzero(vaddr, size);
+
+   for (size_t k = 0; k < count; k++, page += PAGE_SIZE) {
+
+      if (!(b = kalloc_obj(struct ramfs_block))) {
+
+         /* Free the pages not owned by any block */
+         size = (count - k) << PAGE_SHIFT;
+         general_kfree(vaddr + (k << PAGE_SHIFT),
+                       &size,
+                       KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP);
+         return -ENOSPC;
+      }
+
+      bintree_node_init(&b->node);
+      b->offset = page;
+      b->vaddr = vaddr + (k << PAGE_SHIFT);
+      b->shared = false;
+      retain_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+      ramfs_append_new_block(i, b);
+   }
+
+   return 0;
+}
+
+/*
+ * Make sure that every page in [start, end) is backed by a private block, so
+ * that writes in that range will never need to allocate memory. Missing blocks
+ * are allocated in runs of up to RAMFS_MAX_ALLOC_RUN pages, while existing
+ * blocks sharing their page with another inode get un-shared.
+ */
+static int ramfs_alloc_blocks(struct ramfs_inode *i, offt start, offt end)
+{
+   struct ramfs_block *b;
+   offt page = start & (offt)PAGE_MASK;
+   size_t run;
+   int rc;
+
+   ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
+
+   while (page < end) {
+
+      if ((b = ramfs_find_block(i, page))) {
+
+         if (ramfs_block_unshare(b))
+            return -ENOSPC;
+
+         page += PAGE_SIZE;
+         continue;
+      }
+
+      for (run = 1; run < RAMFS_MAX_ALLOC_RUN; run++) {
+
+         const offt p = page + (offt)(run << PAGE_SHIFT);
+
+         if (p >= end || ramfs_find_block(i, p))
+            break;
+      }
+
+      if ((rc = ramfs_alloc_block_run(i, page, run)))
+         return rc;
+
+      page += (offt)(run << PAGE_SHIFT);
+   }
+
+   return 0;
+}
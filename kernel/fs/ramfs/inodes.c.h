@@ -75,6 +75,26 @@ ramfs_create_inode_file(struct ramfs_data *d,
 
    i->type = VFS_FILE;
    i->mode = (mode & 0777) | S_IFREG;
+   i->seals = F_SEAL_SEAL;             /* only memfd files can be sealed */
+
+   i->parent_dir = parent;
+   real_time_get_timespec(&i->ctime);
+   i->mtime = i->ctime;
+   return i;
+}
+
+static struct ramfs_inode *
+ramfs_create_inode_socket(struct ramfs_data *d,
+                          mode_t mode,
+                          struct ramfs_inode *parent)
+{
+   struct ramfs_inode *i = ramfs_new_inode(d);
+
+   if (!i)
+      return NULL;
+
+   i->type = VFS_SOCKET;
+   i->mode = (mode & 0777) | S_IFSOCK;
 
    i->parent_dir = parent;
    real_time_get_timespec(&i->ctime);
@@ -110,6 +130,10 @@ static int ramfs_destroy_inode(struct ramfs_data *d, struct ramfs_inode *i)
          kfree2(i->path, i->path_len + 1);
          break;
 
+      case VFS_SOCKET:
+         /* do nothing: the socket object lives outside of ramfs */
+         break;
+
       default:
          NOT_IMPLEMENTED();
    }
@@ -24,6 +24,33 @@ static int ramfs_mkdir(struct vfs_path *p, mode_t mode)
    return rc;
 }
 
+static int ramfs_mknod(struct vfs_path *p, mode_t mode)
+{
+   struct ramfs_path *rp = (struct ramfs_path *) &p->fs_path;
+   struct ramfs_data *d = p->fs->device_data;
+   struct ramfs_inode *i;
+   int rc;
+
+   if (rp->inode)
+      return -EEXIST;
+
+   if (!S_ISSOCK(mode))
+      return -EPERM; /* Only socket nodes are supported, for AF_UNIX's bind */
+
+   if ((rp->dir_inode->mode & 0300) != 0300) /* write + execute */
+      return -EACCES;
+
+   if (!(i = ramfs_create_inode_socket(d, mode, rp->dir_inode)))
+      return -ENOSPC;
+
+   if ((rc = ramfs_dir_add_entry(rp->dir_inode, p->last_comp, i))) {
+      ramfs_destroy_inode(d, i);
+      return rc;
+   }
+
+   return rc;
+}
+
 static int ramfs_rmdir(struct vfs_path *p)
 {
    struct ramfs_path *rp = (struct ramfs_path *) &p->fs_path;
@@ -6,26 +6,20 @@ static int ramfs_munmap(struct user_mapping *um, void *vaddrp, size_t len)
 }
 
 static int
-ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+ramfs_mmap_pages(struct ramfs_inode *i,
+                 struct user_mapping *um,
+                 pdir_t *pdir,
+                 u32 pg_flags)
 {
-   struct ramfs_handle *rh = um->h;
-   struct ramfs_inode *i = rh->inode;
-   ulong vaddr = um->vaddr;
    struct bintree_walk_ctx ctx;
    struct ramfs_block *b;
-   u32 pg_flags;
+   ulong vaddr = um->vaddr;
    int rc;
 
    const size_t off_begin = um->off;
    const size_t off_end = off_begin + um->len;
 
-   ASSERT(IS_PAGE_ALIGNED(um->len));
-
-   if (i->type != VFS_FILE)
-      return -EACCES;
-
-   if (flags & VFS_MM_DONT_MMAP)
-      goto register_mapping;
+   ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
 
    bintree_in_order_visit_start(&ctx,
                                 i->blocks_tree_root,
@@ -33,11 +27,6 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
                                 node,
                                 false);
 
-   pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
-
-   if ((rh->fl_flags & O_RDWR) == O_RDWR)
-      pg_flags |= PAGING_FL_RW;
-
    while ((b = bintree_in_order_visit_next(&ctx))) {
 
       if ((size_t)b->offset < off_begin)
@@ -46,10 +35,18 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
       if ((size_t)b->offset >= off_end)
          break;
 
-      rc = map_page(pdir,
-                    (void *)vaddr,
-                    KERNEL_VA_TO_PA(b->vaddr),
-                    pg_flags);
+      /*
+       * Pages shared with other inodes cannot be mapped, as writes through
+       * the mapping would bypass the copy-on-write logic.
+       */
+      rc = ramfs_block_unshare(b);
+
+      if (!rc) {
+         rc = map_page(pdir,
+                       (void *)vaddr,
+                       KERNEL_VA_TO_PA(b->vaddr),
+                       pg_flags);
+      }
 
       if (rc) {
 
@@ -66,6 +63,44 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
       vaddr += PAGE_SIZE;
    }
 
+   return 0;
+}
+
+static int
+ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   struct ramfs_handle *rh = um->h;
+   struct ramfs_inode *i = rh->inode;
+   u32 pg_flags;
+   int rc;
+
+   ASSERT(IS_PAGE_ALIGNED(um->len));
+
+   if (i->type != VFS_FILE)
+      return -EACCES;
+
+   if (flags & VFS_MM_DONT_MMAP)
+      goto register_mapping;
+
+   pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
+
+   if ((rh->fl_flags & O_RDWR) == O_RDWR && (um->prot & PROT_WRITE))
+      pg_flags |= PAGING_FL_RW;
+
+   rwlock_wp_exlock(&i->rwlock);
+   {
+      /* Writable mappings would allow bypassing the write seals */
+      if ((um->prot & PROT_WRITE) && (i->seals & RAMFS_WRITE_SEALS))
+         rc = -EPERM;
+      else
+         rc = ramfs_mmap_pages(i, um, pdir, pg_flags);
+
+      if (!rc && !(flags & VFS_MM_DONT_REGISTER))
+         list_add_tail(&i->mappings_list, &um->inode_node);
+   }
+   rwlock_wp_exunlock(&i->rwlock);
+   return rc;
+
 register_mapping:
    if (!(flags & VFS_MM_DONT_REGISTER)) {
       list_add_tail(&i->mappings_list, &um->inode_node);
@@ -104,6 +139,9 @@ ramfs_handle_fault_int(struct process *pi,
    /* The page is *not* present */
    abs_off = um->off + (vaddr - um->vaddr);
 
+   if (rw && !(um->prot & PROT_WRITE))
+      return false; /* Write on a read-only mapping */
+
    if (abs_off >= (ulong)rh->inode->fsize)
       return false; /* Read/write past EOF */
 
@@ -118,7 +156,8 @@ ramfs_handle_fault_int(struct process *pi,
    rc = map_page(pi->pdir,
                  (void *)(vaddr & PAGE_MASK),
                  KERNEL_VA_TO_PA(rw ? block->vaddr : &zero_page),
-                 PAGING_FL_US | PAGING_FL_RW | PAGING_FL_SHARED);
+                 PAGING_FL_US | PAGING_FL_SHARED |
+                 (um->prot & PROT_WRITE ? PAGING_FL_RW : 0));
 
    if (rc)
       panic("Out-of-memory: unable to map a ramfs_block. No OOM killer");
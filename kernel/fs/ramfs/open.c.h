@@ -6,6 +6,8 @@ static const struct file_ops static_ops_ramfs =
    .write = ramfs_write,
    .readv = ramfs_readv,
    .writev = ramfs_writev,
+   .copy_range = ramfs_copy_range,
+   .fallocate = ramfs_fallocate,
    .seek = ramfs_seek,
    .ioctl = ramfs_ioctl,
    .mmap = ramfs_mmap,
@@ -75,6 +77,9 @@ static int ramfs_open_existing_checks(int fl, struct ramfs_inode *i)
    if ((fl & (O_WRONLY | O_RDWR)) && i->type == VFS_DIR)
       return -EISDIR;
 
+   if (i->type == VFS_SOCKET)
+      return -ENXIO; /* Socket nodes can be used only with connect() */
+
    /*
     * On some systems O_TRUNC | O_RDONLY has undefined behavior and on some
     * the file might actually be truncated. On Tilck, that is simply NOT
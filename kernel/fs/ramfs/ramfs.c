@@ -7,6 +7,8 @@
 
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/fs/flock.h>
+#include <tilck/kernel/fs/ramfs.h>
+#include <tilck/kernel/lock_stats.h>
 
 #include <sys/mman.h>      // system header
 
@@ -17,6 +19,7 @@
 #include "inodes.c.h"
 #include "stat.c.h"
 #include "blocks.c.h"
+#include "seals.c.h"
 #include "mmap.c.h"
 #include "rw_ops.c.h"
 #include "open.c.h"
@@ -310,6 +313,76 @@ int ramfs_futimens(struct mnt_fs *fs,
    return 0;
 }
 
+/*
+ * Create a file not linked in any directory (like the O_TMPFILE files in
+ * Linux) and open it in read-write mode. The file is destroyed when its last
+ * handle is closed. Used to implement memfd_create() and SysV shm.
+ */
+int
+ramfs_create_unnamed_file(struct mnt_fs *fs,
+                          mode_t mode,
+                          u32 seals,
+                          fs_handle *out)
+{
+   struct ramfs_data *d = fs->device_data;
+   struct fs_handle_base *hb;
+   struct ramfs_inode *i;
+   int rc;
+
+   rwlock_wp_exlock(&d->rwlock);
+   {
+      i = ramfs_create_inode_file(d, mode, d->root);
+   }
+   rwlock_wp_exunlock(&d->rwlock);
+
+   if (!i)
+      return -ENOMEM;
+
+   i->seals = seals;
+
+   if ((rc = ramfs_open_int(fs, i, out, O_RDWR))) {
+      ramfs_destroy_inode(d, i);
+      return rc;
+   }
+
+   hb = *out;
+   hb->fl_flags = O_RDWR;
+   hb->spec_flags |= VFS_SPFL_NO_LF;
+
+   /* Like in vfs_open(), file handles retain their struct mnt_fs */
+   retain_obj(fs);
+   return 0;
+}
+
+int ramfs_get_seals(fs_handle h)
+{
+   struct ramfs_handle *rh = h;
+
+   if (rh->fops != &static_ops_ramfs || rh->inode->type != VFS_FILE)
+      return -EINVAL;
+
+   return (int)rh->inode->seals;
+}
+
+int ramfs_add_seals(fs_handle h, u32 seals)
+{
+   struct ramfs_handle *rh = h;
+   int rc;
+
+   if (rh->fops != &static_ops_ramfs || rh->inode->type != VFS_FILE)
+      return -EINVAL;
+
+   if (!(rh->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EPERM;
+
+   ramfs_file_exlock(h);
+   {
+      rc = ramfs_add_seals_nolock(rh->inode, seals);
+   }
+   ramfs_file_exunlock(h);
+   return rc;
+}
+
 static const struct fs_ops static_fsops_ramfs =
 {
    .get_inode = ramfs_getinode,
@@ -320,6 +393,7 @@ static const struct fs_ops static_fsops_ramfs =
    .unlink = ramfs_unlink,
    .mkdir = ramfs_mkdir,
    .rmdir = ramfs_rmdir,
+   .mknod = ramfs_mknod,
    .truncate = ramfs_truncate,
    .stat = ramfs_stat,
    .symlink = ramfs_symlink,
@@ -354,6 +428,7 @@ struct mnt_fs *ramfs_create(void)
    }
 
    rwlock_wp_init(&d->rwlock, false);
+   LOCK_STATS_NAME(&d->rwlock, rwlock_wp, "ramfs fs");
    d->next_inode_num = 1;
    d->root = ramfs_create_inode_dir(d, 0777, NULL);
 
@@ -20,11 +20,15 @@
 
 struct ramfs_inode;
 
+/* Max number of pages allocated as a single chunk by ramfs_alloc_blocks() */
+#define RAMFS_MAX_ALLOC_RUN        64
+
 struct ramfs_block {
 
    struct bintree_node node;
    offt offset;                  /* MUST BE divisible by PAGE_SIZE */
    void *vaddr;
+   bool shared;                  /* see ramfs_block_is_shared() */
 };
 
 /*
@@ -76,6 +80,7 @@ struct ramfs_inode {
       struct {
          offt fsize;
          struct ramfs_block *blocks_tree_root;
+         u32 seals;                    /* F_SEAL_* flags, see seals.c.h */
       };
 
       /* valid when type == VFS_DIR */
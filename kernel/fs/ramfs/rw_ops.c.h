@@ -177,7 +177,7 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
 {
    ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
 
-   if (len < 0 || len >= i->fsize)
+   if (len < 0 || len > i->fsize)
       return -EINVAL;
 
    if (i->type == VFS_DIR)
@@ -205,18 +205,10 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
       if (!b || b->offset < len)
          break;
 
-      /* Remove the block object from the tree */
-      bintree_remove_ptr(&i->blocks_tree_root,
-                         b,
-                         struct ramfs_block,
-                         node,
-                         offset);
-
-      ramfs_destroy_block(b);
+      ramfs_remove_block(i, b);
    }
 
    i->fsize = len;
-   i->blocks_count = pow2_round_up_at((ulong) len, PAGE_SIZE);
    return 0;
 }
 
@@ -226,17 +218,22 @@ ramfs_inode_truncate_safe(struct ramfs_inode *i, offt len, bool no_perm_check)
    int rc;
    rwlock_wp_exlock(&i->rwlock);
    {
-      if ((i->mode & 0200) == 0200 || no_perm_check) { /* write permission */
-
-         if (len < i->fsize)
+      if (no_perm_check)
+         rc = 0;
+      else if ((i->mode & 0200) != 0200) /* write permission */
+         rc = -EACCES;
+      else
+         rc = ramfs_check_resize_seals(i, len);
+
+      /*
+       * NOTE: truncating to the current size is not a no-op, as it drops
+       * the blocks past EOF, pre-allocated with FALLOC_FL_KEEP_SIZE.
+       */
+      if (!rc) {
+         if (len <= i->fsize)
             rc = ramfs_inode_truncate(i, len);
-         else if (len > i->fsize)
-            rc = ramfs_inode_extend(i, len);
          else
-            rc = 0; /* len == i->fsize */
-
-      } else {
-         rc = -EACCES;
+            rc = ramfs_inode_extend(i, len);
       }
    }
    rwlock_wp_exunlock(&i->rwlock);
@@ -245,6 +242,9 @@ ramfs_inode_truncate_safe(struct ramfs_inode *i, offt len, bool no_perm_check)
 
 static int ramfs_truncate(struct mnt_fs *fs, vfs_inode_ptr_t i, offt len)
 {
+   if (((struct ramfs_inode *)i)->type == VFS_SOCKET)
+      return -EINVAL;
+
    return ramfs_inode_truncate_safe(i, len, false);
 }
 
@@ -318,6 +318,7 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
    struct ramfs_inode *inode = rh->inode;
    offt tot_written = 0;
    offt buf_rem = (offt)len;
+   int rc;
 
    /* We can be sure it's a file because dirs cannot be open for writing */
    ASSERT(inode->type == VFS_FILE);
@@ -325,6 +326,9 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
    if (rh->fl_flags & O_APPEND)
       *pos = inode->fsize;
 
+   if ((rc = ramfs_check_write_seals(inode, *pos, len)))
+      return rc;
+
    while (buf_rem > 0) {
 
       struct ramfs_block *block;
@@ -335,22 +339,8 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
 
       ASSERT(to_write > 0);
 
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
-
-      /* Assert that if page_off > 0, the block is present */
-      ASSERT(!page_off || block);
-
-      if (!block) {
-
-         if (!(block = ramfs_new_block(page)))
-            break;
-
-         ramfs_append_new_block(inode, block);
-      }
+      if (!(block = ramfs_get_block_for_write(inode, page)))
+         break;
 
       memcpy(block->vaddr + page_off, buf + tot_written, (size_t)to_write);
       tot_written += to_write;
@@ -380,91 +370,417 @@ static ssize_t ramfs_write(fs_handle h, char *buf, size_t len, offt *pos)
    return ret;
 }
 
+/*
+ * Vectored read: walk the file's blocks and the user iovecs together, copying
+ * straight from each block to the user buffers, without any bounce buffer.
+ * The caller holds the inode lock for the whole operation, so the data read is
+ * a consistent snapshot of the file. On a fault, the bytes already copied are
+ * reported to the caller, exactly like a short read.
+ */
 static ssize_t
-ramfs_readv_nolock(struct ramfs_handle *rh, const struct iovec *iov, int iovcnt)
+ramfs_readv_nolock(struct ramfs_handle *rh,
+                   const struct iovec *iov,
+                   int iovcnt,
+                   offt *pos)
 {
-   struct task *curr = get_curr_task();
-   ssize_t ret = 0;
-   ssize_t rc;
-   size_t len;
+   struct ramfs_inode *inode = rh->inode;
+   struct ramfs_block *block = NULL;
+   ssize_t tot_read = 0;
+   size_t iov_off = 0;
+   int i = 0;
 
-   for (int i = 0; i < iovcnt; i++) {
+   if (inode->type == VFS_DIR)
+      return -EISDIR;
+
+   ASSERT(inode->type == VFS_FILE);
 
-      len = MIN(iov[i].iov_len, IO_COPYBUF_SIZE);
-      rc = ramfs_read_nolock(rh, curr->io_copybuf, len, &rh->h_fpos);
+   while (i < iovcnt && *pos < inode->fsize) {
 
-      if (rc < 0) {
-         ret = rc;
-         break;
+      const offt page       = *pos & (offt)PAGE_MASK;
+      const offt page_off   = *pos & (offt)OFFSET_IN_PAGE_MASK;
+      const size_t page_rem = PAGE_SIZE - (size_t)page_off;
+      const size_t file_rem = (size_t)(inode->fsize - *pos);
+      const size_t iov_rem  = iov[i].iov_len - iov_off;
+      const size_t to_read  = MIN3(page_rem, file_rem, iov_rem);
+      char *dest = (char *)iov[i].iov_base + iov_off;
+      const char *src;
+
+      if (!iov_rem) {
+         i++;
+         iov_off = 0;
+         continue;
+      }
+
+      if (!block || block->offset != page) {
+         block = bintree_find_ptr(inode->blocks_tree_root,
+                                  page,
+                                  struct ramfs_block,
+                                  node,
+                                  offset);
       }
 
-      if (copy_to_user(iov[i].iov_base, curr->io_copybuf, len))
-         return -EFAULT;
+      /* Holes are read from the zero page */
+      src = block ? (char *)block->vaddr + page_off : zero_page;
 
-      ret += rc;
+      if (copy_to_user(dest, src, to_read))
+         return tot_read > 0 ? tot_read : -EFAULT;
 
-      if (rc < (ssize_t)iov[i].iov_len)
-         break; // Not enough data to fill all the user buffers.
+      tot_read += (ssize_t)to_read;
+      iov_off  += to_read;
+      *pos     += (offt)to_read;
    }
 
-   return ret;
+   return tot_read;
 }
 
 static ssize_t
-ramfs_readv(fs_handle h, const struct iovec *iov, int iovcnt)
+ramfs_readv(fs_handle h, const struct iovec *iov, int iovcnt, offt *pos)
 {
    struct ramfs_handle *rh = h;
    ssize_t ret;
 
    ramfs_file_shlock(h);
    {
-      ret = ramfs_readv_nolock(rh, iov, iovcnt);
+      ret = ramfs_readv_nolock(rh, iov, iovcnt, pos);
    }
    ramfs_file_shunlock(h);
    return ret;
 }
 
+/*
+ * Vectored write: the counterpart of ramfs_readv_nolock(). Blocks are created
+ * on demand and data is copied directly from the user buffers into them.
+ */
 static ssize_t
-ramfs_writev_nolock(struct ramfs_handle *h, const struct iovec *iov, int iovcnt)
+ramfs_writev_nolock(struct ramfs_handle *rh,
+                    const struct iovec *iov,
+                    int iovcnt,
+                    offt *pos)
 {
-   struct task *curr = get_curr_task();
-   ssize_t ret = 0;
-   ssize_t rc;
-   size_t len;
+   struct ramfs_inode *inode = rh->inode;
+   struct ramfs_block *block = NULL;
+   ssize_t tot_written = 0;
+   size_t iov_off = 0, tot_len = 0;
+   int i, rc;
+
+   /* We can be sure it's a file because dirs cannot be open for writing */
+   ASSERT(inode->type == VFS_FILE);
+
+   if (rh->fl_flags & O_APPEND)
+      *pos = inode->fsize;
 
-   for (int i = 0; i < iovcnt; i++) {
+   for (i = 0; i < iovcnt; i++)
+      tot_len += iov[i].iov_len;
 
-      len = MIN(iov[i].iov_len, IO_COPYBUF_SIZE);
+   if ((rc = ramfs_check_write_seals(inode, *pos, tot_len)))
+      return rc;
 
-      if (copy_from_user(curr->io_copybuf, iov[i].iov_base, len))
-         return -EFAULT;
+   i = 0;
 
-      rc = ramfs_write_nolock(h, curr->io_copybuf, len, &h->h_fpos);
+   while (i < iovcnt) {
 
-      if (rc < 0) {
-         ret = rc;
-         break;
+      const offt page       = *pos & (offt)PAGE_MASK;
+      const offt page_off   = *pos & (offt)OFFSET_IN_PAGE_MASK;
+      const size_t page_rem = PAGE_SIZE - (size_t)page_off;
+      const size_t iov_rem  = iov[i].iov_len - iov_off;
+      const size_t to_write = MIN(page_rem, iov_rem);
+      const char *src = (const char *)iov[i].iov_base + iov_off;
+
+      if (!iov_rem) {
+         i++;
+         iov_off = 0;
+         continue;
+      }
+
+      if (!block || block->offset != page) {
+         if (!(block = ramfs_get_block_for_write(inode, page)))
+            return tot_written > 0 ? tot_written : -ENOSPC;
       }
 
-      ret += rc;
+      if (copy_from_user((char *)block->vaddr + page_off, src, to_write))
+         return tot_written > 0 ? tot_written : -EFAULT;
 
-      if (rc < (ssize_t)iov[i].iov_len)
-         break;
+      tot_written += (ssize_t)to_write;
+      iov_off     += to_write;
+      *pos        += (offt)to_write;
+
+      if (*pos > inode->fsize)
+         inode->fsize = *pos;
    }
 
-   return ret;
+   return tot_written;
 }
 
 static ssize_t
-ramfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
+ramfs_writev(fs_handle h, const struct iovec *iov, int iovcnt, offt *pos)
 {
    struct ramfs_handle *rh = h;
    ssize_t ret;
 
    ramfs_file_exlock(h);
    {
-      ret = ramfs_writev_nolock(rh, iov, iovcnt);
+      ret = ramfs_writev_nolock(rh, iov, iovcnt, pos);
    }
    ramfs_file_exunlock(h);
    return ret;
 }
+
+/*
+ * Make the block at `dst_off` in `dst` share the page of the block at `src_off`
+ * in `src`. Both offsets must be page-aligned. A hole in `src` becomes a hole
+ * in `dst` as well.
+ */
+static int
+ramfs_share_block(struct ramfs_inode *src,
+                  offt src_off,
+                  struct ramfs_inode *dst,
+                  offt dst_off)
+{
+   struct ramfs_block *sb, *db;
+
+   ASSERT(IS_PAGE_ALIGNED(src_off));
+   ASSERT(IS_PAGE_ALIGNED(dst_off));
+
+   sb = bintree_find_ptr(src->blocks_tree_root,
+                         src_off,
+                         struct ramfs_block,
+                         node,
+                         offset);
+
+   db = bintree_find_ptr(dst->blocks_tree_root,
+                         dst_off,
+                         struct ramfs_block,
+                         node,
+                         offset);
+
+   if (!sb) {
+
+      if (db)
+         ramfs_remove_block(dst, db);
+
+      return 0;
+   }
+
+   if (!db) {
+
+      if (!(db = kalloc_obj(struct ramfs_block)))
+         return -ENOMEM;
+
+      bintree_node_init(&db->node);
+      db->offset = dst_off;
+      db->vaddr = NULL;
+      db->shared = false;
+      ramfs_append_new_block(dst, db);
+
+   } else {
+
+      ramfs_block_release_page(db);
+   }
+
+   disable_preemption();
+   {
+      retain_pageframes_mapped_at(get_kernel_pdir(), sb->vaddr, PAGE_SIZE);
+      db->vaddr = sb->vaddr;
+      db->shared = sb->shared = true;
+   }
+   enable_preemption();
+   return 0;
+}
+
+static ssize_t
+ramfs_copy_range_nolock(struct ramfs_inode *src,
+                        offt *src_pos,
+                        struct ramfs_inode *dst,
+                        offt *dst_pos,
+                        size_t len)
+{
+   /* Memory-mapped files cannot share pages: see ramfs_block_is_shared() */
+   const bool can_share = list_is_empty(&src->mappings_list) &&
+                          list_is_empty(&dst->mappings_list);
+   struct ramfs_block *sb, *db;
+   size_t tot = 0;
+   int rc;
+
+   if (*src_pos >= src->fsize)
+      return 0;
+
+   len = MIN(len, (size_t)(src->fsize - *src_pos));
+
+   if ((rc = ramfs_check_write_seals(dst, *dst_pos, len)))
+      return rc;
+
+   if (src == dst) {
+
+      /* Like Linux, don't allow overlapping ranges in the same file */
+      if (*src_pos < *dst_pos + (offt)len && *dst_pos < *src_pos + (offt)len)
+         return -EINVAL;
+   }
+
+   while (tot < len) {
+
+      const size_t rem = len - tot;
+      const size_t s_off = (size_t)(*src_pos & (offt)OFFSET_IN_PAGE_MASK);
+      const size_t d_off = (size_t)(*dst_pos & (offt)OFFSET_IN_PAGE_MASK);
+      size_t n;
+
+      if (can_share && !s_off && !d_off && rem >= PAGE_SIZE) {
+
+         /* Whole page: share it, no data copy */
+         if (ramfs_share_block(src, *src_pos, dst, *dst_pos))
+            break;
+
+         n = PAGE_SIZE;
+
+      } else {
+
+         n = MIN3(PAGE_SIZE - s_off, PAGE_SIZE - d_off, rem);
+
+         sb = bintree_find_ptr(src->blocks_tree_root,
+                               *src_pos & (offt)PAGE_MASK,
+                               struct ramfs_block,
+                               node,
+                               offset);
+
+         db = ramfs_get_block_for_write(dst, *dst_pos & (offt)PAGE_MASK);
+
+         if (!db)
+            break;
+
+         memcpy((char *)db->vaddr + d_off,
+                sb ? (char *)sb->vaddr + s_off : zero_page,
+                n);
+      }
+
+      tot += n;
+      *src_pos += (offt)n;
+      *dst_pos += (offt)n;
+
+      if (*dst_pos > dst->fsize)
+         dst->fsize = *dst_pos;
+   }
+
+   if (len > 0 && !tot)
+      return -ENOSPC;
+
+   return (ssize_t)tot;
+}
+
+static ssize_t
+ramfs_copy_range(fs_handle in_h,
+                 offt *in_pos,
+                 fs_handle out_h,
+                 offt *out_pos,
+                 size_t len)
+{
+   struct ramfs_inode *src = ((struct ramfs_handle *)in_h)->inode;
+   struct ramfs_inode *dst = ((struct ramfs_handle *)out_h)->inode;
+   ssize_t ret;
+
+   if (src->type == VFS_DIR)
+      return -EISDIR;
+
+   ASSERT(dst->type == VFS_FILE);
+
+   if (src == dst) {
+
+      rwlock_wp_exlock(&dst->rwlock);
+      {
+         ret = ramfs_copy_range_nolock(src, in_pos, dst, out_pos, len);
+      }
+      rwlock_wp_exunlock(&dst->rwlock);
+      return ret;
+   }
+
+   /* Always lock the two inodes in the same order, to avoid deadlocks */
+   if (src < dst) {
+      rwlock_wp_shlock(&src->rwlock);
+      rwlock_wp_exlock(&dst->rwlock);
+   } else {
+      rwlock_wp_exlock(&dst->rwlock);
+      rwlock_wp_shlock(&src->rwlock);
+   }
+
+   ret = ramfs_copy_range_nolock(src, in_pos, dst, out_pos, len);
+
+   rwlock_wp_shunlock(&src->rwlock);
+   rwlock_wp_exunlock(&dst->rwlock);
+   return ret;
+}
+
+/*
+ * Deallocate the whole blocks in [off, end) and zero the partial ones at the
+ * edges of the range. Blocks of inodes memory-mapped by user processes are
+ * just zeroed instead, because their pages might be mapped somewhere.
+ */
+static int ramfs_punch_hole(struct ramfs_inode *i, offt off, offt end)
+{
+   const bool mapped = !list_is_empty(&i->mappings_list);
+   struct ramfs_block *b;
+   offt page;
+
+   ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
+
+   b = bintree_get_last_obj(i->blocks_tree_root, struct ramfs_block, node);
+
+   if (!b)
+      return 0;
+
+   end = MIN(end, b->offset + (offt)PAGE_SIZE);
+
+   for (page = off & (offt)PAGE_MASK; page < end; page += PAGE_SIZE) {
+
+      const offt p_start = MAX(off, page) - page;
+      const offt p_end = MIN(end, page + (offt)PAGE_SIZE) - page;
+
+      if (!(b = ramfs_find_block(i, page)))
+         continue;
+
+      if (p_start == 0 && p_end == PAGE_SIZE && !mapped) {
+         ramfs_remove_block(i, b);
+         continue;
+      }
+
+      if (ramfs_block_unshare(b))
+         return -ENOMEM;
+
+      bzero((char *)b->vaddr + p_start, (size_t)(p_end - p_start));
+   }
+
+   return 0;
+}
+
+static int ramfs_fallocate(fs_handle h, int mode, offt off, offt len)
+{
+   struct ramfs_handle *rh = h;
+   struct ramfs_inode *i = rh->inode;
+   const offt end = off + len;
+   int rc;
+
+   if (i->type != VFS_FILE)
+      return -ENODEV;
+
+   ramfs_file_exlock(h);
+   {
+      if ((rc = ramfs_check_falloc_seals(i, mode, end)))
+         goto out;
+
+      if (mode & FALLOC_FL_PUNCH_HOLE) {
+
+         rc = ramfs_punch_hole(i, off, end);
+
+      } else {
+
+         /*
+          * NOTE: in case of failure, the blocks already allocated are kept.
+          * They'll be used by the next writes or dropped by truncate().
+          */
+         rc = ramfs_alloc_blocks(i, off, end);
+
+         if (!rc && !(mode & FALLOC_FL_KEEP_SIZE) && end > i->fsize)
+            rc = ramfs_inode_extend(i, end);
+      }
+   }
+out:
+   ramfs_file_exunlock(h);
+   return rc;
+}
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * File seals, as in Linux's memfd. Regular ramfs files are created with
+ * F_SEAL_SEAL, so only the unnamed files created with MFD_ALLOW_SEALING can
+ * actually be sealed. All the functions here expect the inode to be locked.
+ */
+
+#define RAMFS_ALL_SEALS (F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW |          \
+                         F_SEAL_WRITE | F_SEAL_FUTURE_WRITE)
+
+#define RAMFS_WRITE_SEALS                 (F_SEAL_WRITE | F_SEAL_FUTURE_WRITE)
+
+static int
+ramfs_check_write_seals(struct ramfs_inode *i, offt pos, size_t len)
+{
+   if (i->seals & RAMFS_WRITE_SEALS)
+      return -EPERM;
+
+   if ((i->seals & F_SEAL_GROW) && pos + (offt)len > i->fsize)
+      return -EPERM;
+
+   return 0;
+}
+
+static int ramfs_check_resize_seals(struct ramfs_inode *i, offt len)
+{
+   if ((i->seals & F_SEAL_SHRINK) && len < i->fsize)
+      return -EPERM;
+
+   if ((i->seals & F_SEAL_GROW) && len > i->fsize)
+      return -EPERM;
+
+   return 0;
+}
+
+static int ramfs_check_falloc_seals(struct ramfs_inode *i, int mode, offt end)
+{
+   if (mode & FALLOC_FL_PUNCH_HOLE)
+      return i->seals & RAMFS_WRITE_SEALS ? -EPERM : 0;
+
+   if (!(mode & FALLOC_FL_KEEP_SIZE) && end > i->fsize)
+      return ramfs_check_resize_seals(i, end);
+
+   return 0;
+}
+
+static bool ramfs_has_writable_mappings(struct ramfs_inode *i)
+{
+   struct user_mapping *um;
+
+   list_for_each_ro(um, &i->mappings_list, inode_node) {
+      if (um->prot & PROT_WRITE)
+         return true;
+   }
+
+   return false;
+}
+
+static int ramfs_add_seals_nolock(struct ramfs_inode *i, u32 seals)
+{
+   int rc = 0;
+
+   if (seals & ~RAMFS_ALL_SEALS)
+      return -EINVAL;
+
+   if (i->seals & F_SEAL_SEAL)
+      return -EPERM;
+
+   if (seals & F_SEAL_WRITE) {
+
+      /* Like Linux, F_SEAL_WRITE requires no shared writable mappings */
+      disable_preemption();
+      {
+         if (ramfs_has_writable_mappings(i))
+            rc = -EBUSY;
+      }
+      enable_preemption();
+   }
+
+   if (!rc)
+      i->seals |= seals;
+
+   return rc;
+}
@@ -35,6 +35,10 @@ ramfs_stat_nolock(struct mnt_fs *fs,
          statbuf->st_size = (typeof(statbuf->st_size)) inode->path_len;
          break;
 
+      case VFS_SOCKET:
+         statbuf->st_size = 0;
+         break;
+
       default:
          NOT_IMPLEMENTED();
          break;
@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/pipe.h>
+
+#include <fcntl.h>      // system header
+
+#include "fs_int.h"
+
+#define SPLICE_ALL_FLAGS \
+   (SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT)
+
+/*
+ * Check that the handle can be used as a source (write == false) or as a
+ * destination (write == true) for the in-kernel data movement syscalls. Those
+ * call the read/write file ops with kernel buffers: therefore, handles whose
+ * ops expect user pointers (VFS_SPFL_NO_USER_COPY) cannot be supported.
+ */
+static int splice_check_handle(struct fs_handle_base *hb, bool write)
+{
+   if (write) {
+
+      if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
+         return -EBADF;
+
+      if (!hb->fops->write)
+         return -EINVAL;
+
+   } else {
+
+      if ((hb->fl_flags & O_WRONLY) && !(hb->fl_flags & O_RDWR))
+         return -EBADF;
+
+      if (!hb->fops->read)
+         return -EINVAL;
+   }
+
+   if (hb->spec_flags & VFS_SPFL_NO_USER_COPY)
+      return -EINVAL;
+
+   return 0;
+}
+
+static ssize_t
+do_sendfile(struct fs_handle_base *out,
+            struct fs_handle_base *in,
+            offt *off,
+            size_t count)
+{
+   int rc;
+
+   if ((rc = splice_check_handle(in, false)))
+      return rc;
+
+   if ((rc = splice_check_handle(out, true)))
+      return rc;
+
+   if (is_pipe_read_end(in)) {
+
+      if (off)
+         return -ESPIPE;
+
+      /*
+       * Between two pipes, pipe_splice_to() would write into `out` while
+       * holding the mutex of `in`: use pipe_tee(), like splice() does.
+       */
+      if (is_pipe_write_end(out))
+         return pipe_tee(in, out, count, false, true);
+
+      return pipe_splice_to(in, out, &out->h_fpos, count, false);
+   }
+
+   if (!off)
+      off = &in->h_fpos;
+
+   if (is_pipe_write_end(out))
+      return pipe_splice_from(out, in, off, count, false);
+
+   return vfs_copy_data(in, off, out, &out->h_fpos, count);
+}
+
+static int
+sendfile_int(int out_fd, int in_fd, void *u_offset, bool off64, size_t count)
+{
+   struct fs_handle_base *in, *out;
+   ssize_t rc;
+   s64 off64_val;
+   long off32_val;
+   offt pos;
+
+   if (!(in = get_fs_handle(in_fd)) || !(out = get_fs_handle(out_fd)))
+      return -EBADF;
+
+   count = MIN(count, (size_t)INT32_MAX);
+
+   if (!u_offset)
+      return (int)do_sendfile(out, in, NULL, count);
+
+   if (off64) {
+
+      if (copy_from_user(&off64_val, u_offset, sizeof(off64_val)))
+         return -EFAULT;
+
+   } else {
+
+      if (copy_from_user(&off32_val, u_offset, sizeof(off32_val)))
+         return -EFAULT;
+
+      off64_val = off32_val;
+   }
+
+   if (off64_val < 0 || off64_val > OFFT_MAX)
+      return -EINVAL;
+
+   pos = (offt)off64_val;
+   rc = do_sendfile(out, in, &pos, count);
+
+   if (rc > 0) {
+
+      off64_val = pos;
+      off32_val = (long)pos;
+
+      if (off64) {
+         if (copy_to_user(u_offset, &off64_val, sizeof(off64_val)))
+            return -EFAULT;
+      } else {
+         if (copy_to_user(u_offset, &off32_val, sizeof(off32_val)))
+            return -EFAULT;
+      }
+   }
+
+   return (int)rc;
+}
+
+int sys_sendfile(int out_fd, int in_fd, long *u_offset, size_t count)
+{
+   return sendfile_int(out_fd, in_fd, u_offset, false, count);
+}
+
+int sys_sendfile64(int out_fd, int in_fd, s64 *u_offset, size_t count)
+{
+   return sendfile_int(out_fd, in_fd, u_offset, true, count);
+}
+
+int sys_splice(int fd_in, s64 *u_off_in, int fd_out, s64 *u_off_out,
+               size_t len, u32 flags)
+{
+   const bool nonblock = !!(flags & SPLICE_F_NONBLOCK);
+   struct fs_handle_base *in, *out, *file;
+   bool in_pipe, out_pipe;
+   s64 *u_off;
+   offt pos, *pos_ptr;
+   ssize_t rc;
+   s64 off;
+
+   if (flags & ~SPLICE_ALL_FLAGS)
+      return -EINVAL;
+
+   if (!(in = get_fs_handle(fd_in)) || !(out = get_fs_handle(fd_out)))
+      return -EBADF;
+
+   if ((rc = splice_check_handle(in, false)))
+      return (int)rc;
+
+   if ((rc = splice_check_handle(out, true)))
+      return (int)rc;
+
+   in_pipe = is_pipe_read_end(in);
+   out_pipe = is_pipe_write_end(out);
+   len = MIN(len, (size_t)INT32_MAX);
+
+   if (!in_pipe && !out_pipe)
+      return -EINVAL; /* At least one of the two must be a pipe */
+
+   if ((in_pipe && u_off_in) || (out_pipe && u_off_out))
+      return -ESPIPE;
+
+   if (in_pipe && out_pipe)
+      return (int)pipe_tee(in, out, len, nonblock, true);
+
+   file = in_pipe ? out : in;
+   u_off = in_pipe ? u_off_out : u_off_in;
+   pos_ptr = &file->h_fpos;
+
+   if (u_off) {
+
+      if (copy_from_user(&off, u_off, sizeof(off)))
+         return -EFAULT;
+
+      if (off < 0 || off > OFFT_MAX)
+         return -EINVAL;
+
+      pos = (offt)off;
+      pos_ptr = &pos;
+   }
+
+   if (in_pipe)
+      rc = pipe_splice_to(in, out, pos_ptr, len, nonblock);
+   else
+      rc = pipe_splice_from(out, in, pos_ptr, len, nonblock);
+
+   if (u_off && rc > 0) {
+
+      off = pos;
+
+      if (copy_to_user(u_off, &off, sizeof(off)))
+         return -EFAULT;
+   }
+
+   return (int)rc;
+}
+
+int sys_tee(int fd_in, int fd_out, size_t len, u32 flags)
+{
+   struct fs_handle_base *in, *out;
+
+   if (flags & ~SPLICE_ALL_FLAGS)
+      return -EINVAL;
+
+   if (!(in = get_fs_handle(fd_in)) || !(out = get_fs_handle(fd_out)))
+      return -EBADF;
+
+   if (!is_pipe_read_end(in) || !is_pipe_write_end(out))
+      return -EINVAL;
+
+   len = MIN(len, (size_t)INT32_MAX);
+   return (int)pipe_tee(in, out, len, !!(flags & SPLICE_F_NONBLOCK), false);
+}
+
+int sys_vmsplice(int fd, const struct iovec *u_iov, int nr_segs, u32 flags)
+{
+   struct fs_handle_base *h;
+   struct iovec *iov;
+   int rc;
+
+   if (flags & ~SPLICE_ALL_FLAGS)
+      return -EINVAL;
+
+   if ((rc = copy_iov_from_user(u_iov, nr_segs, &iov)))
+      return rc;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if (!is_pipe_read_end(h) && !is_pipe_write_end(h))
+      return -EBADF;
+
+   return (int)pipe_vmsplice(h, iov, nr_segs, !!(flags & SPLICE_F_NONBLOCK));
+}
+
+int sys_copy_file_range(int fd_in, s64 *u_off_in, int fd_out, s64 *u_off_out,
+                        size_t len, u32 flags)
+{
+   struct fs_handle_base *in, *out;
+   offt in_pos, out_pos;
+   offt *in_ptr, *out_ptr;
+   ssize_t rc;
+   s64 off;
+
+   if (flags)
+      return -EINVAL;
+
+   if (!(in = get_fs_handle(fd_in)) || !(out = get_fs_handle(fd_out)))
+      return -EBADF;
+
+   if (is_pipe_read_end(in) || is_pipe_write_end(out))
+      return -EINVAL;
+
+   in_ptr = &in->h_fpos;
+   out_ptr = &out->h_fpos;
+   len = MIN(len, (size_t)INT32_MAX);
+
+   if (u_off_in) {
+
+      if (copy_from_user(&off, u_off_in, sizeof(off)))
+         return -EFAULT;
+
+      if (off < 0 || off > OFFT_MAX)
+         return -EINVAL;
+
+      in_pos = (offt)off;
+      in_ptr = &in_pos;
+   }
+
+   if (u_off_out) {
+
+      if (copy_from_user(&off, u_off_out, sizeof(off)))
+         return -EFAULT;
+
+      if (off < 0 || off > OFFT_MAX)
+         return -EINVAL;
+
+      out_pos = (offt)off;
+      out_ptr = &out_pos;
+   }
+
+   rc = vfs_copy_file_range(in, in_ptr, out, out_ptr, len);
+
+   if (rc > 0) {
+
+      if (u_off_in) {
+
+         off = in_pos;
+
+         if (copy_to_user(u_off_in, &off, sizeof(off)))
+            return -EFAULT;
+      }
+
+      if (u_off_out) {
+
+         off = out_pos;
+
+         if (copy_to_user(u_off_out, &off, sizeof(off)))
+            return -EFAULT;
+      }
+   }
+
+   return (int)rc;
+}
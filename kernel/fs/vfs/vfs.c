@@ -10,6 +10,7 @@
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/epoll.h>
 
 #include <dirent.h> // system header
 
@@ -38,6 +39,9 @@ void vfs_close(fs_handle h)
    if (!pi->vforked)
       remove_all_mappings_of_handle(pi, h);
 
+   if (hb->spec_flags & VFS_SPFL_EPOLL)
+      epoll_on_handle_close(h);
+
    if (fsops->on_close)
       fsops->on_close(h);
 
@@ -226,7 +230,7 @@ int vfs_fsync(fs_handle h)
 {
    struct fs_handle_base *hb = h;
    int rc = 0;
-   ASSERT(is_preemption_enabled());
+   NO_TEST_ASSERT(is_preemption_enabled());
 
    if (~hb->fs->flags & VFS_FS_RW)
       return -EROFS;
@@ -241,7 +245,7 @@ int vfs_fdatasync(fs_handle h)
 {
    struct fs_handle_base *hb = h;
    int rc = 0;
-   ASSERT(is_preemption_enabled());
+   NO_TEST_ASSERT(is_preemption_enabled());
 
    if (~hb->fs->flags & VFS_FS_RW)
       return -EROFS;
@@ -257,6 +261,36 @@ int vfs_fdatasync(fs_handle h)
    return rc;
 }
 
+int vfs_fallocate(fs_handle h, int mode, offt off, offt len)
+{
+   struct fs_handle_base *hb = h;
+   NO_TEST_ASSERT(is_preemption_enabled());
+
+   if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
+      return -EOPNOTSUPP;
+
+   /* Like on Linux, punching a hole must never change the file size */
+   if ((mode & FALLOC_FL_PUNCH_HOLE) && !(mode & FALLOC_FL_KEEP_SIZE))
+      return -EOPNOTSUPP;
+
+   if (off < 0 || len <= 0)
+      return -EINVAL;
+
+   if (len > OFFT_MAX - off)
+      return -EFBIG;
+
+   if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF;
+
+   if (~hb->fs->flags & VFS_FS_RW)
+      return -EROFS;
+
+   if (!hb->fops->fallocate)
+      return -EOPNOTSUPP;
+
+   return hb->fops->fallocate(h, mode, off, len);
+}
+
 /* ----------- path-based functions -------------- */
 
 typedef int (*vfs_func_impl)(struct mnt_fs *,
@@ -400,6 +434,37 @@ int vfs_mkdir(const char *path, mode_t mode)
    );
 }
 
+static ALWAYS_INLINE int
+vfs_mknod_impl(struct mnt_fs *fs,
+               struct vfs_path *p,
+               mode_t mode,
+               ulong x, ulong y)
+{
+   if (!fs->fsops->mknod)
+      return -EPERM;
+
+   if (!(fs->flags & VFS_FS_RW))
+      return -EROFS;
+
+   if (p->fs_path.inode)
+      return -EEXIST;
+
+   return fs->fsops->mknod(p, mode);
+}
+
+int vfs_mknod(const char *path, mode_t mode)
+{
+   return vfs_path_funcs_wrapper(
+      path,
+      true,             /* exlock */
+      false,            /* res_last_sl */
+      vfs_mknod_impl,
+      mode,
+      0,
+      0
+   );
+}
+
 static ALWAYS_INLINE int
 vfs_rmdir_impl(struct mnt_fs *fs,
                struct vfs_path *p,
@@ -802,7 +867,8 @@ int vfs_futimens(fs_handle h, const struct k_timespec64 times[2])
    return fsops->futimens(hb->fs, fsops->get_inode(h), times);
 }
 
-ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt)
+static ssize_t
+vfs_readv_int(fs_handle h, const struct iovec *iov, int iovcnt, offt *pos)
 {
    struct fs_handle_base *hb = h;
    struct task *curr = get_curr_task();
@@ -810,8 +876,14 @@ ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt)
    ssize_t rc;
    size_t len;
 
+   if (!hb->fops->read && !hb->fops->readv)
+      return -EBADF;
+
+   if ((hb->fl_flags & O_WRONLY) && !(hb->fl_flags & O_RDWR))
+      return -EBADF; /* file not opened for reading */
+
    if (hb->fops->readv)
-      return hb->fops->readv(h, iov, iovcnt);
+      return hb->fops->readv(h, iov, iovcnt, pos);
 
    /*
     * readv() is not implemented in the file system: implement here it in a
@@ -829,14 +901,14 @@ ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt)
 
       len = MIN(iov[i].iov_len, IO_COPYBUF_SIZE);
 
-      rc = vfs_read(h, curr->io_copybuf, len);
+      rc = hb->fops->read(h, curr->io_copybuf, len, pos);
 
       if (rc < 0) {
          ret = rc;
          break;
       }
 
-      if (copy_to_user(iov[i].iov_base, curr->io_copybuf, len))
+      if (copy_to_user(iov[i].iov_base, curr->io_copybuf, (size_t)rc))
          return -EFAULT;
 
       ret += rc;
@@ -848,7 +920,8 @@ ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt)
    return ret;
 }
 
-ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
+static ssize_t
+vfs_writev_int(fs_handle h, const struct iovec *iov, int iovcnt, offt *pos)
 {
    struct fs_handle_base *hb = h;
    struct task *curr = get_curr_task();
@@ -856,19 +929,18 @@ ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
    ssize_t rc;
    size_t len;
 
+   if (!hb->fops->write && !hb->fops->writev)
+      return -EBADF;
+
+   if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF; /* file not opened for writing */
+
    if (hb->fops->writev)
-      return hb->fops->writev(h, iov, iovcnt);
+      return hb->fops->writev(h, iov, iovcnt, pos);
 
    /*
     * writev() is not implemented in the file system: implement here it in a
-    * generic but non-atomic way. There's nothing more we can do. Also, the
-    * POSIX standard does not require writev() to be atomic:
-    *
-    *    https://pubs.opengroup.org/onlinepubs/9699919799/
-    *
-    * Note: Linux's man page claims that readv/writev must be atomic: that's
-    * possible now because all of the Linux file systems support internally the
-    * scatter/gather I/O. On Tilck, not all the file systems will support it.
+    * generic but non-atomic way. See the comment in vfs_readv_int().
     */
 
    for (int i = 0; i < iovcnt; i++) {
@@ -878,7 +950,7 @@ ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
       if (copy_from_user(curr->io_copybuf, iov[i].iov_base, len))
          return -EFAULT;
 
-      rc = vfs_write(h, curr->io_copybuf, len);
+      rc = hb->fops->write(h, curr->io_copybuf, len, pos);
 
       if (rc < 0) {
          ret = rc;
@@ -897,6 +969,112 @@ ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
    return ret;
 }
 
+ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt)
+{
+   struct fs_handle_base *hb = h;
+   return vfs_readv_int(h, iov, iovcnt, &hb->h_fpos);
+}
+
+ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
+{
+   struct fs_handle_base *hb = h;
+   return vfs_writev_int(h, iov, iovcnt, &hb->h_fpos);
+}
+
+ssize_t vfs_preadv(fs_handle h, const struct iovec *iov, int iovcnt, offt off)
+{
+   return vfs_readv_int(h, iov, iovcnt, &off);
+}
+
+ssize_t vfs_pwritev(fs_handle h, const struct iovec *iov, int iovcnt, offt off)
+{
+   return vfs_writev_int(h, iov, iovcnt, &off);
+}
+
+/*
+ * Generic in-kernel data copy between two handles, through the per-task copy
+ * buffer. Used when there's no better way to move the data.
+ */
+ssize_t
+vfs_copy_data(fs_handle in, offt *in_pos,
+              fs_handle out, offt *out_pos, size_t len)
+{
+   struct fs_handle_base *ib = in;
+   struct fs_handle_base *ob = out;
+   struct task *curr = get_curr_task();
+   ssize_t tot = 0;
+   ssize_t r, w;
+
+   while ((size_t)tot < len) {
+
+      const size_t n = MIN(len - (size_t)tot, IO_COPYBUF_SIZE);
+
+      if ((r = ib->fops->read(in, curr->io_copybuf, n, in_pos)) <= 0) {
+
+         if (!tot)
+            tot = r;
+
+         break;
+      }
+
+      w = ob->fops->write(out, curr->io_copybuf, (size_t)r, out_pos);
+
+      if (w < r) {
+
+         /* Give back to `in` the data we could not write */
+         const offt unwritten = (offt)(r - MAX(w, 0));
+
+         if (in_pos == &ib->h_fpos)
+            vfs_seek(in, -unwritten, SEEK_CUR);
+         else
+            *in_pos -= unwritten;
+
+         if (w > 0)
+            tot += w;
+         else if (!tot)
+            tot = w;
+
+         break;
+      }
+
+      tot += w;
+   }
+
+   return tot;
+}
+
+ssize_t
+vfs_copy_file_range(fs_handle in, offt *in_pos,
+                    fs_handle out, offt *out_pos, size_t len)
+{
+   NO_TEST_ASSERT(is_preemption_enabled());
+   struct fs_handle_base *ib = in;
+   struct fs_handle_base *ob = out;
+
+   if (!ib->fops->read)
+      return -EBADF;
+
+   if ((ib->fl_flags & O_WRONLY) && !(ib->fl_flags & O_RDWR))
+      return -EBADF;
+
+   if (!ob->fops->write || !(ob->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF;
+
+   if (ob->fl_flags & O_APPEND)
+      return -EBADF;
+
+   if ((ib->spec_flags | ob->spec_flags) & VFS_SPFL_NO_USER_COPY)
+      return -EINVAL;
+
+   if (!len)
+      return 0;
+
+   if (ib->fs == ob->fs && ib->fops->copy_range)
+      return ib->fops->copy_range(in, in_pos, out, out_pos, len);
+
+   return vfs_copy_data(in, in_pos, out, out_pos, len);
+}
+
 u32 vfs_get_new_device_id(void)
 {
    return next_device_id++;
@@ -23,6 +23,7 @@ vfs_type_to_linux_dirent_type(enum vfs_entry_type t)
       [VFS_CHAR_DEV]    = DT_CHR,
       [VFS_BLOCK_DEV]   = DT_BLK,
       [VFS_PIPE]        = DT_FIFO,
+      [VFS_SOCKET]      = DT_SOCK,
    };
 
    ASSERT(t != VFS_NONE);
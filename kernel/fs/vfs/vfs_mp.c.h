@@ -152,7 +152,7 @@ int mp_remove(const char *target_path)
 
 void vfs_syncfs(struct mnt_fs *fs)
 {
-   ASSERT(is_preemption_enabled());
+   NO_TEST_ASSERT(is_preemption_enabled());
 
    if (~fs->flags & VFS_FS_RW)
       return;  /* the filesystem is mounted as read-only: nothing to sync */
@@ -0,0 +1,523 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/futex.h>
+
+/*
+ * futex
+ * -------
+ *
+ * The fast path of a futex-based lock lives entirely in userspace: the kernel
+ * is entered only by a contended lock, once to sleep (FUTEX_WAIT) and once to
+ * wake up the sleepers (FUTEX_WAKE). Therefore, no per-futex state exists in
+ * the kernel: the waiters are kept in a small hash table of wait queues, keyed
+ * by the "identity" of the futex word:
+ *
+ *    - private futexes (FUTEX_PRIVATE_FLAG) and futexes in anonymous memory
+ *      are identified by the address space (pdir) and the virtual address
+ *
+ *    - shared futexes in file mappings, the only MAP_SHARED mappings supported
+ *      by Tilck, are identified by the physical address, because the same page
+ *      might be mapped at different addresses in different processes.
+ *
+ * Each waiter has its own kcond, living on its stack: that allows the wakers
+ * to wake exactly the waiters matching the key (and the bitset), without any
+ * thundering herd on the other futexes sharing the same bucket.
+ *
+ * Locking: everything is protected by `futex_mutex`. The check of the futex
+ * value in FUTEX_WAIT and the enqueue of the waiter happen while holding it,
+ * so a FUTEX_WAKE issued after the userspace changed the value can never be
+ * lost.
+ */
+
+#define FUTEX_HASH_BITS                                      6
+#define FUTEX_HASH_SIZE                   (1 << FUTEX_HASH_BITS)
+
+struct futex_key {
+
+   void *mm;              /* pdir, or NULL for keys based on the paddr */
+   ulong addr;            /* vaddr or paddr of the futex word */
+};
+
+struct futex_waiter {
+
+   struct list_node node;
+   struct futex_key key;
+   u32 bitset;
+   bool woken;
+   struct kcond cond;
+};
+
+static struct kmutex futex_mutex = STATIC_KMUTEX_INIT(futex_mutex, 0);
+static struct list futex_buckets[FUTEX_HASH_SIZE];
+static bool futex_buckets_ready;
+
+static inline bool
+futex_key_eq(const struct futex_key *a, const struct futex_key *b)
+{
+   return a->mm == b->mm && a->addr == b->addr;
+}
+
+static struct list *futex_get_bucket(const struct futex_key *key)
+{
+   ulong h = (key->addr >> 2) ^ ((ulong)key->mm >> PAGE_SHIFT);
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&futex_mutex));
+
+   /*
+    * Initialize the buckets on first use, instead of requiring an explicit
+    * init call at boot: the futex code has no other reason to run early.
+    */
+   if (UNLIKELY(!futex_buckets_ready)) {
+
+      for (int i = 0; i < FUTEX_HASH_SIZE; i++)
+         list_init(&futex_buckets[i]);
+
+      futex_buckets_ready = true;
+   }
+
+   h ^= h >> FUTEX_HASH_BITS;
+   return &futex_buckets[h & (FUTEX_HASH_SIZE - 1)];
+}
+
+static int
+futex_get_key(u32 *uaddr, bool priv, struct futex_key *key, u32 *val)
+{
+   struct process *pi = get_curr_proc();
+   struct user_mapping *um;
+   ulong paddr;
+   int rc = 0;
+
+   if ((ulong)uaddr & (sizeof(u32) - 1))
+      return -EINVAL;
+
+   /* Read the value: that also makes sure the page is present */
+   if (copy_from_user(val, uaddr, sizeof(u32)))
+      return -EFAULT;
+
+   *key = (struct futex_key) { .mm = pi->pdir, .addr = (ulong)uaddr };
+
+   if (priv)
+      return 0;
+
+   disable_preemption();
+   {
+      um = process_get_user_mapping(uaddr);
+
+      if (um && um->h) {
+
+         if (get_mapping2(pi->pdir, uaddr, &paddr) < 0)
+            rc = -EFAULT;
+         else
+            *key = (struct futex_key) { .mm = NULL, .addr = paddr };
+      }
+   }
+   enable_preemption();
+   return rc;
+}
+
+static int
+futex_wait(u32 *uaddr, bool priv, u32 val, u32 bitset, u64 deadline)
+{
+   struct futex_waiter w = { .bitset = bitset };
+   u32 curr_val;
+   u64 now;
+   int rc;
+
+   if (!bitset)
+      return -EINVAL;
+
+   kmutex_lock(&futex_mutex);
+
+   if ((rc = futex_get_key(uaddr, priv, &w.key, &curr_val)))
+      goto out;
+
+   if (curr_val != val) {
+      rc = -EAGAIN;
+      goto out;
+   }
+
+   list_node_init(&w.node);
+   kcond_init(&w.cond);
+   list_add_tail(futex_get_bucket(&w.key), &w.node);
+
+   while (!w.woken) {
+
+      u32 ticks = KCOND_WAIT_FOREVER;
+
+      if (deadline) {
+
+         if ((now = get_ticks()) >= deadline) {
+            rc = -ETIMEDOUT;
+            break;
+         }
+
+         ticks = (u32)MIN(deadline - now, (u64)INT32_MAX);
+      }
+
+      kcond_wait(&w.cond, &futex_mutex, ticks);
+
+      if (!w.woken && pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   if (!w.woken)
+      list_remove(&w.node);
+
+   kcond_destory(&w.cond);
+
+out:
+   kmutex_unlock(&futex_mutex);
+   return rc;
+}
+
+static int
+futex_wake_key(const struct futex_key *key, int n, u32 bitset)
+{
+   struct futex_waiter *pos, *temp;
+   struct list *bucket = futex_get_bucket(key);
+   int cnt = 0;
+
+   list_for_each(pos, temp, bucket, node) {
+
+      if (cnt >= n)
+         break;
+
+      if (!futex_key_eq(&pos->key, key) || !(pos->bitset & bitset))
+         continue;
+
+      list_remove(&pos->node);
+      pos->woken = true;
+      kcond_signal_one(&pos->cond);
+      cnt++;
+   }
+
+   return cnt;
+}
+
+static int
+futex_wake(u32 *uaddr, bool priv, int n, u32 bitset)
+{
+   struct futex_key key;
+   u32 unused;
+   int rc;
+
+   if (!bitset)
+      return -EINVAL;
+
+   kmutex_lock(&futex_mutex);
+
+   if (!(rc = futex_get_key(uaddr, priv, &key, &unused)))
+      rc = futex_wake_key(&key, n, bitset);
+
+   kmutex_unlock(&futex_mutex);
+   return rc;
+}
+
+/* Used by the kernel itself, e.g. for CLONE_CHILD_CLEARTID */
+int futex_wake_addr(void *uaddr, int n)
+{
+   return futex_wake(uaddr, false, n, FUTEX_BITSET_MATCH_ANY);
+}
+
+static int
+futex_requeue(u32 *uaddr, bool priv, int n, int n2,
+              u32 *uaddr2, bool cmp, u32 val3)
+{
+   struct futex_waiter *pos, *temp;
+   struct futex_key key, key2;
+   struct list *bucket, *bucket2;
+   int woken, requeued = 0;
+   u32 val, unused;
+   int rc;
+
+   if (n < 0 || n2 < 0)
+      return -EINVAL;
+
+   kmutex_lock(&futex_mutex);
+
+   if ((rc = futex_get_key(uaddr, priv, &key, &val)))
+      goto out;
+
+   if ((rc = futex_get_key(uaddr2, priv, &key2, &unused)))
+      goto out;
+
+   if (cmp && val != val3) {
+      rc = -EAGAIN;
+      goto out;
+   }
+
+   woken = futex_wake_key(&key, n, FUTEX_BITSET_MATCH_ANY);
+   bucket = futex_get_bucket(&key);
+   bucket2 = futex_get_bucket(&key2);
+
+   list_for_each(pos, temp, bucket, node) {
+
+      if (requeued >= n2 || futex_key_eq(&key, &key2))
+         break;
+
+      if (!futex_key_eq(&pos->key, &key))
+         continue;
+
+      list_remove(&pos->node);
+      pos->key = key2;
+      list_add_tail(bucket2, &pos->node);
+      requeued++;
+   }
+
+   rc = woken + requeued;
+
+out:
+   kmutex_unlock(&futex_mutex);
+   return rc;
+}
+
+static int
+futex_do_op(u32 op, u32 *val_ref)
+{
+   const u32 type = (op >> 28) & 7;
+   const int cmp = (op >> 24) & 15;
+   const int cmparg = ((int)(op << 20)) >> 20;   /* sign-extended, 12 bits */
+   int oparg = ((int)(op << 8)) >> 20;           /* sign-extended, 12 bits */
+   const int old = (int)*val_ref;
+
+   if ((op >> 28) & FUTEX_OP_OPARG_SHIFT)
+      oparg = (int)(1u << (oparg & 31));
+
+   switch (type) {
+      case FUTEX_OP_SET:
+         *val_ref = (u32)oparg;
+         break;
+      case FUTEX_OP_ADD:
+         *val_ref = (u32)old + (u32)oparg;
+         break;
+      case FUTEX_OP_OR:
+         *val_ref = (u32)old | (u32)oparg;
+         break;
+      case FUTEX_OP_ANDN:
+         *val_ref = (u32)old & ~(u32)oparg;
+         break;
+      case FUTEX_OP_XOR:
+         *val_ref = (u32)old ^ (u32)oparg;
+         break;
+      default:
+         return -ENOSYS;
+   }
+
+   switch (cmp) {
+      case FUTEX_OP_CMP_EQ:
+         return old == cmparg;
+      case FUTEX_OP_CMP_NE:
+         return old != cmparg;
+      case FUTEX_OP_CMP_LT:
+         return old < cmparg;
+      case FUTEX_OP_CMP_LE:
+         return old <= cmparg;
+      case FUTEX_OP_CMP_GT:
+         return old > cmparg;
+      case FUTEX_OP_CMP_GE:
+         return old >= cmparg;
+      default:
+         return -ENOSYS;
+   }
+}
+
+static int
+futex_wake_op(u32 *uaddr, bool priv, int n, int n2, u32 *uaddr2, u32 op)
+{
+   struct futex_key key, key2;
+   u32 unused, val, new_val;
+   int rc, cmp_res = 0;
+
+   kmutex_lock(&futex_mutex);
+
+   if ((rc = futex_get_key(uaddr, priv, &key, &unused)))
+      goto out;
+
+   if ((rc = futex_get_key(uaddr2, priv, &key2, &val)))
+      goto out;
+
+   /*
+    * Write back the value we just read, in order to trigger a possible
+    * copy-on-write fault now: after that, the read-modify-write below can
+    * run with preemption disabled, atomically from the userspace's point of
+    * view, without any page faults.
+    */
+   if (copy_to_user(uaddr2, &val, sizeof(u32))) {
+      rc = -EFAULT;
+      goto out;
+   }
+
+   disable_preemption();
+   {
+      rc = copy_from_user(&val, uaddr2, sizeof(u32));
+      new_val = val;
+
+      if (!rc && (cmp_res = futex_do_op(op, &new_val)) >= 0)
+         rc = copy_to_user(uaddr2, &new_val, sizeof(u32));
+   }
+   enable_preemption();
+
+   if (rc) {
+      rc = -EFAULT;
+      goto out;
+   }
+
+   if (cmp_res < 0) {
+      rc = cmp_res;
+      goto out;
+   }
+
+   rc = futex_wake_key(&key, n, FUTEX_BITSET_MATCH_ANY);
+
+   if (cmp_res)
+      rc += futex_wake_key(&key2, n2, FUTEX_BITSET_MATCH_ANY);
+
+out:
+   kmutex_unlock(&futex_mutex);
+   return rc;
+}
+
+/*
+ * Convert the timeout to an absolute deadline in ticks. FUTEX_WAIT uses a
+ * relative timeout, while FUTEX_WAIT_BITSET an absolute one, either on
+ * CLOCK_MONOTONIC or CLOCK_REALTIME: those are the same clock in Tilck.
+ */
+static int
+futex_get_deadline(const struct k_timespec64 *ts, bool abs, u64 *deadline)
+{
+   struct k_timespec64 now, rel = *ts;
+
+   if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= BILLION)
+      return -EINVAL;
+
+   if (abs) {
+
+      real_time_get_timespec(&now);
+      rel.tv_sec -= now.tv_sec;
+      rel.tv_nsec -= now.tv_nsec;
+
+      if (rel.tv_nsec < 0) {
+         rel.tv_nsec += BILLION;
+         rel.tv_sec--;
+      }
+
+      if (rel.tv_sec < 0)
+         rel = (struct k_timespec64) { 0 };
+   }
+
+   /* Note: deadline == 0 means no timeout, while here it might be just 0 */
+   *deadline = MAX(get_ticks() + timespec_to_ticks(&rel), 1ull);
+   return 0;
+}
+
+static int
+do_futex(u32 *uaddr, int op, u32 val,
+         const struct k_timespec64 *timeout, /* kernel ptr, might be NULL */
+         u32 val2, u32 *uaddr2, u32 val3)
+{
+   const bool priv = !!(op & FUTEX_PRIVATE_FLAG);
+   const int cmd = op & FUTEX_CMD_MASK;
+   u64 deadline = 0;
+   int rc;
+
+   switch (cmd) {
+
+      case FUTEX_WAIT:
+         val3 = FUTEX_BITSET_MATCH_ANY;
+         /* fall-through */
+
+      case FUTEX_WAIT_BITSET:
+
+         if (timeout) {
+            rc = futex_get_deadline(timeout,
+                                    cmd == FUTEX_WAIT_BITSET,
+                                    &deadline);
+
+            if (rc)
+               return rc;
+         }
+
+         return futex_wait(uaddr, priv, val, val3, deadline);
+
+      case FUTEX_WAKE:
+         val3 = FUTEX_BITSET_MATCH_ANY;
+         /* fall-through */
+
+      case FUTEX_WAKE_BITSET:
+         return futex_wake(uaddr, priv, (int)MIN(val, (u32)INT32_MAX), val3);
+
+      case FUTEX_REQUEUE:
+      case FUTEX_CMP_REQUEUE:
+         return futex_requeue(uaddr, priv, (int)val, (int)val2,
+                              uaddr2, cmd == FUTEX_CMP_REQUEUE, val3);
+
+      case FUTEX_WAKE_OP:
+         return futex_wake_op(uaddr, priv, (int)val, (int)val2, uaddr2, val3);
+
+      default:
+         /* FUTEX_FD, the PI futexes and the requeue-PI ops */
+         return -ENOSYS;
+   }
+}
+
+static inline bool futex_cmd_has_timeout(int op)
+{
+   const int cmd = op & FUTEX_CMD_MASK;
+   return cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_BITSET;
+}
+
+int sys_futex(u32 *uaddr, int op, u32 val,
+              const struct k_timespec64 *user_timeout,
+              u32 *uaddr2, u32 val3)
+{
+   struct k_timespec64 ts;
+
+   if (!futex_cmd_has_timeout(op))
+      return do_futex(uaddr, op, val, NULL,
+                      (u32)(ulong)user_timeout, uaddr2, val3);
+
+   if (user_timeout && copy_from_user(&ts, user_timeout, sizeof(ts)))
+      return -EFAULT;
+
+   return do_futex(uaddr, op, val, user_timeout ? &ts : NULL, 0, uaddr2, val3);
+}
+
+int sys_futex_time32(u32 *uaddr, int op, u32 val,
+                     const struct k_timespec32 *user_timeout,
+                     u32 *uaddr2, u32 val3)
+{
+   struct k_timespec32 ts32;
+   struct k_timespec64 ts;
+
+   if (!futex_cmd_has_timeout(op))
+      return do_futex(uaddr, op, val, NULL,
+                      (u32)(ulong)user_timeout, uaddr2, val3);
+
+   if (user_timeout) {
+
+      if (copy_from_user(&ts32, user_timeout, sizeof(ts32)))
+         return -EFAULT;
+
+      ts = (struct k_timespec64) {
+         .tv_sec = ts32.tv_sec,
+         .tv_nsec = ts32.tv_nsec,
+      };
+   }
+
+   return do_futex(uaddr, op, val, user_timeout ? &ts : NULL, 0, uaddr2, val3);
+}
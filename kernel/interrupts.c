@@ -25,6 +25,9 @@ void arch_irq_handling(regs_t *r);
  */
 ATOMIC(int) __in_irq_count;
 
+/* Registers of the context interrupted by the innermost IRQ, if any */
+regs_t *__irq_regs;
+
 static ALWAYS_INLINE void inc_irq_count(void)
 {
    atomic_fetch_add_explicit(&__in_irq_count, 1, mo_relaxed);
@@ -193,6 +196,7 @@ static void irq_resched(regs_t *r)
 
 void irq_entry(regs_t *r)
 {
+   regs_t *prev_irq_regs;
    ASSERT(get_curr_task() != NULL);
    DEBUG_check_not_same_interrupt_nested(regs_intnum(r));
 
@@ -205,9 +209,15 @@ void irq_entry(regs_t *r)
    /* Increase the always-enabled in_irq_count counter */
    inc_irq_count();
 
+   /* Save the interrupted context for get_irq_regs() */
+   prev_irq_regs = __irq_regs;
+   __irq_regs = r;
+
    /* Call the arch-dependent IRQ handling logic */
    arch_irq_handling(r);
 
+   __irq_regs = prev_irq_regs;
+
    /* Decrease the always-enabled in_irq_count counter */
    dec_irq_count();
 
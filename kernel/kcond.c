@@ -106,6 +106,12 @@ kcond_signal_int(struct kcond *c, struct wait_obj *wo)
    ASSERT(!is_preemption_enabled());
    DEBUG_ONLY(check_not_in_irq_handler());
 
+   if (wo->type == WOBJ_KCOND_CB) {
+      struct kcond_cb *cb = CONTAINER_OF(wo, struct kcond_cb, wobj);
+      cb->func(cb);
+      return;
+   }
+
    struct task *ti =
       wo->type != WOBJ_MWO_ELEM
          ? CONTAINER_OF(wo, struct task, wobj)
@@ -147,16 +153,28 @@ kcond_signal_int(struct kcond *c, struct wait_obj *wo)
 
 void kcond_signal_one(struct kcond *c)
 {
+   struct wait_obj *wo_pos, *temp;
+   bool signalled = false;
+
    disable_preemption();
    {
       DEBUG_ONLY(check_not_in_irq_handler());
 
-      if (!list_is_empty(&c->wait_list)) {
+      /*
+       * Callbacks don't "consume" the signal: all of them have to be called,
+       * while only the first real waiter gets woken up.
+       */
+      list_for_each(wo_pos, temp, &c->wait_list, wait_list_node) {
 
-         struct wait_obj *wobj =
-            list_first_obj(&c->wait_list, struct wait_obj, wait_list_node);
+         if (wo_pos->type == WOBJ_KCOND_CB) {
+            kcond_signal_int(c, wo_pos);
+            continue;
+         }
 
-         kcond_signal_int(c, wobj);
+         if (!signalled) {
+            kcond_signal_int(c, wo_pos);
+            signalled = true;
+         }
       }
    }
    enable_preemption();
@@ -176,6 +194,18 @@ void kcond_signal_all(struct kcond *c)
    enable_preemption();
 }
 
+void kcond_register_cb(struct kcond *c, struct kcond_cb *cb, kcond_cb_func f)
+{
+   cb->func = f;
+   wait_obj_set(&cb->wobj, WOBJ_KCOND_CB, c, NO_EXTRA, &c->wait_list);
+}
+
+void kcond_unregister_cb(struct kcond_cb *cb)
+{
+   wait_obj_reset(&cb->wobj);
+   cb->func = NULL;
+}
+
 void kcond_destory(struct kcond *c)
 {
    bzero(c, sizeof(struct kcond));
@@ -15,6 +15,7 @@
 #include <tilck/kernel/sort.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/perf.h>
 
 #include <tilck_gen_headers/config_kmalloc.h>
 
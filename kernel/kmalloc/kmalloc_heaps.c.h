@@ -446,3 +446,39 @@ debug_kmalloc_get_stats(struct debug_kmalloc_stats *stats)
          KMALLOC_HEAVY_STATS ? alloc_arr_used : 0,
    };
 }
+
+static void
+perf_get_heaps_used(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = 0;
+
+   for (int i = 0; i < used_heaps; i++)
+      vals[0] += heaps[i]->mem_allocated;
+}
+
+static void
+perf_get_heaps_free(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = 0;
+
+   for (int i = 0; i < used_heaps; i++)
+      vals[0] += heaps[i]->size - heaps[i]->mem_allocated;
+}
+
+static void
+perf_get_small_heaps(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = (u64)shs.tot_count;
+}
+
+static void
+perf_get_small_heaps_created(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = (u64)shs.lifetime_created_heaps_count;
+}
+
+DEF_PERF_GAUGE_FUNC(kmalloc, heaps_used, perf_get_heaps_used);
+DEF_PERF_GAUGE_FUNC(kmalloc, heaps_free, perf_get_heaps_free);
+DEF_PERF_GAUGE_FUNC(kmalloc, small_heaps, perf_get_small_heaps);
+DEF_PERF_COUNTER_FUNC(kmalloc, small_heaps_created,
+                      perf_get_small_heaps_created);
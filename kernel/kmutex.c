@@ -6,6 +6,7 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/irq.h>
+#include <tilck/kernel/lock_stats.h>
 
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m)
 {
@@ -18,6 +19,10 @@ void kmutex_init(struct kmutex *m, u32 flags)
    bzero(m, sizeof(struct kmutex));
    m->flags = flags;
    list_init(&m->wait_list);
+
+#if KRN_LOCK_STATS
+   lock_stats_init(&m->ls, lock_type_kmutex, LOCK_STATS_CALLER());
+#endif
 }
 
 void kmutex_destroy(struct kmutex *m)
@@ -25,6 +30,36 @@ void kmutex_destroy(struct kmutex *m)
    bzero(m, sizeof(struct kmutex));
 }
 
+static ALWAYS_INLINE u64
+kmutex_stats_wait_begin(void)
+{
+#if KRN_LOCK_STATS
+   return lock_stats_wait_begin();
+#else
+   return 0;
+#endif
+}
+
+/* NOTE: it must be inlined, in order to get the caller of our caller */
+static ALWAYS_INLINE void
+kmutex_stats_acquired(struct kmutex *m, u64 wait_start)
+{
+#if KRN_LOCK_STATS
+   lock_stats_acquired(&m->ls,
+                       lock_type_kmutex,
+                       LOCK_STATS_CALLER(),
+                       wait_start);
+#endif
+}
+
+static ALWAYS_INLINE void
+kmutex_stats_released(struct kmutex *m)
+{
+#if KRN_LOCK_STATS
+   lock_stats_released(&m->ls);
+#endif
+}
+
 static ALWAYS_INLINE void
 kmutex_lock_enable_preemption_wrapper(struct kmutex *m)
 {
@@ -38,6 +73,8 @@ kmutex_lock_enable_preemption_wrapper(struct kmutex *m)
 
 void kmutex_lock(struct kmutex *m)
 {
+   u64 wait_start;
+
    disable_preemption();
    DEBUG_ONLY(check_not_in_irq_handler());
 
@@ -51,6 +88,7 @@ void kmutex_lock(struct kmutex *m)
          m->lock_count++;
       }
 
+      kmutex_stats_acquired(m, 0);
       kmutex_lock_enable_preemption_wrapper(m);
       enable_preemption();
       return;
@@ -75,6 +113,7 @@ void kmutex_lock(struct kmutex *m)
    m->max_num_waiters = MAX(m->num_waiters, m->max_num_waiters);
 #endif
 
+   wait_start = kmutex_stats_wait_begin();
    prepare_to_wait_on(WOBJ_KMUTEX, m, NO_EXTRA, &m->wait_list);
    kmutex_lock_enable_preemption_wrapper(m);
 
@@ -100,6 +139,8 @@ void kmutex_lock(struct kmutex *m)
    if (m->flags & KMUTEX_FL_RECURSIVE) {
       ASSERT(m->lock_count == 1);
    }
+
+   kmutex_stats_acquired(m, wait_start);
 }
 
 bool kmutex_trylock(struct kmutex *m)
@@ -118,6 +159,8 @@ bool kmutex_trylock(struct kmutex *m)
       if (m->flags & KMUTEX_FL_RECURSIVE)
          m->lock_count++;
 
+      kmutex_stats_acquired(m, 0);
+
    } else {
 
       /*
@@ -157,6 +200,7 @@ void kmutex_unlock(struct kmutex *m)
       // m->lock_count == 0: we have to really unlock the mutex
    }
 
+   kmutex_stats_released(m);
    m->owner_task = NULL;
 
    /* Unlock one task waiting to acquire the mutex 'm' (if any) */
@@ -7,6 +7,7 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/lock_stats.h>
 
 void ksem_init(struct ksem *s, int val, int max)
 {
@@ -14,6 +15,10 @@ void ksem_init(struct ksem *s, int val, int max)
    s->max = max;
    s->counter = val;
    list_init(&s->wait_list);
+
+#if KRN_LOCK_STATS
+   lock_stats_init(&s->ls, lock_type_ksem, LOCK_STATS_CALLER());
+#endif
 }
 
 void ksem_destroy(struct ksem *s)
@@ -67,6 +72,10 @@ int ksem_wait(struct ksem *s, int units, int timeout_ticks)
    int rc = -ETIME;
    ASSERT(units > 0);
 
+#if KRN_LOCK_STATS
+   u64 wait_start = 0;
+#endif
+
    if (s->max != KSEM_NO_MAX) {
       if (units > s->max)
          return -EINVAL;
@@ -74,8 +83,15 @@ int ksem_wait(struct ksem *s, int units, int timeout_ticks)
 
    disable_preemption();
    {
-      if (timeout_ticks != KSEM_NO_WAIT)
+      if (timeout_ticks != KSEM_NO_WAIT) {
+
+#if KRN_LOCK_STATS
+         if (s->counter < units)
+            wait_start = lock_stats_wait_begin();
+#endif
+
          ksem_do_wait(s, units, timeout_ticks);
+      }
 
       if (s->counter >= units) {
          s->counter -= units;
@@ -83,6 +99,15 @@ int ksem_wait(struct ksem *s, int units, int timeout_ticks)
       }
    }
    enable_preemption();
+
+#if KRN_LOCK_STATS
+   if (!rc)
+      lock_stats_acquired(&s->ls,
+                          lock_type_ksem,
+                          LOCK_STATS_CALLER(),
+                          wait_start);
+#endif
+
    return rc;
 }
 
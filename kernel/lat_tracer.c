@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lat_tracer.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/elf_utils.h>
+
+/*
+ * The hooks run in the middle of disable_interrupts(), enable_preemption() etc.
+ * Therefore, they must never call any of those functions. The IRQs-off state
+ * is touched only with interrupts disabled, while the preemption-off state
+ * only while the preemption disable count is 1: in both cases, nothing can
+ * interleave with the hooks on our single CPU. The readers just disable the
+ * interrupts.
+ */
+
+#if KRN_LAT_TRACER
+
+struct lat_tracer_state {
+
+   u64 start;                 /* TSC of the open section or 0 if none */
+   void *start_site;
+   u64 top_min;               /* min max_cycles in stats.top, when full */
+   struct lat_tracer_stats stats;
+};
+
+static struct lat_tracer_state states[lat_kinds_count];
+
+static struct lat_section *
+get_min_section(struct lat_tracer_stats *s)
+{
+   struct lat_section *min = &s->top[0];
+
+   for (u32 i = 1; i < s->top_count; i++) {
+      if (s->top[i].max_cycles < min->max_cycles)
+         min = &s->top[i];
+   }
+
+   return min;
+}
+
+static void
+record_section(struct lat_tracer_state *st, void *end_site, u64 cycles)
+{
+   struct lat_tracer_stats *s = &st->stats;
+   struct lat_section *e = NULL;
+
+   s->sections++;
+   s->tot_cycles += cycles;
+
+   if (s->top_count == LAT_TRACER_TOP && cycles <= st->top_min)
+      return; /* Fast path: not one of the worst sections */
+
+   for (u32 i = 0; i < s->top_count; i++) {
+
+      if (s->top[i].start_site == st->start_site &&
+          s->top[i].end_site == end_site)
+      {
+         e = &s->top[i];
+         break;
+      }
+   }
+
+   if (!e) {
+
+      if (s->top_count < LAT_TRACER_TOP)
+         e = &s->top[s->top_count++];
+      else
+         e = get_min_section(s); /* Replace the least bad section */
+
+      e->start_site = st->start_site;
+      e->end_site = end_site;
+      e->max_cycles = 0;
+   }
+
+   e->max_cycles = MAX(e->max_cycles, cycles);
+
+   if (s->top_count == LAT_TRACER_TOP)
+      st->top_min = get_min_section(s)->max_cycles;
+}
+
+static ALWAYS_INLINE void
+section_begin(struct lat_tracer_state *st, void *site)
+{
+   st->start = RDTSC();
+   st->start_site = site;
+}
+
+static ALWAYS_INLINE void
+section_end(struct lat_tracer_state *st, void *site)
+{
+   const u64 now = RDTSC();
+
+   /*
+    * The section might have not been open by a hook: for example, at boot the
+    * preemption is disabled statically.
+    */
+   if (!st->start)
+      return;
+
+   record_section(st, site, now - st->start);
+   st->start = 0;
+}
+
+#define CALLER_SITE()                                                   \
+   __builtin_extract_return_addr(__builtin_return_address(0))
+
+void irqsoff_trace_begin(void)
+{
+   section_begin(&states[lat_irqsoff], CALLER_SITE());
+}
+
+void irqsoff_trace_end(void)
+{
+   section_end(&states[lat_irqsoff], CALLER_SITE());
+}
+
+void irqsoff_trace_on_task_switch(void)
+{
+   section_end(&states[lat_irqsoff], CALLER_SITE());
+}
+
+void preemptoff_trace_begin(void)
+{
+   section_begin(&states[lat_preemptoff], CALLER_SITE());
+}
+
+void preemptoff_trace_end(void)
+{
+   section_end(&states[lat_preemptoff], CALLER_SITE());
+}
+
+void preemptoff_trace_end_at(void *site)
+{
+   section_end(&states[lat_preemptoff], site);
+}
+
+void lat_tracer_get_stats(enum lat_kind k, struct lat_tracer_stats *out)
+{
+   ulong var;
+   ASSERT(k < lat_kinds_count);
+
+   disable_interrupts(&var);
+   {
+      *out = states[k].stats;
+   }
+   enable_interrupts(&var);
+}
+
+void lat_tracer_reset(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+
+   for (int k = 0; k < lat_kinds_count; k++) {
+      bzero(&states[k].stats, sizeof(states[k].stats));
+      states[k].top_min = 0;
+   }
+
+   enable_interrupts(&var);
+}
+
+#else
+
+void lat_tracer_get_stats(enum lat_kind k, struct lat_tracer_stats *out)
+{
+   bzero(out, sizeof(*out));
+}
+
+void lat_tracer_reset(void)
+{
+   /* Nothing to do */
+}
+
+#endif
+
+void lat_tracer_get_site_name(void *site, char *buf, size_t sz)
+{
+   get_ret_addr_str(site, buf, sz);
+}
@@ -0,0 +1,224 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lock_stats.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/perf.h>
+
+/*
+ * The lock classes live in a static table and are never freed, because the
+ * locks keep a pointer to them. The table and the stats are touched only with
+ * preemption disabled and never by IRQ handlers. When the table is full, new
+ * locks are just not accounted.
+ */
+
+#if KRN_LOCK_STATS
+
+static struct lock_class classes[LOCK_STATS_MAX_CLASSES];
+static u32 classes_count;
+
+static struct lock_class *
+get_class(const char *name, void *site, enum lock_type t)
+{
+   struct lock_class *c;
+   ASSERT(!is_preemption_enabled());
+
+   for (u32 i = 0; i < classes_count; i++) {
+
+      c = &classes[i];
+
+      if (c->type != t)
+         continue;
+
+      if (name ? (c->name && !strcmp(c->name, name)) : (c->site == site))
+         return c;
+   }
+
+   if (classes_count == ARRAY_SIZE(classes))
+      return NULL;
+
+   c = &classes[classes_count++];
+   c->name = name;
+   c->site = name ? NULL : site;
+   c->type = t;
+   return c;
+}
+
+void lock_stats_init(struct lock_stat *ls, enum lock_type t, void *site)
+{
+   disable_preemption();
+   {
+      ls->cls = get_class(NULL, site, t);
+      ls->acquired_at = 0;
+   }
+   enable_preemption();
+}
+
+void lock_stats_set_name(struct lock_stat *ls,
+                         enum lock_type t,
+                         const char *name)
+{
+   struct lock_class *c;
+
+   disable_preemption();
+   {
+      /* If the table is full, just keep the lock's current class, if any */
+      if ((c = get_class(name, NULL, t)))
+         ls->cls = c;
+   }
+   enable_preemption();
+}
+
+u64 lock_stats_wait_begin(void)
+{
+   return RDTSC();
+}
+
+void lock_stats_acquired(struct lock_stat *ls,
+                         enum lock_type t,
+                         void *site,
+                         u64 wait_start)
+{
+   const u64 now = RDTSC();
+   struct lock_class *c;
+   u64 wait;
+
+   disable_preemption();
+
+   if (UNLIKELY(!ls->cls))
+      ls->cls = get_class(NULL, site, t);  /* statically initialized lock */
+
+   if (!(c = ls->cls))
+      goto out;
+
+   c->acquisitions++;
+   ls->acquired_at = now;
+
+   if (wait_start) {
+      wait = now - wait_start;
+      c->contentions++;
+      c->wait_cycles += wait;
+      c->max_wait_cycles = MAX(c->max_wait_cycles, wait);
+   }
+
+out:
+   enable_preemption();
+}
+
+void lock_stats_released(struct lock_stat *ls)
+{
+   const u64 now = RDTSC();
+   struct lock_class *c;
+   u64 hold;
+
+   disable_preemption();
+
+   if ((c = ls->cls) && ls->acquired_at) {
+      hold = now - ls->acquired_at;
+      c->hold_cycles += hold;
+      c->max_hold_cycles = MAX(c->max_hold_cycles, hold);
+   }
+
+   ls->acquired_at = 0;
+   enable_preemption();
+}
+
+u32 lock_stats_get_classes(struct lock_class *buf, u32 max)
+{
+   u32 n;
+
+   disable_preemption();
+   {
+      n = MIN(max, classes_count);
+      memcpy(buf, classes, n * sizeof(struct lock_class));
+   }
+   enable_preemption();
+   return n;
+}
+
+void lock_stats_reset(void)
+{
+   struct lock_class *c;
+
+   disable_preemption();
+
+   for (u32 i = 0; i < classes_count; i++) {
+      c = &classes[i];
+      c->acquisitions = 0;
+      c->contentions = 0;
+      c->wait_cycles = c->max_wait_cycles = 0;
+      c->hold_cycles = c->max_hold_cycles = 0;
+   }
+
+   enable_preemption();
+}
+
+/* Totals of all the classes, for /syst/perf */
+
+static void perf_get_acquisitions(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = 0;
+
+   for (u32 i = 0; i < classes_count; i++)
+      vals[0] += classes[i].acquisitions;
+}
+
+static void perf_get_contentions(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = 0;
+
+   for (u32 i = 0; i < classes_count; i++)
+      vals[0] += classes[i].contentions;
+}
+
+static void perf_get_wait_cycles(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = 0;
+
+   for (u32 i = 0; i < classes_count; i++)
+      vals[0] += classes[i].wait_cycles;
+}
+
+DEF_PERF_COUNTER_FUNC(locks, acquisitions, perf_get_acquisitions);
+DEF_PERF_COUNTER_FUNC(locks, contentions, perf_get_contentions);
+DEF_PERF_COUNTER_FUNC(locks, wait_cycles, perf_get_wait_cycles);
+
+#else
+
+u32 lock_stats_get_classes(struct lock_class *buf, u32 max)
+{
+   return 0;
+}
+
+void lock_stats_reset(void)
+{
+   /* Nothing to do */
+}
+
+#endif
+
+void lock_stats_get_class_name(struct lock_class *c, char *buf, size_t sz)
+{
+   if (c->name)
+      snprintk(buf, sz, "%s", c->name);
+   else
+      get_ret_addr_str(c->site, buf, sz);
+}
+
+const char *lock_stats_get_type_str(enum lock_type t)
+{
+   static const char *const strs[] = {
+      [lock_type_kmutex] = "kmutex",
+      [lock_type_rwlock_wp] = "rwlock_wp",
+      [lock_type_ksem] = "ksem",
+   };
+
+   return (u32)t < ARRAY_SIZE(strs) ? strs[t] : "?";
+}
@@ -31,7 +31,12 @@
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/fs/ramfs.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/shm.h>
+#include <tilck/kernel/profiler.h>
+#include <tilck/kernel/sys_stats.h>
+#include <tilck/kernel/boot_prof.h>
 
 #include <tilck/mods/console.h>
 #include <tilck/mods/fb_console.h>
@@ -246,9 +251,6 @@ out:
 static void
 mount_initrd(void)
 {
-   /* declare the ramfs_create() function */
-   struct mnt_fs *ramfs_create(void);
-
    struct mnt_fs *initrd, *ramfs;
    void *ramdisk;
    size_t ramdisk_size;
@@ -279,7 +281,9 @@ mount_initrd(void)
 
    if (LIKELY(ramdisk != NULL)) {
 
-      if (!(initrd = fat_mount_ramdisk(ramdisk, ramdisk_size, 0)))
+      const u32 fl = kopt_initrd_rw ? VFS_FS_RW : 0;
+
+      if (!(initrd = fat_mount_ramdisk(ramdisk, ramdisk_size, fl)))
          panic("Unable to mount the initrd fat32 RAMDISK");
 
       if ((rc = vfs_mkdir("/initrd", 0777)))
@@ -324,12 +328,13 @@ static void do_async_init()
    /* declare the show_hello_message() function */
    void show_hello_message(void);
 
-   mount_initrd();
-   init_devfs();
-   init_modules();
-   init_extra_debug_features();
+   BOOT_STEP(mount_initrd);
+   BOOT_STEP(init_devfs);
+   BOOT_STEP(init_modules);
+   BOOT_STEP(init_extra_debug_features);
 
    show_hello_message();
+   boot_prof_done();
    run_init_or_selftest();
 }
 
@@ -343,33 +348,38 @@ async_init(void)
 void
 kmain(u32 multiboot_magic, u32 mbi_addr)
 {
-   call_kernel_global_ctors();
+   boot_prof_start();
+   BOOT_STEP(call_kernel_global_ctors);
    save_multiboot_info(multiboot_magic, mbi_addr);
 
-   early_init_serial_ports();
-   init_cpu_exception_handling();
-   early_init_paging();
-   early_init_kmalloc();
+   BOOT_STEP(early_init_serial_ports);
+   BOOT_STEP(init_cpu_exception_handling);
+   BOOT_STEP(early_init_paging);
+   BOOT_STEP(early_init_kmalloc);
 
-   read_multiboot_info();
-   enable_cpu_features();
+   BOOT_STEP(read_multiboot_info);
+   BOOT_STEP(enable_cpu_features);
    kmain_early_checks();
-   init_segmentation();
-   init_fpu_memcpy();
-   init_kmalloc();
-   init_paging();
-
-   acpi_mod_init_tables();
-
-   init_console();
-   init_self_tests();
-   init_irq_handling();
-   init_sched();
-   init_syscall_interfaces();
-   init_worker_threads();
-   init_timer();
-   init_system_time();
-   init_kernelfs();
+   BOOT_STEP(init_segmentation);
+   BOOT_STEP(init_fpu_memcpy);
+   BOOT_STEP(init_kmalloc);
+   BOOT_STEP(init_paging);
+
+   BOOT_STEP(acpi_mod_init_tables);
+
+   BOOT_STEP(init_console);
+   BOOT_STEP(init_self_tests);
+   BOOT_STEP(init_irq_handling);
+   BOOT_STEP(init_sched);
+   BOOT_STEP(init_syscall_interfaces);
+   BOOT_STEP(init_worker_threads);
+   BOOT_STEP(init_timer);
+   BOOT_STEP(init_printk_flusher);
+   BOOT_STEP(init_profiler);
+   BOOT_STEP(init_sys_stats);
+   BOOT_STEP(init_system_time);
+   BOOT_STEP(init_kernelfs);
+   BOOT_STEP(init_shm);
 
    async_init();
    do_schedule();
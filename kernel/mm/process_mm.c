@@ -201,14 +201,19 @@ mmap_on_user_heap(struct process *pi,
    return um;
 }
 
+/*
+ * Map `h` in the address space of the current process or, when `h` is NULL,
+ * create an anonymous mapping. Used by sys_mmap_pgoff() and by the kernel
+ * code that needs to map handles not installed in the process' handle table.
+ */
 long
-sys_mmap_pgoff(void *addr, size_t len, int prot,
-               int flags, int fd, size_t pgoffset)
+do_mmap(void *addr, size_t len, int prot,
+        int flags, fs_handle h, size_t pgoffset)
 {
    u32 per_heap_kmalloc_flags = KMALLOC_FL_MULTI_STEP | PAGE_SIZE;
    struct task *curr = get_curr_task();
    struct process *pi = curr->pi;
-   struct fs_handle_base *handle = NULL;
+   struct fs_handle_base *handle = h;
    struct user_mapping *um = NULL;
    size_t actual_len;
    int rc, fl;
@@ -227,7 +232,7 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
 
    actual_len = pow2_round_up_at(len, PAGE_SIZE);
 
-   if (fd == -1) {
+   if (!handle) {
 
       if (!(flags & MAP_ANONYMOUS))
          return -EINVAL;
@@ -249,11 +254,6 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
       if (!(flags & MAP_SHARED))
          return -EINVAL;
 
-      handle = get_fs_handle(fd);
-
-      if (!handle)
-         return -EBADF;
-
       fl = handle->fl_flags;
 
       if ((prot & (PROT_READ | PROT_WRITE)) == 0)
@@ -319,6 +319,18 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
    return (long)um->vaddr;
 }
 
+long
+sys_mmap_pgoff(void *addr, size_t len, int prot,
+               int flags, int fd, size_t pgoffset)
+{
+   fs_handle h = NULL;
+
+   if (fd != -1 && !(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   return do_mmap(addr, len, prot, flags, h, pgoffset);
+}
+
 static int munmap_int(struct process *pi, void *vaddrp, size_t len)
 {
    u32 kfree_flags = KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP;
@@ -5,6 +5,7 @@
 
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sort.h>
+#include <tilck/kernel/boot_prof.h>
 
 static int mods_count;
 static struct module *modules[32];
@@ -28,7 +29,11 @@ void init_modules(void)
 
    for (int i = 0; i < mods_count; i++) {
       struct module *m = modules[i];
+      int step;
+
       printk("*** Init kernel module: %s\n", m->name);
+      step = boot_prof_begin(m->name);
       m->init();
+      boot_prof_end(step);
    }
 }
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/perf.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/interrupts.h>
+
+/*
+ * The perf objects are never unregistered: the list is touched only with
+ * preemption disabled and only to add objects, in order. The static ones are
+ * registered by constructors, when the preemption is still disabled.
+ */
+
+static struct list perf_objs = STATIC_LIST_INIT(perf_objs);
+
+static const char *perf_type_str[] = {
+   [perf_counter] = "counter",
+   [perf_gauge] = "gauge",
+   [perf_hist] = "hist",
+};
+
+const char *perf_get_type_str(enum perf_type t)
+{
+   ASSERT(t < ARRAY_SIZE(perf_type_str));
+   return perf_type_str[t];
+}
+
+static int perf_obj_cmp(struct perf_obj *a, struct perf_obj *b)
+{
+   int rc = strcmp(a->group, b->group);
+   return rc ? rc : strcmp(a->name, b->name);
+}
+
+int perf_register(struct perf_obj *o)
+{
+   struct perf_obj *pos;
+   int rc = 1;
+
+   ASSERT(o->count > 0 && o->count <= PERF_MAX_VALUES);
+   ASSERT(o->vals || o->get);
+   DEBUG_ONLY(check_not_in_irq_handler());
+
+   disable_preemption();
+
+   list_for_each_ro(pos, &perf_objs, node) {
+
+      rc = perf_obj_cmp(o, pos);
+
+      if (rc <= 0)
+         break;
+   }
+
+   if (!rc) {
+      enable_preemption();
+      return -EEXIST;
+   }
+
+   list_node_init(&o->node);
+
+   /* Insert `o` before the first greater object, or at the end */
+   if (rc < 0)
+      list_add_before(&pos->node, &o->node);
+   else
+      list_add_tail(&perf_objs, &o->node);
+
+   enable_preemption();
+   return 0;
+}
+
+int perf_for_each(int (*cb)(struct perf_obj *, void *), void *arg)
+{
+   struct perf_obj *pos;
+   int rc = 0;
+
+   disable_preemption();
+
+   list_for_each_ro(pos, &perf_objs, node) {
+      if ((rc = cb(pos, arg)))
+         break;
+   }
+
+   enable_preemption();
+   return rc;
+}
+
+void perf_read(struct perf_obj *o, u64 *vals)
+{
+   ulong var;
+   disable_interrupts(&var);
+
+   if (o->get) {
+
+      o->get(o, vals);
+
+   } else {
+
+      for (u32 i = 0; i < o->count; i++)
+         vals[i] = o->vals[i];
+   }
+
+   enable_interrupts(&var);
+}
@@ -2,22 +2,36 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/atomics.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
 
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/pipe.h>
 #include <tilck/kernel/fs/kernelfs.h>
-#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/paging.h>
 #include <tilck/kernel/sync.h>
+#include <tilck/kernel/lock_stats.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/user.h>
 
+/*
+ * The pipe's data lives in a ring of pages, instead of a single contiguous
+ * buffer: large pipes don't need large contiguous heap blocks and, on resize,
+ * the pages holding data can be moved instead of copied.
+ */
 struct pipe {
 
    KOBJ_BASE_FIELDS
 
-   char *buf;
-   struct ringbuf rb;
+   u8 **pages;                 /* ring of `pages_cnt` pages */
+   u32 pages_cnt;
+   u32 read_pos;               /* offset of the first byte of data */
+   u32 used;                   /* bytes of data in the pipe */
+
+   struct pipe_handoff *reader;  /* blocked reader accepting a direct copy */
+
    struct kmutex mutex;
    struct kcond not_full_cond;
    struct kcond not_empty_cond;
@@ -27,39 +41,229 @@ struct pipe {
    ATOMIC(int) write_handles;
 };
 
-static ssize_t pipe_read(fs_handle h, char *buf, size_t size, offt *pos)
+/*
+ * A reader blocked on an empty pipe, waiting for data to be copied directly
+ * into its kernel buffer, skipping the ring. See pipe_fill().
+ */
+struct pipe_handoff {
+
+   u8 *buf;
+   size_t len;
+   size_t done;
+};
+
+ulong pipe_max_size = PIPE_DEF_MAX_SIZE;
+
+static ALWAYS_INLINE u32 pipe_capacity(struct pipe *p)
 {
-   struct kfs_handle *kh = h;
-   struct pipe *p = (void *)kh->kobj;
+   return p->pages_cnt << PAGE_SHIFT;
+}
+
+static ALWAYS_INLINE bool pipe_is_empty(struct pipe *p)
+{
+   return p->used == 0;
+}
+
+static ALWAYS_INLINE bool pipe_is_full(struct pipe *p)
+{
+   return p->used == pipe_capacity(p);
+}
+
+/*
+ * Get the contiguous chunk of at most `max` bytes starting at the ring offset
+ * `pos`. Chunks never cross a page boundary.
+ */
+static size_t pipe_get_chunk(struct pipe *p, u32 pos, u32 max, u8 **ptr)
+{
+   const u32 off = pos & OFFSET_IN_PAGE_MASK;
+
+   *ptr = p->pages[pos >> PAGE_SHIFT] + off;
+   return MIN(max, PAGE_SIZE - off);
+}
+
+static size_t pipe_get_read_chunk(struct pipe *p, u8 **ptr)
+{
+   if (pipe_is_empty(p))
+      return 0;
+
+   return pipe_get_chunk(p, p->read_pos, p->used, ptr);
+}
+
+static size_t pipe_get_write_chunk(struct pipe *p, u8 **ptr)
+{
+   const u32 cap = pipe_capacity(p);
+
+   if (pipe_is_full(p))
+      return 0;
+
+   return pipe_get_chunk(p, (p->read_pos + p->used) % cap, cap - p->used, ptr);
+}
+
+static void pipe_commit_read(struct pipe *p, size_t n)
+{
+   ASSERT(n <= p->used);
+   p->used -= (u32)n;
+
+   /* When the pipe gets empty, restart from the beginning of the ring */
+   p->read_pos = p->used ? (u32)((p->read_pos + n) % pipe_capacity(p)) : 0;
+}
+
+static void pipe_commit_write(struct pipe *p, size_t n)
+{
+   ASSERT(n <= pipe_capacity(p) - p->used);
+   p->used += (u32)n;
+}
+
+static void pipe_free_pages(u8 **pages, u32 cnt)
+{
+   for (u32 i = 0; i < cnt; i++) {
+      if (pages[i])
+         kfree2(pages[i], PAGE_SIZE);
+   }
+
+   kfree2(pages, cnt * sizeof(u8 *));
+}
+
+static u8 **pipe_alloc_pages(u32 cnt, u32 start)
+{
+   u8 **pages;
+
+   if (!(pages = kzmalloc(cnt * sizeof(u8 *))))
+      return NULL;
+
+   for (u32 i = start; i < cnt; i++) {
+      if (!(pages[i] = kmalloc(PAGE_SIZE))) {
+         pipe_free_pages(pages, cnt);
+         return NULL;
+      }
+   }
+
+   return pages;
+}
+
+/*
+ * Transfer callback used by pipe_drain() and pipe_fill(): move up to `len`
+ * bytes between `buf`, a contiguous chunk of the pipe's ring buffer, and the
+ * place described by `ctx`. Returns the number of bytes moved, 0 in case of
+ * EOF or a negative errno value. The pipe's mutex is held during the call.
+ */
+typedef ssize_t (*pipe_xfer_cb)(void *ctx, u8 *buf, size_t len);
+
+static ssize_t
+pipe_xfer_chunks(struct pipe *p,
+                 bool fill,
+                 size_t len,
+                 pipe_xfer_cb cb,
+                 void *ctx)
+{
+   ssize_t tot = 0;
+   ssize_t rc;
+   size_t chunk;
+   u8 *ptr;
+
+   while (len > 0) {
+
+      chunk = fill
+         ? pipe_get_write_chunk(p, &ptr)
+         : pipe_get_read_chunk(p, &ptr);
+
+      if (!chunk)
+         break;
+
+      chunk = MIN(chunk, len);
+
+      if ((rc = cb(ctx, ptr, chunk)) <= 0)
+         return tot > 0 ? tot : rc;
+
+      if (fill)
+         pipe_commit_write(p, (size_t)rc);
+      else
+         pipe_commit_read(p, (size_t)rc);
+
+      tot += rc;
+      len -= (size_t)rc;
+
+      if ((size_t)rc < chunk)
+         break; /* Short transfer: the other side cannot do more, stop */
+   }
+
+   return tot;
+}
+
+static ssize_t pipe_xfer_to_kbuf(void *ctx, u8 *buf, size_t len)
+{
+   u8 **dest = ctx;
+   memcpy(*dest, buf, len);
+   *dest += len;
+   return (ssize_t)len;
+}
+
+static ssize_t pipe_xfer_from_kbuf(void *ctx, u8 *buf, size_t len)
+{
+   u8 **src = ctx;
+   memcpy(buf, *src, len);
+   *src += len;
+   return (ssize_t)len;
+}
+
+/* Read from the pipe, passing the data in place to `cb` */
+static ssize_t
+pipe_drain(struct pipe *p,
+           bool nonblock,
+           size_t len,
+           pipe_xfer_cb cb,
+           void *ctx)
+{
+   struct pipe_handoff ho = { .len = len };
    bool sig_pending = false;
    ssize_t rc = 0;
-   ASSERT(*pos == 0);
 
-   if (!size)
+   if (!len)
       return 0;
 
    kmutex_lock(&p->mutex);
 
    while (true) {
 
-      rc = (ssize_t)ringbuf_read_bytes(&p->rb, (u8 *)buf, size);
-
-      if (rc)
+      if (!pipe_is_empty(p)) {
+         rc = pipe_xfer_chunks(p, false, len, cb, ctx);
          break; /* Everything is alright, we read something */
+      }
 
       if (atomic_load_explicit(&p->write_handles, mo_relaxed) == 0) {
          /* No more writers, always return 0, no matter what. */
          break;
       }
 
-      if (kh->fl_flags & O_NONBLOCK) {
+      if (nonblock) {
          rc = -EAGAIN;
          break;
       }
 
+      /*
+       * Readers with a kernel destination buffer (i.e. read()) offer it to
+       * the writers: a writer finding the pipe empty will copy its data
+       * directly there, skipping the ring. Readers copying to user memory
+       * cannot do that, as writers run in a different address space.
+       */
+      if (cb == &pipe_xfer_to_kbuf && !p->reader) {
+         ho.buf = *(u8 **)ctx;
+         p->reader = &ho;
+      }
+
       /* Wait for writers to fill up the buffer */
       kcond_wait(&p->not_empty_cond, &p->mutex, KCOND_WAIT_FOREVER);
 
+      if (p->reader == &ho)
+         p->reader = NULL;
+
+      if (ho.done) {
+         /* A writer copied its data directly in our buffer */
+         *(u8 **)ctx += ho.done;
+         rc = (ssize_t)ho.done;
+         break;
+      }
+
       /* After wake up */
       if (pending_signals()) {
          sig_pending = true;
@@ -81,7 +285,7 @@ static ssize_t pipe_read(fs_handle h, char *buf, size_t size, offt *pos)
     */
    kcond_signal_one(&p->not_full_cond);
 
-   if (!ringbuf_is_empty(&p->rb)) {
+   if (!pipe_is_empty(p)) {
       /* The buffer is not empty: wake up one more reader, if any */
       kcond_signal_one(&p->not_empty_cond);
    }
@@ -91,15 +295,43 @@ static ssize_t pipe_read(fs_handle h, char *buf, size_t size, offt *pos)
    return !sig_pending ? rc : -EINTR;
 }
 
-static ssize_t pipe_write(fs_handle h, char *buf, size_t size, offt *pos)
+/*
+ * Copy the data directly into the buffer of the reader blocked in pipe_drain().
+ * The rest of the data, if any, goes into the ring as usual.
+ */
+static ssize_t
+pipe_handoff(struct pipe *p, size_t len, pipe_xfer_cb cb, void *ctx)
+{
+   struct pipe_handoff *ho = p->reader;
+   const size_t n = MIN(len, ho->len);
+   ssize_t rc, rc2;
+
+   ASSERT(pipe_is_empty(p));
+
+   if ((rc = cb(ctx, ho->buf, n)) <= 0)
+      return rc;
+
+   ho->done = (size_t)rc;
+   p->reader = NULL;
+
+   if ((size_t)rc == n && len > n) {
+      if ((rc2 = pipe_xfer_chunks(p, true, len - n, cb, ctx)) > 0)
+         rc += rc2;
+   }
+
+   /* Make sure the reader we handed the data to is woken up */
+   kcond_signal_all(&p->not_empty_cond);
+   return rc;
+}
+
+/* Write into the pipe, letting `cb` produce the data in place */
+static ssize_t
+pipe_fill(struct pipe *p, bool nonblock, size_t len, pipe_xfer_cb cb, void *ctx)
 {
-   struct kfs_handle *kh = h;
-   struct pipe *p = (void *)kh->kobj;
    bool sig_pending = false;
    ssize_t rc = 0;
-   ASSERT(*pos == 0);
 
-   if (!size)
+   if (!len)
       return 0;
 
    kmutex_lock(&p->mutex);
@@ -114,12 +346,17 @@ static ssize_t pipe_write(fs_handle h, char *buf, size_t size, offt *pos)
          break;
       }
 
-      rc = (ssize_t)ringbuf_write_bytes(&p->rb, (u8 *)buf, size);
+      if (p->reader && pipe_is_empty(p)) {
+         rc = pipe_handoff(p, len, cb, ctx);
+         break; /* Single-copy transfer to a blocked reader */
+      }
 
-      if (rc)
+      if (!pipe_is_full(p)) {
+         rc = pipe_xfer_chunks(p, true, len, cb, ctx);
          break; /* Everything is alright, we wrote something */
+      }
 
-      if (kh->fl_flags & O_NONBLOCK) {
+      if (nonblock) {
          rc = -EAGAIN;
          break;
       }
@@ -136,11 +373,11 @@ static ssize_t pipe_write(fs_handle h, char *buf, size_t size, offt *pos)
 
    /*
     * Wake up one blocked reader, instead of all of them.
-    * See the comments in pipe_read() above.
+    * See the comments in pipe_drain() above.
     */
    kcond_signal_one(&p->not_empty_cond);
 
-   if (!ringbuf_is_full(&p->rb)) {
+   if (!pipe_is_full(p)) {
       /* The buffer is not full: wake up one more writer, if any */
       kcond_signal_one(&p->not_full_cond);
    }
@@ -150,6 +387,324 @@ static ssize_t pipe_write(fs_handle h, char *buf, size_t size, offt *pos)
    return !sig_pending ? rc : -EINTR;
 }
 
+struct pipe_iov_cursor {
+
+   const struct iovec *iov;
+   int iovcnt;
+   int i;
+   size_t off;
+};
+
+/* Copy between the pipe and user buffers described by an iovec array */
+static ssize_t
+pipe_xfer_iov(struct pipe_iov_cursor *c, u8 *buf, size_t len, bool to_user)
+{
+   size_t tot = 0;
+
+   while (tot < len && c->i < c->iovcnt) {
+
+      char *ubuf = (char *)c->iov[c->i].iov_base + c->off;
+      const size_t n = MIN(len - tot, c->iov[c->i].iov_len - c->off);
+      int rc;
+
+      rc = to_user
+         ? copy_to_user(ubuf, buf + tot, n)
+         : copy_from_user(buf + tot, ubuf, n);
+
+      if (rc)
+         return tot > 0 ? (ssize_t)tot : -EFAULT;
+
+      tot += n;
+      c->off += n;
+
+      if (c->off == c->iov[c->i].iov_len) {
+         c->i++;
+         c->off = 0;
+      }
+   }
+
+   return (ssize_t)tot;
+}
+
+static ssize_t pipe_xfer_to_user(void *ctx, u8 *buf, size_t len)
+{
+   return pipe_xfer_iov(ctx, buf, len, true);
+}
+
+static ssize_t pipe_xfer_from_user(void *ctx, u8 *buf, size_t len)
+{
+   return pipe_xfer_iov(ctx, buf, len, false);
+}
+
+static size_t iov_tot_len(const struct iovec *iov, int iovcnt)
+{
+   size_t tot = 0;
+
+   for (int i = 0; i < iovcnt; i++)
+      tot += iov[i].iov_len;
+
+   return tot;
+}
+
+static ssize_t pipe_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct pipe *p = (void *)kh->kobj;
+   ASSERT(*pos == 0);
+
+   return pipe_drain(p, !!(kh->fl_flags & O_NONBLOCK),
+                     size, &pipe_xfer_to_kbuf, &buf);
+}
+
+static ssize_t pipe_write(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct pipe *p = (void *)kh->kobj;
+   ASSERT(*pos == 0);
+
+   return pipe_fill(p, !!(kh->fl_flags & O_NONBLOCK),
+                    size, &pipe_xfer_from_kbuf, &buf);
+}
+
+/*
+ * Vectored I/O between the pipe's buffer and user memory, with no intermediate
+ * copy. Used by readv(), writev() and vmsplice().
+ */
+ssize_t
+pipe_vmsplice(fs_handle h, const struct iovec *iov, int iovcnt, bool nonblock)
+{
+   struct kfs_handle *kh = h;
+   struct pipe *p = (void *)kh->kobj;
+   struct pipe_iov_cursor c = { .iov = iov, .iovcnt = iovcnt };
+   const size_t len = iov_tot_len(iov, iovcnt);
+
+   nonblock = nonblock || (kh->fl_flags & O_NONBLOCK);
+
+   if (is_pipe_write_end(h))
+      return pipe_fill(p, nonblock, len, &pipe_xfer_from_user, &c);
+
+   ASSERT(is_pipe_read_end(h));
+   return pipe_drain(p, nonblock, len, &pipe_xfer_to_user, &c);
+}
+
+static ssize_t
+pipe_readv(fs_handle h, const struct iovec *iov, int iovcnt, offt *pos)
+{
+   return pipe_vmsplice(h, iov, iovcnt, false);
+}
+
+static ssize_t
+pipe_writev(fs_handle h, const struct iovec *iov, int iovcnt, offt *pos)
+{
+   return pipe_vmsplice(h, iov, iovcnt, false);
+}
+
+struct pipe_file_ctx {
+
+   fs_handle h;
+   offt *pos;
+};
+
+static ssize_t pipe_xfer_from_file(void *ctx, u8 *buf, size_t len)
+{
+   struct pipe_file_ctx *c = ctx;
+   struct fs_handle_base *hb = c->h;
+   return hb->fops->read(c->h, (char *)buf, len, c->pos);
+}
+
+static ssize_t pipe_xfer_to_file(void *ctx, u8 *buf, size_t len)
+{
+   struct pipe_file_ctx *c = ctx;
+   struct fs_handle_base *hb = c->h;
+   return hb->fops->write(c->h, (char *)buf, len, c->pos);
+}
+
+/*
+ * Fill the pipe reading directly from `src` into the pipe's buffer: the data
+ * is copied only once, from the file to the pipe.
+ */
+ssize_t
+pipe_splice_from(fs_handle pipe_wh,
+                 fs_handle src,
+                 offt *pos,
+                 size_t len,
+                 bool nonblock)
+{
+   struct kfs_handle *kh = pipe_wh;
+   struct pipe *p = (void *)kh->kobj;
+   struct pipe_file_ctx c = { .h = src, .pos = pos };
+
+   ASSERT(is_pipe_write_end(pipe_wh));
+   nonblock = nonblock || (kh->fl_flags & O_NONBLOCK);
+   return pipe_fill(p, nonblock, len, &pipe_xfer_from_file, &c);
+}
+
+/*
+ * Drain the pipe writing directly from the pipe's buffer to `dst`.
+ */
+ssize_t
+pipe_splice_to(fs_handle pipe_rh,
+               fs_handle dst,
+               offt *pos,
+               size_t len,
+               bool nonblock)
+{
+   struct kfs_handle *kh = pipe_rh;
+   struct pipe *p = (void *)kh->kobj;
+   struct pipe_file_ctx c = { .h = dst, .pos = pos };
+
+   ASSERT(is_pipe_read_end(pipe_rh));
+   nonblock = nonblock || (kh->fl_flags & O_NONBLOCK);
+   return pipe_drain(p, nonblock, len, &pipe_xfer_to_file, &c);
+}
+
+/*
+ * Copy up to `len` bytes from `in` to `out`, buffer to buffer. If `consume` is
+ * true, the data is also removed from `in`. Both the mutexes must be held.
+ */
+static size_t
+pipe_copy_data(struct pipe *in, struct pipe *out, size_t len, bool consume)
+{
+   const u32 avail = (u32)MIN(len, in->used);
+   u32 pos = in->read_pos;
+   size_t tot = 0;
+   size_t n;
+   u8 *dest, *src;
+
+   while (tot < avail) {
+
+      if (!(n = pipe_get_write_chunk(out, &dest)))
+         break; /* `out` is full */
+
+      n = MIN(n, pipe_get_chunk(in, pos, avail - (u32)tot, &src));
+      memcpy(dest, src, n);
+      pipe_commit_write(out, n);
+      pos = (u32)((pos + n) % pipe_capacity(in));
+      tot += n;
+   }
+
+   if (consume)
+      pipe_commit_read(in, tot);
+
+   return tot;
+}
+
+static ssize_t
+pipe_tee_locked(struct pipe *in, struct pipe *out, size_t len, bool consume)
+{
+   size_t n;
+
+   if (atomic_load_explicit(&out->read_handles, mo_relaxed) == 0) {
+
+      /* Broken pipe */
+      send_signal(get_curr_pid(), SIGPIPE, true);
+      return -EPIPE;
+   }
+
+   if (pipe_is_empty(in)) {
+
+      if (atomic_load_explicit(&in->write_handles, mo_relaxed) == 0)
+         return 0; /* No more writers: EOF */
+
+      return -EAGAIN;
+   }
+
+   if (pipe_is_full(out))
+      return -EAGAIN;
+
+   n = pipe_copy_data(in, out, len, consume);
+
+   kcond_signal_one(&out->not_empty_cond);
+
+   if (!pipe_is_full(out))
+      kcond_signal_one(&out->not_full_cond);
+
+   if (consume)
+      kcond_signal_one(&in->not_full_cond);
+
+   if (!pipe_is_empty(in)) {
+      /* We might have taken the wake-up of a reader: pass it on */
+      kcond_signal_one(&in->not_empty_cond);
+   }
+
+   return (ssize_t)n;
+}
+
+/*
+ * Move or duplicate (`consume` == false) data from the pipe `in_rh` to the
+ * pipe `out_wh`, without any intermediate buffer. Used by tee() and by
+ * splice() between two pipes.
+ */
+ssize_t
+pipe_tee(fs_handle in_rh,
+         fs_handle out_wh,
+         size_t len,
+         bool nonblock,
+         bool consume)
+{
+   struct kfs_handle *in_kh = in_rh;
+   struct kfs_handle *out_kh = out_wh;
+   struct pipe *in = (void *)in_kh->kobj;
+   struct pipe *out = (void *)out_kh->kobj;
+   struct pipe *first = in < out ? in : out;
+   struct pipe *second = in < out ? out : in;
+   ssize_t rc;
+
+   ASSERT(is_pipe_read_end(in_rh));
+   ASSERT(is_pipe_write_end(out_wh));
+
+   if (in == out)
+      return -EINVAL;
+
+   if (!len)
+      return 0;
+
+   nonblock = nonblock || ((in_kh->fl_flags | out_kh->fl_flags) & O_NONBLOCK);
+
+   while (true) {
+
+      /* Always lock the two pipes in the same order, to avoid deadlocks */
+      kmutex_lock(&first->mutex);
+      kmutex_lock(&second->mutex);
+      {
+         rc = pipe_tee_locked(in, out, len, consume);
+      }
+      kmutex_unlock(&second->mutex);
+      kmutex_unlock(&first->mutex);
+
+      if (rc != -EAGAIN || nonblock)
+         break;
+
+      /* Wait for data in `in` or for space in `out`, one pipe at a time */
+      kmutex_lock(&in->mutex);
+
+      if (pipe_is_empty(in) &&
+          atomic_load_explicit(&in->write_handles, mo_relaxed) > 0)
+      {
+         kcond_wait(&in->not_empty_cond, &in->mutex, KCOND_WAIT_FOREVER);
+         kmutex_unlock(&in->mutex);
+
+      } else {
+
+         kmutex_unlock(&in->mutex);
+         kmutex_lock(&out->mutex);
+
+         if (pipe_is_full(out) &&
+             atomic_load_explicit(&out->read_handles, mo_relaxed) > 0)
+         {
+            kcond_wait(&out->not_full_cond, &out->mutex, KCOND_WAIT_FOREVER);
+         }
+
+         kmutex_unlock(&out->mutex);
+      }
+
+      if (pending_signals())
+         return -EINTR;
+   }
+
+   return rc;
+}
+
 static int pipe_read_ready(fs_handle h)
 {
    struct kfs_handle *kh = h;
@@ -158,7 +713,7 @@ static int pipe_read_ready(fs_handle h)
 
    kmutex_lock(&p->mutex);
    {
-      ret = !ringbuf_is_empty(&p->rb) ||
+      ret = !pipe_is_empty(p) ||
             atomic_load_explicit(&p->write_handles, mo_relaxed) == 0;
    }
    kmutex_unlock(&p->mutex);
@@ -180,7 +735,7 @@ static int pipe_write_ready(fs_handle h)
 
    kmutex_lock(&p->mutex);
    {
-      ret = !ringbuf_is_full(&p->rb) ||
+      ret = !pipe_is_full(p) ||
             atomic_load_explicit(&p->read_handles, mo_relaxed) == 0;
    }
    kmutex_unlock(&p->mutex);
@@ -222,6 +777,7 @@ static struct kcond *pipe_get_except_cond(fs_handle h)
 static const struct file_ops static_ops_pipe_read_end =
 {
    .read = pipe_read,
+   .readv = pipe_readv,
    .read_ready = pipe_read_ready,
    .except_ready = pipe_except_ready,
    .get_rready_cond = pipe_get_rready_cond,
@@ -231,20 +787,143 @@ static const struct file_ops static_ops_pipe_read_end =
 static const struct file_ops static_ops_pipe_write_end =
 {
    .write = pipe_write,
+   .writev = pipe_writev,
    .except_ready = pipe_except_ready,
    .write_ready = pipe_write_ready,
    .get_wready_cond = pipe_get_wready_cond,
    .get_except_cond = pipe_get_except_cond,
 };
 
+bool is_pipe_read_end(fs_handle h)
+{
+   struct fs_handle_base *hb = h;
+   return hb->fops == &static_ops_pipe_read_end;
+}
+
+bool is_pipe_write_end(fs_handle h)
+{
+   struct fs_handle_base *hb = h;
+   return hb->fops == &static_ops_pipe_write_end;
+}
+
+/*
+ * Change the number of pages of the ring. When the data, starting from its
+ * first page, fits in the new ring without wrapping around, the pages are just
+ * moved; otherwise the data is copied into a brand new set of pages.
+ */
+static int pipe_resize_locked(struct pipe *p, u32 new_cnt)
+{
+   const u32 old_cnt = p->pages_cnt;
+   const u32 first = p->read_pos >> PAGE_SHIFT;
+   const u32 off = p->read_pos & OFFSET_IN_PAGE_MASK;
+   const u32 new_cap = new_cnt << PAGE_SHIFT;
+   bool move;
+   u8 **pages;
+
+   if (p->used > new_cap)
+      return -EBUSY;
+
+   if (new_cnt == old_cnt)
+      return 0;
+
+   move = off + p->used <= MIN(pipe_capacity(p), new_cap);
+
+   if (!(pages = pipe_alloc_pages(new_cnt, move ? old_cnt : 0)))
+      return -ENOMEM;
+
+   if (move) {
+
+      for (u32 i = 0; i < old_cnt; i++) {
+
+         u8 *pg = p->pages[(first + i) % old_cnt];
+
+         if (i < new_cnt)
+            pages[i] = pg;
+         else
+            kfree2(pg, PAGE_SIZE);
+      }
+
+      kfree2(p->pages, old_cnt * sizeof(u8 *));
+      p->read_pos = off;
+
+   } else {
+
+      size_t n;
+      u8 *src;
+
+      for (u32 done = 0; done < p->used; done += n) {
+
+         const u32 dst_off = done & OFFSET_IN_PAGE_MASK;
+         const u32 pos = (p->read_pos + done) % pipe_capacity(p);
+
+         n = pipe_get_chunk(p, pos, p->used - done, &src);
+         n = MIN(n, PAGE_SIZE - dst_off);
+         memcpy(pages[done >> PAGE_SHIFT] + dst_off, src, n);
+      }
+
+      pipe_free_pages(p->pages, old_cnt);
+      p->read_pos = 0;
+   }
+
+   p->pages = pages;
+   p->pages_cnt = new_cnt;
+   return 0;
+}
+
+/*
+ * F_SETPIPE_SZ: the capacity is rounded up to a power-of-two number of pages.
+ * Returns the new capacity or a negative errno value.
+ */
+int pipe_set_size(fs_handle h, ulong size)
+{
+   struct kfs_handle *kh = h;
+   struct pipe *p = (void *)kh->kobj;
+   const ulong max_size = MAX(pipe_max_size, PAGE_SIZE);
+   int rc;
+
+   if (size > (1ul << 30))
+      return -EINVAL;
+
+   size = roundup_next_power_of_2(MAX(size, PAGE_SIZE));
+
+   if (size > max_size)
+      return -EPERM;
+
+   kmutex_lock(&p->mutex);
+   {
+      if (!(rc = pipe_resize_locked(p, (u32)(size >> PAGE_SHIFT)))) {
+
+         rc = (int)pipe_capacity(p);
+
+         /* The pipe might have grown: wake up the writers waiting for space */
+         kcond_signal_all(&p->not_full_cond);
+      }
+   }
+   kmutex_unlock(&p->mutex);
+   return rc;
+}
+
+int pipe_get_size(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct pipe *p = (void *)kh->kobj;
+   int rc;
+
+   kmutex_lock(&p->mutex);
+   {
+      rc = (int)pipe_capacity(p);
+   }
+   kmutex_unlock(&p->mutex);
+   return rc;
+}
+
 void destroy_pipe(struct pipe *p)
 {
    kcond_destory(&p->err_cond);
    kcond_destory(&p->not_empty_cond);
    kcond_destory(&p->not_full_cond);
    kmutex_destroy(&p->mutex);
-   ringbuf_destory(&p->rb);
-   kfree2(p->buf, PIPE_BUF_SIZE);
+   pipe_free_pages(p->pages, p->pages_cnt);
    kfree_obj(p, struct pipe);
 }
 
@@ -288,16 +967,17 @@ struct pipe *create_pipe(void)
    if (!(p = (void *)kzalloc_obj(struct pipe)))
       return NULL;
 
-   if (!(p->buf = kmalloc(PIPE_BUF_SIZE))) {
+   if (!(p->pages = pipe_alloc_pages(PIPE_BUF_SIZE >> PAGE_SHIFT, 0))) {
       kfree_obj(p, struct pipe);
       return NULL;
    }
 
+   p->pages_cnt = PIPE_BUF_SIZE >> PAGE_SHIFT;
    p->on_handle_close = &pipe_on_handle_close;
    p->on_handle_dup = &pipe_on_handle_dup;
    p->destory_obj = (void *)&destroy_pipe;
-   ringbuf_init(&p->rb, PIPE_BUF_SIZE, 1, p->buf);
    kmutex_init(&p->mutex, 0);
+   LOCK_STATS_NAME(&p->mutex, kmutex, "pipe");
    kcond_init(&p->not_full_cond);
    kcond_init(&p->not_empty_cond);
    kcond_init(&p->err_cond);
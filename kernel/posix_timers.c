@@ -0,0 +1,526 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/posix_timers.h>
+
+/*
+ * POSIX per-process timers (timer_create() & friends) and the ITIMER_REAL
+ * timer of setitimer() and alarm(), which is just a special POSIX timer using
+ * a negative ID. All of them are kernel timers, so no task has to sleep while
+ * they're armed. The `timers_list` of a process is protected by disabling the
+ * preemption, as none of the operations here, except deleting a timer, needs
+ * to sleep.
+ */
+
+#define MAX_POSIX_TIMERS                  32   /* per process */
+#define ITIMER_REAL_ID                    -1
+#define POSIX_TIMER_MAX_OVERRUN    0x7fffffff   /* DELAYTIMER_MAX on Linux */
+
+struct posix_timer {
+
+   struct list_node node;                 /* node in pi->timers_list */
+   struct ktimer timer;
+   int id;
+   int clk;
+   int pid;
+   int tid;                               /* 0 for process signals */
+   int signo;
+   int overrun;                           /* for the last signal sent */
+};
+
+static bool is_timer_clock_supported(int clk)
+{
+   return clk == CLOCK_REALTIME ||
+          clk == CLOCK_MONOTONIC ||
+          clk == CLOCK_BOOTTIME;
+}
+
+/* Called by the ktimers worker thread */
+static void posix_timer_on_expire(struct ktimer *timer, u64 expirations)
+{
+   struct posix_timer *pt = CONTAINER_OF(timer, struct posix_timer, timer);
+
+   pt->overrun = (int)MIN(expirations - 1, (u64)POSIX_TIMER_MAX_OVERRUN);
+
+   if (pt->tid)
+      send_signal2(pt->pid, pt->tid, pt->signo, 0);
+   else
+      send_signal2(pt->pid, pt->pid, pt->signo, SIG_FL_PROCESS);
+}
+
+static struct posix_timer *get_posix_timer(struct process *pi, int id)
+{
+   struct posix_timer *pos;
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(pos, &pi->timers_list, node) {
+      if (pos->id == id)
+         return pos;
+   }
+
+   return NULL;
+}
+
+static int get_free_timer_id(struct process *pi)
+{
+   for (int id = 0; id < MAX_POSIX_TIMERS; id++) {
+      if (!get_posix_timer(pi, id))
+         return id;
+   }
+
+   return -1;
+}
+
+static struct posix_timer *
+alloc_posix_timer(int clk, int signo, int tid, bool notify)
+{
+   struct posix_timer *pt;
+
+   if (!(pt = kzalloc_obj(struct posix_timer)))
+      return NULL;
+
+   list_node_init(&pt->node);
+   ktimer_init(&pt->timer, notify ? &posix_timer_on_expire : NULL);
+   pt->clk = clk;
+   pt->pid = get_curr_proc()->pid;
+   pt->tid = tid;
+   pt->signo = signo;
+   return pt;
+}
+
+static void free_posix_timer(struct posix_timer *pt)
+{
+   ktimer_destroy(&pt->timer);
+   kfree_obj(pt, struct posix_timer);
+}
+
+static int check_sigevent(struct process *pi, struct k_sigevent *sev)
+{
+   struct task *ti;
+   int rc = 0;
+
+   switch (sev->sigev_notify) {
+
+      case SIGEV_NONE:
+         return 0;
+
+      case SIGEV_SIGNAL:
+      case SIGEV_THREAD_ID:
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   if (!IN_RANGE(sev->sigev_signo, 1, _NSIG))
+      return -EINVAL;
+
+   if (sev->sigev_notify == SIGEV_THREAD_ID) {
+
+      disable_preemption();
+      {
+         ti = get_task(sev->sigev_notify_thread_id);
+
+         if (!ti || ti->pi != pi)
+            rc = -EINVAL;
+      }
+      enable_preemption();
+   }
+
+   return rc;
+}
+
+int sys_timer_create(clockid_t clk, struct k_sigevent *u_sev, int *u_id)
+{
+   struct process *pi = get_curr_proc();
+   struct posix_timer *pt;
+   struct k_sigevent sev;
+   int rc, id;
+
+   if (!is_timer_clock_supported(clk))
+      return -EINVAL;
+
+   if (u_sev) {
+
+      if (copy_from_user(&sev, u_sev, sizeof(sev)))
+         return -EFAULT;
+
+   } else {
+
+      sev = (struct k_sigevent) {
+         .sigev_signo = SIGALRM,
+         .sigev_notify = SIGEV_SIGNAL,
+      };
+   }
+
+   if ((rc = check_sigevent(pi, &sev)))
+      return rc;
+
+   pt = alloc_posix_timer(clk,
+                          sev.sigev_signo,
+                          sev.sigev_notify == SIGEV_THREAD_ID
+                             ? sev.sigev_notify_thread_id
+                             : 0,
+                          sev.sigev_notify != SIGEV_NONE);
+
+   if (!pt)
+      return -ENOMEM;
+
+   disable_preemption();
+   {
+      if ((id = get_free_timer_id(pi)) >= 0) {
+         pt->id = id;
+         list_add_tail(&pi->timers_list, &pt->node);
+      }
+   }
+   enable_preemption();
+
+   if (id < 0) {
+      free_posix_timer(pt);
+      return -EAGAIN;
+   }
+
+   if (copy_to_user(u_id, &id, sizeof(id))) {
+      sys_timer_delete(id);
+      return -EFAULT;
+   }
+
+   return 0;
+}
+
+static int
+do_timer_settime(int id,
+                 int flags,
+                 const struct k_itimerspec64 *val,
+                 struct k_itimerspec64 *old)
+{
+   struct process *pi = get_curr_proc();
+   struct posix_timer *pt;
+   int rc;
+
+   if (id < 0)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((pt = get_posix_timer(pi, id)))
+         rc = ktimer_settime(&pt->timer,
+                             pt->clk,
+                             !!(flags & TIMER_ABSTIME),
+                             val,
+                             old);
+      else
+         rc = -EINVAL;
+   }
+   enable_preemption();
+   return rc;
+}
+
+static int do_timer_gettime(int id, struct k_itimerspec64 *val)
+{
+   struct process *pi = get_curr_proc();
+   struct posix_timer *pt;
+   int rc = 0;
+
+   if (id < 0)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((pt = get_posix_timer(pi, id)))
+         ktimer_gettime(&pt->timer, val);
+      else
+         rc = -EINVAL;
+   }
+   enable_preemption();
+   return rc;
+}
+
+int sys_timer_settime(int id,
+                      int flags,
+                      const struct k_itimerspec64 *u_val,
+                      struct k_itimerspec64 *u_old)
+{
+   struct k_itimerspec64 val, old;
+   int rc;
+
+   if (copy_from_user(&val, u_val, sizeof(val)))
+      return -EFAULT;
+
+   if ((rc = do_timer_settime(id, flags, &val, &old)))
+      return rc;
+
+   if (u_old && copy_to_user(u_old, &old, sizeof(old)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_gettime(int id, struct k_itimerspec64 *u_val)
+{
+   struct k_itimerspec64 val;
+   int rc;
+
+   if ((rc = do_timer_gettime(id, &val)))
+      return rc;
+
+   if (copy_to_user(u_val, &val, sizeof(val)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_settime32(int id,
+                        int flags,
+                        const struct k_itimerspec32 *u_val,
+                        struct k_itimerspec32 *u_old)
+{
+   struct k_itimerspec64 val, old;
+   struct k_itimerspec32 val32;
+   int rc;
+
+   if (copy_from_user(&val32, u_val, sizeof(val32)))
+      return -EFAULT;
+
+   itimerspec32_to_64(&val32, &val);
+
+   if ((rc = do_timer_settime(id, flags, &val, &old)))
+      return rc;
+
+   if (u_old) {
+
+      itimerspec64_to_32(&old, &val32);
+
+      if (copy_to_user(u_old, &val32, sizeof(val32)))
+         return -EFAULT;
+   }
+
+   return 0;
+}
+
+int sys_timer_gettime32(int id, struct k_itimerspec32 *u_val)
+{
+   struct k_itimerspec64 val;
+   struct k_itimerspec32 val32;
+   int rc;
+
+   if ((rc = do_timer_gettime(id, &val)))
+      return rc;
+
+   itimerspec64_to_32(&val, &val32);
+
+   if (copy_to_user(u_val, &val32, sizeof(val32)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_getoverrun(int id)
+{
+   struct process *pi = get_curr_proc();
+   struct posix_timer *pt;
+   int rc;
+
+   if (id < 0)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      pt = get_posix_timer(pi, id);
+      rc = pt ? pt->overrun : -EINVAL;
+   }
+   enable_preemption();
+   return rc;
+}
+
+int sys_timer_delete(int id)
+{
+   struct process *pi = get_curr_proc();
+   struct posix_timer *pt;
+
+   if (id < 0)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((pt = get_posix_timer(pi, id)))
+         list_remove(&pt->node);
+   }
+   enable_preemption();
+
+   if (!pt)
+      return -EINVAL;
+
+   free_posix_timer(pt);
+   return 0;
+}
+
+static void
+timeval_to_timespec(const struct k_timeval *tv, struct k_timespec64 *ts)
+{
+   ts->tv_sec = tv->tv_sec;
+   ts->tv_nsec = tv->tv_usec * 1000;
+}
+
+static void
+timespec_to_timeval(const struct k_timespec64 *ts, struct k_timeval *tv)
+{
+   tv->tv_sec = (long)ts->tv_sec;
+   tv->tv_usec = ts->tv_nsec / 1000;
+}
+
+static void itimer_get(struct process *pi, struct k_itimerval *val)
+{
+   struct k_itimerspec64 ts = {0};
+   struct posix_timer *pt;
+
+   disable_preemption();
+   {
+      if ((pt = get_posix_timer(pi, ITIMER_REAL_ID)))
+         ktimer_gettime(&pt->timer, &ts);
+   }
+   enable_preemption();
+
+   timespec_to_timeval(&ts.it_interval, &val->it_interval);
+   timespec_to_timeval(&ts.it_value, &val->it_value);
+}
+
+static int
+itimer_set(struct process *pi,
+           const struct k_itimerval *val,
+           struct k_itimerval *old)
+{
+   struct posix_timer *pt, *new_pt = NULL;
+   struct k_itimerspec64 ts, old_ts = {0};
+   int rc;
+
+   if (!IN_RANGE(val->it_value.tv_usec, 0, MILLION) ||
+       !IN_RANGE(val->it_interval.tv_usec, 0, MILLION))
+   {
+      return -EINVAL;
+   }
+
+   timeval_to_timespec(&val->it_interval, &ts.it_interval);
+   timeval_to_timespec(&val->it_value, &ts.it_value);
+
+   /* The ITIMER_REAL timer is allocated on its first use */
+   new_pt = alloc_posix_timer(CLOCK_MONOTONIC, SIGALRM, 0, true);
+
+   if (!new_pt)
+      return -ENOMEM;
+
+   disable_preemption();
+   {
+      if (!(pt = get_posix_timer(pi, ITIMER_REAL_ID))) {
+         pt = new_pt;
+         pt->id = ITIMER_REAL_ID;
+         list_add_tail(&pi->timers_list, &pt->node);
+         new_pt = NULL;
+      }
+
+      rc = ktimer_settime(&pt->timer, pt->clk, false, &ts, &old_ts);
+   }
+   enable_preemption();
+
+   if (new_pt)
+      free_posix_timer(new_pt);
+
+   if (old) {
+      timespec_to_timeval(&old_ts.it_interval, &old->it_interval);
+      timespec_to_timeval(&old_ts.it_value, &old->it_value);
+   }
+
+   return rc;
+}
+
+int sys_setitimer(int which,
+                  const struct k_itimerval *u_val,
+                  struct k_itimerval *u_old)
+{
+   struct k_itimerval val = {0}, old;
+   int rc;
+
+   if (which != ITIMER_REAL)
+      return -EINVAL; /* ITIMER_VIRTUAL and ITIMER_PROF are not supported */
+
+   /* Like Linux, treat a NULL `u_val` as a zero value: disarm the timer */
+   if (u_val && copy_from_user(&val, u_val, sizeof(val)))
+      return -EFAULT;
+
+   if ((rc = itimer_set(get_curr_proc(), &val, &old)))
+      return rc;
+
+   if (u_old && copy_to_user(u_old, &old, sizeof(old)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_getitimer(int which, struct k_itimerval *u_val)
+{
+   struct k_itimerval val;
+
+   if (which != ITIMER_REAL)
+      return -EINVAL;
+
+   itimer_get(get_curr_proc(), &val);
+
+   if (copy_to_user(u_val, &val, sizeof(val)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_alarm(u32 seconds)
+{
+   struct k_itimerval old, val = {
+      .it_value = { .tv_sec = (long)seconds },
+   };
+
+   if (itimer_set(get_curr_proc(), &val, &old))
+      return 0;
+
+   /* Like Linux, round to the nearest second, but never return 0 if armed */
+   if (old.it_value.tv_usec >= MILLION / 2 ||
+       (!old.it_value.tv_sec && old.it_value.tv_usec))
+   {
+      old.it_value.tv_sec++;
+   }
+
+   return (int)old.it_value.tv_sec;
+}
+
+void posix_timers_delete_all(struct process *pi, bool keep_itimer)
+{
+   struct posix_timer *pt, *temp;
+   struct list to_free;
+   ASSERT(is_preemption_enabled());
+
+   list_init(&to_free);
+
+   disable_preemption();
+   {
+      list_for_each(pt, temp, &pi->timers_list, node) {
+
+         if (keep_itimer && pt->id == ITIMER_REAL_ID)
+            continue;
+
+         list_remove(&pt->node);
+         list_add_tail(&to_free, &pt->node);
+      }
+   }
+   enable_preemption();
+
+   list_for_each(pt, temp, &to_free, node)
+      free_posix_timer(pt);
+}
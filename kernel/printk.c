@@ -14,6 +14,8 @@
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/datetime.h>
 
+#include <tilck/kernel/worker_thread.h>
+
 #define PRINTK_BUF_SZ                         224
 #define PRINTK_PREFIXBUF_SZ                   32
 
@@ -23,49 +25,51 @@
    #define PRINTK_SAFE_STACK_SPACE         2048   /* TODO: check this */
 #endif
 
-
+#if TINY_KERNEL
+   #define PRINTK_RECS                        32
+#else
+   #define PRINTK_RECS                       256
+#endif
 
 #define PRINTK_COLOR                          COLOR_GREEN
-#define PRINTK_RINGBUF_FLUSH_COLOR            COLOR_CYAN
-#define PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR    COLOR_MAGENTA
+#define PRINTK_DROPPED_COLOR                  COLOR_MAGENTA
 #define PRINTK_PANIC_COLOR                    COLOR_RED
 
-struct ringbuf_stat {
-
-   union {
+#define PRINTK_REC_PREFIX                     (1 << 0)
+#define PRINTK_REC_LOWSS                      (1 << 1)
 
-      struct {
-         u32 read_pos              : 14;
-         u32 write_pos             : 14;
-         u32 full                  :  1;
-         u32 first_printk          :  1;
-         u32 newline               :  1;
-         u32 unused0               :  1;
-      };
-
-      ATOMIC(u32) raw;
-      u32 __raw;
-   };
+/*
+ * A printk() record. The records live in a ring of fixed-size slots, in which
+ * any context (tasks and IRQ handlers) appends without locks, by reserving the
+ * slot with a CAS on `printk_head`. The slot is published by writing its
+ * sequence number + 1 in `commit`, after everything else. The only consumer,
+ * normally the "printk" worker thread, writes the records to the terminal in
+ * order and frees them by moving `printk_tail` forward.
+ */
+struct printk_rec {
+
+   ATOMIC(u32) commit;        /* seq + 1, once the record is ready */
+   u16 len;
+   u8 flags;
+   u8 unused0;
+   u64 ts;                    /* system time, see get_sys_time() */
+   struct tty *tty;           /* target tty, when !KRN_PRINTK_ON_CURR_TTY */
+   char buf[PRINTK_BUF_SZ];
 };
 
-#if TINY_KERNEL
-   static char printk_rbuf[2 * KB];
-#else
-   static char printk_rbuf[8 * KB];
-#endif
-
-static volatile struct ringbuf_stat printk_rbuf_stat =
-{
-   .newline = 1
-};
+static struct printk_rec printk_recs[PRINTK_RECS];
+static ATOMIC(u32) printk_head;     /* seq of the next record to reserve */
+static ATOMIC(u32) printk_tail;     /* seq of the next record to flush */
+static ATOMIC(u32) printk_dropped;  /* records dropped because of a full ring */
+static ATOMIC(bool) printk_newline = true;
+static ATOMIC(bool) printk_flushing;
+static bool printk_flush_pending;
+static u32 printk_dropped_reported;
+static struct worker_thread *printk_wth;
 
 bool __in_printk;
 
-/*
- * NOTE: the ring buf cannot be larger than 16K elems because of the size of the
- * read_pos and write_pos bit-fields.
- */
-STATIC_ASSERT(sizeof(printk_rbuf) <= 16 * KB);
+STATIC_ASSERT((PRINTK_RECS & (PRINTK_RECS - 1)) == 0);
 
 static void
 printk_direct_flush_no_tty(const char *buf, size_t size, u8 color)
@@ -85,12 +89,20 @@ printk_direct_flush_no_tty(const char *buf, size_t size, u8 color)
 }
 
 static void
-printk_direct_flush(const char *buf, size_t size, u8 color)
+printk_direct_flush(const char *buf,
+                    size_t size,
+                    u8 color,
+                    struct tty *tty,
+                    bool sync)
 {
    if (!size)
       return;
 
-   __in_printk = true;
+   /*
+    * The flusher thread can wait for the terminal like any other task: mark
+    * only the synchronous flushes, which might happen in any context.
+    */
+   __in_printk = sync;
    {
       if (LIKELY(get_curr_tty() != NULL)) {
 
@@ -98,10 +110,10 @@ printk_direct_flush(const char *buf, size_t size, u8 color)
 
          if (UNLIKELY(in_kernel_shutdown()))
             tty_write_on_all_ttys(buf, size);
-         else if (KRN_PRINTK_ON_CURR_TTY || !get_curr_process_tty())
+         else if (!tty)
             term_write(buf, size, color);
          else
-            tty_curr_proc_write(buf, size);
+            tty_write_on(tty, buf, size);
 
       } else {
 
@@ -109,153 +121,204 @@ printk_direct_flush(const char *buf, size_t size, u8 color)
       }
    }
    __in_printk = false;
-   return;
 }
 
-static ALWAYS_INLINE u32
-printk_calc_used(const struct ringbuf_stat *cs)
+static void
+printk_flush_rec(struct printk_rec *r, bool sync)
 {
-   u32 used = (cs->write_pos - cs->read_pos) % sizeof(printk_rbuf);
+   char prefixbuf[PRINTK_PREFIXBUF_SZ];
+   int prefix_sz = 0;
 
-   if (!used)
-      used = cs->full ? sizeof(printk_rbuf) : 0;
+   if (r->flags & PRINTK_REC_PREFIX) {
+      prefix_sz = snprintk(
+         prefixbuf, sizeof(prefixbuf), "[%5u.%03u] %s",
+         (u32)(r->ts / TS_SCALE),
+         (u32)((r->ts % TS_SCALE) / (TS_SCALE / 1000)),
+         (r->flags & PRINTK_REC_LOWSS) ? "[LOWSS] " : ""
+      );
+   }
 
-   return used;
+   printk_direct_flush(prefixbuf, (size_t)prefix_sz,
+                       PRINTK_COLOR, r->tty, sync);
+   printk_direct_flush(r->buf, r->len, PRINTK_COLOR, r->tty, sync);
 }
 
 static void
-__printk_flush_ringbuf(char *tmpbuf, u32 buf_size)
+printk_flush_dropped_msg(bool sync)
 {
-   struct ringbuf_stat cs, ns;
-   u32 used, to_read = 0;
+   const u32 dropped = atomic_load_explicit(&printk_dropped, mo_relaxed);
+   char buf[48];
+   int rc;
 
-   while (true) {
+   if (dropped == printk_dropped_reported)
+      return;
 
-      do {
-         cs = printk_rbuf_stat;
-         ns = printk_rbuf_stat;
-         used = printk_calc_used(&cs);
+   rc = snprintk(buf, sizeof(buf), "{_DROPPED_ %u_}\n",
+                 dropped - printk_dropped_reported);
 
-         /* We can read at most 'buf_size' bytes at a time */
-         to_read = UNSAFE_MIN(buf_size, used);
+   printk_direct_flush(buf, (size_t)rc, PRINTK_DROPPED_COLOR, NULL, sync);
+   printk_dropped_reported = dropped;
+}
 
-         /* And copy them to our minibuf */
-         for (u32 i = 0; i < to_read; i++)
-            tmpbuf[i] = printk_rbuf[(cs.read_pos + i) % sizeof(printk_rbuf)];
+static ALWAYS_INLINE struct printk_rec *
+printk_get_ready_rec(u32 seq)
+{
+   struct printk_rec *r = &printk_recs[seq % PRINTK_RECS];
 
-         /* Increase read_pos and decrease used */
-         ns.read_pos = (ns.read_pos + to_read) % sizeof(printk_rbuf);
+   if (atomic_load_explicit(&r->commit, mo_acquire) != seq + 1)
+      return NULL;   /* Not reserved yet or still being written */
 
-         if (!to_read)
-            ns.first_printk = 0;
+   return r;
+}
 
-         /* Repeat that until we were able to do that atomically */
+/* Returns false if somebody else is flushing the ring */
+static bool
+__printk_flush_ringbuf(bool sync)
+{
+   struct printk_rec *r;
+   bool exp;
+   u32 tail;
 
-      } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                                &cs.__raw,
-                                ns.__raw,
-                                mo_relaxed,
-                                mo_relaxed));
+   do {
 
-      /* Note: we checked that `first_printk` in `cs` was unset! */
-      if (!to_read)
-         break;
+      exp = false;
 
-      printk_direct_flush(tmpbuf, to_read, PRINTK_RINGBUF_FLUSH_COLOR);
-   }
+      if (!atomic_compare_exchange_strong_explicit(&printk_flushing,
+                                                   &exp, true,
+                                                   mo_acquire,
+                                                   mo_relaxed))
+      {
+         /* Somebody else is flushing: it will flush our records too. */
+         return false;
+      }
+
+      printk_flush_dropped_msg(sync);
+      tail = atomic_load_explicit(&printk_tail, mo_relaxed);
+
+      while ((r = printk_get_ready_rec(tail))) {
+
+         /*
+          * Write the record directly from its slot: no producer can reuse it
+          * until we move the tail forward.
+          */
+         printk_flush_rec(r, sync);
+         atomic_store_explicit(&printk_tail, ++tail, mo_release);
+      }
+
+      atomic_store_explicit(&printk_flushing, false, mo_release);
+
+      /*
+       * A record might have been committed after our last check, but before
+       * we released `printk_flushing`: in that case its producer did not flush
+       * it, so we have to re-check.
+       */
+
+   } while (printk_get_ready_rec(tail));
+
+   return true;
 }
 
 void
 printk_flush_ringbuf(void)
 {
-   char minibuf[80];
-   __printk_flush_ringbuf(minibuf, sizeof(minibuf));
+   disable_preemption();
+
+   while (!__printk_flush_ringbuf(true)) {
+
+      /*
+       * The flusher thread has the lowest priority: it might have been
+       * preempted in the middle of a flush. Our caller expects the ring to be
+       * drained when we return, so yield until the flusher is done, if we can.
+       */
+      if (get_preempt_disable_count() > 1 || !are_interrupts_enabled())
+         break;
+
+      if (in_irq() || in_panic())
+         break;
+
+      kernel_yield_preempt_disabled();
+      disable_preemption();
+   }
+
+   enable_preemption();
 }
 
-static void printk_append_to_ringbuf(const char *buf, size_t size)
+static void
+printk_flush_job(void *unused)
 {
-   static const char err_msg[] = "{_DROPPED_}\n";
-   struct ringbuf_stat cs, ns;
-   u32 used;
+   printk_flush_pending = false;
+   __printk_flush_ringbuf(false);
+}
 
-   if (!size)
+static void
+printk_wakeup_flusher(void)
+{
+   ulong var;
+
+   /*
+    * Records appended by the flusher itself (e.g. printk() calls in the tty
+    * layer) will be seen by its flush loop.
+    */
+   if (get_curr_task() == wth_get_task(printk_wth) && !in_irq())
       return;
 
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      used = printk_calc_used(&cs);
+   disable_interrupts(&var);
+   {
+      if (!printk_flush_pending)
+         printk_flush_pending = wth_enqueue_on(printk_wth,
+                                               &printk_flush_job,
+                                               NULL);
+   }
+   enable_interrupts(&var);
+}
 
-      if (used + size >= sizeof(printk_rbuf)) {
+static void
+printk_append_rec(const char *buf, size_t size, u8 flags)
+{
+   struct printk_rec *r;
+   u32 head, tail;
 
-         /* Corner case: the ring buffer is full */
+   do {
 
-         if (term_is_initialized()) {
-            printk_direct_flush(buf, size, PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR);
-            return;
-         }
+      head = atomic_load_explicit(&printk_head, mo_relaxed);
+      tail = atomic_load_explicit(&printk_tail, mo_acquire);
 
-         if (buf != err_msg && used < sizeof(printk_rbuf) - 1) {
-            size = MIN(sizeof(printk_rbuf) - used - 1, sizeof(err_msg));
-            printk_append_to_ringbuf(err_msg, size);
-         }
+      if (head - tail >= PRINTK_RECS) {
 
+         /* Corner case: the ring is full */
+         atomic_fetch_add_explicit(&printk_dropped, 1, mo_relaxed);
          return;
       }
 
-      ns.write_pos = (ns.write_pos + size) % sizeof(printk_rbuf);
+   } while (!atomic_compare_exchange_weak_explicit(&printk_head,
+                                                   &head, head + 1,
+                                                   mo_relaxed,
+                                                   mo_relaxed));
 
-      if (ns.write_pos == ns.read_pos)
-         ns.full = 1;
+   /* Now the slot `head` is ours */
+   r = &printk_recs[head % PRINTK_RECS];
+   r->len = (u16)size;
+   r->flags = flags;
+   r->ts = get_sys_time();
+   r->tty = KRN_PRINTK_ON_CURR_TTY ? NULL : get_curr_process_tty();
+   memcpy(r->buf, buf, size);
 
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
-
-   // Now we have some allocated space in the ringbuf
-
-   for (u32 i = 0; i < size; i++)
-      printk_rbuf[(cs.write_pos + i) % sizeof(printk_rbuf)] = buf[i];
+   atomic_store_explicit(&r->commit, head + 1, mo_release);
 }
 
-/*
- * Sets atomically first_printk=1 and returns the old ringbuf_stat.
- */
-static struct ringbuf_stat
-try_set_first_printk_on_stack(bool newline)
-{
-   struct ringbuf_stat cs, ns;
-
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      ns.first_printk = 1;
-      ns.newline = newline;
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
-
-   return cs;
-}
-
-static void
-restore_first_printk_value(void)
+void
+init_printk_flusher(void)
 {
-   struct ringbuf_stat cs, ns;
+   disable_preemption();
+   {
+      printk_wth = wth_create_thread("printk",
+                                     WTH_PRIO_LOWEST,
+                                     WTH_PRINTK_QUEUE_SIZE);
+   }
+   enable_preemption();
 
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      ns.first_printk = 0;
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
+   if (!printk_wth)
+      panic("printk: unable to create the flusher worker thread");
 }
 
 STATIC int
@@ -283,17 +346,12 @@ vsnprintk_with_truc_suffix(char *buf, u32 bufsz, const char *fmt, va_list args)
 }
 
 static void
-__tilck_vprintk(char *prefixbuf,
-                char *buf,
-                u32 bufsz,
-                u32 flags,
-                const char *fmt,
-                va_list args)
+__tilck_vprintk(char *buf, u32 bufsz, u32 flags, const char *fmt, va_list args)
 {
    bool prefix = !in_panic();
    bool has_newline = false;
-   struct ringbuf_stat old;
-   int written, prefix_sz = 0;
+   u8 rec_flags = 0;
+   int written;
 
    if (fmt[0] == PRINTK_CTRL_CHAR) {
 
@@ -321,69 +379,45 @@ __tilck_vprintk(char *prefixbuf,
       }
    }
 
-   old = try_set_first_printk_on_stack(has_newline);
-
-   if (prefix && old.newline) {
-
-      const u64 systime = get_sys_time();
-
-      prefix_sz = snprintk(
-         prefixbuf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
-         (u32)(systime / TS_SCALE),
-         (u32)((systime % TS_SCALE) / (TS_SCALE / 1000)),
-         bufsz < PRINTK_BUF_SZ ? "[LOWSS] " : ""
-      );
-
-   } else {
-
+   /* Put the prefix only at the beginning of the lines */
+   if (!atomic_exchange_explicit(&printk_newline, has_newline, mo_relaxed))
       prefix = false;
-   }
 
+   if (in_panic() && term_is_initialized()) {
 
-   if (!term_is_initialized()) {
-      printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
-      printk_append_to_ringbuf(buf, (size_t) written);
-      restore_first_printk_value();
-      return;
-   }
+      /*
+       * Synchronous path: the flusher thread won't run anymore. Flush first
+       * the records still in the ring, unless we panicked while flushing them.
+       */
 
-   if (in_panic()) {
       u8 color = in_panic_debugger() ? DEFAULT_FG_COLOR : PRINTK_PANIC_COLOR;
-      printk_direct_flush(buf, (size_t) written, color);
-      restore_first_printk_value();
+      struct tty *t = KRN_PRINTK_ON_CURR_TTY ? NULL : get_curr_process_tty();
+
+      __printk_flush_ringbuf(true);
+      printk_direct_flush(buf, (size_t) written, color, t, true);
       return;
    }
 
-   disable_preemption();
-   {
-      if (!old.first_printk) {
-
-         /*
-          * OK, we were the first. Now, flush our buffer directly and loop
-          * flushing anything that, in the meanwhile, printk() calls from IRQs
-          * generated.
-          */
-
-         printk_direct_flush(prefixbuf, (size_t) prefix_sz, PRINTK_COLOR);
-         printk_direct_flush(buf, (size_t) written, PRINTK_COLOR);
-         __printk_flush_ringbuf(buf, bufsz);
+   if (prefix)
+      rec_flags |= PRINTK_REC_PREFIX;
 
-         /*
-          * No need to call restore_first_printk_value(): printk_flush_ringbuf
-          * clears the `first_printk` bit for us.
-          */
+   if (bufsz < PRINTK_BUF_SZ)
+      rec_flags |= PRINTK_REC_LOWSS;
 
-      } else {
+   disable_preemption();
+   {
+      /*
+       * Keep the preemption disabled while the record is uncommitted: the
+       * flusher cannot go past it until then.
+       */
+      printk_append_rec(buf, (size_t) written, rec_flags);
 
-         /*
-          * We were NOT the first printk on the stack: we're in an IRQ handler
-          * and can only append our data to the ringbuf. On return, at some
-          * point, the first printk(), in printk_flush_ringbuf() [case above]
-          * will flush our data.
-          */
+      if (term_is_initialized()) {
 
-         printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
-         printk_append_to_ringbuf(buf, (size_t) written);
+         if (printk_wth && !in_kernel_shutdown())
+            printk_wakeup_flusher();
+         else
+            __printk_flush_ringbuf(true);  /* early boot or shutdown */
       }
    }
    enable_preemption();
@@ -392,29 +426,24 @@ __tilck_vprintk(char *prefixbuf,
 static void
 __regular_tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   char prefixbuf[PRINTK_PREFIXBUF_SZ];
    char buf[PRINTK_BUF_SZ];
-
-   __tilck_vprintk(prefixbuf, buf, sizeof(buf), flags, fmt, args);
+   __tilck_vprintk(buf, sizeof(buf), flags, fmt, args);
 }
 
 static void
 __low_ssp_tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   char prefixbuf[PRINTK_PREFIXBUF_SZ];
    char buf[64];
-
-   __tilck_vprintk(prefixbuf, buf, sizeof(buf), flags, fmt, args);
+   __tilck_vprintk(buf, sizeof(buf), flags, fmt, args);
 }
 
 void
 tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   static char p_prefixbuf[PRINTK_PREFIXBUF_SZ];
    static char p_buf[PRINTK_BUF_SZ];
 
    if (in_panic())
-      __tilck_vprintk(p_prefixbuf, p_buf, sizeof(p_buf), flags, fmt, args);
+      __tilck_vprintk(p_buf, sizeof(p_buf), flags, fmt, args);
    else if (get_rem_stack() < PRINTK_SAFE_STACK_SPACE)
       panic("No stack space for vprintk(\"%s\")", fmt);
    else if (get_rem_stack() < PRINTK_SAFE_STACK_SPACE + 512)
@@ -14,7 +14,9 @@
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/signal.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/lock_stats.h>
 
 #include <sys/prctl.h>        // system header
 
@@ -127,6 +129,9 @@ static bool do_common_task_allocs(struct task *ti, bool alloc_bufs)
 
       ti->args_copybuf = (void *)((ulong)ti->io_copybuf + IO_COPYBUF_SIZE);
    }
+
+   /* Not critical: without it, only the system-wide stats are updated */
+   ti->lat = kzalloc_obj(struct sched_lat_stats);
    return true;
 }
 
@@ -146,11 +151,15 @@ void process_free_mappings_info(struct process *pi)
 void free_common_task_allocs(struct task *ti)
 {
    struct process *pi = ti->pi;
-   process_free_mappings_info(pi);
+
+   if (is_main_thread(ti))
+      process_free_mappings_info(pi);
 
    free_kernel_stack(ti);
    kfree2(ti->io_copybuf, IO_COPYBUF_SIZE + ARGS_COPYBUF_SIZE);
+   kfree_obj(ti->lat, struct sched_lat_stats);
 
+   ti->lat = NULL;
    ti->io_copybuf = NULL;
    ti->args_copybuf = NULL;
    ti->kernel_stack = NULL;
@@ -170,7 +179,7 @@ void free_mem_for_zombie_task(struct task *ti)
 
    free_common_task_allocs(ti);
 
-   if (ti->pi->automatic_reaping) {
+   if (ti->pi->automatic_reaping && is_main_thread(ti)) {
       /* The SIGCHLD signal has been EXPLICITLY ignored by the parent */
       remove_task(ti);
    }
@@ -182,6 +191,7 @@ void init_task_lists(struct task *ti)
    list_node_init(&ti->runnable_node);
    list_node_init(&ti->wakeup_timer_node);
    list_node_init(&ti->siblings_node);
+   list_node_init(&ti->threads_node);
 
    list_init(&ti->tasks_waiting_list);
    list_init(&ti->on_exit);
@@ -191,7 +201,11 @@ void init_task_lists(struct task *ti)
 void init_process_lists(struct process *pi)
 {
    list_init(&pi->children);
+   list_init(&pi->threads);
+   list_init(&pi->shm_list);
+   list_init(&pi->timers_list);
    kmutex_init(&pi->fslock, KMUTEX_FL_RECURSIVE);
+   LOCK_STATS_NAME(&pi->fslock, kmutex, "process fslock");
 }
 
 struct task *
@@ -233,6 +247,9 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    pi->automatic_reaping = false;
    pi->cwd.fs = NULL;
    pi->vforked = false;
+   pi->threads_count = 1;
+   pi->killing_threads = false;
+   pi->group_exit = false;
 
    if (new_pdir != parent_pi->pdir) {
 
@@ -246,6 +263,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
 
    } else {
       pi->vforked = true;
+      pi->vfork_parent_tid = parent->tid;
    }
 
    pi->inherited_mmap_heap = !!pi->mi;
@@ -253,6 +271,8 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    ti->tid = pid;
    ti->is_main_thread = true;
    ti->timer_ready = false;
+   ti->clear_child_tid = NULL;
+   ti->trace_buf = NULL;
 
    /*
     * From fork(2):
@@ -264,8 +284,10 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
     */
    drop_all_pending_signals(ti);
 
-   /* Reset sched ticks in the new process */
+   /* Reset sched ticks and latency stats in the new process */
    bzero(&ti->ticks, sizeof(ti->ticks));
+   ti->runnable_since = 0;
+   ti->lat = NULL;
 
    /* Copy parent's `cwd` while retaining the `fs` and the inode obj */
    process_set_cwd2_nolock_raw(pi, &parent_pi->cwd);
@@ -280,6 +302,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    init_task_lists(ti);
    init_process_lists(pi);
    list_add_tail(&parent_pi->children, &ti->siblings_node);
+   list_add_tail(&pi->threads, &ti->threads_node);
 
    pi->proc_tty = parent_pi->proc_tty;
    return ti;
@@ -526,6 +549,57 @@ int kthread_join_all(const int *tids, size_t n, bool ignore_signals)
    return rc;
 }
 
+/*
+ * Send SIGKILL to all the threads of the current process, except the current
+ * one. Used by exit_group() and by execve() in multi-threaded processes.
+ */
+void process_kill_other_threads(void)
+{
+   struct task *curr = get_curr_task();
+   struct process *pi = curr->pi;
+   struct task *pos;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(pi->killing_threads);
+
+   list_for_each_ro(pos, &pi->threads, threads_node) {
+      if (pos != curr)
+         send_signal2(pi->pid, pos->tid, SIGKILL, 0);
+   }
+}
+
+/* Wait for all the other threads of the current process to exit */
+void process_wait_other_threads(void)
+{
+   struct task *curr = get_curr_task();
+   struct process *pi = curr->pi;
+   struct task *pos;
+   int tid;
+
+   ASSERT(is_preemption_enabled());
+
+   while (true) {
+
+      tid = 0;
+
+      disable_preemption();
+      {
+         list_for_each_ro(pos, &pi->threads, threads_node) {
+            if (pos != curr) {
+               tid = pos->tid;
+               break;
+            }
+         }
+      }
+      enable_preemption();
+
+      if (!tid)
+         break;
+
+      kthread_join(tid, true);
+   }
+}
+
 void
 handle_vforked_child_move_on(struct process *pi)
 {
@@ -533,7 +607,7 @@ handle_vforked_child_move_on(struct process *pi)
 
    ASSERT(!is_preemption_enabled());
    ASSERT(pi->vforked);
-   parent = get_task(pi->parent_pid);
+   parent = get_task(pi->vfork_parent_tid);
 
    ASSERT(parent != NULL);
    ASSERT(parent->stopped);
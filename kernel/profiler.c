@@ -0,0 +1,337 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/syscalls.h>
+
+#include <tilck/kernel/profiler.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/debug_utils.h>
+
+/*
+ * The stacks are aggregated in an open-addressing hash table, allocated the
+ * first time the profiler is started and never freed. The table is written
+ * only by the timer IRQ handler, while all the other functions here touch it
+ * with the interrupts disabled.
+ */
+
+#define PROF_MAX_STACKS                        1024   /* must be a power of 2 */
+#define PROF_MAX_PROBES                          32
+
+struct prof_stack {
+
+   u32 count;                         /* 0 means: free slot */
+   u32 depth;                         /* 0 for the "[user]" stack */
+   ulong frames[PROF_MAX_FRAMES];     /* frames[0] is the interrupted IP */
+};
+
+long prof_hz;
+ulong prof_samples;
+ulong prof_lost;
+u32 __prof_period;
+
+static u32 ticks_to_next_sample;
+static struct prof_stack *stacks;
+
+/*
+ * Get the end of the kernel stack containing `r`: the current task's one or,
+ * for the kernel process and for the dying tasks, the initial one. Kernel
+ * stacks are not aligned to their size (see KERNEL_STACK_ISOLATION). Returns
+ * 0 when `r` is in neither of them.
+ */
+static ulong
+prof_get_stack_end(regs_t *r)
+{
+   const ulong stack = (ulong)get_curr_task()->kernel_stack;
+
+   if (stack && IN_RANGE((ulong)r, stack, stack + KERNEL_STACK_SIZE))
+      return stack + KERNEL_STACK_SIZE;
+
+   if (IN_RANGE((ulong)r, init_st_begin, init_st_end))
+      return init_st_end;
+
+   return 0;
+}
+
+static u32
+prof_stack_walk(regs_t *r, ulong *frames)
+{
+   const ulong stack_end = prof_get_stack_end(r);
+   ulong fp = (ulong)regs_get_frame_ptr(r);
+   ulong prev_fp = (ulong)r;
+   u32 n = 0;
+
+   frames[n++] = (ulong)regs_get_ip(r);
+
+   if (!stack_end)
+      return n;
+
+   /*
+    * The interrupted kernel code used the same stack the regs have been pushed
+    * on: stop as soon as a frame pointer goes outside of it or does not move
+    * towards its end, as it cannot be trusted anymore.
+    */
+   while (n < PROF_MAX_FRAMES) {
+
+      if (fp <= prev_fp || fp + 2 * sizeof(ulong) > stack_end)
+         break;
+
+      if (fp & (sizeof(ulong) - 1))
+         break;
+
+      if (!((ulong *)fp)[1])
+         break;
+
+      frames[n++] = ((ulong *)fp)[1];
+      prev_fp = fp;
+      fp = ((ulong *)fp)[0];
+   }
+
+   return n;
+}
+
+static u32
+prof_hash(ulong *frames, u32 depth)
+{
+   u32 h = 2166136261u;    /* FNV-1a */
+
+   for (u32 i = 0; i < depth; i++)
+      h = (h ^ (u32)frames[i]) * 16777619u;
+
+   return h;
+}
+
+static void
+prof_record(ulong *frames, u32 depth)
+{
+   const size_t sz = depth * sizeof(ulong);
+   u32 idx = prof_hash(frames, depth);
+   struct prof_stack *s;
+
+   for (u32 i = 0; i < PROF_MAX_PROBES; i++, idx++) {
+
+      s = &stacks[idx & (PROF_MAX_STACKS - 1)];
+
+      if (!s->count) {
+         s->depth = depth;
+         memcpy(s->frames, frames, sz);
+         s->count = 1;
+         return;
+      }
+
+      if (s->depth == depth && !memcmp(s->frames, frames, sz)) {
+         s->count++;
+         return;
+      }
+   }
+
+   prof_lost++;
+}
+
+/* Called by the timer IRQ handler, only when `__prof_period` > 0 */
+void prof_timer_tick(void)
+{
+   ulong frames[PROF_MAX_FRAMES];
+   regs_t *r = get_irq_regs();
+   u32 depth = 0;
+
+   if (--ticks_to_next_sample)
+      return;
+
+   ticks_to_next_sample = __prof_period;
+
+   if (!r)
+      return;
+
+   if ((ulong)regs_get_ip(r) >= KERNEL_BASE_VA)
+      depth = prof_stack_walk(r, frames);
+
+   prof_samples++;
+   prof_record(frames, depth);
+}
+
+int prof_start(long hz)
+{
+   ulong var;
+   u32 period;
+
+   if (hz <= 0 || hz > TIMER_HZ)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if (!stacks)
+         stacks = kzalloc_array_obj(struct prof_stack, PROF_MAX_STACKS);
+   }
+   enable_preemption();
+
+   if (!stacks)
+      return -ENOMEM;
+
+   period = (u32)(TIMER_HZ / hz);
+
+   disable_interrupts(&var);
+   {
+      ticks_to_next_sample = period;
+      __prof_period = period;
+      prof_hz = TIMER_HZ / (long)period;
+   }
+   enable_interrupts(&var);
+   return 0;
+}
+
+void prof_stop(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      __prof_period = 0;
+      prof_hz = 0;
+   }
+   enable_interrupts(&var);
+}
+
+void prof_reset(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      if (stacks)
+         bzero(stacks, sizeof(struct prof_stack) * PROF_MAX_STACKS);
+
+      prof_samples = 0;
+      prof_lost = 0;
+   }
+   enable_interrupts(&var);
+}
+
+struct folded_ctx {
+   char *buf;              /* NULL when just counting */
+   size_t buf_sz;
+   size_t len;
+};
+
+static void
+folded_append(struct folded_ctx *ctx, const char *s)
+{
+   const size_t n = strlen(s);
+
+   if (ctx->buf && ctx->len + n <= ctx->buf_sz)
+      memcpy(ctx->buf + ctx->len, s, n);
+
+   ctx->len += n;
+}
+
+static const char *
+prof_resolve(ulong va, bool ret_addr)
+{
+   const char *name;
+   long off;
+   u32 sym_size;
+
+   /*
+    * Resolve return addresses using the address of the call instruction:
+    * calls to NORETURN functions might be the last instruction of a function
+    * (see dump_stacktrace()).
+    */
+   name = find_sym_at_addr(ret_addr ? va - 1 : va, &off, &sym_size);
+   return name ? name : "???";
+}
+
+/* Returns false when the line didn't fit in the buffer */
+static bool
+folded_append_stack(struct folded_ctx *ctx, struct prof_stack *s)
+{
+   const size_t line_start = ctx->len;
+   char cnt_buf[16];
+
+   if (!s->depth)
+      folded_append(ctx, "[user]");
+
+   for (u32 i = s->depth; i > 0; i--) {
+
+      folded_append(ctx, prof_resolve(s->frames[i - 1], i > 1));
+
+      if (i > 1)
+         folded_append(ctx, ";");
+   }
+
+   snprintk(cnt_buf, sizeof(cnt_buf), " %u\n", s->count);
+   folded_append(ctx, cnt_buf);
+
+   if (ctx->buf && ctx->len > ctx->buf_sz) {
+      ctx->len = line_start;
+      return false;
+   }
+
+   return true;
+}
+
+size_t prof_get_folded(char *buf, size_t buf_sz)
+{
+   struct folded_ctx ctx = { .buf = buf, .buf_sz = buf_sz };
+   struct prof_stack s;
+   ulong var;
+
+   if (!stacks)
+      return 0;
+
+   for (u32 i = 0; i < PROF_MAX_STACKS; i++) {
+
+      disable_interrupts(&var);
+      {
+         s = stacks[i];
+      }
+      enable_interrupts(&var);
+
+      if (!s.count)
+         continue;
+
+      s.depth = MIN(s.depth, (u32)PROF_MAX_FRAMES);
+
+      if (!folded_append_stack(&ctx, &s))
+         break;
+   }
+
+   return ctx.len;
+}
+
+int sys_tilck_prof(int cmd, long arg)
+{
+   switch (cmd) {
+
+      case TILCK_PROF_START:
+         return prof_start(arg);
+
+      case TILCK_PROF_STOP:
+         prof_stop();
+         return 0;
+
+      case TILCK_PROF_RESET:
+         prof_reset();
+         return 0;
+
+      default:
+         return -EINVAL;
+   }
+}
+
+void init_profiler(void)
+{
+   int rc;
+
+   if (!kopt_prof_hz)
+      return;
+
+   if ((rc = prof_start(kopt_prof_hz)))
+      printk("WARNING: unable to start the profiler (error: %d)\n", rc);
+   else
+      printk("Profiler started at %ld Hz\n", prof_hz);
+}
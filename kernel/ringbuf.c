@@ -12,6 +12,10 @@ extern inline bool ringbuf_read_elem1(struct ringbuf *rb, u8 *elem_ptr);
 extern inline bool ringbuf_is_empty(struct ringbuf *rb);
 extern inline bool ringbuf_is_full(struct ringbuf *rb);
 extern inline size_t ringbuf_get_elems(struct ringbuf *rb);
+extern inline size_t ringbuf_get_write_chunk(struct ringbuf *rb, u8 **ptr);
+extern inline size_t ringbuf_get_read_chunk(struct ringbuf *rb, u8 **ptr);
+extern inline void ringbuf_commit_write(struct ringbuf *rb, size_t n);
+extern inline void ringbuf_commit_read(struct ringbuf *rb, size_t n);
 
 void
 ringbuf_init(struct ringbuf *rb, size_t max_elems, size_t elem_size, void *buf)
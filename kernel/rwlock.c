@@ -2,6 +2,7 @@
 
 #include <tilck/kernel/rwlock.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/lock_stats.h>
 
 void rwlock_rp_init(struct rwlock_rp *r)
 {
@@ -65,6 +66,10 @@ void rwlock_wp_init(struct rwlock_wp *rw, bool recursive)
    rw->r = 0;
    rw->w = false;
    rw->rec = recursive;
+
+#if KRN_LOCK_STATS
+   lock_stats_init(&rw->ls, lock_type_rwlock_wp, LOCK_STATS_CALLER());
+#endif
 }
 
 void rwlock_wp_destroy(struct rwlock_wp *rw)
@@ -76,10 +81,43 @@ void rwlock_wp_destroy(struct rwlock_wp *rw)
    kmutex_destroy(&rw->m);
 }
 
+static ALWAYS_INLINE u64
+rwlock_wp_stats_wait_begin(bool contended)
+{
+#if KRN_LOCK_STATS
+   return contended ? lock_stats_wait_begin() : 0;
+#else
+   return 0;
+#endif
+}
+
+static ALWAYS_INLINE void
+rwlock_wp_stats_acquired(struct rwlock_wp *rw, u64 wait_start)
+{
+#if KRN_LOCK_STATS
+   lock_stats_acquired(&rw->ls,
+                       lock_type_rwlock_wp,
+                       LOCK_STATS_CALLER(),
+                       wait_start);
+#endif
+}
+
+static ALWAYS_INLINE void
+rwlock_wp_stats_released(struct rwlock_wp *rw)
+{
+#if KRN_LOCK_STATS
+   lock_stats_released(&rw->ls);
+#endif
+}
+
 void rwlock_wp_shlock(struct rwlock_wp *rw)
 {
+   u64 wait_start;
+
    kmutex_lock(&rw->m);
    {
+      wait_start = rwlock_wp_stats_wait_begin(rw->w);
+
       /* Wait until there's at least one writer waiting (they have priority) */
       while (rw->w) {
          kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
@@ -91,6 +129,7 @@ void rwlock_wp_shlock(struct rwlock_wp *rw)
        * lock.
        */
       rw->r++;
+      rwlock_wp_stats_acquired(rw, wait_start);
    }
    kmutex_unlock(&rw->m);
 }
@@ -111,6 +150,8 @@ void rwlock_wp_shunlock(struct rwlock_wp *rw)
 
 static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 {
+   u64 wait_start;
+
    if (rw->rec) {
       if (rw->ex_owner == get_curr_task()) {
          ASSERT(rw->w);
@@ -121,6 +162,8 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
    }
 
 
+   wait_start = rwlock_wp_stats_wait_begin(rw->w || rw->r > 0);
+
    /* Wait our turn until other writers are waiting to write */
    while (rw->w) {
       kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
@@ -145,6 +188,7 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 
    ASSERT(rw->ex_owner == NULL);
    rw->ex_owner = get_curr_task();
+   rwlock_wp_stats_acquired(rw, wait_start);
 
    if (rw->rec) {
       /* recursive locking count */
@@ -178,6 +222,7 @@ static void rwlock_wp_exunlock_int(struct rwlock_wp *rw)
    }
 
    rw->ex_owner = NULL;
+   rwlock_wp_stats_released(rw);
 
    /* The `w` flag must be set */
    ASSERT(rw->w);
@@ -10,6 +10,11 @@
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/errno.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/lat_tracer.h>
+#include <tilck/kernel/perf.h>
+
+#include <tilck/mods/tracing.h>
 
 /* Shared global variables */
 struct task *__current;
@@ -22,6 +27,10 @@ struct process *kernel_process_pi;
 /* Task lists */
 struct list runnable_tasks_list;
 
+/* Latency histograms */
+struct sched_lat_hist sched_wakeup_lat;
+struct sched_lat_hist sched_rq_wait;
+
 /* Static variables */
 static struct task *tree_by_tid_root;
 static u64 idle_ticks;
@@ -30,6 +39,15 @@ static int current_max_pid = -1;
 static int current_max_kernel_tid = -1;
 struct task *idle_task;
 
+static void perf_get_idle_ticks(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = idle_ticks;
+}
+
+DEF_PERF_HIST(sched, wakeup_lat, sched_wakeup_lat.cnt);
+DEF_PERF_HIST(sched, rq_wait, sched_rq_wait.cnt);
+DEF_PERF_COUNTER_FUNC(sched, idle_ticks, perf_get_idle_ticks);
+
 const char *const task_state_str[5] = {
    [TASK_STATE_INVALID]  = "invalid",
    [TASK_STATE_RUNNABLE] = "runnable",
@@ -40,8 +58,14 @@ const char *const task_state_str[5] = {
 
 void enable_preemption(void)
 {
-   int oldval =
-      atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
+   int oldval;
+
+   if (KRN_LAT_TRACER && get_preempt_disable_count() == 1)
+      preemptoff_trace_end_at(
+         __builtin_extract_return_addr(__builtin_return_address(0))
+      );
+
+   oldval = atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
 
    ASSERT(oldval > 0);
 
@@ -115,7 +139,7 @@ int sched_count_proc_in_group(int pgid)
 
       while ((ti = bintree_in_order_visit_next(&ctx))) {
 
-         if (ti->pi->pgid == pgid)
+         if (ti->pi->pgid == pgid && is_main_thread(ti))
             count++;
       }
    }
@@ -229,8 +253,8 @@ static int create_new_pid_visit_cb(void *obj, void *arg)
 
    } else {
 
-      if (!is_main_thread(ti))
-         return 0; /* skip threads */
+      if (is_kernel_thread(ti))
+         return 0; /* skip kernel threads: user threads use pids too */
 
       ASSERT(tid >= 0);
 
@@ -524,19 +548,74 @@ static void task_remove_from_state_list(struct task *ti)
    }
 }
 
+static void sched_lat_hist_add(struct sched_lat_hist *h, u64 ns)
+{
+   u64 us = ns / 1000;
+   u32 i = 0;
+
+   while (us && i < SCHED_LAT_BUCKETS - 1) {
+      us >>= 1;
+      i++;
+   }
+
+   h->cnt[i]++;
+}
+
+/*
+ * Track how long the tasks wait in the runqueue, before running. Called with
+ * interrupts disabled.
+ */
+static void
+sched_lat_account(struct task *ti, enum task_state old, enum task_state new)
+{
+   struct sched_lat_stats *lat = ti->lat;
+   u64 delta;
+
+   if (new == TASK_STATE_RUNNABLE) {
+      ti->runnable_since = get_sys_time_hr();
+      ti->woken_up = (old == TASK_STATE_SLEEPING);
+      return;
+   }
+
+   if (new == TASK_STATE_RUNNING && ti->runnable_since) {
+
+      delta = get_sys_time_hr() - ti->runnable_since;
+      sched_lat_hist_add(&sched_rq_wait, delta);
+
+      if (lat)
+         sched_lat_hist_add(&lat->rq_wait, delta);
+
+      if (ti->woken_up) {
+
+         sched_lat_hist_add(&sched_wakeup_lat, delta);
+
+         if (lat)
+            sched_lat_hist_add(&lat->wakeup_lat, delta);
+      }
+   }
+
+   ti->runnable_since = 0;
+}
+
 void task_change_state(struct task *ti, enum task_state new_state)
 {
+   enum task_state old_state;
    ulong var;
    ASSERT(ti->state != new_state);
    ASSERT(ti->state != TASK_STATE_ZOMBIE);
 
    disable_interrupts(&var);
    {
+      old_state = atomic_load_explicit(&ti->state, mo_relaxed);
       task_remove_from_state_list(ti);
       atomic_store_explicit(&ti->state, new_state, mo_relaxed);
       task_add_to_state_list(ti);
+      sched_lat_account(ti, old_state, new_state);
    }
    enable_interrupts(&var);
+
+   if (new_state == TASK_STATE_RUNNABLE && old_state == TASK_STATE_SLEEPING)
+      trace_sched_wakeup(ti);
 }
 
 void task_change_state_idempotent(struct task *ti, enum task_state new_state)
@@ -820,6 +899,9 @@ int send_signal_to_group(int pgid, int sig)
 
       struct process *pi = ti->pi;
 
+      if (!is_main_thread(ti))
+         continue; /* signals are sent to processes, not threads */
+
       if (pi->pgid == pgid && pi != curr_pi && pi->pid != 1) {
 
          if (pi->pid != pgid)
@@ -866,6 +948,9 @@ int send_signal_to_session(int sid, int sig)
 
       struct process *pi = ti->pi;
 
+      if (!is_main_thread(ti))
+         continue; /* signals are sent to processes, not threads */
+
       if (pi->pgid == sid && pi != curr_pi && pi->pid != 1) {
 
          if (pi->pid != sid)
@@ -0,0 +1,548 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/ramfs.h>
+#include <tilck/kernel/shm.h>
+
+#include <sys/mman.h>      // system header
+#include <sys/ipc.h>       // system header
+#include <sys/shm.h>       // system header
+
+/*
+ * Shared memory objects: both the memfd_create() files and the SysV shm
+ * segments are unnamed files in a private ramfs instance. Mapping them uses
+ * ramfs_mmap(), which maps the file's blocks directly in the user space:
+ * processes sharing an object share its pages, without any copy.
+ *
+ * A SysV segment owns a handle to its file. Each shmat() creates a dup of that
+ * handle, owned by the attaching process and kept in its `shm_list` instead of
+ * its handle table. That dup handle is the one memory-mapped: closing it in
+ * shmdt() also removes the mapping.
+ *
+ * Locking: `shm_mutex` protects the segments table and the segment objects,
+ * while the per-process attachment lists and `nattch` are also modified with
+ * preemption disabled, because fork() duplicates them in that context.
+ */
+
+#define MEMFD_NAME_MAX                 249   /* excluding "memfd:", as Linux */
+#define MEMFD_ALL_FLAGS       (MFD_CLOEXEC | MFD_ALLOW_SEALING)
+
+#define SHM_MAX_SEGS                       64
+#define SHM_MAX_SIZE                (32 * MB)
+
+#ifndef IPC_64
+   #define IPC_64                      0x0100
+#endif
+
+/* The SysV shm operations multiplexed by sys_ipc(), used by libmusl on i386 */
+#define IPCOP_SHMAT                        21
+#define IPCOP_SHMDT                        22
+#define IPCOP_SHMGET                       23
+#define IPCOP_SHMCTL                       24
+
+struct shm_seg {
+
+   int id;
+   key_t key;
+   size_t size;
+   mode_t mode;
+   fs_handle h;                  /* handle to the backing ramfs file */
+   ulong nattch;
+   bool removed;                 /* IPC_RMID: destroy it when nattch == 0 */
+
+   int cpid;
+   int lpid;
+   s64 atime;
+   s64 dtime;
+   s64 ctime;
+};
+
+struct shm_attach {
+
+   struct list_node node;        /* node in pi->shm_list */
+   struct shm_seg *seg;
+   fs_handle h;                  /* dup of seg->h, mapped at `vaddr` */
+   ulong vaddr;
+};
+
+static struct mnt_fs *shm_fs;
+static struct kmutex shm_mutex;
+static struct shm_seg *shm_segs[SHM_MAX_SEGS];
+static u32 shm_seq;
+
+void init_shm(void)
+{
+   if (!(shm_fs = ramfs_create()))
+      panic("Unable to create the ramfs instance for shm");
+
+   /* The fs is never mounted: keep it alive, as mp_add() would do */
+   retain_obj(shm_fs);
+   kmutex_init(&shm_mutex, 0);
+}
+
+int sys_memfd_create(const char *u_name, u32 flags)
+{
+   char *name = get_curr_task()->args_copybuf;
+   fs_handle h;
+   int rc, fd;
+
+   if (flags & ~MEMFD_ALL_FLAGS)
+      return -EINVAL;
+
+   /* The name is used only for debugging on Linux: just validate it */
+   rc = copy_str_from_user(name, u_name, MEMFD_NAME_MAX + 1, NULL);
+
+   if (rc < 0)
+      return -EFAULT;
+
+   if (rc > 0)
+      return -EINVAL;
+
+   rc = ramfs_create_unnamed_file(shm_fs,
+                                  0777,
+                                  flags & MFD_ALLOW_SEALING ? 0 : F_SEAL_SEAL,
+                                  &h);
+   if (rc)
+      return rc;
+
+   fd = install_fs_handle(h, flags & MFD_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (fd < 0)
+      vfs_close(h);
+
+   return fd;
+}
+
+static struct shm_seg *shm_get_seg(int id)
+{
+   struct shm_seg *seg;
+   ASSERT(kmutex_is_curr_task_holding_lock(&shm_mutex));
+
+   if (id < 0)
+      return NULL;
+
+   seg = shm_segs[id % SHM_MAX_SEGS];
+   return seg && seg->id == id ? seg : NULL;
+}
+
+static struct shm_seg *shm_find_key(key_t key)
+{
+   ASSERT(kmutex_is_curr_task_holding_lock(&shm_mutex));
+
+   for (int i = 0; i < SHM_MAX_SEGS; i++) {
+      if (shm_segs[i] && shm_segs[i]->key == key)
+         return shm_segs[i];
+   }
+
+   return NULL;
+}
+
+static void shm_destroy_seg(struct shm_seg *seg)
+{
+   ASSERT(kmutex_is_curr_task_holding_lock(&shm_mutex));
+   ASSERT(seg->removed && !seg->nattch);
+
+   vfs_close(seg->h);
+   kfree_obj(seg, struct shm_seg);
+}
+
+static int shm_create_seg(key_t key, size_t size, mode_t mode)
+{
+   struct shm_seg *seg;
+   int idx, rc;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&shm_mutex));
+
+   if (!size || size > SHM_MAX_SIZE)
+      return -EINVAL;
+
+   for (idx = 0; idx < SHM_MAX_SEGS; idx++) {
+      if (!shm_segs[idx])
+         break;
+   }
+
+   if (idx == SHM_MAX_SEGS)
+      return -ENOSPC;
+
+   if (!(seg = kzalloc_obj(struct shm_seg)))
+      return -ENOMEM;
+
+   /* NOTE: the access checks are done on `seg->mode`, not on the file */
+   if ((rc = ramfs_create_unnamed_file(shm_fs, 0600, F_SEAL_SEAL, &seg->h))) {
+      kfree_obj(seg, struct shm_seg);
+      return rc;
+   }
+
+   /* Just set the file size: the pages are allocated on the first write */
+   rc = vfs_ftruncate(seg->h, (offt)pow2_round_up_at(size, PAGE_SIZE));
+
+   if (rc) {
+      vfs_close(seg->h);
+      kfree_obj(seg, struct shm_seg);
+      return rc;
+   }
+
+   /* The ID encodes the index in the table plus a sequence number */
+   shm_seq = (shm_seq + 1) & 0x7fff;
+
+   seg->id = (int)shm_seq * SHM_MAX_SEGS + idx;
+   seg->key = key;
+   seg->size = size;
+   seg->mode = mode & 0777;
+   seg->cpid = get_curr_proc()->pid;
+   seg->ctime = get_timestamp();
+
+   shm_segs[idx] = seg;
+   return seg->id;
+}
+
+int sys_shmget(key_t key, size_t size, int shmflg)
+{
+   struct shm_seg *seg = NULL;
+   int rc;
+
+   kmutex_lock(&shm_mutex);
+
+   if (key != IPC_PRIVATE)
+      seg = shm_find_key(key);
+
+   if (seg) {
+
+      if ((shmflg & IPC_CREAT) && (shmflg & IPC_EXCL))
+         rc = -EEXIST;
+      else if (size > seg->size)
+         rc = -EINVAL;
+      else
+         rc = seg->id;
+
+   } else if (key != IPC_PRIVATE && !(shmflg & IPC_CREAT)) {
+
+      rc = -ENOENT;
+
+   } else {
+
+      rc = shm_create_seg(key, size, (mode_t)shmflg & 0777);
+   }
+
+   kmutex_unlock(&shm_mutex);
+   return rc;
+}
+
+/* Drop an attachment, already removed from its process' list */
+static void shm_put_attach(struct shm_attach *a)
+{
+   struct shm_seg *seg = a->seg;
+
+   /* This removes also the mapping */
+   vfs_close(a->h);
+
+   kmutex_lock(&shm_mutex);
+   {
+      disable_preemption();
+      {
+         ASSERT(seg->nattch > 0);
+         seg->nattch--;
+      }
+      enable_preemption();
+
+      seg->lpid = get_curr_proc()->pid;
+      seg->dtime = get_timestamp();
+
+      if (seg->removed && !seg->nattch)
+         shm_destroy_seg(seg);
+   }
+   kmutex_unlock(&shm_mutex);
+   kfree_obj(a, struct shm_attach);
+}
+
+long sys_shmat(int shmid, void *u_addr, int shmflg)
+{
+   struct process *pi = get_curr_proc();
+   const int prot = PROT_READ | (shmflg & SHM_RDONLY ? 0 : PROT_WRITE);
+   struct shm_attach *a;
+   struct shm_seg *seg;
+   long res;
+   int rc;
+
+   if (u_addr)
+      return -EINVAL; /* Like for mmap(), addr != NULL is not supported */
+
+   if (!(a = kzalloc_obj(struct shm_attach)))
+      return -ENOMEM;
+
+   list_node_init(&a->node);
+   kmutex_lock(&shm_mutex);
+
+   if (!(seg = shm_get_seg(shmid))) {
+      res = -EINVAL;
+      goto err;
+   }
+
+   if ((rc = vfs_dup(seg->h, &a->h))) {
+      res = rc;
+      goto err;
+   }
+
+   /* The dup handle belongs to the current process, not to the creator */
+   ((struct fs_handle_base *)a->h)->pi = pi;
+
+   if (shmflg & SHM_RDONLY)
+      ((struct fs_handle_base *)a->h)->fl_flags = O_RDONLY;
+
+   res = do_mmap(NULL, seg->size, prot, MAP_SHARED, a->h, 0);
+
+   if (res < 0) {
+      vfs_close(a->h);
+      goto err;
+   }
+
+   a->seg = seg;
+   a->vaddr = (ulong)res;
+   seg->lpid = pi->pid;
+   seg->atime = get_timestamp();
+
+   disable_preemption();
+   {
+      seg->nattch++;
+      list_add_tail(&pi->shm_list, &a->node);
+   }
+   enable_preemption();
+
+   kmutex_unlock(&shm_mutex);
+   return res;
+
+err:
+   kmutex_unlock(&shm_mutex);
+   kfree_obj(a, struct shm_attach);
+   return res;
+}
+
+int sys_shmdt(const void *u_addr)
+{
+   struct process *pi = get_curr_proc();
+   struct shm_attach *pos, *a = NULL;
+
+   disable_preemption();
+   {
+      list_for_each_ro(pos, &pi->shm_list, node) {
+         if (pos->vaddr == (ulong)u_addr) {
+            a = pos;
+            list_remove(&a->node);
+            break;
+         }
+      }
+   }
+   enable_preemption();
+
+   if (!a)
+      return -EINVAL;
+
+   shm_put_attach(a);
+   return 0;
+}
+
+static void shm_fill_ds(struct shm_seg *seg, struct k_shmid64_ds *ds)
+{
+   bzero(ds, sizeof(*ds));
+
+   ds->shm_perm.key = seg->key;
+   ds->shm_perm.mode = (typeof(ds->shm_perm.mode))seg->mode;
+   ds->shm_perm.seq = (u16)(seg->id / SHM_MAX_SEGS);
+   ds->shm_segsz = seg->size;
+   ds->shm_atime = (typeof(ds->shm_atime))seg->atime;
+   ds->shm_dtime = (typeof(ds->shm_dtime))seg->dtime;
+   ds->shm_ctime = (typeof(ds->shm_ctime))seg->ctime;
+   ds->shm_cpid = seg->cpid;
+   ds->shm_lpid = seg->lpid;
+   ds->shm_nattch = seg->nattch;
+}
+
+static int shm_rmid(struct shm_seg *seg)
+{
+   shm_segs[seg->id % SHM_MAX_SEGS] = NULL;
+   seg->removed = true;
+
+   if (!seg->nattch)
+      shm_destroy_seg(seg);
+
+   return 0;
+}
+
+int sys_shmctl(int shmid, int cmd, struct k_shmid64_ds *u_buf)
+{
+   struct k_shmid64_ds ds;
+   struct shm_seg *seg;
+   int rc = 0;
+
+   /* libmusl always passes IPC_64: that's the only layout supported */
+   cmd &= ~IPC_64;
+
+   if (cmd == IPC_SET) {
+      if (copy_from_user(&ds, u_buf, sizeof(ds)))
+         return -EFAULT;
+   }
+
+   kmutex_lock(&shm_mutex);
+
+   if (!(seg = shm_get_seg(shmid))) {
+      rc = -EINVAL;
+      goto out;
+   }
+
+   switch (cmd) {
+
+      case IPC_STAT:
+         shm_fill_ds(seg, &ds);
+         break;
+
+      case IPC_SET:
+         seg->mode = ds.shm_perm.mode & 0777;
+         seg->ctime = get_timestamp();
+         break;
+
+      case IPC_RMID:
+         rc = shm_rmid(seg);
+         break;
+
+      case SHM_LOCK:
+      case SHM_UNLOCK:
+         break; /* Tilck never swaps pages out */
+
+      default:
+         rc = -EINVAL;
+   }
+
+out:
+   kmutex_unlock(&shm_mutex);
+
+   if (!rc && cmd == IPC_STAT) {
+      if (copy_to_user(u_buf, &ds, sizeof(ds)))
+         rc = -EFAULT;
+   }
+
+   return rc;
+}
+
+int
+sys_ipc(u32 call, int first, ulong second, ulong third, void *ptr, long fifth)
+{
+   long res;
+
+   switch (call & 0xffff) {
+
+      case IPCOP_SHMAT:
+
+         if ((res = sys_shmat(first, ptr, (int)second)) < 0)
+            return (int)res;
+
+         /* The attach address is returned through `third` */
+         if (copy_to_user((void *)third, &res, sizeof(ulong)))
+            return -EFAULT;
+
+         return 0;
+
+      case IPCOP_SHMDT:
+         return sys_shmdt(ptr);
+
+      case IPCOP_SHMGET:
+         return sys_shmget(first, second, (int)third);
+
+      case IPCOP_SHMCTL:
+         return sys_shmctl(first, (int)second, ptr);
+
+      default:
+         return -ENOSYS; /* semaphores and message queues */
+   }
+}
+
+int shm_fork_attachments(struct process *pi)
+{
+   struct process *parent = get_curr_proc();
+   struct shm_attach *a, *a2, *tmp;
+   struct user_mapping *um;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(list_is_empty(&pi->shm_list));
+
+   list_for_each_ro(a, &parent->shm_list, node) {
+
+      if (!(a2 = kzalloc_obj(struct shm_attach)))
+         goto oom;
+
+      if (vfs_dup(a->h, &a2->h)) {
+         kfree_obj(a2, struct shm_attach);
+         goto oom;
+      }
+
+      ((struct fs_handle_base *)a2->h)->pi = pi;
+
+      a2->seg = a->seg;
+      a2->vaddr = a->vaddr;
+      a2->seg->nattch++;
+      list_node_init(&a2->node);
+      list_add_tail(&pi->shm_list, &a2->node);
+
+      /* The child's copy of the mapping has to refer to the new handle */
+      if (pi->mi) {
+         list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+            if (um->h == a->h)
+               um->h = a2->h;
+         }
+      }
+   }
+
+   return 0;
+
+oom:
+
+   list_for_each(a2, tmp, &pi->shm_list, node) {
+
+      list_remove(&a2->node);
+      a2->seg->nattch--;
+
+      enable_preemption();
+      {
+         vfs_close(a2->h);
+      }
+      disable_preemption();
+      kfree_obj(a2, struct shm_attach);
+   }
+
+   return -ENOMEM;
+}
+
+void shm_detach_all(struct process *pi)
+{
+   struct shm_attach *a;
+   ASSERT(is_preemption_enabled());
+
+   while (true) {
+
+      a = NULL;
+      disable_preemption();
+      {
+         if (!list_is_empty(&pi->shm_list)) {
+            a = list_first_obj(&pi->shm_list, struct shm_attach, node);
+            list_remove(&a->node);
+         }
+      }
+      enable_preemption();
+
+      if (!a)
+         break;
+
+      shm_put_attach(a);
+   }
+}
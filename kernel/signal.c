@@ -17,6 +17,13 @@
 
 typedef void (*action_type)(struct task *, int signum, int fl);
 
+/*
+ * Signalled every time a signal becomes pending, for any task. That causes
+ * spurious wake-ups when there are signalfds in multiple processes, but it
+ * doesn't tie the lifetime of signalfd objects to any process.
+ */
+struct kcond signalfd_cond = STATIC_KCOND_INIT(signalfd_cond);
+
 static void __add_sig(ulong *set, int signum)
 {
    ASSERT(signum > 0);
@@ -37,6 +44,9 @@ static void add_pending_sig(struct task *ti, int signum, int fl)
 
    if (fl & SIG_FL_FAULT)
       __add_sig(ti->sa_fault_pending, signum);
+
+   /* Wake up the tasks waiting on a signalfd, see signalfd.c */
+   kcond_signal_all(&signalfd_cond);
 }
 
 static void __del_sig(ulong *set, int signum)
@@ -83,6 +93,24 @@ static bool is_sig_masked(struct task *ti, int signum)
    return __is_sig_set(ti->sa_mask, signum);
 }
 
+static const action_type signal_default_actions[_NSIG];
+static void action_ignore(struct task *ti, int signum, int fl);
+
+static bool is_sig_ignored(struct task *ti, int signum)
+{
+   __sighandler_t h = ti->pi->sa_handlers[signum - 1];
+
+   if (h == SIG_DFL) {
+
+      if (ti->tid == 1)
+         return true; /* See the comment in do_send_signal() */
+
+      return signal_default_actions[signum] == action_ignore;
+   }
+
+   return h == SIG_IGN;
+}
+
 static int get_first_pending_sig(struct task *ti, enum sig_state sig_state)
 {
    for (u32 i = 0; i < K_SIGACTION_MASK_WORDS; i++) {
@@ -180,7 +208,17 @@ bool process_signals(void *__ti, enum sig_state sig_state, void *regs)
       return false;
    }
 
-   sig = get_first_pending_sig(ti, sig_state);
+   while ((sig = get_first_pending_sig(ti, sig_state)) > 0) {
+
+      /*
+       * Ignored signals become pending only while blocked (see
+       * do_send_signal()). Now that they're unblocked, just drop them.
+       */
+      if (!is_sig_ignored(ti, sig))
+         break;
+
+      del_pending_sig(ti, sig);
+   }
 
    if (sig < 0)
       return false;
@@ -372,7 +410,16 @@ static void do_send_signal(struct task *ti, int signum, int fl)
       h = SIG_IGN;
    }
 
-   if (h == SIG_IGN) {
+   if (is_sig_ignored(ti, signum) && is_sig_masked(ti, signum)) {
+
+      /*
+       * Like on Linux, blocked signals are never ignored, because they might
+       * be consumed through a signalfd or the handler might change before
+       * they get unblocked.
+       */
+      add_pending_sig(ti, signum, fl);
+
+   } else if (h == SIG_IGN) {
 
       action_ignore(ti, signum, fl);
 
@@ -395,6 +442,34 @@ static void do_send_signal(struct task *ti, int signum, int fl)
    }
 }
 
+static bool
+can_take_process_signal(struct task *ti, int signum)
+{
+   return ti->state != TASK_STATE_ZOMBIE &&
+          ti->nested_sig_handlers >= 0 &&
+          !is_sig_masked(ti, signum);
+}
+
+/*
+ * A signal sent to a process can be handled by any of its threads: prefer the
+ * main thread, unless it's dying or it's blocking the signal.
+ */
+static struct task *
+get_process_signal_target(struct task *main_ti, int signum)
+{
+   struct task *pos;
+
+   if (can_take_process_signal(main_ti, signum))
+      return main_ti;
+
+   list_for_each_ro(pos, &main_ti->pi->threads, threads_node) {
+      if (can_take_process_signal(pos, signum))
+         return pos;
+   }
+
+   return main_ti;
+}
+
 int send_signal2(int pid, int tid, int signum, int flags)
 {
    struct task *ti;
@@ -418,10 +493,12 @@ int send_signal2(int pid, int tid, int signum, int flags)
    if (signum == 0)
       goto end; /* the user app is just checking permissions */
 
+   if ((flags & SIG_FL_PROCESS) && signum < _NSIG)
+      ti = get_process_signal_target(ti, signum);
+
    if (ti->state == TASK_STATE_ZOMBIE)
       goto end; /* do nothing */
 
-   /* TODO: update this code when thread support is added */
    do_send_signal(ti, signum, flags);
 
 end:
@@ -432,6 +509,43 @@ err_end:
    return rc;
 }
 
+/*
+ * Remove and return the lowest pending signal of `ti` that is also in `set`,
+ * or -1 if there's none. Used by signalfd.
+ */
+int dequeue_pending_signal(struct task *ti, const ulong *set)
+{
+   ASSERT(!is_preemption_enabled());
+
+   for (u32 i = 0; i < K_SIGACTION_MASK_WORDS; i++) {
+
+      ulong val = ti->sa_pending[i] & set[i];
+
+      if (val != 0) {
+
+         u32 idx = get_first_set_bit_index_l(val);
+         int signum = (int)(i * NBITS + idx + 1);
+
+         del_pending_sig(ti, signum);
+         return signum;
+      }
+   }
+
+   return -1;
+}
+
+bool is_any_signal_pending_in(struct task *ti, const ulong *set)
+{
+   ASSERT(!is_preemption_enabled());
+
+   for (u32 i = 0; i < K_SIGACTION_MASK_WORDS; i++) {
+      if (ti->sa_pending[i] & set[i])
+         return true;
+   }
+
+   return false;
+}
+
 bool pending_signals(void)
 {
    struct task *curr = get_curr_task();
@@ -473,16 +587,24 @@ int sys_tkill(int tid, int sig)
    if (!IN_RANGE(sig, 0, _NSIG) || tid <= 0)
       return -EINVAL;
 
-   return send_signal(tid, sig, false);
+   struct task *ti;
+   int pid = -1;
+
+   disable_preemption();
+   {
+      if ((ti = get_task(tid)))
+         pid = ti->pi->pid;
+   }
+   enable_preemption();
+
+   if (pid < 0)
+      return -ESRCH;
+
+   return send_signal2(pid, tid, sig, false);
 }
 
 int sys_tgkill(int pid /* linux: tgid */, int tid, int sig)
 {
-   if (pid != tid) {
-      printk("sys_tgkill: pid != tid NOT SUPPORTED yet.\n");
-      return -EINVAL;
-   }
-
    if (!IN_RANGE(sig, 0, _NSIG) || pid <= 0 || tid <= 0)
       return -EINVAL;
 
@@ -494,8 +616,11 @@ static int kill_each_task(void *obj, void *arg)
    struct task *ti = obj;
    int sig = *(int *)arg;
 
-   if (ti != get_curr_task() && !is_kernel_thread(ti)) {
-      send_signal(ti->tid, sig, false);
+   if (ti->pi != get_curr_proc() &&
+       !is_kernel_thread(ti) &&
+       is_main_thread(ti))
+   {
+      send_signal(ti->tid, sig, true);
    }
 
    return 0;
@@ -819,6 +944,52 @@ int sys_rt_sigsuspend(sigset_t *u_mask, size_t sigsetsize)
    return sys_pause();
 }
 
+/*
+ * Temporarily replace the signal mask of the current task with `u_mask`,
+ * saving the current one in `saved`. Used by syscalls having a sigmask param,
+ * like epoll_pwait(). Must be followed by a call to restore_temp_sigmask().
+ */
+int set_temp_sigmask(const sigset_t *u_mask, size_t sigsetsize, ulong *saved)
+{
+   struct task *curr = get_curr_task();
+
+   if (sigsetsize < sizeof(curr->sa_mask))
+      return -EINVAL;
+
+   memcpy(saved, curr->sa_mask, sizeof(curr->sa_mask));
+
+   if (copy_from_user(curr->sa_mask, u_mask, sizeof(curr->sa_mask))) {
+      memcpy(curr->sa_mask, saved, sizeof(curr->sa_mask));
+      return -EFAULT;
+   }
+
+   __del_sig(curr->sa_mask, SIGKILL);
+   __del_sig(curr->sa_mask, SIGSTOP);
+   return 0;
+}
+
+/*
+ * Restore the mask saved by set_temp_sigmask(). When the syscall has been
+ * interrupted by a signal, the temporary mask has to stay in place until the
+ * signal handler returns: in that case, do like sys_rt_sigsuspend() and let
+ * sys_rt_sigreturn() restore the old mask.
+ */
+void restore_temp_sigmask(const ulong *saved, int syscall_rc)
+{
+   struct task *curr = get_curr_task();
+
+   if (syscall_rc == -EINTR &&
+       !curr->nested_sig_handlers &&
+       !curr->in_sigsuspend)
+   {
+      memcpy(curr->sa_old_mask, saved, sizeof(curr->sa_old_mask));
+      curr->in_sigsuspend = true;
+      return;
+   }
+
+   memcpy(curr->sa_mask, saved, sizeof(curr->sa_mask));
+}
+
 int sys_pause(void)
 {
    ASSERT(!is_preemption_enabled()); /* Thanks to SYSFL_NO_PREEMPT */
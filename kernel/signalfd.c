@@ -0,0 +1,233 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/syscalls.h>
+
+/*
+ * signalfd: read the pending signals in a given set as signalfd_siginfo
+ * records instead of running a signal handler. The signals have to be blocked,
+ * otherwise they'll be delivered as usual. Like on Linux, the signals read are
+ * always the ones of the *reading* task, no matter which process created the
+ * signalfd. Process signals blocked by all the threads stay pending in the
+ * main thread (see get_process_signal_target()), so they're looked for there
+ * as well.
+ */
+
+#define SIGNALFD_ALL_FLAGS            (SFD_CLOEXEC | SFD_NONBLOCK)
+#define SIGNALFD_MASK_SIZE                          sizeof(u64)
+
+struct signalfd {
+
+   KOBJ_BASE_FIELDS
+
+   ulong mask[K_SIGACTION_MASK_WORDS];
+};
+
+static const struct file_ops static_ops_signalfd;
+
+static struct task *get_main_thread_if_not_curr(void)
+{
+   struct task *curr = get_curr_task();
+   struct task *main_ti = get_task(curr->pi->pid);
+
+   return main_ti != curr ? main_ti : NULL;
+}
+
+static int signalfd_dequeue(struct signalfd *sfd)
+{
+   struct task *main_ti;
+   int sig;
+
+   ASSERT(!is_preemption_enabled());
+
+   if ((sig = dequeue_pending_signal(get_curr_task(), sfd->mask)) > 0)
+      return sig;
+
+   if ((main_ti = get_main_thread_if_not_curr()))
+      return dequeue_pending_signal(main_ti, sfd->mask);
+
+   return -1;
+}
+
+static bool signalfd_is_ready(struct signalfd *sfd)
+{
+   struct task *main_ti;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (is_any_signal_pending_in(get_curr_task(), sfd->mask))
+      return true;
+
+   if ((main_ti = get_main_thread_if_not_curr()))
+      return is_any_signal_pending_in(main_ti, sfd->mask);
+
+   return false;
+}
+
+static ssize_t signalfd_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct signalfd *sfd = (void *)kh->kobj;
+   struct task *curr = get_curr_task();
+   struct k_signalfd_siginfo info;
+   size_t cnt = 0;
+   int sig;
+
+   if (size < sizeof(info))
+      return -EINVAL;
+
+   while (true) {
+
+      disable_preemption();
+
+      while (cnt + sizeof(info) <= size && (sig = signalfd_dequeue(sfd)) > 0) {
+
+         /* Tilck doesn't keep any siginfo: the sender is unknown */
+         bzero(&info, sizeof(info));
+         info.ssi_signo = (u32)sig;
+         info.ssi_code = SI_USER;
+
+         memcpy(buf + cnt, &info, sizeof(info));
+         cnt += sizeof(info);
+      }
+
+      if (cnt || (kh->fl_flags & O_NONBLOCK)) {
+         enable_preemption();
+         break;
+      }
+
+      if (pending_signals()) {
+         enable_preemption();
+         return -EINTR;
+      }
+
+      prepare_to_wait_on(WOBJ_KCOND,
+                         &signalfd_cond,
+                         NO_EXTRA,
+                         &signalfd_cond.wait_list);
+
+      enter_sleep_wait_state();
+
+      /* In case of a signal, we're still on the wait list */
+      wait_obj_reset(&curr->wobj);
+   }
+
+   return cnt ? (ssize_t)cnt : -EAGAIN;
+}
+
+static int signalfd_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct signalfd *sfd = (void *)kh->kobj;
+   bool ret;
+
+   disable_preemption();
+   {
+      ret = signalfd_is_ready(sfd);
+   }
+   enable_preemption();
+   return ret;
+}
+
+static struct kcond *signalfd_get_rready_cond(fs_handle h)
+{
+   return &signalfd_cond;
+}
+
+static const struct file_ops static_ops_signalfd =
+{
+   .read = signalfd_read,
+   .read_ready = signalfd_read_ready,
+   .get_rready_cond = signalfd_get_rready_cond,
+};
+
+static void destroy_signalfd(struct signalfd *sfd)
+{
+   kfree_obj(sfd, struct signalfd);
+}
+
+static void signalfd_set_mask(struct signalfd *sfd, const ulong *mask)
+{
+   disable_preemption();
+   {
+      memcpy(sfd->mask, mask, sizeof(sfd->mask));
+
+      /* Like sigprocmask(), silently ignore SIGKILL and SIGSTOP */
+      sfd->mask[(SIGKILL - 1) / NBITS] &= ~(1ul << ((SIGKILL - 1) % NBITS));
+      sfd->mask[(SIGSTOP - 1) / NBITS] &= ~(1ul << ((SIGSTOP - 1) % NBITS));
+   }
+   enable_preemption();
+}
+
+static int signalfd_create(const ulong *mask, int flags)
+{
+   struct signalfd *sfd;
+   fs_handle h;
+   int fd;
+
+   if (!(sfd = (void *)kzalloc_obj(struct signalfd)))
+      return -ENOMEM;
+
+   sfd->destory_obj = (void *)&destroy_signalfd;
+   signalfd_set_mask(sfd, mask);
+
+   h = kfs_create_new_handle(&static_ops_signalfd,
+                             (void *)sfd,
+                             O_RDONLY | (flags & SFD_NONBLOCK));
+
+   if (!h) {
+      destroy_signalfd(sfd);
+      return -ENOMEM;
+   }
+
+   fd = install_fs_handle(h, flags & SFD_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (fd < 0)
+      vfs_close(h); /* Destroys also the signalfd object */
+
+   return fd;
+}
+
+int sys_signalfd4(int fd, const sigset_t *u_mask, size_t sizemask, int flags)
+{
+   ulong mask[K_SIGACTION_MASK_WORDS] = {0};
+   struct kfs_handle *kh;
+
+   if (flags & ~SIGNALFD_ALL_FLAGS)
+      return -EINVAL;
+
+   if (sizemask != SIGNALFD_MASK_SIZE)
+      return -EINVAL;
+
+   if (copy_from_user(mask, u_mask, MIN(sizemask, sizeof(mask))))
+      return -EFAULT;
+
+   if (fd == -1)
+      return signalfd_create(mask, flags);
+
+   /* Change the mask of an existing signalfd */
+   if (!(kh = get_fs_handle(fd)))
+      return -EBADF;
+
+   if (kh->fops != &static_ops_signalfd)
+      return -EINVAL;
+
+   signalfd_set_mask((void *)kh->kobj, mask);
+   return fd;
+}
+
+int sys_signalfd(int fd, const sigset_t *u_mask, size_t sizemask)
+{
+   return sys_signalfd4(fd, u_mask, sizemask, 0);
+}
@@ -0,0 +1,881 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/socket.h>
+
+#include "fs/fs_int.h"
+
+/*
+ * Socket syscalls. Only the AF_UNIX family is supported: see af_unix.c.
+ *
+ * The data goes through the per-task `io_copybuf`: like for write(), larger
+ * sends on stream sockets are partial, while larger datagrams are rejected.
+ */
+
+#define SOCK_SEND_FLAGS        (MSG_DONTWAIT | MSG_NOSIGNAL)
+#define SOCK_RECV_FLAGS        (MSG_DONTWAIT | MSG_NOSIGNAL | MSG_PEEK |     \
+                                MSG_TRUNC | MSG_WAITALL | MSG_CMSG_CLOEXEC)
+
+#define SOCK_MAX_CONTROL       (K_CMSG_HDR_SIZE + 2 * UNIX_SCM_MAX_FD * 4)
+
+/* socketcall() call numbers, see <linux/net.h> */
+enum socketcall_num {
+
+   SC_SOCKET = 1,
+   SC_BIND,
+   SC_CONNECT,
+   SC_LISTEN,
+   SC_ACCEPT,
+   SC_GETSOCKNAME,
+   SC_GETPEERNAME,
+   SC_SOCKETPAIR,
+   SC_SEND,
+   SC_RECV,
+   SC_SENDTO,
+   SC_RECVFROM,
+   SC_SHUTDOWN,
+   SC_SETSOCKOPT,
+   SC_GETSOCKOPT,
+   SC_SENDMSG,
+   SC_RECVMSG,
+   SC_ACCEPT4,
+   SC_RECVMMSG,
+   SC_SENDMMSG,
+};
+
+static const u8 socketcall_nargs[] = {
+
+   [SC_SOCKET]       = 3,
+   [SC_BIND]         = 3,
+   [SC_CONNECT]      = 3,
+   [SC_LISTEN]       = 2,
+   [SC_ACCEPT]       = 3,
+   [SC_GETSOCKNAME]  = 3,
+   [SC_GETPEERNAME]  = 3,
+   [SC_SOCKETPAIR]   = 4,
+   [SC_SEND]         = 4,
+   [SC_RECV]         = 4,
+   [SC_SENDTO]       = 6,
+   [SC_RECVFROM]     = 6,
+   [SC_SHUTDOWN]     = 2,
+   [SC_SETSOCKOPT]   = 5,
+   [SC_GETSOCKOPT]   = 5,
+   [SC_SENDMSG]      = 3,
+   [SC_RECVMSG]      = 3,
+   [SC_ACCEPT4]      = 4,
+   [SC_RECVMMSG]     = 5,
+   [SC_SENDMMSG]     = 4,
+};
+
+static int get_sock_handle(int fd, fs_handle *out)
+{
+   fs_handle h;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if (!is_unix_socket(h))
+      return -ENOTSOCK;
+
+   *out = h;
+   return 0;
+}
+
+static int
+copy_sockaddr_from_user(struct k_sockaddr_un *addr,
+                        const void *u_addr,
+                        int addrlen)
+{
+   const int path_off = offsetof(struct k_sockaddr_un, sun_path);
+
+   if (addrlen <= path_off || addrlen > (int)sizeof(*addr))
+      return -EINVAL;
+
+   bzero(addr, sizeof(*addr));
+
+   if (copy_from_user(addr, u_addr, (size_t)addrlen))
+      return -EFAULT;
+
+   if (addr->sun_family != AF_UNIX)
+      return -EAFNOSUPPORT;
+
+   if (!addr->sun_path[0])
+      return -EOPNOTSUPP; /* The abstract namespace is not supported */
+
+   if (addr->sun_path[sizeof(addr->sun_path) - 1])
+      return -ENAMETOOLONG;
+
+   return 0;
+}
+
+static int
+copy_sockaddr_to_user(void *u_addr,
+                      int *u_addrlen,
+                      const struct k_sockaddr_un *addr,
+                      int addrlen)
+{
+   int ulen;
+
+   if (!u_addr)
+      return 0;
+
+   if (copy_from_user(&ulen, u_addrlen, sizeof(int)))
+      return -EFAULT;
+
+   if (ulen < 0)
+      return -EINVAL;
+
+   if (copy_to_user(u_addr, addr, (size_t)MIN(ulen, addrlen)))
+      return -EFAULT;
+
+   if (copy_to_user(u_addrlen, &addrlen, sizeof(int)))
+      return -EFAULT;
+
+   return 0;
+}
+
+static int check_socket_args(int family, int *type, int protocol, int *flags)
+{
+   *flags = *type & (SOCK_NONBLOCK | SOCK_CLOEXEC);
+   *type &= ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+   if (family != AF_UNIX)
+      return -EAFNOSUPPORT;
+
+   if (protocol != 0 && protocol != PF_UNIX)
+      return -EPROTONOSUPPORT;
+
+   if (*type != SOCK_STREAM && *type != SOCK_DGRAM)
+      return -ESOCKTNOSUPPORT;
+
+   return 0;
+}
+
+int sys_socket(int family, int type, int protocol)
+{
+   fs_handle h;
+   int rc, fd, flags;
+
+   if ((rc = check_socket_args(family, &type, protocol, &flags)))
+      return rc;
+
+   if ((rc = unix_create(type, flags, &h)))
+      return rc;
+
+   fd = install_fs_handle(h, flags & SOCK_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (fd < 0)
+      vfs_close(h); /* Destroys also the socket */
+
+   return fd;
+}
+
+int sys_socketpair(int family, int type, int protocol, int u_sv[2])
+{
+   fs_handle h[2];
+   int rc, flags, fd_flags;
+   int fds[2];
+
+   if ((rc = check_socket_args(family, &type, protocol, &flags)))
+      return rc;
+
+   if ((rc = unix_socketpair(type, flags, h)))
+      return rc;
+
+   fd_flags = flags & SOCK_CLOEXEC ? FD_CLOEXEC : 0;
+
+   if ((fds[0] = install_fs_handle(h[0], fd_flags)) < 0) {
+      vfs_close(h[0]);
+      vfs_close(h[1]);
+      return fds[0];
+   }
+
+   if ((fds[1] = install_fs_handle(h[1], fd_flags)) < 0) {
+      vfs_close(h[1]);
+      sys_close(fds[0]);
+      return fds[1];
+   }
+
+   if (copy_to_user(u_sv, fds, sizeof(fds))) {
+      sys_close(fds[0]);
+      sys_close(fds[1]);
+      return -EFAULT;
+   }
+
+   return 0;
+}
+
+int sys_bind(int fd, const void *u_addr, int addrlen)
+{
+   struct k_sockaddr_un addr;
+   fs_handle h;
+   int rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if ((rc = copy_sockaddr_from_user(&addr, u_addr, addrlen)))
+      return rc;
+
+   addrlen = (int)(offsetof(struct k_sockaddr_un, sun_path) +
+                   strlen(addr.sun_path) + 1);
+
+   return unix_bind(h, &addr, addrlen);
+}
+
+int sys_connect(int fd, const void *u_addr, int addrlen)
+{
+   struct k_sockaddr_un addr;
+   fs_handle h;
+   int rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if ((rc = copy_sockaddr_from_user(&addr, u_addr, addrlen)))
+      return rc;
+
+   return unix_connect(h, &addr);
+}
+
+int sys_listen(int fd, int backlog)
+{
+   fs_handle h;
+   int rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   return unix_listen(h, backlog);
+}
+
+int sys_accept4(int fd, void *u_addr, int *u_addrlen, int flags)
+{
+   struct k_sockaddr_un addr;
+   fs_handle h, new_h;
+   int rc, new_fd, addrlen;
+
+   if (flags & ~(SOCK_NONBLOCK | SOCK_CLOEXEC))
+      return -EINVAL;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if ((rc = unix_accept(h, flags, &new_h, &addr, &addrlen)))
+      return rc;
+
+   new_fd = install_fs_handle(new_h, flags & SOCK_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (new_fd < 0) {
+      vfs_close(new_h);
+      return new_fd;
+   }
+
+   if ((rc = copy_sockaddr_to_user(u_addr, u_addrlen, &addr, addrlen))) {
+      sys_close(new_fd);
+      return rc;
+   }
+
+   return new_fd;
+}
+
+static int
+sock_getname(int fd, void *u_addr, int *u_addrlen, bool peer)
+{
+   struct k_sockaddr_un addr;
+   fs_handle h;
+   int rc, addrlen;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if (!u_addr || !u_addrlen)
+      return -EFAULT;
+
+   if ((rc = unix_getname(h, peer, &addr, &addrlen)))
+      return rc;
+
+   return copy_sockaddr_to_user(u_addr, u_addrlen, &addr, addrlen);
+}
+
+int sys_getsockname(int fd, void *u_addr, int *u_addrlen)
+{
+   return sock_getname(fd, u_addr, u_addrlen, false);
+}
+
+int sys_getpeername(int fd, void *u_addr, int *u_addrlen)
+{
+   return sock_getname(fd, u_addr, u_addrlen, true);
+}
+
+int sys_getsockopt(int fd, int level, int optname,
+                   void *u_optval, int *u_optlen)
+{
+   fs_handle h;
+   int rc, len, val;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if (level != SOL_SOCKET)
+      return -ENOPROTOOPT;
+
+   if (copy_from_user(&len, u_optlen, sizeof(int)))
+      return -EFAULT;
+
+   if (len < (int)sizeof(int))
+      return -EINVAL;
+
+   if ((rc = unix_getsockopt(h, optname, &val)))
+      return rc;
+
+   len = sizeof(int);
+
+   if (copy_to_user(u_optval, &val, sizeof(int)))
+      return -EFAULT;
+
+   if (copy_to_user(u_optlen, &len, sizeof(int)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_setsockopt(int fd, int level, int optname,
+                   const void *u_optval, int optlen)
+{
+   fs_handle h;
+   int rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if (level != SOL_SOCKET)
+      return -ENOPROTOOPT;
+
+   switch (optname) {
+
+      case SO_SNDBUF:
+      case SO_RCVBUF:
+      case SO_REUSEADDR:
+      case SO_KEEPALIVE:
+         /* Accepted, but without any effect */
+         return optlen < (int)sizeof(int) ? -EINVAL : 0;
+
+      default:
+         return -ENOPROTOOPT;
+   }
+}
+
+static int sock_send_len(fs_handle h, size_t *len)
+{
+   if (*len <= IO_COPYBUF_SIZE)
+      return 0;
+
+   if (unix_sock_type(h) == SOCK_DGRAM)
+      return -EMSGSIZE;
+
+   *len = IO_COPYBUF_SIZE;
+   return 0;
+}
+
+/*
+ * Receive, handling MSG_WAITALL for stream sockets: keep reading until the
+ * buffer is full, the peer hangs up or some handles (SCM_RIGHTS) arrive.
+ */
+static ssize_t sock_recv(fs_handle h, struct unix_msg *m)
+{
+   struct unix_msg part;
+   size_t tot = 0;
+   ssize_t rc;
+
+   if (!(m->flags & MSG_WAITALL) || (m->flags & MSG_PEEK))
+      return unix_recv(h, m);
+
+   if (unix_sock_type(h) != SOCK_STREAM)
+      return unix_recv(h, m);
+
+   do {
+
+      part = *m;
+      part.buf += tot;
+      part.len -= tot;
+      part.rights = NULL;
+
+      if ((rc = unix_recv(h, &part)) <= 0)
+         break;
+
+      tot += (size_t)rc;
+
+      if (part.rights) {
+         m->rights = part.rights;
+         break;
+      }
+
+   } while (tot < m->len);
+
+   return tot > 0 ? (ssize_t)tot : rc;
+}
+
+int sys_sendto(int fd, const void *u_buf, size_t len, int flags,
+               const void *u_addr, int addrlen)
+{
+   struct task *curr = get_curr_task();
+   struct k_sockaddr_un addr;
+   struct unix_msg m = { .buf = curr->io_copybuf, .flags = flags };
+   fs_handle h;
+   int rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   if (flags & ~SOCK_SEND_FLAGS)
+      return -EOPNOTSUPP;
+
+   len = MIN(len, (size_t)INT32_MAX);
+
+   if ((rc = sock_send_len(h, &len)))
+      return rc;
+
+   if (copy_from_user(m.buf, u_buf, len))
+      return -EFAULT;
+
+   if (u_addr) {
+
+      if ((rc = copy_sockaddr_from_user(&addr, u_addr, addrlen)))
+         return rc;
+
+      m.addr = &addr;
+   }
+
+   m.len = len;
+   return (int)unix_send(h, &m);
+}
+
+int sys_recvfrom(int fd, void *u_buf, size_t len, int flags,
+                 void *u_addr, int *u_addrlen)
+{
+   struct task *curr = get_curr_task();
+   struct k_sockaddr_un addr;
+   struct unix_msg m = { .buf = curr->io_copybuf, .flags = flags };
+   fs_handle h;
+   ssize_t rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return (int)rc;
+
+   if (flags & ~SOCK_RECV_FLAGS)
+      return -EOPNOTSUPP;
+
+   m.len = MIN(len, IO_COPYBUF_SIZE);
+   m.addr = &addr;
+   rc = sock_recv(h, &m);
+
+   /* Handles passed with SCM_RIGHTS can be received only with recvmsg() */
+   unix_free_rights(m.rights);
+
+   if (rc < 0)
+      return (int)rc;
+
+   if (copy_to_user(u_buf, m.buf, MIN((size_t)rc, m.len)))
+      return -EFAULT;
+
+   if (copy_sockaddr_to_user(u_addr, u_addrlen, &addr, m.addr_len))
+      return -EFAULT;
+
+   return (int)rc;
+}
+
+/* Dup the handles passed with SCM_RIGHTS */
+static int
+sock_dup_fds(const int *fds, int cnt, struct unix_rights **out)
+{
+   struct process *pi = get_curr_proc();
+   struct unix_rights *r;
+   fs_handle h;
+   int rc = 0;
+
+   if (!(r = unix_alloc_rights()))
+      return -ENOMEM;
+
+   kmutex_lock(&pi->fslock);
+
+   for (int i = 0; i < cnt; i++) {
+
+      if (!(h = get_fs_handle(fds[i]))) {
+         rc = -EBADF;
+         break;
+      }
+
+      if ((rc = vfs_dup(h, &r->handles[i])))
+         break;
+
+      r->cnt++;
+   }
+
+   kmutex_unlock(&pi->fslock);
+
+   if (rc) {
+      unix_free_rights(r);
+      return rc;
+   }
+
+   *out = r;
+   return 0;
+}
+
+static int
+sock_get_rights(const struct k_msghdr *msg, struct unix_rights **out)
+{
+   ulong buf[SOCK_MAX_CONTROL / sizeof(ulong) + 1];
+   const size_t ctl_len = msg->msg_controllen;
+   struct k_cmsghdr *c;
+   size_t off, cnt;
+   int rc;
+
+   if (ctl_len > sizeof(buf))
+      return -ENOBUFS;
+
+   if (copy_from_user(buf, msg->msg_control, ctl_len))
+      return -EFAULT;
+
+   for (off = 0; off + K_CMSG_HDR_SIZE <= ctl_len; ) {
+
+      c = (void *)((u8 *)buf + off);
+
+      if (c->cmsg_len < K_CMSG_HDR_SIZE || c->cmsg_len > ctl_len - off)
+         return -EINVAL;
+
+      /* Only a single SCM_RIGHTS message is supported */
+      if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS || *out)
+         return -EINVAL;
+
+      cnt = (c->cmsg_len - K_CMSG_HDR_SIZE) / sizeof(int);
+
+      if (cnt > UNIX_SCM_MAX_FD)
+         return -EINVAL;
+
+      if (cnt) {
+
+         rc = sock_dup_fds((int *)((u8 *)c + K_CMSG_HDR_SIZE), (int)cnt, out);
+
+         if (rc)
+            return rc;
+      }
+
+      off += K_CMSG_ALIGN(c->cmsg_len);
+   }
+
+   return 0;
+}
+
+/*
+ * Install in the current process the handles received with SCM_RIGHTS and
+ * write the control message for them.
+ */
+static int
+sock_put_rights(struct k_msghdr *msg, struct unix_msg *m)
+{
+   struct unix_rights *r = m->rights;
+   const size_t ctl_len = msg->msg_controllen;
+   struct k_cmsghdr hdr = { .cmsg_level = SOL_SOCKET, .cmsg_type = SCM_RIGHTS };
+   const int fd_flags = m->flags & MSG_CMSG_CLOEXEC ? FD_CLOEXEC : 0;
+   u8 *u_ctl = msg->msg_control;
+   int fds[UNIX_SCM_MAX_FD];
+   int max_fds = 0, cnt = 0;
+
+   msg->msg_controllen = 0;
+
+   if (!r)
+      return 0;
+
+   if (ctl_len >= K_CMSG_HDR_SIZE)
+      max_fds = (int)((ctl_len - K_CMSG_HDR_SIZE) / sizeof(int));
+
+   for (int i = 0; i < r->cnt && cnt < max_fds; i++) {
+
+      struct fs_handle_base *hb = r->handles[i];
+      int fd;
+
+      hb->pi = get_curr_proc();
+
+      if ((fd = install_fs_handle(hb, fd_flags)) < 0)
+         break;
+
+      fds[cnt++] = fd;
+      r->handles[i] = NULL;
+   }
+
+   if (cnt < r->cnt)
+      m->out_flags |= MSG_CTRUNC;
+
+   /* Close the handles that could not be installed */
+   unix_free_rights(r);
+   m->rights = NULL;
+
+   if (!cnt)
+      return 0;
+
+   hdr.cmsg_len = K_CMSG_HDR_SIZE + (size_t)cnt * sizeof(int);
+
+   if (copy_to_user(u_ctl, &hdr, sizeof(hdr)))
+      return -EFAULT;
+
+   if (copy_to_user(u_ctl + K_CMSG_HDR_SIZE, fds, (size_t)cnt * sizeof(int)))
+      return -EFAULT;
+
+   msg->msg_controllen = MIN(K_CMSG_ALIGN(hdr.cmsg_len), ctl_len);
+   return 0;
+}
+
+static int
+sock_copy_msg_iov(const struct k_msghdr *msg, struct iovec **iov, size_t *len)
+{
+   int rc;
+
+   *iov = NULL;
+   *len = 0;
+
+   if (!msg->msg_iovlen)
+      return 0;
+
+   if (msg->msg_iovlen > INT32_MAX)
+      return -EMSGSIZE;
+
+   if ((rc = copy_iov_from_user(msg->msg_iov, (int)msg->msg_iovlen, iov)))
+      return rc;
+
+   for (ulong i = 0; i < msg->msg_iovlen; i++)
+      *len += (*iov)[i].iov_len;
+
+   return 0;
+}
+
+int sys_sendmsg(int fd, const struct k_msghdr *u_msg, int flags)
+{
+   struct task *curr = get_curr_task();
+   struct k_sockaddr_un addr;
+   struct unix_msg m = { .buf = curr->io_copybuf, .flags = flags };
+   struct k_msghdr msg;
+   struct iovec *iov;
+   size_t len, n;
+   ssize_t rc;
+   fs_handle h;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return (int)rc;
+
+   if (flags & ~SOCK_SEND_FLAGS)
+      return -EOPNOTSUPP;
+
+   if (copy_from_user(&msg, u_msg, sizeof(msg)))
+      return -EFAULT;
+
+   if ((rc = sock_copy_msg_iov(&msg, &iov, &len)))
+      return (int)rc;
+
+   if ((rc = sock_send_len(h, &len)))
+      return (int)rc;
+
+   /* Gather the data in the kernel buffer */
+   for (ulong i = 0; m.len < len; i++) {
+
+      n = MIN(iov[i].iov_len, len - m.len);
+
+      if (copy_from_user(m.buf + m.len, iov[i].iov_base, n))
+         return -EFAULT;
+
+      m.len += n;
+   }
+
+   if (msg.msg_name) {
+
+      rc = copy_sockaddr_from_user(&addr, msg.msg_name, msg.msg_namelen);
+
+      if (rc)
+         return (int)rc;
+
+      m.addr = &addr;
+   }
+
+   if (msg.msg_controllen) {
+      if ((rc = sock_get_rights(&msg, &m.rights))) {
+         unix_free_rights(m.rights);
+         return (int)rc;
+      }
+   }
+
+   rc = unix_send(h, &m);
+
+   /* The handles have not been queued */
+   unix_free_rights(m.rights);
+   return (int)rc;
+}
+
+int sys_recvmsg(int fd, struct k_msghdr *u_msg, int flags)
+{
+   struct task *curr = get_curr_task();
+   struct k_sockaddr_un addr;
+   struct unix_msg m = { .buf = curr->io_copybuf, .flags = flags };
+   struct k_msghdr msg;
+   struct iovec *iov;
+   size_t len, n, tot;
+   ssize_t rc;
+   fs_handle h;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return (int)rc;
+
+   if (flags & ~SOCK_RECV_FLAGS)
+      return -EOPNOTSUPP;
+
+   if (copy_from_user(&msg, u_msg, sizeof(msg)))
+      return -EFAULT;
+
+   if ((rc = sock_copy_msg_iov(&msg, &iov, &len)))
+      return (int)rc;
+
+   m.len = MIN(len, IO_COPYBUF_SIZE);
+   m.addr = &addr;
+
+   if ((rc = sock_recv(h, &m)) < 0)
+      return (int)rc;
+
+   /* Scatter the data in the user buffers */
+   tot = MIN((size_t)rc, m.len);
+
+   for (ulong i = 0, done = 0; done < tot; i++) {
+
+      n = MIN(iov[i].iov_len, tot - done);
+
+      if (copy_to_user(iov[i].iov_base, m.buf + done, n)) {
+         unix_free_rights(m.rights);
+         return -EFAULT;
+      }
+
+      done += n;
+   }
+
+   if (msg.msg_name) {
+
+      n = msg.msg_namelen > 0 ? (size_t)msg.msg_namelen : 0;
+      n = MIN(n, (size_t)m.addr_len);
+
+      if (copy_to_user(msg.msg_name, &addr, n)) {
+         unix_free_rights(m.rights);
+         return -EFAULT;
+      }
+
+      msg.msg_namelen = m.addr_len;
+   }
+
+   if (sock_put_rights(&msg, &m))
+      return -EFAULT;
+
+   msg.msg_flags = (u32)m.out_flags;
+
+   if (copy_to_user(&u_msg->msg_namelen, &msg.msg_namelen, sizeof(int)))
+      return -EFAULT;
+
+   if (copy_to_user(&u_msg->msg_controllen, &msg.msg_controllen, sizeof(ulong)))
+      return -EFAULT;
+
+   if (copy_to_user(&u_msg->msg_flags, &msg.msg_flags, sizeof(u32)))
+      return -EFAULT;
+
+   return (int)rc;
+}
+
+int sys_shutdown(int fd, int how)
+{
+   fs_handle h;
+   int rc;
+
+   if ((rc = get_sock_handle(fd, &h)))
+      return rc;
+
+   return unix_shutdown(h, how);
+}
+
+int sys_socketcall(int call, ulong *u_args)
+{
+   ulong a[6];
+
+   if (call < SC_SOCKET || call >= (int)ARRAY_SIZE(socketcall_nargs))
+      return -EINVAL;
+
+   if (copy_from_user(a, u_args, socketcall_nargs[call] * sizeof(ulong)))
+      return -EFAULT;
+
+   switch (call) {
+
+      case SC_SOCKET:
+         return sys_socket((int)a[0], (int)a[1], (int)a[2]);
+
+      case SC_BIND:
+         return sys_bind((int)a[0], (void *)a[1], (int)a[2]);
+
+      case SC_CONNECT:
+         return sys_connect((int)a[0], (void *)a[1], (int)a[2]);
+
+      case SC_LISTEN:
+         return sys_listen((int)a[0], (int)a[1]);
+
+      case SC_ACCEPT:
+         return sys_accept4((int)a[0], (void *)a[1], (int *)a[2], 0);
+
+      case SC_ACCEPT4:
+         return sys_accept4((int)a[0], (void *)a[1], (int *)a[2], (int)a[3]);
+
+      case SC_GETSOCKNAME:
+         return sys_getsockname((int)a[0], (void *)a[1], (int *)a[2]);
+
+      case SC_GETPEERNAME:
+         return sys_getpeername((int)a[0], (void *)a[1], (int *)a[2]);
+
+      case SC_SOCKETPAIR:
+         return sys_socketpair((int)a[0], (int)a[1], (int)a[2], (int *)a[3]);
+
+      case SC_SEND:
+         return sys_sendto((int)a[0], (void *)a[1], a[2], (int)a[3], NULL, 0);
+
+      case SC_RECV:
+         return sys_recvfrom((int)a[0], (void *)a[1], a[2], (int)a[3],
+                             NULL, NULL);
+
+      case SC_SENDTO:
+         return sys_sendto((int)a[0], (void *)a[1], a[2], (int)a[3],
+                           (void *)a[4], (int)a[5]);
+
+      case SC_RECVFROM:
+         return sys_recvfrom((int)a[0], (void *)a[1], a[2], (int)a[3],
+                             (void *)a[4], (int *)a[5]);
+
+      case SC_SHUTDOWN:
+         return sys_shutdown((int)a[0], (int)a[1]);
+
+      case SC_SETSOCKOPT:
+         return sys_setsockopt((int)a[0], (int)a[1], (int)a[2],
+                               (void *)a[3], (int)a[4]);
+
+      case SC_GETSOCKOPT:
+         return sys_getsockopt((int)a[0], (int)a[1], (int)a[2],
+                               (void *)a[3], (int *)a[4]);
+
+      case SC_SENDMSG:
+         return sys_sendmsg((int)a[0], (void *)a[1], (int)a[2]);
+
+      case SC_RECVMSG:
+         return sys_recvmsg((int)a[0], (void *)a[1], (int)a[2]);
+
+      default:
+         return -ENOSYS; /* recvmmsg() and sendmmsg() */
+   }
+}
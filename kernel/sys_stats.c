@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/sys_stats.h>
+#include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/cmdline.h>
+
+/*
+ * The stats are updated only by handle_syscall() with preemption disabled and
+ * never by IRQ handlers: therefore, disabling preemption is enough to read a
+ * consistent snapshot of them.
+ */
+
+struct syscall_stats *sys_stats;
+
+static ALWAYS_INLINE u32 cycles_to_bucket(u64 cycles)
+{
+   u32 i = 0;
+
+   if (cycles >= (1ull << (SYS_STATS_BUCKETS - 2)))
+      return SYS_STATS_BUCKETS - 1;
+
+   while (cycles) {
+      cycles >>= 1;
+      i++;
+   }
+
+   return i;
+}
+
+void sys_stats_account(u32 sn, long rc, u64 cycles)
+{
+   struct syscall_stats *s = &sys_stats[sn];
+   ASSERT(!is_preemption_enabled());
+
+   s->calls++;
+   s->tot_cycles += cycles;
+   s->hist[cycles_to_bucket(cycles)]++;
+
+   if (IN_RANGE(rc, -4095, 0))
+      s->errors++;
+
+   if (cycles > s->max_cycles)
+      s->max_cycles = cycles;
+}
+
+void sys_stats_get(u32 sn, struct syscall_stats *s)
+{
+   ASSERT(sys_stats != NULL);
+   ASSERT(sn < MAX_SYSCALLS);
+
+   disable_preemption();
+   {
+      *s = sys_stats[sn];
+   }
+   enable_preemption();
+}
+
+void sys_stats_reset(void)
+{
+   if (!sys_stats)
+      return;
+
+   disable_preemption();
+   {
+      bzero(sys_stats, sizeof(struct syscall_stats) * MAX_SYSCALLS);
+   }
+   enable_preemption();
+}
+
+const char *sys_stats_get_name(u32 sn)
+{
+   const char *name;
+   void *func;
+   long off;
+   u32 sz;
+
+   if (!(func = get_syscall_func_ptr(sn)))
+      return NULL;
+
+   if (!(name = find_sym_at_addr((ulong)func, &off, &sz)) || off)
+      return NULL;
+
+   if (!strncmp(name, "sys_", 4))
+      name += 4;
+
+   return name;
+}
+
+void init_sys_stats(void)
+{
+   if (!kopt_sys_stats)
+      return;
+
+   if (!x86_cpu_features.edx1.tsc) {
+      printk("WARNING: syscall stats not available: no TSC\n");
+      return;
+   }
+
+   sys_stats = kzalloc_array_obj(struct syscall_stats, MAX_SYSCALLS);
+
+   if (!sys_stats) {
+      printk("WARNING: unable to allocate the syscall stats\n");
+      return;
+   }
+
+   printk("Syscall stats enabled\n");
+}
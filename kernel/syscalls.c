@@ -112,7 +112,7 @@ int sys_newuname(struct utsname *user_buf)
 
 NORETURN int sys_exit(int exit_status)
 {
-   terminate_process(exit_status, 0 /* term_sig */);
+   terminate_thread(exit_status);
 
    /* Necessary to guarantee to the compiler that we won't return. */
    NOT_REACHED();
@@ -120,8 +120,10 @@ NORETURN int sys_exit(int exit_status)
 
 NORETURN int sys_exit_group(int status)
 {
-   // TODO: update when user threads are supported
-   sys_exit(status);
+   terminate_process(status, 0 /* term_sig */);
+
+   /* Necessary to guarantee to the compiler that we won't return. */
+   NOT_REACHED();
 }
 
 ulong sys_times(struct tms *user_buf)
@@ -161,6 +163,54 @@ int sys_vfork(void)
    return do_fork(true);
 }
 
+int sys_clone(ulong flags,
+              void *newsp,
+              int *parent_tid,
+              void *tls,
+              int *child_tid)
+{
+   return do_clone(flags, newsp, parent_tid, tls, child_tid);
+}
+
+int sys_clone3(struct k_clone_args *user_args, size_t size)
+{
+   struct k_clone_args args = {0};
+   void *newsp = NULL;
+
+   if (size < CLONE_ARGS_SIZE_VER0)
+      return -EINVAL;
+
+   if (copy_from_user(&args, user_args, MIN(size, sizeof(args))))
+      return -EFAULT;
+
+   if (args.flags & ~0xffffffffull)
+      return -EINVAL;
+
+   if (args.flags & CSIGNAL)
+      return -EINVAL;    /* the signal must be passed in `exit_signal` */
+
+   if (args.exit_signal & ~(u64)CSIGNAL)
+      return -EINVAL;
+
+   if (args.set_tid || args.set_tid_size || args.cgroup)
+      return -EINVAL;    /* not supported */
+
+   if (args.stack) {
+
+      if (!args.stack_size)
+         return -EINVAL;
+
+      /* Unlike clone(), clone3() takes the lowest address of the stack */
+      newsp = TO_PTR(args.stack + args.stack_size);
+   }
+
+   return do_clone((ulong)args.flags | (ulong)args.exit_signal,
+                   newsp,
+                   TO_PTR(args.parent_tid),
+                   TO_PTR(args.tls),
+                   TO_PTR(args.child_tid));
+}
+
 static int
 stop_all_user_tasks(void *task, void *unused)
 {
@@ -317,8 +367,3 @@ int sys_futimesat_time32(int dirfd, const char *u_path,
    // TODO (future): consider implementing sys_futimesat_time32() [obsolete]
    return -ENOSYS;
 }
-
-int sys_socketcall(int call, ulong *args)
-{
-   return -ENOSYS;
-}
@@ -1,10 +1,12 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/config_kernel.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
 #include <tilck/common/atomics.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/hal.h>
@@ -13,6 +15,11 @@
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/profiler.h>
+#include <tilck/kernel/perf.h>
+
+#include <tilck/mods/tracing.h>
 
 FASTCALL void asm_nop_loop(u32 iters);
 
@@ -24,6 +31,8 @@ u64 __time_ns;             /* nanoseconds since the timer started */
 u32 __tick_duration;       /* the real duration of a tick, ~TS_SCALE/TIMER_HZ */
 int __tick_adj_val;
 int __tick_adj_ticks_rem;
+u64 __tick_tsc;            /* TSC value read at the last tick */
+u32 __tsc_per_tick;        /* avg TSC cycles in a tick, 0 if not measured yet */
 
 /* Debug counters */
 u32 slow_timer_irq_handler_count;
@@ -37,6 +46,20 @@ static u32 loops_per_tick;         /* Tilck bogoMips as loops/tick    */
 static u32 loops_per_ms = 5000000; /* loops/millisecond (initial val)  */
 static u32 loops_per_us = 5000;    /* loops/microsecond (initial val) */
 
+/* Kernel timers (see timer.h) */
+static struct list ktimers_list = STATIC_LIST_INIT(ktimers_list);
+static struct list ktimers_exp_list = STATIC_LIST_INIT(ktimers_exp_list);
+static struct worker_thread *ktimers_wth;
+static bool ktimers_job_pending;
+
+static void perf_get_ticks(struct perf_obj *o, u64 *vals)
+{
+   vals[0] = __ticks;
+}
+
+DEF_PERF_COUNTER_FUNC(timer, ticks, perf_get_ticks);
+DEF_PERF_COUNTER(timer, slow_irq_handlers, slow_timer_irq_handler_count);
+
 u64 get_ticks(void)
 {
    u64 curr_ticks;
@@ -160,6 +183,7 @@ static void tick_all_timers(void)
 
          pos->timer_ready = true;
          list_remove(&pos->wakeup_timer_node);
+         trace_timer_wakeup(pos);
 
          if (pos->state == TASK_STATE_SLEEPING) {
             task_change_state(pos, TASK_STATE_RUNNABLE);
@@ -174,6 +198,264 @@ static void tick_all_timers(void)
       sched_set_need_resched();
 }
 
+void ktimer_init(struct ktimer *t, ktimer_func func)
+{
+   bzero(t, sizeof(*t));
+   list_node_init(&t->node);
+   list_node_init(&t->exp_node);
+   t->func = func;
+}
+
+/*
+ * Insert `t` in the sorted list of armed timers, after the timers expiring at
+ * the same tick. That's O(N) in the number of armed timers, but it happens
+ * only when a timer is armed or re-armed, while on a tick with no expirations,
+ * only the head of the list is checked.
+ */
+static void ktimer_insert(struct ktimer *t)
+{
+   struct ktimer *pos;
+   ASSERT(!are_interrupts_enabled());
+
+   list_for_each_ro(pos, &ktimers_list, node) {
+      if (pos->expire > t->expire) {
+         list_add_before(&pos->node, &t->node);
+         return;
+      }
+   }
+
+   list_add_tail(&ktimers_list, &t->node);
+}
+
+static void ktimer_stop_nolock(struct ktimer *t)
+{
+   ASSERT(!are_interrupts_enabled());
+
+   if (t->armed) {
+      list_remove(&t->node);
+      t->armed = false;
+   }
+
+   if (!list_node_is_empty(&t->exp_node)) {
+      list_remove(&t->exp_node);
+      list_node_init(&t->exp_node);
+   }
+
+   t->count = 0;
+}
+
+void ktimer_start(struct ktimer *t, u64 expire, u64 interval)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      ktimer_stop_nolock(t);
+      t->expire = expire;
+      t->interval = interval;
+      t->armed = true;
+      ktimer_insert(t);
+   }
+   enable_interrupts(&var);
+}
+
+void ktimer_stop(struct ktimer *t)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      ktimer_stop_nolock(t);
+   }
+   enable_interrupts(&var);
+}
+
+bool ktimer_get(struct ktimer *t, u64 *rem, u64 *interval)
+{
+   bool armed;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      armed = t->armed;
+      *interval = t->interval;
+
+      /* If the timer expires in this tick, say there's 1 tick left */
+      if (armed)
+         *rem = t->expire > __ticks ? t->expire - __ticks : 1;
+      else
+         *rem = 0;
+   }
+   enable_interrupts(&var);
+   return armed;
+}
+
+void ktimer_destroy(struct ktimer *t)
+{
+   DEBUG_ONLY(check_not_in_irq_handler());
+   ktimer_stop(t);
+
+   /*
+    * Once stopped, the timer cannot be queued again, but its `func` might be
+    * running right now in the worker thread: wait for it.
+    */
+   while (t->running)
+      wth_wait_for_completion(ktimers_wth);
+}
+
+static void ktimers_run_expired(void *unused)
+{
+   struct ktimer *t;
+   u64 count;
+   ulong var;
+
+   while (true) {
+
+      disable_interrupts(&var);
+
+      if (list_is_empty(&ktimers_exp_list)) {
+         ktimers_job_pending = false;
+         enable_interrupts(&var);
+         break;
+      }
+
+      t = list_first_obj(&ktimers_exp_list, struct ktimer, exp_node);
+      list_remove(&t->exp_node);
+      list_node_init(&t->exp_node);
+      count = t->count;
+      t->count = 0;
+      t->running = true;
+      enable_interrupts(&var);
+
+      t->func(t, count);
+
+      disable_interrupts(&var);
+      {
+         t->running = false;
+      }
+      enable_interrupts(&var);
+   }
+}
+
+static void tick_all_ktimers(void)
+{
+   struct ktimer *t;
+   ulong var;
+
+   disable_interrupts(&var);
+
+   while (!list_is_empty(&ktimers_list)) {
+
+      t = list_first_obj(&ktimers_list, struct ktimer, node);
+
+      if (t->expire > __ticks)
+         break;
+
+      list_remove(&t->node);
+
+      if (t->interval) {
+         t->expire += t->interval;
+         ktimer_insert(t);
+      } else {
+         t->armed = false;
+      }
+
+      if (!t->func)
+         continue;
+
+      t->count++;
+
+      if (list_node_is_empty(&t->exp_node))
+         list_add_tail(&ktimers_exp_list, &t->exp_node);
+   }
+
+   /*
+    * Run all the callbacks with a single job. If the enqueue fails, we'll
+    * just retry on the next tick.
+    */
+   if (!list_is_empty(&ktimers_exp_list) && !ktimers_job_pending && ktimers_wth)
+      ktimers_job_pending = wth_enqueue_on(ktimers_wth,
+                                           &ktimers_run_expired,
+                                           NULL);
+
+   enable_interrupts(&var);
+}
+
+static int
+ktimer_ts_to_ticks(int clk,
+                   bool abs_time,
+                   const struct k_timespec64 *ts,
+                   u64 *ticks)
+{
+   struct k_timespec64 now, rel = *ts;
+   int rc;
+
+   if (abs_time) {
+
+      if ((rc = do_clock_gettime(clk, &now)))
+         return rc;
+
+      rel.tv_sec -= now.tv_sec;
+      rel.tv_nsec -= now.tv_nsec;
+
+      if (rel.tv_nsec < 0) {
+         rel.tv_sec--;
+         rel.tv_nsec += BILLION;
+      }
+
+      if (rel.tv_sec < 0) {
+         *ticks = 0; /* Already expired: fire on the next tick */
+         return 0;
+      }
+   }
+
+   *ticks = timespec_to_ticks(&rel);
+   return 0;
+}
+
+static bool is_valid_timespec(const struct k_timespec64 *ts)
+{
+   return ts->tv_sec >= 0 && IN_RANGE(ts->tv_nsec, 0, BILLION);
+}
+
+int ktimer_settime(struct ktimer *t,
+                   int clk,
+                   bool abs_time,
+                   const struct k_itimerspec64 *val,
+                   struct k_itimerspec64 *old)
+{
+   u64 ticks, interval;
+   int rc;
+
+   if (!is_valid_timespec(&val->it_value))
+      return -EINVAL;
+
+   if (!is_valid_timespec(&val->it_interval))
+      return -EINVAL;
+
+   if (old)
+      ktimer_gettime(t, old);
+
+   if (!val->it_value.tv_sec && !val->it_value.tv_nsec) {
+      ktimer_stop(t);
+      return 0;
+   }
+
+   if ((rc = ktimer_ts_to_ticks(clk, abs_time, &val->it_value, &ticks)))
+      return rc;
+
+   interval = timespec_to_ticks(&val->it_interval);
+   ktimer_start(t, get_ticks() + ticks, interval);
+   return 0;
+}
+
+void ktimer_gettime(struct ktimer *t, struct k_itimerspec64 *val)
+{
+   u64 rem, interval;
+
+   ktimer_get(t, &rem, &interval);
+   ticks_to_timespec(rem, &val->it_value);
+   ticks_to_timespec(interval, &val->it_interval);
+}
+
 static void do_sleep_internal(u32 ticks)
 {
    ASSERT(are_interrupts_enabled());
@@ -294,6 +576,32 @@ static ALWAYS_INLINE bool timer_nested_irq(void)
    return res;
 }
 
+/*
+ * Keep a running average of the TSC cycles per tick, used by get_sys_time_hr()
+ * to interpolate the time between two ticks. Samples far off the average (e.g.
+ * because of lost ticks) are discarded.
+ */
+static ALWAYS_INLINE void update_tsc_per_tick(void)
+{
+   u64 now, delta;
+
+   if (!x86_cpu_features.edx1.tsc)
+      return;
+
+   now = RDTSC();
+   delta = now - __tick_tsc;
+
+   if (__tick_tsc && delta <= UINT32_MAX) {
+
+      if (!__tsc_per_tick)
+         __tsc_per_tick = (u32)delta;
+      else if (delta < 2 * (u64)__tsc_per_tick)
+         __tsc_per_tick = (u32)(((u64)__tsc_per_tick * 7 + delta) / 8);
+   }
+
+   __tick_tsc = now;
+}
+
 static enum irq_action timer_irq_handler(void *ctx)
 {
    u32 ns_delta;
@@ -331,11 +639,16 @@ static enum irq_action timer_irq_handler(void *ctx)
        */
       __ticks++;
       __time_ns += ns_delta;
+      update_tsc_per_tick();
    }
    enable_interrupts_forced();
 
+   if (UNLIKELY(__prof_period))
+      prof_timer_tick();
+
    sched_account_ticks();
    tick_all_timers();
+   tick_all_ktimers();
    return IRQ_HANDLED;
 }
 
@@ -433,6 +746,15 @@ void init_timer(void)
    if (!wth_enqueue_anywhere(WTH_PRIO_HIGHEST, &do_bogomips_loop, &ctx))
       panic("Timer: unable to enqueue job in wth 0");
 
+   disable_preemption();
+   {
+      ktimers_wth = wth_create_thread("ktimers", 1, WTH_KTIMERS_QUEUE_SIZE);
+   }
+   enable_preemption();
+
+   if (!ktimers_wth)
+      panic("Timer: unable to create the ktimers worker thread");
+
    irq_install_handler(X86_PC_TIMER_IRQ, &measure_bogomips);
    irq_install_handler(X86_PC_TIMER_IRQ, &timer);
 }
@@ -0,0 +1,309 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/syscalls.h>
+
+/*
+ * timerfd: a kernel timer with the file interface. Reading it returns the
+ * number of expirations since the last read, as a u64.
+ */
+
+#define TIMERFD_CREATE_FLAGS               (TFD_CLOEXEC | TFD_NONBLOCK)
+#define TIMERFD_SET_FLAGS  (TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET)
+
+struct timerfd {
+
+   KOBJ_BASE_FIELDS
+
+   struct ktimer timer;
+   int clk;
+   u64 expirations;                   /* since the last read */
+   struct kmutex mutex;
+   struct kcond rcond;                /* expirations > 0 */
+};
+
+static const struct file_ops static_ops_timerfd;
+
+static ssize_t timerfd_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *t = (void *)kh->kobj;
+   ssize_t rc = sizeof(u64);
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   kmutex_lock(&t->mutex);
+
+   while (!t->expirations) {
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         goto out;
+      }
+
+      kcond_wait(&t->rcond, &t->mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         goto out;
+      }
+   }
+
+   memcpy(buf, &t->expirations, sizeof(u64));
+   t->expirations = 0;
+
+out:
+   kmutex_unlock(&t->mutex);
+   return rc;
+}
+
+static int timerfd_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *t = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&t->mutex);
+   {
+      ret = t->expirations > 0;
+   }
+   kmutex_unlock(&t->mutex);
+   return ret;
+}
+
+static struct kcond *timerfd_get_rready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *t = (void *)kh->kobj;
+   return &t->rcond;
+}
+
+static const struct file_ops static_ops_timerfd =
+{
+   .read = timerfd_read,
+   .read_ready = timerfd_read_ready,
+   .get_rready_cond = timerfd_get_rready_cond,
+};
+
+/* Called by the ktimers worker thread */
+static void timerfd_on_expire(struct ktimer *timer, u64 expirations)
+{
+   struct timerfd *t = CONTAINER_OF(timer, struct timerfd, timer);
+
+   kmutex_lock(&t->mutex);
+   {
+      t->expirations += expirations;
+      kcond_signal_all(&t->rcond);
+   }
+   kmutex_unlock(&t->mutex);
+}
+
+static void destroy_timerfd(struct timerfd *t)
+{
+   ktimer_destroy(&t->timer);
+   kcond_destory(&t->rcond);
+   kmutex_destroy(&t->mutex);
+   kfree_obj(t, struct timerfd);
+}
+
+static struct timerfd *create_timerfd(int clk)
+{
+   struct timerfd *t;
+
+   if (!(t = (void *)kzalloc_obj(struct timerfd)))
+      return NULL;
+
+   t->destory_obj = (void *)&destroy_timerfd;
+   t->clk = clk;
+   ktimer_init(&t->timer, &timerfd_on_expire);
+   kmutex_init(&t->mutex, 0);
+   kcond_init(&t->rcond);
+   return t;
+}
+
+static struct timerfd *get_timerfd(int fd, int *rc)
+{
+   struct kfs_handle *kh;
+
+   if (!(kh = get_fs_handle(fd))) {
+      *rc = -EBADF;
+      return NULL;
+   }
+
+   if (kh->fops != &static_ops_timerfd) {
+      *rc = -EINVAL;
+      return NULL;
+   }
+
+   return (void *)kh->kobj;
+}
+
+int sys_timerfd_create(int clk, int flags)
+{
+   struct timerfd *t;
+   fs_handle h;
+   int fd;
+
+   if (clk != CLOCK_REALTIME && clk != CLOCK_MONOTONIC && clk != CLOCK_BOOTTIME)
+      return -EINVAL;
+
+   if (flags & ~TIMERFD_CREATE_FLAGS)
+      return -EINVAL;
+
+   if (!(t = create_timerfd(clk)))
+      return -ENOMEM;
+
+   h = kfs_create_new_handle(&static_ops_timerfd,
+                             (void *)t,
+                             O_RDONLY | (flags & TFD_NONBLOCK));
+
+   if (!h) {
+      destroy_timerfd(t);
+      return -ENOMEM;
+   }
+
+   fd = install_fs_handle(h, flags & TFD_CLOEXEC ? FD_CLOEXEC : 0);
+
+   if (fd < 0)
+      vfs_close(h); /* Destroys also the timerfd object */
+
+   return fd;
+}
+
+static int
+do_timerfd_settime(int fd,
+                   int flags,
+                   const struct k_itimerspec64 *val,
+                   struct k_itimerspec64 *old)
+{
+   struct timerfd *t;
+   int rc;
+
+   if (flags & ~TIMERFD_SET_FLAGS)
+      return -EINVAL;
+
+   if (!(t = get_timerfd(fd, &rc)))
+      return rc;
+
+   /*
+    * Tilck's clocks cannot be set, so TFD_TIMER_CANCEL_ON_SET is accepted but
+    * the timer is never canceled.
+    */
+
+   kmutex_lock(&t->mutex);
+   {
+      rc = ktimer_settime(&t->timer,
+                          t->clk,
+                          !!(flags & TFD_TIMER_ABSTIME),
+                          val,
+                          old);
+
+      if (!rc)
+         t->expirations = 0;
+   }
+   kmutex_unlock(&t->mutex);
+   return rc;
+}
+
+static int do_timerfd_gettime(int fd, struct k_itimerspec64 *val)
+{
+   struct timerfd *t;
+   int rc;
+
+   if (!(t = get_timerfd(fd, &rc)))
+      return rc;
+
+   ktimer_gettime(&t->timer, val);
+   return 0;
+}
+
+int sys_timerfd_settime(int fd,
+                        int flags,
+                        const struct k_itimerspec64 *u_val,
+                        struct k_itimerspec64 *u_old)
+{
+   struct k_itimerspec64 val, old;
+   int rc;
+
+   if (copy_from_user(&val, u_val, sizeof(val)))
+      return -EFAULT;
+
+   if ((rc = do_timerfd_settime(fd, flags, &val, &old)))
+      return rc;
+
+   if (u_old && copy_to_user(u_old, &old, sizeof(old)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_gettime(int fd, struct k_itimerspec64 *u_val)
+{
+   struct k_itimerspec64 val;
+   int rc;
+
+   if ((rc = do_timerfd_gettime(fd, &val)))
+      return rc;
+
+   if (copy_to_user(u_val, &val, sizeof(val)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_settime32(int fd,
+                          int flags,
+                          const struct k_itimerspec32 *u_val,
+                          struct k_itimerspec32 *u_old)
+{
+   struct k_itimerspec64 val, old;
+   struct k_itimerspec32 val32;
+   int rc;
+
+   if (copy_from_user(&val32, u_val, sizeof(val32)))
+      return -EFAULT;
+
+   itimerspec32_to_64(&val32, &val);
+
+   if ((rc = do_timerfd_settime(fd, flags, &val, &old)))
+      return rc;
+
+   if (u_old) {
+
+      itimerspec64_to_32(&old, &val32);
+
+      if (copy_to_user(u_old, &val32, sizeof(val32)))
+         return -EFAULT;
+   }
+
+   return 0;
+}
+
+int sys_timerfd_gettime32(int fd, struct k_itimerspec32 *u_val)
+{
+   struct k_itimerspec64 val;
+   struct k_itimerspec32 val32;
+   int rc;
+
+   if ((rc = do_timerfd_gettime(fd, &val)))
+      return rc;
+
+   itimerspec64_to_32(&val, &val32);
+
+   if (copy_to_user(u_val, &val32, sizeof(val32)))
+      return -EFAULT;
+
+   return 0;
+}
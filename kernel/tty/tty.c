@@ -372,6 +372,11 @@ ssize_t tty_curr_proc_write(const char *buf, size_t size)
    return tty_write_int(get_curr_process_tty(), NULL, buf, size);
 }
 
+ssize_t tty_write_on(struct tty *t, const char *buf, size_t size)
+{
+   return tty_write_int(t, NULL, buf, size);
+}
+
 void tty_write_on_all_ttys(const char *buf, size_t size)
 {
    for (u32 i = 0; i < ARRAY_SIZE(ttys); i++) {
@@ -154,16 +154,22 @@ void wake_up_tasks_waiting_on(struct task *ti, enum wakeup_reason r)
          wake_up(task_to_wake_up);
    }
 
-   if (LIKELY(pi->parent_pid > 0)) {
+   /* The parent process is interested only in the state of its children */
+   if (LIKELY(pi->parent_pid > 0) && is_main_thread(ti)) {
 
       struct task *parent_task = get_task(pi->parent_pid);
+      struct task *pos;
       int tid;
 
-      if (is_waiting_on_multiple_children(parent_task, &tid)      &&
-          !waitpid_should_skip_child(parent_task, ti, tid)        &&
-          is_good_reason_to_wake_up_task(&parent_task->wobj, r))
-      {
-         wake_up(parent_task);
+      /* Any thread of the parent process might be in waitpid(-1) */
+      list_for_each_ro(pos, &parent_task->pi->threads, threads_node) {
+
+         if (is_waiting_on_multiple_children(pos, &tid)           &&
+             !waitpid_should_skip_child(pos, ti, tid)             &&
+             is_good_reason_to_wake_up_task(&pos->wobj, r))
+         {
+            wake_up(pos);
+         }
       }
 
       send_signal(pi->parent_pid, SIGCHLD, true);
@@ -204,7 +210,10 @@ int sys_wait4(int tid, int *user_wstatus, int options, void *user_rusage)
 
          struct task *waited_task = get_task(tid);
 
-         if (!waited_task || !task_is_parent(curr, waited_task)) {
+         if (!waited_task                        ||
+             !is_main_thread(waited_task)        ||
+             !task_is_parent(curr, waited_task))
+         {
             enable_preemption();
             return -ECHILD;
          }
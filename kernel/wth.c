@@ -2,6 +2,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/atomics.h>
+#include <tilck/common/printk.h>
 
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/kmalloc.h>
@@ -14,6 +15,8 @@
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/sort.h>
 
+#include <tilck/mods/tracing.h>
+
 #include "wth_int.h"
 
 STATIC int worker_threads_cnt;
@@ -144,8 +147,12 @@ bool wth_process_single_job(struct worker_thread *t)
    success = safe_ringbuf_read_elem(&t->rb, &job_to_run);
 
    if (success) {
+      trace_wth_job_start(job_to_run.func, job_to_run.arg);
+
       /* Run the job with preemption enabled */
       job_to_run.func(job_to_run.arg);
+
+      trace_wth_job_end(job_to_run.func, job_to_run.arg);
    }
 
    return success;
@@ -203,6 +210,31 @@ struct task *wth_get_runnable_thread(void)
    return selected ? selected->task : NULL;
 }
 
+static void
+wth_perf_get_pending(struct perf_obj *o, u64 *vals)
+{
+   struct worker_thread *t = CONTAINER_OF(o, struct worker_thread, perf);
+   vals[0] = safe_ringbuf_get_elems(&t->rb);
+}
+
+static void
+wth_register_perf_obj(struct worker_thread *t)
+{
+   snprintk(t->perf_name, sizeof(t->perf_name), "%s_pending",
+            t->name ? t->name : "generic");
+
+   t->perf = (struct perf_obj) {
+      .group = "wth",
+      .name = t->perf_name,
+      .type = perf_gauge,
+      .count = 1,
+      .get = &wth_perf_get_pending,
+   };
+
+   /* Just stats: on a name clash, the thread won't have its gauge */
+   perf_register(&t->perf);
+}
+
 struct worker_thread *
 wth_create_thread(const char *name, int priority, u16 queue_size)
 {
@@ -251,6 +283,7 @@ wth_create_thread(const char *name, int priority, u16 queue_size)
 
    /* Sort all the worker threads */
    insertion_sort_ptr(worker_threads, (u32)worker_threads_cnt, &wth_cmp_func);
+   wth_register_perf_obj(t);
    return t;
 }
 
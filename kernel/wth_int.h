@@ -3,6 +3,7 @@
 #pragma once
 #include <tilck/kernel/safe_ringbuf.h>
 #include <tilck/kernel/sync.h>
+#include <tilck/kernel/perf.h>
 
 struct wjob {
    void (*func)(void *);
@@ -18,6 +19,9 @@ struct worker_thread {
    struct kcond completion;
    int priority;              /* 0 is the max priority */
    volatile bool waiting_for_jobs;
+
+   struct perf_obj perf;      /* gauge: the number of pending jobs */
+   char perf_name[24];
 };
 
 extern struct worker_thread *worker_threads[WTH_MAX_THREADS];
@@ -4,6 +4,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
 #include <tilck/common/syscalls.h>
 
 #include <tilck/kernel/modules.h>
@@ -132,15 +133,29 @@ static void redraw_screen(void)
 {
    struct dp_screen *pos;
    char buf[64];
-   int rc;
+   int rc, col = 0;
 
    dp_clear();
    dp_move_cursor(dp_start_row + 1, dp_start_col + 2);
 
    list_for_each_ro(pos, &dp_screens_list, node) {
+
+      /* "N[label] " */
+      rc = (int)strlen(pos->label) + 4;
+
+      if (col + rc > DP_W - 4) {
+         /* Wrap the headers on the empty row before the screen's start */
+         dp_move_cursor(dp_start_row + 2, dp_start_col + 2);
+         col = 0;
+      }
+
       dp_write_header(pos->index+1, pos->label, pos == dp_ctx);
+      col += rc;
    }
 
+   if (col + 8 > DP_W - 4)
+      dp_move_cursor(dp_start_row + 2, dp_start_col + 2);
+
    dp_write_raw("q[Quit]" RESET_ATTRS " ");
    dp_ctx->draw_func();
 
@@ -0,0 +1,230 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/sort.h>
+#include <tilck/kernel/lock_stats.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+static struct lock_class *locks_arr;
+static u32 locks_count;
+static char locks_order_by;
+
+static long cmp_u64_desc(u64 x, u64 y)
+{
+   return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+static long dp_locks_cmpf_wait(const void *a, const void *b)
+{
+   const struct lock_class *x = a;
+   const struct lock_class *y = b;
+   return cmp_u64_desc(x->wait_cycles, y->wait_cycles);
+}
+
+static long dp_locks_cmpf_cont(const void *a, const void *b)
+{
+   const struct lock_class *x = a;
+   const struct lock_class *y = b;
+   return cmp_u64_desc(x->contentions, y->contentions);
+}
+
+static long dp_locks_cmpf_acq(const void *a, const void *b)
+{
+   const struct lock_class *x = a;
+   const struct lock_class *y = b;
+   return cmp_u64_desc(x->acquisitions, y->acquisitions);
+}
+
+static long dp_locks_cmpf_hold(const void *a, const void *b)
+{
+   const struct lock_class *x = a;
+   const struct lock_class *y = b;
+   return cmp_u64_desc(x->hold_cycles, y->hold_cycles);
+}
+
+static void dp_locks_sort(char order_by)
+{
+   cmpfun_ptr cmpf;
+
+   switch (order_by) {
+
+      case 'c':
+         cmpf = dp_locks_cmpf_cont;
+         break;
+
+      case 'a':
+         cmpf = dp_locks_cmpf_acq;
+         break;
+
+      case 'h':
+         cmpf = dp_locks_cmpf_hold;
+         break;
+
+      default:
+         cmpf = dp_locks_cmpf_wait;
+         order_by = 'w';
+   }
+
+   insertion_sort_generic(locks_arr, sizeof(locks_arr[0]), locks_count, cmpf);
+   locks_order_by = order_by;
+}
+
+static void dp_locks_load_stats(void)
+{
+   u32 n = lock_stats_get_classes(locks_arr, LOCK_STATS_MAX_CLASSES);
+   locks_count = 0;
+
+   /* Compact the array, skipping the classes never acquired */
+   for (u32 i = 0; i < n; i++) {
+      if (locks_arr[i].acquisitions)
+         locks_arr[locks_count++] = locks_arr[i];
+   }
+
+   dp_locks_sort(locks_order_by);
+}
+
+static void dp_locks_enter(void)
+{
+   if (!KRN_LOCK_STATS)
+      return;
+
+   if (!locks_arr) {
+
+      locks_arr = kzalloc_array_obj(struct lock_class, LOCK_STATS_MAX_CLASSES);
+
+      if (!locks_arr)
+         panic("Unable to alloc memory for locks_arr");
+   }
+
+   dp_locks_load_stats();
+}
+
+static int dp_locks_keypress(struct key_event ke)
+{
+   const char c = ke.print_char;
+
+   if (!KRN_LOCK_STATS)
+      return kb_handler_nak;
+
+   switch (c) {
+
+      case 'w':
+      case 'c':
+      case 'a':
+      case 'h':
+         dp_locks_sort(c);
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'r':
+         lock_stats_reset();
+         dp_locks_load_stats();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'u':
+         dp_locks_load_stats();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      default:
+         return kb_handler_nak;
+   }
+}
+
+static const char *
+dp_locks_hl(char order_by)
+{
+   return locks_order_by == order_by ? E_COLOR_BR_WHITE REVERSE_VIDEO : "";
+}
+
+static void dp_show_locks(void)
+{
+   int row = dp_screen_start_row;
+   char name[32];
+
+   if (!KRN_LOCK_STATS) {
+      dp_writeln("Not available: recompile with KRN_LOCK_STATS=1");
+      return;
+   }
+
+   dp_writeln("Lock classes acquired: %u (times in Kcycles)", locks_count);
+   dp_writeln(
+      "Order by: "
+      E_COLOR_BR_WHITE "w" RESET_ATTRS "ait time, "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS "ontentions, "
+      E_COLOR_BR_WHITE "a" RESET_ATTRS "cquisitions, "
+      E_COLOR_BR_WHITE "h" RESET_ATTRS "old time. "
+      E_COLOR_BR_WHITE "u" RESET_ATTRS "pdate, "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "eset"
+   );
+
+   dp_writeln("");
+
+   dp_writeln(
+                 "     Lock      "     RESET_ATTRS
+      TERM_VLINE "  Type  "            RESET_ATTRS
+      TERM_VLINE "%s" "   Acq   "     RESET_ATTRS
+      TERM_VLINE "%s" "  Cont  "      RESET_ATTRS
+      TERM_VLINE "%s" "   Wait   "    RESET_ATTRS
+      TERM_VLINE " Max wait"           RESET_ATTRS
+      TERM_VLINE "%s" "  Hold  "      RESET_ATTRS,
+      dp_locks_hl('a'),
+      dp_locks_hl('c'),
+      dp_locks_hl('w'),
+      dp_locks_hl('h')
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqnqqqqqqqqnqqqqqqqqq"
+      "nqqqqqqqqnqqqqqqqqqqnqqqqqqqqqnqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (u32 i = 0; i < locks_count; i++) {
+
+      struct lock_class *c = &locks_arr[i];
+      lock_stats_get_class_name(c, name, sizeof(name));
+
+      dp_writeln("%-14.14s "
+                 TERM_VLINE " %-6.6s "
+                 TERM_VLINE " %7u "
+                 TERM_VLINE " %6u "
+                 TERM_VLINE " %8llu "
+                 TERM_VLINE " %7llu "
+                 TERM_VLINE " %7llu",
+                 name,
+                 lock_stats_get_type_str(c->type),
+                 c->acquisitions,
+                 c->contentions,
+                 c->wait_cycles / 1000,
+                 c->max_wait_cycles / 1000,
+                 c->hold_cycles / 1000);
+   }
+
+   dp_writeln("");
+}
+
+static struct dp_screen dp_locks_screen =
+{
+   .index = 7,
+   .label = "Locks",
+   .draw_func = dp_show_locks,
+   .on_dp_enter = dp_locks_enter,
+   .on_keypress_func = dp_locks_keypress,
+};
+
+__attribute__((constructor))
+static void dp_locks_init(void)
+{
+   dp_register_screen(&dp_locks_screen);
+}
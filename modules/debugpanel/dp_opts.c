@@ -101,6 +101,8 @@ static void dp_show_opts(void)
    DUMP_BOOL_OPT(FORK_NO_COW);
    DUMP_BOOL_OPT(MMAP_NO_COW);
    DUMP_BOOL_OPT(PANIC_SHOW_REGS);
+   DUMP_BOOL_OPT(KRN_LOCK_STATS);
+   DUMP_BOOL_OPT(KRN_LAT_TRACER);
    DUMP_BOOL_OPT(KMALLOC_HEAVY_STATS);
    DUMP_BOOL_OPT(KMALLOC_FREE_MEM_POISONING);
    DUMP_BOOL_OPT(KMALLOC_SUPPORT_DEBUG_LOG);
@@ -0,0 +1,222 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/sort.h>
+#include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/sys_stats.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+struct sys_info {
+
+   u32 sn;
+   u32 calls;
+   u32 errors;
+   u64 tot_cycles;
+   u64 max_cycles;
+};
+
+static struct sys_info *sys_arr;
+static u32 sys_count;
+static char sys_order_by;
+
+static long cmp_u64_desc(u64 x, u64 y)
+{
+   return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+static long dp_sys_cmpf_tot(const void *a, const void *b)
+{
+   const struct sys_info *x = a;
+   const struct sys_info *y = b;
+   return cmp_u64_desc(x->tot_cycles, y->tot_cycles);
+}
+
+static long dp_sys_cmpf_calls(const void *a, const void *b)
+{
+   const struct sys_info *x = a;
+   const struct sys_info *y = b;
+   return cmp_u64_desc(x->calls, y->calls);
+}
+
+static long dp_sys_cmpf_max(const void *a, const void *b)
+{
+   const struct sys_info *x = a;
+   const struct sys_info *y = b;
+   return cmp_u64_desc(x->max_cycles, y->max_cycles);
+}
+
+static void dp_sys_sort(char order_by)
+{
+   cmpfun_ptr cmpf;
+
+   switch (order_by) {
+
+      case 'c':
+         cmpf = dp_sys_cmpf_calls;
+         break;
+
+      case 'm':
+         cmpf = dp_sys_cmpf_max;
+         break;
+
+      default:
+         cmpf = dp_sys_cmpf_tot;
+         order_by = 't';
+   }
+
+   insertion_sort_generic(sys_arr, sizeof(sys_arr[0]), sys_count, cmpf);
+   sys_order_by = order_by;
+}
+
+static void dp_sys_load_stats(void)
+{
+   struct syscall_stats s;
+   sys_count = 0;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+
+      sys_stats_get(i, &s);
+
+      if (!s.calls)
+         continue;
+
+      sys_arr[sys_count++] = (struct sys_info) {
+         .sn = i,
+         .calls = s.calls,
+         .errors = s.errors,
+         .tot_cycles = s.tot_cycles,
+         .max_cycles = s.max_cycles,
+      };
+   }
+
+   dp_sys_sort(sys_order_by);
+}
+
+static void dp_sys_enter(void)
+{
+   if (!sys_stats)
+      return;
+
+   if (!sys_arr) {
+      if (!(sys_arr = kzalloc_array_obj(struct sys_info, MAX_SYSCALLS)))
+         panic("Unable to alloc memory for sys_arr");
+   }
+
+   dp_sys_load_stats();
+}
+
+static int dp_sys_keypress(struct key_event ke)
+{
+   const char c = ke.print_char;
+
+   if (!sys_stats)
+      return kb_handler_nak;
+
+   switch (c) {
+
+      case 't':
+      case 'c':
+      case 'm':
+         dp_sys_sort(c);
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'r':
+         sys_stats_reset();
+         dp_sys_load_stats();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'u':
+         dp_sys_load_stats();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      default:
+         return kb_handler_nak;
+   }
+}
+
+static void dp_show_syscalls(void)
+{
+   int row = dp_screen_start_row;
+   const char *name;
+
+   if (!sys_stats) {
+      dp_writeln("Not available: boot the kernel with -sys_stats");
+      return;
+   }
+
+   dp_writeln("Syscalls called: %u", sys_count);
+   dp_writeln(
+      "Order by: "
+      E_COLOR_BR_WHITE "t" RESET_ATTRS "otal time, "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS "alls, "
+      E_COLOR_BR_WHITE "m" RESET_ATTRS "ax time. "
+      E_COLOR_BR_WHITE "u" RESET_ATTRS "pdate, "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "eset"
+   );
+
+   dp_writeln("");
+
+   dp_writeln(
+                 "      Syscall     "   RESET_ATTRS
+      TERM_VLINE "%s" "  Calls  "       RESET_ATTRS
+      TERM_VLINE " Errors "             RESET_ATTRS
+      TERM_VLINE "%s" " Tot (Kcyc) "    RESET_ATTRS
+      TERM_VLINE " Avg (cyc) "          RESET_ATTRS
+      TERM_VLINE "%s" " Max (Kcyc)"     RESET_ATTRS,
+      sys_order_by == 'c' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      sys_order_by == 't' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      sys_order_by == 'm' ? E_COLOR_BR_WHITE REVERSE_VIDEO : ""
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqqqnqqqqqqqqqnqqqqqqqqn"
+      "qqqqqqqqqqqqnqqqqqqqqqqqnqqqqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (u32 i = 0; i < sys_count; i++) {
+
+      const struct sys_info *s = &sys_arr[i];
+      name = sys_stats_get_name(s->sn);
+
+      dp_writeln("%-17.17s "
+                 TERM_VLINE " %7u "
+                 TERM_VLINE " %6u "
+                 TERM_VLINE " %10llu "
+                 TERM_VLINE " %9llu "
+                 TERM_VLINE " %9llu",
+                 name ? name : "?",
+                 s->calls,
+                 s->errors,
+                 s->tot_cycles / 1000,
+                 s->tot_cycles / s->calls,
+                 s->max_cycles / 1000);
+   }
+
+   dp_writeln("");
+}
+
+static struct dp_screen dp_syscalls_screen =
+{
+   .index = 6,
+   .label = "Syscalls",
+   .draw_func = dp_show_syscalls,
+   .on_dp_enter = dp_sys_enter,
+   .on_keypress_func = dp_sys_keypress,
+};
+
+__attribute__((constructor))
+static void dp_syscalls_init(void)
+{
+   dp_register_screen(&dp_syscalls_screen);
+}
@@ -6,10 +6,12 @@
 #include <tilck/common/printk.h>
 
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/timer.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/elf_utils.h>
 
 #include <tilck/mods/tracing.h>
 
@@ -138,7 +140,8 @@ tracing_ui_msg(void)
       TERM_VLINE " #Sys traced: " E_COLOR_BR_BLUE "%d" RESET_ATTRS " "
       TERM_VLINE " #Tasks traced: " E_COLOR_BR_BLUE "%d" RESET_ATTRS " "
       TERM_VLINE "\r\n"
-      TERM_VLINE " Printk lvl: " E_COLOR_BR_BLUE "%d" RESET_ATTRS
+      TERM_VLINE " Printk lvl: " E_COLOR_BR_BLUE "%d" RESET_ATTRS " "
+      TERM_VLINE " #Dropped events: " E_COLOR_BR_BLUE "%u" RESET_ATTRS
       "\r\n",
 
       tracing_is_force_exp_block_enabled()
@@ -151,7 +154,8 @@ tracing_ui_msg(void)
 
       get_traced_syscalls_count(),
       get_traced_tasks_count(),
-      tracing_get_printk_lvl()
+      tracing_get_printk_lvl(),
+      tracing_get_dropped_events_count()
    );
 
    get_traced_syscalls_str(line_buf, TRACED_SYSCALLS_STR_LEN);
@@ -166,6 +170,23 @@ tracing_ui_msg(void)
    dp_write_raw(E_COLOR_YELLOW "> " RESET_ATTRS);
 }
 
+static void
+dp_dump_wth_job_event(struct trace_event *e)
+{
+   const char *func;
+   long off;
+   u32 sym_size;
+
+   func = find_sym_at_addr(e->sched_ev.func, &off, &sym_size);
+
+   dp_write_raw(
+      E_COLOR_BR_BLUE "JOB %s" RESET_ATTRS ": %s(%p)\r\n",
+      e->type == te_wth_job_start ? "START" : "END",
+      func ? func : "???",
+      TO_PTR(e->sched_ev.arg)
+   );
+}
+
 static void
 dp_dump_tracing_event(struct trace_event *e)
 {
@@ -206,6 +227,30 @@ dp_dump_tracing_event(struct trace_event *e)
          );
          break;
 
+      case te_sched_switch:
+         dp_write_raw(
+            E_COLOR_BR_BLUE "SWITCH" RESET_ATTRS " (%s) -> [%05d]\r\n",
+            task_state_str[e->sched_ev.state],
+            e->sched_ev.other_tid
+         );
+         break;
+
+      case te_sched_wakeup:
+         dp_write_raw(
+            E_COLOR_BR_BLUE "WAKEUP" RESET_ATTRS " by [%05d]\r\n",
+            e->sched_ev.other_tid
+         );
+         break;
+
+      case te_timer_wakeup:
+         dp_write_raw(E_COLOR_BR_BLUE "TIMER EXPIRED" RESET_ATTRS "\r\n");
+         break;
+
+      case te_wth_job_start:
+      case te_wth_job_end:
+         dp_dump_wth_job_event(e);
+         break;
+
       default:
          dp_write_raw(
             E_COLOR_BR_RED "<unknown event %d>\r\n" RESET_ATTRS,
@@ -241,7 +286,7 @@ dp_tracing_screen_main_loop(void)
          }
       }
 
-      if (read_trace_event(&e, TIMER_HZ / 10))
+      if (read_trace_event(&e, ms_to_ticks(TRACE_READ_TIMEOUT_MS)))
          dp_dump_tracing_event(&e);
    }
 
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/boot_prof.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/boot_prof/steps: the boot profile (see boot_prof.h), one line per
+ * step, in the order the steps began, in the format:
+ *
+ *    <depth> <start cycles> <cycles> <start us> <us> <name>
+ *
+ * The start times are relative to the entry of kmain(). The file is empty
+ * until the boot is done.
+ */
+
+#define STEP_LINE_MAX                                   128
+
+static offt
+steps_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return BOOT_PROF_MAX_STEPS * STEP_LINE_MAX;
+}
+
+static offt
+steps_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct boot_prof_step *steps, *s;
+   char *p = buf;
+   size_t rem = (size_t)buf_sz;
+   u32 n;
+   int rc;
+
+   ASSERT(off == 0);
+   steps = kalloc_array_obj(struct boot_prof_step, BOOT_PROF_MAX_STEPS);
+
+   if (!steps)
+      return -ENOMEM;
+
+   n = boot_prof_get_steps(steps, BOOT_PROF_MAX_STEPS);
+
+   for (u32 i = 0; i < n; i++) {
+
+      s = &steps[i];
+      rc = snprintk(p, rem, "%u %llu %llu %llu %llu %s\n",
+                    s->depth, s->start, s->cycles,
+                    boot_prof_cycles_to_us(s->start),
+                    boot_prof_cycles_to_us(s->cycles),
+                    s->name);
+
+      p += rc;
+      rem -= (size_t)rc;
+   }
+
+   kfree_array_obj(steps, struct boot_prof_step, BOOT_PROF_MAX_STEPS);
+   return (offt)(p - (char *)buf);
+}
+
+static const struct sysobj_prop_type boot_prof_ptype_steps = {
+   .get_buf_sz = &steps_get_buf_sz,
+   .load = &steps_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(steps, &boot_prof_ptype_steps);
+
+void sysfs_create_boot_prof_obj(void)
+{
+   struct sysobj *obj;
+
+   obj = sysfs_create_custom_obj(
+      "boot_prof",
+      NULL,       /* hooks */
+      &prop_steps, NULL,
+      NULL
+   );
+
+   if (!obj)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "boot_prof", obj))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs boot_prof obj");
+}
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lat_tracer.h>
+#include <tilck/kernel/sort.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/lat_tracer: the results of the IRQs-off and preemption-off latency
+ * tracer (see lat_tracer.h).
+ *
+ *    irqsoff, preemptoff: the stats of the sections of each kind, as:
+ *       sections <count>
+ *       tot_cycles <cycles>
+ *       <max cycles> <start site> <end site>    (one line per worst section)
+ *
+ *    reset: writing anything here resets the stats of both kinds
+ *
+ * The worst sections are sorted by their max duration, in descending order.
+ * Everything is zero when the kernel has been built with KRN_LAT_TRACER=0.
+ */
+
+#define SITE_NAME_MAX                                   64
+#define STATS_LINE_MAX                (24 + 2 * SITE_NAME_MAX)
+
+static long cmp_section_desc(const void *a, const void *b)
+{
+   const struct lat_section *x = a;
+   const struct lat_section *y = b;
+
+   if (x->max_cycles == y->max_cycles)
+      return 0;
+
+   return x->max_cycles < y->max_cycles ? 1 : -1;
+}
+
+static offt
+lat_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return (LAT_TRACER_TOP + 2) * STATS_LINE_MAX;
+}
+
+static offt
+lat_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct lat_tracer_stats s;
+   char start[SITE_NAME_MAX], end[SITE_NAME_MAX];
+   char *p = buf;
+   size_t rem = (size_t)buf_sz;
+   int rc;
+
+   ASSERT(off == 0);
+   lat_tracer_get_stats((enum lat_kind)(ulong)data, &s);
+
+   insertion_sort_generic(s.top, sizeof(s.top[0]), s.top_count,
+                          cmp_section_desc);
+
+   rc = snprintk(p, rem, "sections %llu\ntot_cycles %llu\n",
+                 s.sections, s.tot_cycles);
+   p += rc;
+   rem -= (size_t)rc;
+
+   for (u32 i = 0; i < s.top_count; i++) {
+
+      lat_tracer_get_site_name(s.top[i].start_site, start, sizeof(start));
+      lat_tracer_get_site_name(s.top[i].end_site, end, sizeof(end));
+
+      rc = snprintk(p, rem, "%llu %s %s\n", s.top[i].max_cycles, start, end);
+      p += rc;
+      rem -= (size_t)rc;
+   }
+
+   return (offt)(p - (char *)buf);
+}
+
+static offt
+lat_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   lat_tracer_reset();
+   return buf_sz;
+}
+
+static const struct sysobj_prop_type lat_ptype_stats = {
+   .get_buf_sz = &lat_get_buf_sz,
+   .load = &lat_load,
+};
+
+static const struct sysobj_prop_type lat_ptype_reset = {
+   .store = &lat_reset_store,
+};
+
+DEF_STATIC_SYSOBJ_PROP(irqsoff, &lat_ptype_stats);
+DEF_STATIC_SYSOBJ_PROP(preemptoff, &lat_ptype_stats);
+DEF_STATIC_SYSOBJ_PROP(reset, &lat_ptype_reset);
+
+void sysfs_create_lat_tracer_obj(void)
+{
+   struct sysobj *obj;
+
+   obj = sysfs_create_custom_obj(
+      "lat_tracer",
+      NULL,       /* hooks */
+      &prop_irqsoff, (void *)(ulong)lat_irqsoff,
+      &prop_preemptoff, (void *)(ulong)lat_preemptoff,
+      &prop_reset, NULL,
+      NULL
+   );
+
+   if (!obj)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "lat_tracer", obj))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs lat_tracer obj");
+}
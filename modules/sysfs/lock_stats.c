@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lock_stats.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/lock_stats/table: the stats of the lock classes (see lock_stats.h)
+ * acquired at least once, one per line, in the format:
+ *
+ *    <type> <acquisitions> <contentions> <wait cycles> <max wait cycles>
+ *       <hold cycles> <max hold cycles> <class name>
+ *
+ * The file is empty when the kernel has been built with KRN_LOCK_STATS=0.
+ */
+
+#define STATS_LINE_MAX                                 192
+#define CLASS_NAME_MAX                                  64
+
+static offt
+table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return KRN_LOCK_STATS ? LOCK_STATS_MAX_CLASSES * STATS_LINE_MAX : 0;
+}
+
+static int
+dump_lock_class(char *buf, size_t buf_sz, struct lock_class *c)
+{
+   char name[CLASS_NAME_MAX];
+   lock_stats_get_class_name(c, name, sizeof(name));
+
+   return snprintk(buf, buf_sz, "%s %u %u %llu %llu %llu %llu %s\n",
+                   lock_stats_get_type_str(c->type),
+                   c->acquisitions, c->contentions,
+                   c->wait_cycles, c->max_wait_cycles,
+                   c->hold_cycles, c->max_hold_cycles,
+                   name);
+}
+
+static offt
+table_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct lock_class *classes;
+   size_t len = 0;
+   u32 n;
+
+   ASSERT(off == 0);
+
+   if (!KRN_LOCK_STATS)
+      return 0;
+
+   classes = kmalloc(sizeof(struct lock_class) * LOCK_STATS_MAX_CLASSES);
+
+   if (!classes)
+      return -ENOMEM;
+
+   n = lock_stats_get_classes(classes, LOCK_STATS_MAX_CLASSES);
+
+   for (u32 i = 0; i < n; i++) {
+
+      if (!classes[i].acquisitions)
+         continue;
+
+      len += (size_t)dump_lock_class(buf + len,
+                                     (size_t)buf_sz - len,
+                                     &classes[i]);
+   }
+
+   kfree2(classes, sizeof(struct lock_class) * LOCK_STATS_MAX_CLASSES);
+   return (offt)len;
+}
+
+static const struct sysobj_prop_type lock_stats_ptype_table = {
+   .get_buf_sz = &table_get_buf_sz,
+   .load = &table_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(table, &lock_stats_ptype_table);
+
+void sysfs_create_lock_stats_obj(void)
+{
+   struct sysobj *obj;
+
+   obj = sysfs_create_custom_obj(
+      "lock_stats",
+      NULL,       /* hooks */
+      &prop_table, NULL,
+      NULL
+   );
+
+   if (!obj)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "lock_stats", obj))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs lock_stats obj");
+}
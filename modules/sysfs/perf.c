@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/perf.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/perf: the kernel perf objects (see perf.h).
+ *
+ *    snapshot: all the objects, read at once, in the format:
+ *       ts <system time in ns>
+ *       <type> <group>.<name> <value 0> [<value 1> ...]  (one line per obj)
+ *
+ *    <group>/<name>: the values of a single object, on one line
+ *
+ * The group directories are created when this module is initialized: the
+ * objects registered later (e.g. the gauges of the worker threads created by
+ * other modules) appear only in the snapshot.
+ */
+
+#define PERF_LINE_MAX                  (64 + PERF_MAX_VALUES * 21)
+
+struct snapshot_ctx {
+   char *buf;
+   size_t buf_sz;
+   size_t len;
+};
+
+struct collect_ctx {
+   struct perf_obj **objs;
+   u32 max;
+   u32 count;
+};
+
+static int
+dump_values(char *buf, size_t buf_sz, struct perf_obj *o)
+{
+   u64 vals[PERF_MAX_VALUES];
+   int rc = 0;
+
+   perf_read(o, vals);
+
+   for (u32 i = 0; i < o->count; i++)
+      rc += snprintk(buf + rc, buf_sz - (size_t)rc, i ? " %llu" : "%llu",
+                     vals[i]);
+
+   rc += snprintk(buf + rc, buf_sz - (size_t)rc, "\n");
+   return rc;
+}
+
+static int
+count_objs_cb(struct perf_obj *o, void *arg)
+{
+   (*(u32 *)arg)++;
+   return 0;
+}
+
+static u32
+count_objs(void)
+{
+   u32 cnt = 0;
+   perf_for_each(&count_objs_cb, &cnt);
+   return cnt;
+}
+
+static int
+dump_obj_cb(struct perf_obj *o, void *arg)
+{
+   struct snapshot_ctx *ctx = arg;
+   char *p = ctx->buf + ctx->len;
+   size_t rem = ctx->buf_sz - ctx->len;
+   int rc;
+
+   if (!sysfs_buf_has_room(ctx->buf_sz, ctx->len, PERF_LINE_MAX))
+      return 0;
+
+   rc = snprintk(p, rem, "%s %s.%s ",
+                 perf_get_type_str(o->type), o->group, o->name);
+
+   rc += dump_values(p + rc, rem - (size_t)rc, o);
+   ctx->len += (size_t)rc;
+   return 0;
+}
+
+static offt
+snapshot_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return sysfs_buf_sz_with_slack(count_objs() * PERF_LINE_MAX, PERF_LINE_MAX);
+}
+
+static offt
+snapshot_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct snapshot_ctx ctx = { .buf = buf, .buf_sz = (size_t)buf_sz };
+   ASSERT(off == 0);
+
+   ctx.len = (size_t)snprintk(buf, ctx.buf_sz, "ts %llu\n", get_sys_time());
+   perf_for_each(&dump_obj_cb, &ctx);
+   return (offt)ctx.len;
+}
+
+static offt
+obj_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return PERF_LINE_MAX;
+}
+
+static offt
+obj_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return dump_values(buf, (size_t)buf_sz, data);
+}
+
+static const struct sysobj_prop_type perf_ptype_snapshot = {
+   .get_buf_sz = &snapshot_get_buf_sz,
+   .load = &snapshot_load,
+};
+
+static const struct sysobj_prop_type perf_ptype_obj = {
+   .get_buf_sz = &obj_get_buf_sz,
+   .load = &obj_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(snapshot, &perf_ptype_snapshot);
+
+static int
+collect_objs_cb(struct perf_obj *o, void *arg)
+{
+   struct collect_ctx *ctx = arg;
+
+   if (ctx->count == ctx->max)
+      return 1;
+
+   ctx->objs[ctx->count++] = o;
+   return 0;
+}
+
+/*
+ * Create the directory of the group of `objs[0]`, having `n` objects. Its
+ * type and props are never freed, like the directory itself.
+ */
+static int
+create_group_obj(struct sysobj *parent, struct perf_obj **objs, u32 n)
+{
+   struct sysobj_type *type;
+   struct sysobj_prop *props;
+   struct sysobj *obj;
+   void **prop_data;
+
+   type = kzalloc_obj(struct sysobj_type);
+   props = kzalloc_array_obj(struct sysobj_prop, n);
+   prop_data = kzalloc_array_obj(void *, n);
+
+   if (type)
+      type->properties = kzalloc_array_obj(struct sysobj_prop *, n + 1);
+
+   if (!type || !type->properties || !props || !prop_data)
+      return -ENOMEM;
+
+   type->name = objs[0]->group;
+
+   for (u32 i = 0; i < n; i++) {
+      props[i].name = objs[i]->name;
+      props[i].type = &perf_ptype_obj;
+      type->properties[i] = &props[i];
+      prop_data[i] = objs[i];
+   }
+
+   if (!(obj = sysfs_create_obj_va_arr(type, NULL, prop_data)))
+      return -ENOMEM;
+
+   return sysfs_register_obj(NULL, parent, objs[0]->group, obj);
+}
+
+static int
+create_group_objs(struct sysobj *parent)
+{
+   struct collect_ctx ctx;
+   u32 start = 0;
+   int rc = 0;
+
+   ctx.max = count_objs();
+   ctx.count = 0;
+   ctx.objs = kalloc_array_obj(struct perf_obj *, ctx.max);
+
+   if (!ctx.objs)
+      return -ENOMEM;
+
+   /* The objects are sorted by group: create a directory for each run */
+   perf_for_each(&collect_objs_cb, &ctx);
+
+   for (u32 i = 1; i <= ctx.count && !rc; i++) {
+
+      if (i < ctx.count && !strcmp(ctx.objs[i]->group, ctx.objs[start]->group))
+         continue;
+
+      rc = create_group_obj(parent, ctx.objs + start, i - start);
+      start = i;
+   }
+
+   kfree_array_obj(ctx.objs, struct perf_obj *, ctx.max);
+   return rc;
+}
+
+void sysfs_create_perf_obj(void)
+{
+   struct sysobj *perf;
+
+   perf = sysfs_create_custom_obj(
+      "perf",
+      NULL,       /* hooks */
+      &prop_snapshot, NULL,
+      NULL
+   );
+
+   if (!perf)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "perf", perf))
+      goto fail;
+
+   if (create_group_objs(perf))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs perf obj");
+}
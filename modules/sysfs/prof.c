@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <tilck/kernel/profiler.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/prof: the state of the sampling profiler and its results as folded
+ * stacks, ready to be passed to flamegraph.pl. The profiler is controlled
+ * with the `prof_hz` kernel option and with TILCK_CMD_PROFILER (see `dp -p`).
+ */
+
+#define FOLDED_LINE_AVG                                 64
+
+static offt
+prof_folded_get_buf_sz(struct sysobj *obj, void *data)
+{
+   const size_t sz = prof_get_folded(NULL, 0);
+   return sz ? sysfs_buf_sz_with_slack(sz, FOLDED_LINE_AVG) : 0;
+}
+
+static offt
+prof_folded_load(struct sysobj *obj,
+                 void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return (offt)prof_get_folded(buf, (size_t)buf_sz);
+}
+
+static const struct sysobj_prop_type prof_ptype_folded = {
+   .get_buf_sz = &prof_folded_get_buf_sz,
+   .load = &prof_folded_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(hz, &sysobj_ptype_ro_long);
+DEF_STATIC_SYSOBJ_PROP(samples, &sysobj_ptype_ro_ulong);
+DEF_STATIC_SYSOBJ_PROP(lost, &sysobj_ptype_ro_ulong);
+DEF_STATIC_SYSOBJ_PROP(folded, &prof_ptype_folded);
+
+void sysfs_create_prof_obj(void)
+{
+   struct sysobj *prof;
+
+   prof = sysfs_create_custom_obj(
+      "prof",
+      NULL,       /* hooks */
+      &prop_hz, &prof_hz,
+      &prop_samples, &prof_samples,
+      &prop_lost, &prof_lost,
+      &prop_folded, NULL,
+      NULL
+   );
+
+   if (!prof)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "prof", prof))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs prof obj");
+}
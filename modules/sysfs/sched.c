@@ -0,0 +1,192 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/sched: the scheduling latency histograms (see struct sched_lat_hist).
+ *
+ *    wakeup_lat, rq_wait: the system-wide histograms, one bucket per line
+ *
+ *    tasks: the per-task histograms, as two lines per task in the format:
+ *       <tid> wakeup <count 0> <count 1> ... <count N-1>
+ *       <tid> rq_wait <count 0> <count 1> ... <count N-1>
+ *
+ * The per-task histograms are exported all in the same file because sysfs
+ * objects cannot be unregistered: they could not follow the tasks' life.
+ */
+
+#define HIST_LINE_MAX                                 40
+#define TASK_LINE_MAX      (24 + SCHED_LAT_BUCKETS * 11)
+
+struct tasks_ctx {
+   char *buf;
+   size_t buf_sz;
+   size_t len;
+};
+
+static void
+sched_lat_hist_copy(struct sched_lat_hist *dst, struct sched_lat_hist *src)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      *dst = *src;
+   }
+   enable_interrupts(&var);
+}
+
+static offt
+hist_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return SCHED_LAT_BUCKETS * HIST_LINE_MAX;
+}
+
+static offt
+hist_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct sched_lat_hist h;
+   char *p = buf;
+   size_t rem = (size_t)buf_sz;
+   int rc;
+
+   ASSERT(off == 0);
+   sched_lat_hist_copy(&h, data);
+
+   for (u32 i = 0; i < SCHED_LAT_BUCKETS; i++) {
+
+      if (i == 0)
+         rc = snprintk(p, rem, "[0, 1) us: %u\n", h.cnt[i]);
+      else if (i == SCHED_LAT_BUCKETS - 1)
+         rc = snprintk(p, rem, "[%u, inf) us: %u\n", 1u << (i - 1), h.cnt[i]);
+      else
+         rc = snprintk(p, rem, "[%u, %u) us: %u\n",
+                       1u << (i - 1), 1u << i, h.cnt[i]);
+
+      p += rc;
+      rem -= (size_t)rc;
+   }
+
+   return (offt)(p - (char *)buf);
+}
+
+static const struct sysobj_prop_type sched_ptype_hist = {
+   .get_buf_sz = &hist_get_buf_sz,
+   .load = &hist_load,
+};
+
+static int
+count_tasks_cb(void *obj, void *arg)
+{
+   (*(size_t *)arg)++;
+   return 0;
+}
+
+static void
+tasks_append_hist(struct tasks_ctx *ctx,
+                  int tid,
+                  const char *name,
+                  struct sched_lat_hist *h)
+{
+   char *p = ctx->buf + ctx->len;
+   size_t rem = ctx->buf_sz - ctx->len;
+   int rc;
+
+   if (!sysfs_buf_has_room(ctx->buf_sz, ctx->len, TASK_LINE_MAX))
+      return;
+
+   rc = snprintk(p, rem, "%d %s", tid, name);
+
+   for (u32 i = 0; i < SCHED_LAT_BUCKETS; i++)
+      rc += snprintk(p + rc, rem - (size_t)rc, " %u", h->cnt[i]);
+
+   rc += snprintk(p + rc, rem - (size_t)rc, "\n");
+   ctx->len += (size_t)rc;
+}
+
+static int
+dump_task_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct tasks_ctx *ctx = arg;
+   struct sched_lat_stats lat;
+
+   if (!ti->lat)
+      return 0;
+
+   sched_lat_hist_copy(&lat.wakeup_lat, &ti->lat->wakeup_lat);
+   sched_lat_hist_copy(&lat.rq_wait, &ti->lat->rq_wait);
+
+   tasks_append_hist(ctx, ti->tid, "wakeup", &lat.wakeup_lat);
+   tasks_append_hist(ctx, ti->tid, "rq_wait", &lat.rq_wait);
+   return 0;
+}
+
+static offt
+tasks_get_buf_sz(struct sysobj *obj, void *data)
+{
+   size_t cnt = 0;
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&count_tasks_cb, &cnt);
+   }
+   enable_preemption();
+
+   return sysfs_buf_sz_with_slack(cnt * 2 * TASK_LINE_MAX, TASK_LINE_MAX);
+}
+
+static offt
+tasks_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct tasks_ctx ctx = { .buf = buf, .buf_sz = (size_t)buf_sz };
+   ASSERT(off == 0);
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&dump_task_cb, &ctx);
+   }
+   enable_preemption();
+   return (offt)ctx.len;
+}
+
+static const struct sysobj_prop_type sched_ptype_tasks = {
+   .get_buf_sz = &tasks_get_buf_sz,
+   .load = &tasks_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(wakeup_lat, &sched_ptype_hist);
+DEF_STATIC_SYSOBJ_PROP(rq_wait, &sched_ptype_hist);
+DEF_STATIC_SYSOBJ_PROP(tasks, &sched_ptype_tasks);
+
+void sysfs_create_sched_obj(void)
+{
+   struct sysobj *sched;
+
+   sched = sysfs_create_custom_obj(
+      "sched",
+      NULL,       /* hooks */
+      &prop_wakeup_lat, &sched_wakeup_lat,
+      &prop_rq_wait, &sched_rq_wait,
+      &prop_tasks, NULL,
+      NULL
+   );
+
+   if (!sched)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "sched", sched))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs sched obj");
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/sys_stats.h>
+#include <tilck/kernel/sys_types.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/sys_stats/table: the per-syscall statistics (see sys_stats.h), one
+ * line for each syscall called at least once, in the format:
+ *
+ *    <num> <name> <calls> <errors> <tot cycles> <max cycles> <hist 0> ...
+ *
+ * where the histogram has SYS_STATS_BUCKETS counts. The file is empty when
+ * the kernel has not been booted with the `-sys_stats` option.
+ */
+
+#define STATS_LINE_MAX               (128 + SYS_STATS_BUCKETS * 11)
+
+static u32
+count_called_syscalls(void)
+{
+   struct syscall_stats s;
+   u32 cnt = 0;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+
+      sys_stats_get(i, &s);
+
+      if (s.calls)
+         cnt++;
+   }
+
+   return cnt;
+}
+
+static offt
+table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   if (!sys_stats)
+      return 0;
+
+   return sysfs_buf_sz_with_slack(count_called_syscalls() * STATS_LINE_MAX,
+                                  STATS_LINE_MAX);
+}
+
+static int
+dump_syscall_stats(char *buf, size_t buf_sz, u32 sn, struct syscall_stats *s)
+{
+   const char *name = sys_stats_get_name(sn);
+   int rc;
+
+   rc = snprintk(buf, buf_sz, "%u %s %u %u %llu %llu",
+                 sn, name ? name : "?", s->calls, s->errors,
+                 s->tot_cycles, s->max_cycles);
+
+   for (u32 i = 0; i < SYS_STATS_BUCKETS; i++)
+      rc += snprintk(buf + rc, buf_sz - (size_t)rc, " %u", s->hist[i]);
+
+   rc += snprintk(buf + rc, buf_sz - (size_t)rc, "\n");
+   return rc;
+}
+
+static offt
+table_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct syscall_stats s;
+   size_t len = 0;
+
+   ASSERT(off == 0);
+
+   if (!sys_stats)
+      return 0;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+
+      if (!sysfs_buf_has_room((size_t)buf_sz, len, STATS_LINE_MAX))
+         break;
+
+      sys_stats_get(i, &s);
+
+      if (s.calls)
+         len += (size_t)dump_syscall_stats(buf + len, (size_t)buf_sz - len,
+                                           i, &s);
+   }
+
+   return (offt)len;
+}
+
+static const struct sysobj_prop_type sys_stats_ptype_table = {
+   .get_buf_sz = &table_get_buf_sz,
+   .load = &table_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(table, &sys_stats_ptype_table);
+
+void sysfs_create_sys_stats_obj(void)
+{
+   struct sysobj *obj;
+
+   obj = sysfs_create_custom_obj(
+      "sys_stats",
+      NULL,       /* hooks */
+      &prop_table, NULL,
+      NULL
+   );
+
+   if (!obj)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "sys_stats", obj))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs sys_stats obj");
+}
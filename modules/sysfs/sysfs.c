@@ -11,6 +11,7 @@
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/rwlock.h>
+#include <tilck/kernel/lock_stats.h>
 #include <tilck/kernel/paging.h>
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/modules.h>
@@ -25,6 +26,14 @@
 #include "lock_and_retain.c.h"
 
 void sysfs_create_config_obj(void);
+void sysfs_create_tunables_obj(void);
+void sysfs_create_prof_obj(void);
+void sysfs_create_sched_obj(void);
+void sysfs_create_sys_stats_obj(void);
+void sysfs_create_lock_stats_obj(void);
+void sysfs_create_lat_tracer_obj(void);
+void sysfs_create_perf_obj(void);
+void sysfs_create_boot_prof_obj(void);
 static struct mnt_fs *sysfs;
 
 static int
@@ -184,6 +193,7 @@ static const struct fs_ops static_fsops_sysfs =
    .unlink = NULL,
    .mkdir = NULL,
    .rmdir = NULL,
+   .mknod = NULL,
    .truncate = NULL,
    .stat = sysfs_stat,
    .symlink = NULL,
@@ -654,6 +664,7 @@ create_sysfs(void)
    d->next_inode = 1;
    d->wrt_time = (time_t)get_timestamp();
    rwlock_wp_init(&d->rwlock, false);
+   LOCK_STATS_NAME(&d->rwlock, rwlock_wp, "sysfs fs");
    list_init(&d->dirty_handles);
    d->root = sysfs_create_inode_dir(d, NULL);
 
@@ -756,6 +767,14 @@ init_sysfs(void)
       panic("Unable to create default objects");
 
    sysfs_create_config_obj();
+   sysfs_create_tunables_obj();
+   sysfs_create_prof_obj();
+   sysfs_create_sched_obj();
+   sysfs_create_sys_stats_obj();
+   sysfs_create_lock_stats_obj();
+   sysfs_create_lat_tracer_obj();
+   sysfs_create_perf_obj();
+   sysfs_create_boot_prof_obj();
 }
 
 static struct module sysfs_module = {
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/pipe.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * Run-time tunables: unlike the properties in /syst/config, these are plain
+ * kernel variables that can be changed by writing to their sysfs files.
+ */
+
+/* fs */
+DEF_STATIC_SYSOBJ_PROP(pipe_max_size, &sysobj_ptype_rw_ulong);
+
+void sysfs_create_tunables_obj(void)
+{
+   struct sysobj *fs;
+
+   fs = sysfs_create_custom_obj(
+      "fs",
+      NULL,       /* hooks */
+      &prop_pipe_max_size, &pipe_max_size,
+      NULL
+   );
+
+   if (!fs)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "fs", fs))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs tunables objs");
+}
@@ -3,11 +3,13 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
 
+#include <tilck/common/atomics.h>
+
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/sync.h>
-#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/bintree.h>
@@ -16,7 +18,17 @@
 
 #include <tilck/mods/tracing.h>
 
-#define TRACE_BUF_SIZE                       (128 * KB)
+/*
+ * Each buffer has room for 512 events (128 KB), like the single buffer used
+ * before having per-task buffers: a traced task alone does not lose more
+ * events than before. The per-task buffers are allocated on demand.
+ */
+#define SHARED_TRACE_BUF_EVENTS                      512
+#define TASK_TRACE_BUF_EVENTS                        512
+#define MAX_TASK_TRACE_BUFS                            8
+
+#define SHARED_TRACE_BUF_TID                          -1
+#define ORPHAN_TRACE_BUF_TID                           0
 
 struct symbol_node {
 
@@ -27,10 +39,35 @@ struct symbol_node {
    const char *name;
 };
 
-static struct kmutex tracing_lock;
+/*
+ * Single-producer single-consumer ring of trace events.
+ *
+ * Each traced task gets its own buffer, where only the task itself writes,
+ * without taking any locks. Events produced by non-traced tasks and by IRQ
+ * handlers go instead in the shared buffer, written with the interrupts
+ * disabled. The reader, with preemption disabled, merges all the buffers by
+ * picking every time the oldest event. When a task dies, its buffer becomes
+ * an orphan: the reader can still drain it, until it gets reused by another
+ * traced task.
+ */
+struct trace_buf {
+
+   struct list_node node;
+
+   int tid;                      /* owner task, or one of the *_TRACE_BUF_TID */
+   u32 max_elems;                /* always a power of 2 */
+   u32 dropped;                  /* events lost because the buffer was full */
+
+   ATOMIC(u32) head;             /* written only by the producer */
+   ATOMIC(u32) tail;             /* written only by the consumer */
+
+   struct trace_event *events;
+};
+
 static struct kcond tracing_cond;
-static struct ringbuf tracing_rb;
-static void *tracing_buf;
+static struct trace_buf shared_tb;
+static struct list trace_bufs_list = STATIC_LIST_INIT(trace_bufs_list);
+static int task_trace_bufs_count;
 
 static u32 syms_count;
 static struct symbol_node *syms_buf;
@@ -232,15 +269,220 @@ trace_syscall_exit_save_params(const struct syscall_info *si,
    }
 }
 
+static ALWAYS_INLINE u32
+trace_buf_get_elems(struct trace_buf *tb)
+{
+   return atomic_load_explicit(&tb->head, mo_acquire) -
+          atomic_load_explicit(&tb->tail, mo_relaxed);
+}
+
+static bool
+trace_buf_write(struct trace_buf *tb, struct trace_event *e)
+{
+   const u32 head = atomic_load_explicit(&tb->head, mo_relaxed);
+   const u32 tail = atomic_load_explicit(&tb->tail, mo_acquire);
+
+   if (head - tail == tb->max_elems) {
+      tb->dropped++;
+      return false;
+   }
+
+   memcpy(&tb->events[head & (tb->max_elems - 1)], e, sizeof(*e));
+   atomic_store_explicit(&tb->head, head + 1, mo_release);
+   return true;
+}
+
+static struct trace_event *
+trace_buf_peek(struct trace_buf *tb)
+{
+   const u32 tail = atomic_load_explicit(&tb->tail, mo_relaxed);
+
+   if (atomic_load_explicit(&tb->head, mo_acquire) == tail)
+      return NULL;
+
+   return &tb->events[tail & (tb->max_elems - 1)];
+}
+
+static void
+trace_buf_consume(struct trace_buf *tb)
+{
+   const u32 tail = atomic_load_explicit(&tb->tail, mo_relaxed);
+   atomic_store_explicit(&tb->tail, tail + 1, mo_release);
+}
+
 static void
-enqueue_trace_event(struct trace_event *e)
+trace_buf_init(struct trace_buf *tb, int tid, u32 max_elems, void *events)
 {
-   kmutex_lock(&tracing_lock);
+   ASSERT(max_elems && !(max_elems & (max_elems - 1)));
+
+   list_node_init(&tb->node);
+   tb->tid = tid;
+   tb->max_elems = max_elems;
+   tb->dropped = 0;
+   tb->events = events;
+   atomic_store_explicit(&tb->head, 0, mo_relaxed);
+   atomic_store_explicit(&tb->tail, 0, mo_relaxed);
+}
+
+static void
+tracing_on_task_exit(struct task *ti)
+{
+   struct trace_buf *tb = ti->trace_buf;
+
+   disable_preemption();
    {
-      ringbuf_write_elem(&tracing_rb, e);
-      kcond_signal_one(&tracing_cond);
+      /* Keep the events: the reader will still be able to drain them */
+      tb->tid = ORPHAN_TRACE_BUF_TID;
+      ti->trace_buf = NULL;
+   }
+   enable_preemption();
+}
+
+/*
+ * Get an orphan buffer for `curr`, preferring an empty one. A buffer with
+ * unread events is reused only when no more buffers can be allocated.
+ */
+static struct trace_buf *
+claim_orphan_trace_buf(struct task *curr)
+{
+   struct trace_buf *pos, *tb = NULL;
+   u32 elems;
+
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(pos, &trace_bufs_list, node) {
+
+      if (pos->tid != ORPHAN_TRACE_BUF_TID)
+         continue;
+
+      if (!tb || trace_buf_get_elems(pos) < trace_buf_get_elems(tb))
+         tb = pos;
+   }
+
+   if (!tb)
+      return NULL;
+
+   elems = trace_buf_get_elems(tb);
+
+   if (elems && task_trace_bufs_count < MAX_TASK_TRACE_BUFS)
+      return NULL;
+
+   /* Drop the unread events: the reader is not keeping up */
+   tb->dropped += elems;
+   atomic_store_explicit(&tb->tail,
+                         atomic_load_explicit(&tb->head, mo_relaxed),
+                         mo_release);
+   tb->tid = curr->tid;
+   return tb;
+}
+
+static struct trace_buf *
+alloc_task_trace_buf(struct task *curr)
+{
+   struct trace_buf *tb;
+   struct trace_event *events = NULL;
+   bool reserved = false;
+
+   disable_preemption();
+   {
+      if (!(tb = claim_orphan_trace_buf(curr))) {
+         if (task_trace_bufs_count < MAX_TASK_TRACE_BUFS) {
+            task_trace_bufs_count++;
+            reserved = true;
+         }
+      }
    }
-   kmutex_unlock(&tracing_lock);
+   enable_preemption();
+
+   if (reserved) {
+
+      tb = kalloc_obj(struct trace_buf);
+      events = kalloc_array_obj(struct trace_event, TASK_TRACE_BUF_EVENTS);
+
+      if (!tb || !events) {
+
+         if (tb)
+            kfree_obj(tb, struct trace_buf);
+
+         if (events)
+            kfree_array_obj(events, struct trace_event, TASK_TRACE_BUF_EVENTS);
+
+         disable_preemption();
+         task_trace_bufs_count--;
+         enable_preemption();
+         return NULL;
+      }
+
+      trace_buf_init(tb, curr->tid, TASK_TRACE_BUF_EVENTS, events);
+
+      disable_preemption();
+      list_add_tail(&trace_bufs_list, &tb->node);
+      enable_preemption();
+   }
+
+   if (!tb)
+      return NULL;
+
+   if (register_on_task_exit_cb(&tracing_on_task_exit)) {
+      disable_preemption();
+      tb->tid = ORPHAN_TRACE_BUF_TID;
+      enable_preemption();
+      return NULL;
+   }
+
+   curr->trace_buf = tb;
+   return tb;
+}
+
+/*
+ * Get the buffer where the current context can write without locks. Only
+ * traced tasks running syscalls (alloc == true) get a buffer of their own.
+ */
+static struct trace_buf *
+get_curr_trace_buf(bool alloc)
+{
+   struct task *curr = get_curr_task();
+   struct trace_buf *tb;
+
+   if (in_irq())
+      return &shared_tb;
+
+   if (LIKELY((tb = curr->trace_buf) != NULL))
+      return tb;
+
+   if (alloc && curr->traced && (tb = alloc_task_trace_buf(curr)))
+      return tb;
+
+   return &shared_tb;
+}
+
+static void
+enqueue_trace_event(struct trace_event *e, bool alloc)
+{
+   struct trace_buf *tb = get_curr_trace_buf(alloc);
+   ulong var;
+
+   if (tb == &shared_tb) {
+
+      /* Multiple producers: IRQ handlers and non-traced tasks */
+      disable_interrupts(&var);
+      {
+         trace_buf_write(tb, e);
+      }
+      enable_interrupts(&var);
+
+   } else {
+
+      trace_buf_write(tb, e);
+   }
+
+   /*
+    * Racy check, but safe: the reader checks for new events and starts
+    * waiting on `tracing_cond` with preemption disabled. IRQ handlers cannot
+    * signal a condition: in that case, the reader will wake up on timeout.
+    */
+   if (!in_irq() && !list_is_empty(&tracing_cond.wait_list))
+      kcond_signal_one(&tracing_cond);
 }
 
 void
@@ -264,7 +506,7 @@ trace_syscall_enter_int(u32 sys,
 
       .type = te_sys_enter,
       .tid = get_curr_tid(),
-      .sys_time = get_sys_time(),
+      .sys_time = get_sys_time_hr(),
       .sys_ev = {
          .sys = sys,
          .args = {a1,a2,a3,a4,a5,a6}
@@ -272,7 +514,7 @@ trace_syscall_enter_int(u32 sys,
    };
 
    trace_syscall_enter_save_params(si, &e);
-   enqueue_trace_event(&e);
+   enqueue_trace_event(&e, true);
 }
 
 void
@@ -293,7 +535,7 @@ trace_syscall_exit_int(u32 sys,
    struct trace_event e = {
       .type = te_sys_exit,
       .tid = get_curr_tid(),
-      .sys_time = get_sys_time(),
+      .sys_time = get_sys_time_hr(),
       .sys_ev = {
          .sys = sys,
          .retval = retval,
@@ -302,7 +544,7 @@ trace_syscall_exit_int(u32 sys,
    };
 
    trace_syscall_exit_save_params(si, &e);
-   enqueue_trace_event(&e);
+   enqueue_trace_event(&e, true);
 }
 
 void
@@ -316,7 +558,7 @@ trace_printk_int(int level, const char *fmt, ...)
    struct trace_event e = {
       .type = te_printk,
       .tid = get_curr_tid(),
-      .sys_time = get_sys_time(),
+      .sys_time = get_sys_time_hr(),
       .p_ev = {
          .level = level,
       }
@@ -327,7 +569,7 @@ trace_printk_int(int level, const char *fmt, ...)
    vsnprintk(e.p_ev.buf, sizeof(e.p_ev.buf), fmt, args);
    va_end(args);
 
-   enqueue_trace_event(&e);
+   enqueue_trace_event(&e, false);
 }
 
 void
@@ -349,13 +591,13 @@ trace_signal_delivered_int(int target_tid, int signum)
    struct trace_event e = {
       .type = te_signal_delivered,
       .tid = target_tid,
-      .sys_time = get_sys_time(),
+      .sys_time = get_sys_time_hr(),
       .sig_ev = {
          .signum = signum
       }
    };
 
-   enqueue_trace_event(&e);
+   enqueue_trace_event(&e, false);
 }
 
 void
@@ -367,38 +609,156 @@ trace_task_killed_int(int signum)
    struct trace_event e = {
       .type = te_killed,
       .tid = get_curr_tid(),
-      .sys_time = get_sys_time(),
+      .sys_time = get_sys_time_hr(),
       .sig_ev = {
          .signum = signum
       }
    };
 
-   enqueue_trace_event(&e);
+   enqueue_trace_event(&e, false);
+}
+
+/*
+ * Scheduler events are emitted also from contexts where signaling a condition
+ * is not possible (e.g. task_change_state(), called by kcond_signal_*() too).
+ * Therefore, they always go in the shared buffer, without waking up the
+ * reader: it gets them on timeout, at most TRACE_READ_TIMEOUT_MS later, or as
+ * soon as any other event wakes it up. The shared buffer has to hold all the
+ * events produced in the meanwhile: assume as worst case a switch + wakeup
+ * pair every 250 us.
+ */
+#define MAX_SCHED_EVENTS_PER_MS                        8
+
+STATIC_ASSERT(
+   SHARED_TRACE_BUF_EVENTS >= MAX_SCHED_EVENTS_PER_MS * TRACE_READ_TIMEOUT_MS
+);
+
+static void
+enqueue_sched_event(struct trace_event *e)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      trace_buf_write(&shared_tb, e);
+   }
+   enable_interrupts(&var);
+}
+
+void
+trace_sched_switch_int(struct task *prev, struct task *next)
+{
+   struct trace_event e = {
+      .type = te_sched_switch,
+      .tid = prev->tid,
+      .sys_time = get_sys_time_hr(),
+      .sched_ev = {
+         .other_tid = next->tid,
+         .state = (int)atomic_load_explicit(&prev->state, mo_relaxed),
+      }
+   };
+
+   enqueue_sched_event(&e);
+}
+
+void
+trace_sched_wakeup_int(struct task *ti, bool timer)
+{
+   struct trace_event e = {
+      .type = timer ? te_timer_wakeup : te_sched_wakeup,
+      .tid = ti->tid,
+      .sys_time = get_sys_time_hr(),
+      .sched_ev = {
+         .other_tid = in_irq() ? 0 : get_curr_tid(),
+      }
+   };
+
+   enqueue_sched_event(&e);
+}
+
+void
+trace_wth_job_int(bool start, void *func, void *arg)
+{
+   struct trace_event e = {
+      .type = start ? te_wth_job_start : te_wth_job_end,
+      .tid = get_curr_tid(),
+      .sys_time = get_sys_time_hr(),
+      .sched_ev = {
+         .func = (ulong)func,
+         .arg = (ulong)arg,
+      }
+   };
+
+   enqueue_sched_event(&e);
+}
+
+/* Merge step: find the buffer containing the oldest event */
+static struct trace_buf *
+get_oldest_event_buf(void)
+{
+   struct trace_buf *pos, *tb = NULL;
+   struct trace_event *e, *oldest = NULL;
+
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(pos, &trace_bufs_list, node) {
+
+      if (!(e = trace_buf_peek(pos)))
+         continue;
+
+      if (!oldest || e->sys_time < oldest->sys_time) {
+         oldest = e;
+         tb = pos;
+      }
+   }
+
+   return tb;
 }
 
 bool read_trace_event_noblock(struct trace_event *e)
 {
-   bool ret;
-   kmutex_lock(&tracing_lock);
+   struct trace_buf *tb;
+   bool ret = false;
+
+   disable_preemption();
    {
-      ret = ringbuf_read_elem(&tracing_rb, e);
+      if ((tb = get_oldest_event_buf())) {
+         memcpy(e, trace_buf_peek(tb), sizeof(*e));
+         trace_buf_consume(tb);
+         ret = true;
+      }
    }
-   kmutex_unlock(&tracing_lock);
+   enable_preemption();
    return ret;
 }
 
 bool read_trace_event(struct trace_event *e, u32 timeout_ticks)
 {
-   bool ret;
-   kmutex_lock(&tracing_lock);
-   {
-      if (ringbuf_is_empty(&tracing_rb))
-         kcond_wait(&tracing_cond, &tracing_lock, timeout_ticks);
+   struct task *curr = get_curr_task();
+
+   if (read_trace_event_noblock(e))
+      return true;
 
-      ret = ringbuf_read_elem(&tracing_rb, e);
+   disable_preemption();
+
+   if (get_oldest_event_buf()) {
+      enable_preemption();
+      return read_trace_event_noblock(e);
    }
-   kmutex_unlock(&tracing_lock);
-   return ret;
+
+   prepare_to_wait_on(WOBJ_KCOND,
+                      &tracing_cond,
+                      NO_EXTRA,
+                      &tracing_cond.wait_list);
+
+   if (timeout_ticks != KCOND_WAIT_FOREVER)
+      task_set_wakeup_timer(curr, timeout_ticks);
+
+   enter_sleep_wait_state();
+
+   /* In case of timeout or signal, we're still on the wait list */
+   wait_obj_reset(&curr->wobj);
+   task_cancel_wakeup_timer(curr);
+   return read_trace_event_noblock(e);
 }
 
 const struct syscall_info *
@@ -763,13 +1123,31 @@ set_traced_syscalls(const char *s)
 int
 tracing_get_in_buffer_events_count(void)
 {
-   int rc;
-   kmutex_lock(&tracing_lock);
+   struct trace_buf *pos;
+   u32 cnt = 0;
+
+   disable_preemption();
    {
-      rc = (int)ringbuf_get_elems(&tracing_rb); // integer narrowing
+      list_for_each_ro(pos, &trace_bufs_list, node)
+         cnt += trace_buf_get_elems(pos);
    }
-   kmutex_unlock(&tracing_lock);
-   return rc;
+   enable_preemption();
+   return (int)cnt;
+}
+
+u32
+tracing_get_dropped_events_count(void)
+{
+   struct trace_buf *pos;
+   u32 cnt = 0;
+
+   disable_preemption();
+   {
+      list_for_each_ro(pos, &trace_bufs_list, node)
+         cnt += pos->dropped;
+   }
+   enable_preemption();
+   return cnt;
 }
 
 static void
@@ -781,8 +1159,13 @@ tracing_init_oom_panic(const char *buf_name)
 void
 init_tracing(void)
 {
-   if (!(tracing_buf = kzmalloc(TRACE_BUF_SIZE)))
-      tracing_init_oom_panic("tracing_buf");
+   void *shared_events;
+
+   shared_events =
+      kzalloc_array_obj(struct trace_event, SHARED_TRACE_BUF_EVENTS);
+
+   if (!shared_events)
+      tracing_init_oom_panic("shared_events");
 
    if (!(syms_buf = kalloc_array_obj(struct symbol_node, MAX_SYSCALLS)))
       tracing_init_oom_panic("syms_buf");
@@ -802,12 +1185,12 @@ init_tracing(void)
    if (!(traced_syscalls_str = kmalloc(TRACED_SYSCALLS_STR_LEN)))
       tracing_init_oom_panic("traced_syscalls_str");
 
-   ringbuf_init(&tracing_rb,
-                TRACE_BUF_SIZE / sizeof(struct trace_event),
-                sizeof(struct trace_event),
-                tracing_buf);
+   trace_buf_init(&shared_tb,
+                  SHARED_TRACE_BUF_TID,
+                  SHARED_TRACE_BUF_EVENTS,
+                  shared_events);
 
-   kmutex_init(&tracing_lock, 0);
+   list_add_tail(&trace_bufs_list, &shared_tb.node);
    kcond_init(&tracing_cond);
 
    foreach_symbol(elf_symbol_cb, NULL);
@@ -816,6 +1199,7 @@ init_tracing(void)
    tracing_allocate_slots_for_params();
 
    set_traced_syscalls("*");
+   init_tracing_dev();
 }
 
 static struct module dp_module = {
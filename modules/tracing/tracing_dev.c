@@ -0,0 +1,367 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/atomics.h>
+#include <tilck/common/tracing_dev.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/lock_stats.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/paging_hw.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/vfs.h>
+
+#include <tilck/mods/tracing.h>
+
+#include <sys/mman.h>      // system header
+
+/*
+ * /dev/trace: binary export of the trace events.
+ *
+ * While the device is open, tracing is enabled and a kernel thread moves the
+ * events from the tracing buffers (see read_trace_event()) to a ring in memory
+ * that user space can mmap() and drain without a syscall per event. The layout
+ * of that memory is described in <tilck/common/tracing_dev.h>. Plain read() is
+ * supported too.
+ *
+ * NOTE: the events moved here are not visible anymore in the debug panel.
+ */
+
+#define TRACE_DEV_BUF_SIZE                  (256 * KB)
+
+static struct trace_dev_hdr *hdr;
+static char *events;
+static u32 events_mask;
+
+static int users_count;
+static bool tracing_was_enabled;
+static struct kmutex users_lock;
+static struct kcond users_cond;
+static struct kmutex read_lock;
+static struct kcond events_cond;
+
+static ALWAYS_INLINE char *
+get_event_ptr(u32 idx)
+{
+   return events + (idx & events_mask) * sizeof(struct trace_event);
+}
+
+static void
+trace_dev_write_event(struct trace_event *e)
+{
+   const u32 head = hdr->head;
+
+   /* `tail` is controlled by user space: just use it to check for space */
+   if (head - hdr->tail >= hdr->max_events) {
+      hdr->dropped++;
+      return;
+   }
+
+   memcpy(get_event_ptr(head), e, sizeof(*e));
+   atomic_thread_fence(mo_release);
+   hdr->head = head + 1;
+}
+
+static void
+trace_dev_wait_for_users(void)
+{
+   kmutex_lock(&users_lock);
+   {
+      while (!users_count)
+         kcond_wait(&users_cond, &users_lock, KCOND_WAIT_FOREVER);
+   }
+   kmutex_unlock(&users_lock);
+}
+
+static void
+trace_dev_pump(void *unused)
+{
+   struct trace_event e;
+
+   while (true) {
+
+      trace_dev_wait_for_users();
+
+      if (!read_trace_event(&e, ms_to_ticks(TRACE_READ_TIMEOUT_MS)))
+         continue;
+
+      do {
+         trace_dev_write_event(&e);
+      } while (read_trace_event_noblock(&e));
+
+      hdr->buf_dropped = tracing_get_dropped_events_count();
+
+      kcond_signal_all(&events_cond);
+   }
+}
+
+static ALWAYS_INLINE bool
+trace_dev_has_events(void)
+{
+   return hdr->head != hdr->tail;
+}
+
+static ssize_t
+trace_dev_read(fs_handle h, char *user_buf, size_t size, offt *pos)
+{
+   struct fs_handle_base *hb = h;
+   struct task *curr = get_curr_task();
+   const size_t ev_size = sizeof(struct trace_event);
+   size_t cnt = 0;
+   int rc = 0;
+   u32 tail;
+
+   if (size < ev_size)
+      return -EINVAL;
+
+   while (true) {
+
+      disable_preemption();
+
+      if (trace_dev_has_events() || (hb->fl_flags & O_NONBLOCK)) {
+         enable_preemption();
+         break;
+      }
+
+      if (pending_signals()) {
+         enable_preemption();
+         return -EINTR;
+      }
+
+      prepare_to_wait_on(WOBJ_KCOND,
+                         &events_cond,
+                         NO_EXTRA,
+                         &events_cond.wait_list);
+
+      enter_sleep_wait_state();
+
+      /* In case of a signal, we're still on the wait list */
+      wait_obj_reset(&curr->wobj);
+   }
+
+   /* Just one reader at a time can move `tail` safely */
+   kmutex_lock(&read_lock);
+   {
+      tail = hdr->tail;
+
+      while (cnt + ev_size <= size && tail != hdr->head) {
+
+         atomic_thread_fence(mo_acquire);
+
+         if (copy_to_user(user_buf + cnt, get_event_ptr(tail), ev_size)) {
+            rc = -EFAULT;
+            break;
+         }
+
+         tail++;
+         cnt += ev_size;
+      }
+
+      hdr->tail = tail;
+   }
+   kmutex_unlock(&read_lock);
+
+   if (cnt)
+      return (ssize_t)cnt;
+
+   return rc ? rc : -EAGAIN;
+}
+
+static int
+trace_dev_read_ready(fs_handle h)
+{
+   return trace_dev_has_events();
+}
+
+static struct kcond *
+trace_dev_get_rready_cond(fs_handle h)
+{
+   return &events_cond;
+}
+
+static int
+trace_dev_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   const size_t pg_count = um->len >> PAGE_SHIFT;
+   const u32 rw = um->prot & PROT_WRITE ? PAGING_FL_RW : 0;
+   size_t mapped_cnt;
+
+   if (flags & VFS_MM_DONT_MMAP)
+      return 0;
+
+   if (um->off + um->len > TRACE_DEV_BUF_SIZE)
+      return -EACCES;
+
+   mapped_cnt = map_pages(pdir,
+                          um->vaddrp,
+                          KERNEL_VA_TO_PA(hdr) + um->off,
+                          pg_count,
+                          PAGING_FL_US | PAGING_FL_SHARED | rw);
+
+   if (mapped_cnt != pg_count) {
+      unmap_pages_permissive(pdir, um->vaddrp, mapped_cnt, false);
+      return -ENOMEM;
+   }
+
+   return 0;
+}
+
+static int
+trace_dev_munmap(struct user_mapping *um, void *vaddrp, size_t len)
+{
+   return generic_fs_munmap(um, vaddrp, len);
+}
+
+static int
+trace_dev_add_user(int minor, void *extra)
+{
+   kmutex_lock(&users_lock);
+   {
+      if (!users_count++) {
+         tracing_was_enabled = tracing_is_enabled();
+         tracing_set_enabled(true);
+         kcond_signal_one(&users_cond);
+      }
+   }
+   kmutex_unlock(&users_lock);
+   return 0;
+}
+
+static void
+trace_dev_remove_user(int minor, void *extra)
+{
+   kmutex_lock(&users_lock);
+   {
+      ASSERT(users_count > 0);
+
+      if (!--users_count)
+         tracing_set_enabled(tracing_was_enabled);
+   }
+   kmutex_unlock(&users_lock);
+}
+
+static int
+create_trace_device(int minor,
+                    enum vfs_entry_type *type,
+                    struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_trace_dev = {
+      .read = trace_dev_read,
+      .read_ready = trace_dev_read_ready,
+      .get_rready_cond = trace_dev_get_rready_cond,
+      .mmap = trace_dev_mmap,
+      .munmap = trace_dev_munmap,
+   };
+
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &static_ops_trace_dev;
+   nfo->spec_flags = VFS_SPFL_NO_USER_COPY | VFS_SPFL_MMAP_SUPPORTED;
+   nfo->create_extra = &trace_dev_add_user;
+   nfo->on_dup_extra = &trace_dev_add_user;
+   nfo->destroy_extra = &trace_dev_remove_user;
+   return 0;
+}
+
+static void
+trace_dev_fill_sys_names(void)
+{
+   char *names = (char *)hdr + hdr->sys_names_off;
+   const char *name;
+
+   for (u32 i = 0; i < hdr->sys_names_count; i++) {
+
+      if (!(name = tracing_get_syscall_name(i)))
+         continue;
+
+      if (!strncmp(name, "sys_", 4))
+         name += 4;
+
+      strncpy(names + i * TRACE_DEV_SYS_NAME_LEN,
+              name,
+              TRACE_DEV_SYS_NAME_LEN - 1);
+   }
+}
+
+static void
+trace_dev_init_hdr(void)
+{
+   const u32 ev_size = sizeof(struct trace_event);
+   u32 max_events = 1;
+
+   while (2 * max_events * ev_size <= TRACE_DEV_BUF_SIZE - TRACE_DEV_HDR_SIZE)
+      max_events *= 2;
+
+   *hdr = (struct trace_dev_hdr) {
+      .magic = TRACE_DEV_MAGIC,
+      .version = TRACE_DEV_VERSION,
+      .hdr_size = TRACE_DEV_HDR_SIZE,
+      .event_size = ev_size,
+      .max_events = max_events,
+      .ulong_size = sizeof(ulong),
+      .printk_buf_size = sizeof(((struct printk_event_data *)0)->buf),
+      .off_type = OFFSET_OF(struct trace_event, type),
+      .off_tid = OFFSET_OF(struct trace_event, tid),
+      .off_sys_time = OFFSET_OF(struct trace_event, sys_time),
+      .off_sys = OFFSET_OF(struct trace_event, sys_ev.sys),
+      .off_retval = OFFSET_OF(struct trace_event, sys_ev.retval),
+      .off_args = OFFSET_OF(struct trace_event, sys_ev.args),
+      .off_printk_level = OFFSET_OF(struct trace_event, p_ev.level),
+      .off_printk_buf = OFFSET_OF(struct trace_event, p_ev.buf),
+      .off_signum = OFFSET_OF(struct trace_event, sig_ev.signum),
+      .off_sched_other_tid = OFFSET_OF(struct trace_event, sched_ev.other_tid),
+      .off_sched_state = OFFSET_OF(struct trace_event, sched_ev.state),
+      .off_sched_func = OFFSET_OF(struct trace_event, sched_ev.func),
+      .off_sched_arg = OFFSET_OF(struct trace_event, sched_ev.arg),
+      .sys_names_off = sizeof(struct trace_dev_hdr),
+      .sys_names_count = MAX_SYSCALLS,
+   };
+
+   events = (char *)hdr + TRACE_DEV_HDR_SIZE;
+   events_mask = max_events - 1;
+   trace_dev_fill_sys_names();
+}
+
+void
+init_tracing_dev(void)
+{
+   struct driver_info *di;
+   int major, rc;
+
+   STATIC_ASSERT(
+      sizeof(struct trace_dev_hdr) +
+      MAX_SYSCALLS * TRACE_DEV_SYS_NAME_LEN <= TRACE_DEV_HDR_SIZE
+   );
+
+   if (!(hdr = aligned_kmalloc(TRACE_DEV_BUF_SIZE, PAGE_SIZE)))
+      panic("Unable to allocate the /dev/trace buffer");
+
+   bzero(hdr, TRACE_DEV_BUF_SIZE);
+   trace_dev_init_hdr();
+
+   kmutex_init(&users_lock, 0);
+   kmutex_init(&read_lock, 0);
+   LOCK_STATS_NAME(&users_lock, kmutex, "trace_dev users");
+   LOCK_STATS_NAME(&read_lock, kmutex, "trace_dev read");
+   kcond_init(&users_cond);
+   kcond_init(&events_cond);
+
+   if (!(di = kzalloc_obj(struct driver_info)))
+      panic("Unable to allocate the /dev/trace driver info");
+
+   di->name = "trace";
+   di->create_dev_file = create_trace_device;
+   major = register_driver(di, -1);
+
+   if ((rc = create_dev_file("trace", (u16)major, 0, NULL)))
+      panic("Unable to create /dev/trace (error: %d)", rc);
+
+   if ((rc = kthread_create(trace_dev_pump, 0, NULL)) < 0)
+      panic("Unable to create the /dev/trace kthread (error: %d)", rc);
+}
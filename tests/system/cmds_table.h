@@ -50,6 +50,7 @@ CMD_ENTRY(fs4,          TT_SHORT,  true)
 CMD_ENTRY(fs5,          TT_SHORT,  true)
 CMD_ENTRY(fs6,          TT_SHORT,  true)
 CMD_ENTRY(fs7,          TT_SHORT,  true)
+CMD_ENTRY(fs8,          TT_SHORT,  true)
 CMD_ENTRY(fs_perf1,     TT_SHORT,  true)
 CMD_ENTRY(fs_perf2,     TT_SHORT,  true)
 CMD_ENTRY(fmmap1,       TT_SHORT,  true)
@@ -64,6 +65,37 @@ CMD_ENTRY(pipe2,        TT_SHORT,  true)
 CMD_ENTRY(pipe3,        TT_SHORT,  true)
 CMD_ENTRY(pipe4,        TT_SHORT,  true)
 CMD_ENTRY(pipe5,        TT_SHORT,  true)
+CMD_ENTRY(pipe6,        TT_SHORT,  true)
+CMD_ENTRY(pipe7,        TT_SHORT,  true)
+CMD_ENTRY(unix1,        TT_SHORT,  true)
+CMD_ENTRY(unix2,        TT_SHORT,  true)
+CMD_ENTRY(unix3,        TT_SHORT,  true)
+CMD_ENTRY(unix4,        TT_SHORT,  true)
+CMD_ENTRY(shm1,         TT_SHORT,  true)
+CMD_ENTRY(shm2,         TT_SHORT,  true)
+CMD_ENTRY(timerfd1,     TT_SHORT,  true)
+CMD_ENTRY(ptimer1,      TT_SHORT,  true)
+CMD_ENTRY(signalfd1,    TT_SHORT,  true)
+CMD_ENTRY(prof1,        TT_SHORT,  true)
+CMD_ENTRY(sched_lat1,   TT_SHORT,  true)
+CMD_ENTRY(sys_stats1,   TT_SHORT,  true)
+CMD_ENTRY(lock_stats1,  TT_SHORT,  true)
+CMD_ENTRY(lat_tracer1,  TT_SHORT,  true)
+CMD_ENTRY(perf1,        TT_SHORT,  true)
+CMD_ENTRY(boot_prof1,   TT_SHORT,  true)
+CMD_ENTRY(splice1,      TT_SHORT,  true)
+CMD_ENTRY(splice2,      TT_SHORT,  true)
+CMD_ENTRY(splice3,      TT_SHORT,  true)
+CMD_ENTRY(splice4,      TT_SHORT,  true)
+CMD_ENTRY(fallocate1,   TT_SHORT,  true)
+CMD_ENTRY(eventfd1,     TT_SHORT,  true)
+CMD_ENTRY(eventfd2,     TT_SHORT,  true)
+CMD_ENTRY(epoll1,       TT_SHORT,  true)
+CMD_ENTRY(epoll2,       TT_SHORT,  true)
+CMD_ENTRY(futex1,       TT_SHORT,  true)
+CMD_ENTRY(futex2,       TT_SHORT,  true)
+CMD_ENTRY(thread1,      TT_SHORT,  true)
+CMD_ENTRY(thread2,      TT_SHORT,  true)
 CMD_ENTRY(pollerr,      TT_SHORT,  true)
 CMD_ENTRY(pollhup,      TT_SHORT,  true)
 CMD_ENTRY(poll1,        TT_SHORT,  true)
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char steps_buf[16 * 1024];
+
+static int read_steps(void)
+{
+   return read_whole_file("/syst/boot_prof/steps",
+                          steps_buf, sizeof(steps_buf));
+}
+
+/*
+ * Check that the boot profile has the root step, the init_modules() step and
+ * the sysfs module's step nested in it, all within the root step.
+ */
+int cmd_boot_prof1(int argc, char **argv)
+{
+   unsigned long long start, cycles, root_end = 0;
+   bool found_mods = false, found_sysfs = false;
+   unsigned depth, cnt = 0;
+   char name[64];
+   char *line;
+
+   DEVSHELL_CMD_ASSERT(read_steps() > 0);
+
+   for (line = strtok(steps_buf, "\n"); line; line = strtok(NULL, "\n")) {
+
+      int rc = sscanf(line, "%u %llu %llu %*u %*u %63s",
+                      &depth, &start, &cycles, name);
+
+      DEVSHELL_CMD_ASSERT(rc == 4);
+
+      if (!cnt++) {
+         DEVSHELL_CMD_ASSERT(depth == 0 && !strcmp(name, "boot"));
+         DEVSHELL_CMD_ASSERT(cycles > 0);
+         root_end = start + cycles;
+         continue;
+      }
+
+      DEVSHELL_CMD_ASSERT(depth > 0);
+      DEVSHELL_CMD_ASSERT(start + cycles <= root_end);
+
+      if (depth == 1 && !strcmp(name, "init_modules"))
+         found_mods = true;
+
+      if (depth == 2 && !strcmp(name, "sysfs"))
+         found_sysfs = true;
+   }
+
+   printf("boot steps: %u, boot cycles: %llu\n", cnt, root_end);
+   DEVSHELL_CMD_ASSERT(found_mods);
+   DEVSHELL_CMD_ASSERT(found_sysfs);
+   return 0;
+}
@@ -8,6 +8,7 @@ int remove_test_file(const char *path, int n);
 void remove_test_file_expecting_success(const char *path, int n);
 bool running_on_tilck(void);
 void not_on_tilck_message(void);
+int read_whole_file(const char *path, char *buf, size_t buf_sz);
 
 int test_sig(void (*child_func)(void *),
              void *arg,
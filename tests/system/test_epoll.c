@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <poll.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static int epoll_add(int epfd, int fd, unsigned events)
+{
+   struct epoll_event ev = { .events = events, .data.fd = fd };
+   return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/* Level-triggered and edge-triggered events on pipes, EPOLL_CTL_* errors */
+int cmd_epoll1(int argc, char **argv)
+{
+   struct epoll_event evs[4];
+   int p1[2], p2[2], epfd, rc;
+   char buf[16];
+
+   rc = pipe(p1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = pipe(p2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   epfd = epoll_create1(EPOLL_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(epfd > 0);
+
+   printf("Add the read end of two pipes, the second one with EPOLLET\n");
+   rc = epoll_add(epfd, p1[0], EPOLLIN);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_add(epfd, p2[0], EPOLLIN | EPOLLET);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_add(epfd, p1[0], EPOLLIN);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EEXIST);
+
+   rc = epoll_add(epfd, epfd, EPOLLIN);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   printf("No events, the timeout expires\n");
+   rc = epoll_wait(epfd, evs, 4, 50);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Write to both the pipes\n");
+   rc = write(p1[1], "a", 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = write(p2[1], "b", 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+   DEVSHELL_CMD_ASSERT(evs[0].events == EPOLLIN);
+   DEVSHELL_CMD_ASSERT(evs[1].events == EPOLLIN);
+
+   printf("Without reading, only the level-triggered one is reported again\n");
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].data.fd == p1[0]);
+
+   printf("A new write generates a new edge\n");
+   rc = write(p2[1], "c", 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   printf("Drain the pipes: no more events\n");
+   rc = read(p1[0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = read(p2[0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("EPOLL_CTL_MOD with EPOLLONESHOT\n");
+   evs[0] = (struct epoll_event) {
+      .events = EPOLLIN | EPOLLONESHOT,
+      .data.u32 = 1234,
+   };
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_MOD, p1[0], &evs[0]);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(p1[1], "d", 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].data.u32 == 1234);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("EPOLL_CTL_DEL\n");
+   rc = epoll_ctl(epfd, EPOLL_CTL_DEL, p1[0], NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_DEL, p1[0], NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ENOENT);
+
+   printf("Closing the write end reports EPOLLHUP\n");
+   close(p2[1]);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].events & EPOLLHUP);
+
+   printf("Closing a registered fd removes it from the set\n");
+   close(p2[0]);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   close(p1[0]);
+   close(p1[1]);
+   close(epfd);
+   return 0;
+}
+
+/* Wake-up from a child, timeouts, poll() on the epoll fd */
+int cmd_epoll2(int argc, char **argv)
+{
+   struct epoll_event ev;
+   struct pollfd pfd;
+   int p[2], epfd, rc, wstatus;
+   pid_t child;
+
+   rc = pipe(p);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   epfd = epoll_create(1);
+   DEVSHELL_CMD_ASSERT(epfd > 0);
+
+   rc = epoll_add(epfd, p[0], EPOLLIN);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+      usleep(100 * 1000);
+      rc = write(p[1], "x", 1);
+      exit(rc == 1 ? 0 : 1);
+   }
+
+   printf("Wait for the child to write on the pipe\n");
+
+   do {
+      rc = epoll_wait(epfd, &ev, 1, 3000);
+   } while (rc < 0 && errno == EINTR);
+
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(ev.data.fd == p[0]);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && !WEXITSTATUS(wstatus));
+
+   printf("poll() on the epoll fd\n");
+   pfd = (struct pollfd) { .fd = epfd, .events = POLLIN };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1 && (pfd.revents & POLLIN));
+
+   printf("Drain the pipe, epoll_pwait() must time out\n");
+   rc = read(p[0], &ev, 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = epoll_pwait(epfd, &ev, 1, 100, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Invalid args\n");
+   rc = epoll_wait(epfd, &ev, 0, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = epoll_wait(p[0], &ev, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = epoll_create1(O_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(p[0]);
+   close(p[1]);
+   close(epfd);
+   return 0;
+}
@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+
+#include "devshell.h"
+
+/* Counter and semaphore modes, non-blocking behavior, overflow */
+int cmd_eventfd1(int argc, char **argv)
+{
+   struct pollfd pfd;
+   uint64_t val;
+   int fd, rc;
+
+   fd = eventfd(3, EFD_NONBLOCK | EFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   printf("Counter mode: read() returns the whole counter\n");
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 3);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   printf("Writes add up\n");
+   val = 5;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN | POLLOUT };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents == (POLLIN | POLLOUT));
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 10);
+
+   printf("Invalid sizes and values\n");
+   rc = read(fd, &val, 4);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   val = UINT64_MAX;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   printf("Overflow: the write would block\n");
+   val = UINT64_MAX - 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   val = 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLOUT };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   close(fd);
+
+   printf("Semaphore mode: read() decrements the counter by 1\n");
+   fd = eventfd(2, EFD_NONBLOCK | EFD_SEMAPHORE);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   for (int i = 0; i < 2; i++) {
+      rc = read(fd, &val, sizeof(val));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+      DEVSHELL_CMD_ASSERT(val == 1);
+   }
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+   close(fd);
+
+   printf("Invalid flags\n");
+   rc = eventfd(0, O_APPEND);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   return 0;
+}
+
+/* Blocking read(), woken up by a child process */
+int cmd_eventfd2(int argc, char **argv)
+{
+   uint64_t val;
+   int fd, rc, wstatus;
+   pid_t child;
+
+   fd = eventfd(0, 0);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      val = 7;
+      usleep(100 * 1000);
+      rc = write(fd, &val, sizeof(val));
+      exit(rc == sizeof(val) ? 0 : 1);
+   }
+
+   printf("Wait for the child to signal the eventfd\n");
+
+   do {
+      rc = read(fd, &val, sizeof(val));
+   } while (rc < 0 && errno == EINTR);
+
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 7);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && !WEXITSTATUS(wstatus));
+
+   close(fd);
+   return 0;
+}
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static const char test_file[] = "/tmp/test_fallocate";
+
+/* Test fallocate(), including FALLOC_FL_KEEP_SIZE and FALLOC_FL_PUNCH_HOLE */
+int cmd_fallocate1(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   const int punch_fl = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+   struct stat statbuf;
+   char *buf, *vaddr;
+   int fd, rc;
+
+   buf = malloc(4 * page_size);
+   DEVSHELL_CMD_ASSERT(buf != NULL);
+
+   fd = open(test_file, O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   printf("Pre-allocate 4 pages, keeping the size\n");
+   rc = fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fstat(fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_size == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_blocks == (blkcnt_t)(4 * page_size / 512));
+
+   printf("Write the pre-allocated pages\n");
+   memset(buf, 'x', 4 * page_size);
+   rc = write(fd, buf, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == (int)(4 * page_size));
+
+   rc = fstat(fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_blocks == (blkcnt_t)(4 * page_size / 512));
+
+   printf("Punch a hole in the middle of the file\n");
+   rc = fallocate(fd, punch_fl, page_size / 2, 2 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fstat(fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_size == (off_t)(4 * page_size));
+   DEVSHELL_CMD_ASSERT(statbuf.st_blocks == (blkcnt_t)(3 * page_size / 512));
+
+   rc = pread(fd, buf, 4 * page_size, 0);
+   DEVSHELL_CMD_ASSERT(rc == (int)(4 * page_size));
+
+   for (size_t i = 0; i < 4 * page_size; i++) {
+      const bool in_hole = i >= page_size / 2 && i < 5 * page_size / 2;
+      DEVSHELL_CMD_ASSERT(buf[i] == (in_hole ? 0 : 'x'));
+   }
+
+   printf("Punch a hole in a memory-mapped page\n");
+   vaddr = mmap(NULL, 4 * page_size, PROT_READ, MAP_SHARED, fd, 0);
+   DEVSHELL_CMD_ASSERT(vaddr != (void *)-1);
+   DEVSHELL_CMD_ASSERT(vaddr[3 * page_size] == 'x');
+
+   rc = fallocate(fd, punch_fl, 3 * page_size, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(vaddr[3 * page_size] == 0);
+
+   rc = munmap(vaddr, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Pre-allocate past EOF and extend the file\n");
+   rc = fallocate(fd, 0, 4 * page_size, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_END) == (off_t)(5 * page_size));
+
+   printf("Invalid arguments\n");
+   rc = fallocate(fd, FALLOC_FL_PUNCH_HOLE, 0, page_size);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EOPNOTSUPP);
+
+   rc = fallocate(fd, 0, 0, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(fd);
+   free(buf);
+   rc = unlink(test_file);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
@@ -14,6 +14,7 @@
 #include <sys/syscall.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <dirent.h>
 
 #include "devshell.h"
@@ -40,6 +41,62 @@ int cmd_fs7(int argc, char **argv)
    return 0;
 }
 
+/* Test readv(), writev(), preadv() and pwritev() across page boundaries */
+int cmd_fs8(int argc, char **argv)
+{
+   static char buf1[3000], buf2[3000], rbuf1[3000], rbuf2[3000];
+   struct iovec iov[2];
+   int fd, rc;
+
+   memset(buf1, 'a', sizeof(buf1));
+   memset(buf2, 'b', sizeof(buf2));
+
+   fd = open("/tmp/test_fs8", O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   iov[0] = (struct iovec) { .iov_base = buf1, .iov_len = sizeof(buf1) };
+   iov[1] = (struct iovec) { .iov_base = buf2, .iov_len = sizeof(buf2) };
+
+   rc = writev(fd, iov, 2);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(buf1) + sizeof(buf2));
+
+   /* Overwrite 200 bytes across the page boundary, without moving the pos */
+   memset(buf1, 'c', 200);
+   rc = pwritev(fd, iov, 1, 4000);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(buf1));
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == 6000);
+
+   iov[0] = (struct iovec) { .iov_base = rbuf1, .iov_len = sizeof(rbuf1) };
+   iov[1] = (struct iovec) { .iov_base = rbuf2, .iov_len = sizeof(rbuf2) };
+
+   rc = preadv(fd, iov, 2, 0);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(rbuf1) + sizeof(rbuf2));
+   DEVSHELL_CMD_ASSERT(rbuf1[2999] == 'a');
+   DEVSHELL_CMD_ASSERT(rbuf2[0] == 'b');
+   DEVSHELL_CMD_ASSERT(rbuf2[999] == 'b');
+   DEVSHELL_CMD_ASSERT(rbuf2[1000] == 'c');
+   DEVSHELL_CMD_ASSERT(rbuf2[1199] == 'c');
+   DEVSHELL_CMD_ASSERT(rbuf2[1200] == 'a');
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == 6000);
+
+   rc = lseek(fd, 5990, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 5990);
+
+   rc = readv(fd, iov, 2);
+   DEVSHELL_CMD_ASSERT(rc == 1010);
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == 7000);
+
+   /* A bad buffer after a good one: expect a short read */
+   iov[1].iov_base = (void *)0xabc;
+   rc = preadv(fd, iov, 2, 0);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(rbuf1));
+
+   close(fd);
+   rc = unlink("/tmp/test_fs8");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
 static const char test_str[] = "this is a test string\n";
 static const char test_str2[] = "hello from the 2nd page";
 static const char test_str_exp[] = "This is a test string\n";
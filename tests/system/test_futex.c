@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static const char futex_file[] = "/tmp/futex_file";
+
+static long
+futex(int *uaddr, int op, int val,
+      const struct timespec *timeout, int *uaddr2, int val3)
+{
+   return syscall(SYS_futex, uaddr, op, val, timeout, uaddr2, val3);
+}
+
+/* Private futexes: EAGAIN, timeouts, wake-ups without waiters, FUTEX_WAKE_OP */
+int cmd_futex1(int argc, char **argv)
+{
+   struct timespec ts = { .tv_sec = 0, .tv_nsec = 50 * 1000 * 1000 };
+   int word = 1, word2 = 5;
+   long rc;
+
+   printf("FUTEX_WAIT with a different value returns EAGAIN\n");
+   rc = futex(&word, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   printf("FUTEX_WAIT with a timeout returns ETIMEDOUT\n");
+   rc = futex(&word, FUTEX_WAIT_PRIVATE, 1, &ts, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ETIMEDOUT);
+
+   printf("FUTEX_WAKE without waiters\n");
+   rc = futex(&word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Invalid args\n");
+   rc = futex((int *)((char *)&word + 1), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = futex(&word, FUTEX_WAIT_BITSET_PRIVATE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   ts.tv_nsec = 2000 * 1000 * 1000;
+   rc = futex(&word, FUTEX_WAIT_PRIVATE, 1, &ts, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = futex(NULL, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EFAULT);
+
+   printf("FUTEX_WAKE_OP modifies the second word\n");
+   rc = futex(&word, FUTEX_WAKE_OP_PRIVATE, 1, (void *)1, &word2,
+              FUTEX_OP(FUTEX_OP_ADD, 3, FUTEX_OP_CMP_EQ, 5));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(word2 == 8);
+
+   rc = futex(&word, FUTEX_WAKE_OP_PRIVATE, 1, (void *)1, &word2,
+              FUTEX_OP((FUTEX_OP_OPARG_SHIFT | FUTEX_OP_OR), 4,
+                       FUTEX_OP_CMP_GT, 0));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(word2 == (8 | 16));
+
+   printf("FUTEX_CMP_REQUEUE with a different value returns EAGAIN\n");
+   rc = futex(&word, FUTEX_CMP_REQUEUE_PRIVATE, 1, (void *)1, &word2, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   rc = futex(&word, FUTEX_CMP_REQUEUE_PRIVATE, 1, (void *)1, &word2, 1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/* Shared futexes in a file mapping: wait/wake and requeue between processes */
+int cmd_futex2(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   int fd, rc, wstatus;
+   int *words;
+   pid_t child;
+   long ret;
+
+   fd = open(futex_file, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = ftruncate(fd, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   words = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   DEVSHELL_CMD_ASSERT(words != MAP_FAILED);
+
+   words[0] = 0;
+   words[1] = 0;
+   words[2] = 0;
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      /* Wait on words[0]: the parent will requeue us on words[1] */
+      while (__atomic_load_n(&words[0], __ATOMIC_SEQ_CST) == 0) {
+
+         ret = futex(&words[0], FUTEX_WAIT, 0, NULL, NULL, 0);
+
+         if (ret < 0 && errno != EAGAIN && errno != EINTR)
+            exit(1);
+      }
+
+      exit(0);
+   }
+
+   printf("Requeue the child from words[0] to words[1]\n");
+
+   do {
+
+      usleep(20 * 1000);
+      ret = futex(&words[0], FUTEX_CMP_REQUEUE, 0, (void *)1, &words[1], 0);
+      DEVSHELL_CMD_ASSERT(ret >= 0);
+
+   } while (ret == 0);
+
+   DEVSHELL_CMD_ASSERT(ret == 1);
+
+   printf("FUTEX_REQUEUE counts the requeued waiters too\n");
+   ret = futex(&words[1], FUTEX_REQUEUE, 0, (void *)1, &words[2], 0);
+   DEVSHELL_CMD_ASSERT(ret == 1);
+
+   printf("Waking up words[0] must not wake the child anymore\n");
+   words[0] = 1;
+   ret = futex(&words[0], FUTEX_WAKE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(ret == 0);
+
+   printf("Wake the child through words[2]\n");
+   ret = futex(&words[2], FUTEX_WAKE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(ret == 1);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && !WEXITSTATUS(wstatus));
+
+   munmap(words, page_size);
+   close(fd);
+   unlink(futex_file);
+   return 0;
+}
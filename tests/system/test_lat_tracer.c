@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char stats_buf[8 * 1024];
+
+static int read_stats(const char *kind)
+{
+   char path[64];
+
+   sprintf(path, "/syst/lat_tracer/%s", kind);
+   return read_whole_file(path, stats_buf, sizeof(stats_buf));
+}
+
+/*
+ * Check the format of the stats of the given kind. Returns the number of
+ * sections measured or -1 in case of a malformed file.
+ */
+static long long check_stats(const char *kind)
+{
+   unsigned long long sections, tot_cycles, max_cycles, prev = ~0ull;
+   char start[64], end[64];
+   char *line;
+
+   if (read_stats(kind) <= 0)
+      return -1;
+
+   line = strtok(stats_buf, "\n");
+
+   if (!line || sscanf(line, "sections %llu", &sections) != 1)
+      return -1;
+
+   line = strtok(NULL, "\n");
+
+   if (!line || sscanf(line, "tot_cycles %llu", &tot_cycles) != 1)
+      return -1;
+
+   while ((line = strtok(NULL, "\n"))) {
+
+      if (sscanf(line, "%llu %63s %63s", &max_cycles, start, end) != 3)
+         return -1;
+
+      if (max_cycles > prev)
+         return -1; /* not sorted */
+
+      prev = max_cycles;
+   }
+
+   printf("%s: %llu sections, worst: %llu cycles\n",
+          kind, sections, prev != ~0ull ? prev : 0);
+
+   return (long long)sections;
+}
+
+/* Check the IRQs-off and preemption-off latency tracer, when enabled */
+int cmd_lat_tracer1(int argc, char **argv)
+{
+   long long irqsoff, preemptoff;
+   int fd;
+
+   irqsoff = check_stats("irqsoff");
+   preemptoff = check_stats("preemptoff");
+
+   DEVSHELL_CMD_ASSERT(irqsoff >= 0);
+   DEVSHELL_CMD_ASSERT(preemptoff >= 0);
+
+   if (!irqsoff && !preemptoff) {
+      printf("Latency tracer disabled, skipping\n");
+      return 0;
+   }
+
+   /* Every syscall disables the preemption at least once */
+   DEVSHELL_CMD_ASSERT(preemptoff > 0);
+
+   fd = open("/syst/lat_tracer/reset", O_WRONLY);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+   DEVSHELL_CMD_ASSERT(write(fd, "1", 1) == 1);
+   close(fd);
+
+   /* After the reset, only the sections since then are counted */
+   DEVSHELL_CMD_ASSERT(check_stats("preemptoff") < preemptoff);
+   return 0;
+}
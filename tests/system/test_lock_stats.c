@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char table_buf[64 * 1024];
+
+static int read_table(void)
+{
+   return read_whole_file("/syst/lock_stats/table",
+                          table_buf, sizeof(table_buf));
+}
+
+/* Returns the acquisitions of the given lock class or -1 if not found */
+static long get_acquisitions(const char *class_name)
+{
+   char *line;
+   unsigned acq;
+   long ret = -1;
+   int name_off;
+
+   for (line = strtok(table_buf, "\n"); line; line = strtok(NULL, "\n")) {
+
+      name_off = -1;
+      sscanf(line, "%*s %u %*u %*u %*u %*u %*u %n", &acq, &name_off);
+
+      if (name_off < 0)
+         return -2;
+
+      if (!strcmp(line + name_off, class_name))
+         ret = acq;
+   }
+
+   return ret;
+}
+
+/* Check that the lock stats count the acquisitions of the pipe mutexes */
+int cmd_lock_stats1(int argc, char **argv)
+{
+   long before, after;
+   int fds[2], rc;
+   char c = 'x';
+
+   rc = read_table();
+   DEVSHELL_CMD_ASSERT(rc >= 0);
+
+   if (!rc) {
+      printf("Lock stats disabled, skipping\n");
+      return 0;
+   }
+
+   before = get_acquisitions("pipe");
+   DEVSHELL_CMD_ASSERT(before >= -1);
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < 10; i++) {
+      DEVSHELL_CMD_ASSERT(write(fds[1], &c, 1) == 1);
+      DEVSHELL_CMD_ASSERT(read(fds[0], &c, 1) == 1);
+   }
+
+   close(fds[0]);
+   close(fds[1]);
+
+   DEVSHELL_CMD_ASSERT(read_table() > 0);
+   after = get_acquisitions("pipe");
+
+   printf("pipe lock acquisitions: %ld -> %ld\n", before, after);
+   DEVSHELL_CMD_ASSERT(after >= (before > 0 ? before : 0) + 20);
+   return 0;
+}
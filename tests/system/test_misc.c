@@ -28,6 +28,25 @@ void not_on_tilck_message(void)
    fprintf(stderr, "[SKIP]: Test designed to run exclusively on Tilck\n");
 }
 
+/*
+ * Read the whole file (e.g. a /syst one) in `buf`, as a NUL-terminated string,
+ * truncating it if it does not fit. Returns its length or -1 on error.
+ */
+int read_whole_file(const char *path, char *buf, size_t buf_sz)
+{
+   int fd, rc, tot = 0;
+
+   if ((fd = open(path, O_RDONLY)) < 0)
+      return -1;
+
+   while ((rc = read(fd, buf + tot, buf_sz - 1 - (size_t)tot)) > 0)
+      tot += rc;
+
+   close(fd);
+   buf[tot] = 0;
+   return tot;
+}
+
 
 int cmd_loop(int argc, char **argv)
 {
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char snapshot_buf[64 * 1024];
+
+/* Returns the number of values of the given object or -1 if not found */
+static int
+get_obj(const char *type, const char *name, unsigned long long *val)
+{
+   char line_type[16], line_name[64];
+   char *line, *p, *end;
+   unsigned long long v;
+   int cnt, off;
+
+   for (line = strtok(snapshot_buf, "\n"); line; line = strtok(NULL, "\n")) {
+
+      if (sscanf(line, "%15s %63s %n", line_type, line_name, &off) != 2)
+         continue;
+
+      if (strcmp(line_type, type) || strcmp(line_name, name))
+         continue;
+
+      for (cnt = 0, p = line + off; ; cnt++, p = end) {
+
+         v = strtoull(p, &end, 10);
+
+         if (end == p)
+            break;
+
+         if (!cnt)
+            *val = v;
+      }
+
+      return cnt;
+   }
+
+   return -1;
+}
+
+/*
+ * Check that /syst/perf/snapshot has the timer ticks counter and the sched
+ * histograms, and that it matches the per-object files.
+ */
+int cmd_perf1(int argc, char **argv)
+{
+   unsigned long long ticks, file_ticks, tmp;
+   char buf[64];
+   int rc;
+
+   rc = read_whole_file("/syst/perf/snapshot",
+                        snapshot_buf, sizeof(snapshot_buf));
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   DEVSHELL_CMD_ASSERT(!strncmp(snapshot_buf, "ts ", 3));
+
+   rc = get_obj("counter", "timer.ticks", &ticks);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(ticks > 0);
+
+   rc = read_whole_file("/syst/perf/snapshot",
+                        snapshot_buf, sizeof(snapshot_buf));
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   rc = get_obj("hist", "sched.wakeup_lat", &tmp);
+   DEVSHELL_CMD_ASSERT(rc > 1);
+
+   rc = read_whole_file("/syst/perf/timer/ticks", buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc > 0);
+
+   file_ticks = strtoull(buf, NULL, 10);
+   printf("ticks: snapshot: %llu, file: %llu\n", ticks, file_ticks);
+   DEVSHELL_CMD_ASSERT(file_ticks >= ticks);
+   return 0;
+}
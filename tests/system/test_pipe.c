@@ -1,5 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -469,3 +471,192 @@ int cmd_pipe5(int argc, char **argv)
 
    return 0;
 }
+
+static const char pipe_max_size_file[] = "/syst/fs/pipe_max_size";
+
+static int fill_pipe_nonblock(int wfd, unsigned char *val)
+{
+   unsigned char buf[256];
+   int tot = 0, rc;
+
+   do {
+
+      for (int i = 0; i < (int)sizeof(buf); i++)
+         buf[i] = (*val)++;
+
+      rc = write(wfd, buf, sizeof(buf));
+
+      if (rc > 0) {
+         *val -= (unsigned char)(sizeof(buf) - rc);
+         tot += rc;
+      }
+
+   } while (rc > 0);
+
+   return rc < 0 && errno == EAGAIN ? tot : -1;
+}
+
+static bool check_pipe_data(int rfd, int len, unsigned char *val)
+{
+   unsigned char buf[256];
+   int rc;
+
+   while (len > 0) {
+
+      rc = read(rfd, buf, MIN(len, (int)sizeof(buf)));
+
+      if (rc <= 0)
+         return false;
+
+      for (int i = 0; i < rc; i++) {
+         if (buf[i] != (*val)++)
+            return false;
+      }
+
+      len -= rc;
+   }
+
+   return true;
+}
+
+static int set_pipe_max_size(long val)
+{
+   char buf[32];
+   int fd, rc;
+
+   if ((fd = open(pipe_max_size_file, O_WRONLY)) < 0)
+      return -1;
+
+   sprintf(buf, "%ld\n", val);
+   rc = write(fd, buf, strlen(buf));
+   close(fd);
+   return rc > 0 ? 0 : -1;
+}
+
+/* F_SETPIPE_SZ and F_GETPIPE_SZ: resize with data in the pipe, limits */
+int cmd_pipe6(int argc, char **argv)
+{
+   unsigned char wval = 0, rval = 0;
+   int fds[2], rc, sz;
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < 2; i++) {
+      rc = fcntl(fds[i], F_SETFL, O_NONBLOCK);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   sz = fcntl(fds[0], F_GETPIPE_SZ);
+   printf("Default pipe size: %d\n", sz);
+   DEVSHELL_CMD_ASSERT(sz == getpagesize());
+
+   rc = fill_pipe_nonblock(fds[1], &wval);
+   DEVSHELL_CMD_ASSERT(rc == sz);
+
+   printf("Grow a full pipe: the size is rounded up to a power of 2\n");
+   rc = fcntl(fds[1], F_SETPIPE_SZ, 3 * sz);
+   DEVSHELL_CMD_ASSERT(rc == 4 * sz);
+   DEVSHELL_CMD_ASSERT(fcntl(fds[0], F_GETPIPE_SZ) == 4 * sz);
+
+   rc = fill_pipe_nonblock(fds[1], &wval);
+   DEVSHELL_CMD_ASSERT(rc == 3 * sz);
+
+   printf("Make the data wrap around the end of the ring\n");
+   DEVSHELL_CMD_ASSERT(check_pipe_data(fds[0], 2 * sz + 100, &rval));
+
+   rc = fill_pipe_nonblock(fds[1], &wval);
+   DEVSHELL_CMD_ASSERT(rc == 2 * sz + 100);
+
+   printf("Shrinking below the amount of data fails with EBUSY\n");
+   rc = fcntl(fds[0], F_SETPIPE_SZ, 2 * sz);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBUSY);
+
+   printf("Shrink the pipe with wrapped data in it\n");
+   DEVSHELL_CMD_ASSERT(check_pipe_data(fds[0], 2 * sz + 200, &rval));
+
+   rc = fcntl(fds[0], F_SETPIPE_SZ, 2 * sz);
+   DEVSHELL_CMD_ASSERT(rc == 2 * sz);
+
+   DEVSHELL_CMD_ASSERT(check_pipe_data(fds[0], 2 * sz - 200, &rval));
+   DEVSHELL_CMD_ASSERT(read(fds[0], &rc, 1) < 0 && errno == EAGAIN);
+
+   rc = fill_pipe_nonblock(fds[1], &wval);
+   DEVSHELL_CMD_ASSERT(rc == 2 * sz);
+   DEVSHELL_CMD_ASSERT(check_pipe_data(fds[0], 2 * sz, &rval));
+
+   printf("Invalid args\n");
+   rc = fcntl(fds[0], F_SETPIPE_SZ, -1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = fcntl(0, F_GETPIPE_SZ);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBADF);
+
+   if (set_pipe_max_size(sz) == 0) {
+
+      printf("Sizes above %s fail with EPERM\n", pipe_max_size_file);
+      rc = fcntl(fds[0], F_SETPIPE_SZ, 2 * sz);
+      DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+      rc = fcntl(fds[0], F_SETPIPE_SZ, sz);
+      DEVSHELL_CMD_ASSERT(rc == sz);
+
+      rc = set_pipe_max_size(1024 * 1024);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   close(fds[0]);
+   close(fds[1]);
+   return 0;
+}
+
+/* Writers handing data directly to a blocked reader: check data and order */
+int cmd_pipe7(int argc, char **argv)
+{
+   static unsigned char buf[6000];
+   unsigned char rval = 0;
+   int fds[2], rc, wstatus;
+   pid_t child;
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      unsigned char wval = 0;
+      close(fds[0]);
+
+      for (int i = 0; i < 3; i++) {
+
+         usleep(50 * 1000); /* Let the parent block in read() */
+
+         for (int j = 0; j < (int)sizeof(buf); j++)
+            buf[j] = wval++;
+
+         for (int off = 0; off < (int)sizeof(buf); off += rc) {
+            if ((rc = write(fds[1], buf + off, sizeof(buf) - off)) <= 0)
+               exit(1);
+         }
+      }
+
+      exit(0);
+   }
+
+   close(fds[1]);
+
+   printf("Read 3 x %d bytes with small reads\n", (int)sizeof(buf));
+   DEVSHELL_CMD_ASSERT(check_pipe_data(fds[0], 3 * sizeof(buf), &rval));
+
+   rc = read(fds[0], buf, 1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && !WEXITSTATUS(wstatus));
+
+   close(fds[0]);
+   return 0;
+}
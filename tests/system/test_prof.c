@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char folded_buf[64 * 1024];
+
+static long read_prof_ulong(const char *name)
+{
+   char path[64], buf[32];
+
+   sprintf(path, "/syst/prof/%s", name);
+   return read_whole_file(path, buf, sizeof(buf)) > 0 ? atol(buf) : -1;
+}
+
+/* Sample a busy loop with the profiler and check the folded stacks */
+int cmd_prof1(int argc, char **argv)
+{
+   int rc, tot;
+   time_t end;
+   char *line;
+
+   printf("Invalid sampling rates\n");
+   rc = tilck_prof_cmd(TILCK_PROF_START, 0);
+   DEVSHELL_CMD_ASSERT(rc == -EINVAL);
+
+   rc = tilck_prof_cmd(TILCK_PROF_START, 1000 * 1000);
+   DEVSHELL_CMD_ASSERT(rc == -EINVAL);
+
+   rc = tilck_prof_cmd(123, 0);
+   DEVSHELL_CMD_ASSERT(rc == -EINVAL);
+
+   printf("Sample a busy loop for 1-2 seconds\n");
+   rc = tilck_prof_cmd(TILCK_PROF_RESET, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = tilck_prof_cmd(TILCK_PROF_START, 50);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(read_prof_ulong("hz") > 0);
+
+   end = time(NULL) + 2;
+
+   while (time(NULL) < end)
+      getppid();
+
+   rc = tilck_prof_cmd(TILCK_PROF_STOP, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(read_prof_ulong("hz") == 0);
+   DEVSHELL_CMD_ASSERT(read_prof_ulong("samples") > 0);
+
+   printf("Read the folded stacks\n");
+   tot = read_whole_file("/syst/prof/folded", folded_buf, sizeof(folded_buf));
+   DEVSHELL_CMD_ASSERT(tot > 0);
+   DEVSHELL_CMD_ASSERT(folded_buf[tot - 1] == '\n');
+
+   /* Every line is: "func1;func2;...;funcN <count>" */
+   for (line = strtok(folded_buf, "\n"); line; line = strtok(NULL, "\n")) {
+      char *cnt = strrchr(line, ' ');
+      DEVSHELL_CMD_ASSERT(cnt != NULL && cnt != line);
+      DEVSHELL_CMD_ASSERT(atoi(cnt + 1) > 0);
+   }
+
+   rc = tilck_prof_cmd(TILCK_PROF_RESET, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(read_prof_ulong("samples") == 0);
+   return 0;
+}
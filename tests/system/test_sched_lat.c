@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char sched_buf[16 * 1024];
+
+static int read_sched_file(const char *name)
+{
+   char path[64];
+
+   sprintf(path, "/syst/sched/%s", name);
+   return read_whole_file(path, sched_buf, sizeof(sched_buf));
+}
+
+static long hist_total(void)
+{
+   long tot = 0;
+   char *line, *cnt;
+
+   /* Every line is: "[lo, hi) us: <count>" */
+   for (line = strtok(sched_buf, "\n"); line; line = strtok(NULL, "\n")) {
+
+      if (line[0] != '[' || !(cnt = strstr(line, "us: ")))
+         return -1;
+
+      tot += atol(cnt + 4);
+   }
+
+   return tot;
+}
+
+/* Check that sleeping updates the latency histograms */
+int cmd_sched_lat1(int argc, char **argv)
+{
+   char prefix[32];
+   long before, after;
+   bool found = false;
+   char *line;
+
+   DEVSHELL_CMD_ASSERT(read_sched_file("wakeup_lat") > 0);
+   DEVSHELL_CMD_ASSERT((before = hist_total()) >= 0);
+
+   for (int i = 0; i < 5; i++)
+      usleep(10 * 1000);
+
+   DEVSHELL_CMD_ASSERT(read_sched_file("wakeup_lat") > 0);
+   DEVSHELL_CMD_ASSERT((after = hist_total()) >= before + 5);
+
+   DEVSHELL_CMD_ASSERT(read_sched_file("rq_wait") > 0);
+   DEVSHELL_CMD_ASSERT(hist_total() >= after);
+
+   printf("Wakeups: %ld -> %ld\n", before, after);
+
+   /* Look for our own line in the per-task histograms */
+   DEVSHELL_CMD_ASSERT(read_sched_file("tasks") > 0);
+   sprintf(prefix, "%d wakeup ", getpid());
+
+   for (line = strtok(sched_buf, "\n"); line; line = strtok(NULL, "\n")) {
+      if (!strncmp(line, prefix, strlen(prefix)))
+         found = true;
+   }
+
+   DEVSHELL_CMD_ASSERT(found);
+   return 0;
+}
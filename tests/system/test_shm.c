@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/syscall.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+#ifndef F_ADD_SEALS
+   #define F_ADD_SEALS        1033
+   #define F_GET_SEALS        1034
+   #define F_SEAL_SEAL        0x0001
+   #define F_SEAL_SHRINK      0x0002
+   #define F_SEAL_GROW        0x0004
+   #define F_SEAL_WRITE       0x0008
+#endif
+
+#ifndef MFD_ALLOW_SEALING
+   #define MFD_CLOEXEC        0x0001U
+   #define MFD_ALLOW_SEALING  0x0002U
+#endif
+
+static int test_memfd_create(const char *name, unsigned flags)
+{
+   return syscall(SYS_memfd_create, name, flags);
+}
+
+static void shm_wait_child(pid_t child)
+{
+   int wstatus, rc;
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+}
+
+/* memfd_create(), shared file mappings across fork and file seals */
+int cmd_shm1(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   char buf[32];
+   char *va;
+   pid_t child;
+   int fd, rc;
+
+   fd = test_memfd_create("shm1", MFD_ALLOW_SEALING);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   rc = ftruncate(fd, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(fd, "parent", 6);
+   DEVSHELL_CMD_ASSERT(rc == 6);
+
+   va = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   DEVSHELL_CMD_ASSERT(va != MAP_FAILED);
+   DEVSHELL_CMD_ASSERT(!memcmp(va, "parent", 6));
+
+   printf("The child's writes through the mapping are visible\n");
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+      memcpy(va, "child!", 6);
+      exit(0);
+   }
+
+   shm_wait_child(child);
+   DEVSHELL_CMD_ASSERT(!memcmp(va, "child!", 6));
+
+   rc = pread(fd, buf, 6, 0);
+   DEVSHELL_CMD_ASSERT(rc == 6);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "child!", 6));
+
+   printf("F_SEAL_WRITE fails with EBUSY while a writable mapping exists\n");
+   rc = fcntl(fd, F_GET_SEALS);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBUSY);
+
+   rc = munmap(va, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_GROW);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(fd, F_GET_SEALS);
+   DEVSHELL_CMD_ASSERT(rc == (F_SEAL_WRITE | F_SEAL_GROW));
+
+   printf("Writes and growing are denied on a sealed memfd\n");
+   rc = pwrite(fd, "x", 1, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+   rc = ftruncate(fd, 2 * page_size);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+   va = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   DEVSHELL_CMD_ASSERT(va == MAP_FAILED && errno == EPERM);
+
+   va = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+   DEVSHELL_CMD_ASSERT(va != MAP_FAILED);
+   DEVSHELL_CMD_ASSERT(!memcmp(va, "child!", 6));
+   munmap(va, page_size);
+
+   printf("Shrinking is still allowed\n");
+   rc = ftruncate(fd, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(fd, F_ADD_SEALS, F_SEAL_SEAL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+   close(fd);
+
+   printf("Without MFD_ALLOW_SEALING, the memfd cannot be sealed\n");
+   fd = test_memfd_create("shm1b", MFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   rc = fcntl(fd, F_GET_SEALS);
+   DEVSHELL_CMD_ASSERT(rc == F_SEAL_SEAL);
+
+   rc = fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+   rc = fcntl(fd, F_GETFD);
+   DEVSHELL_CMD_ASSERT(rc == FD_CLOEXEC);
+   close(fd);
+   return 0;
+}
+
+/* SysV shared memory: shmget(), shmat() across fork, IPC_STAT, IPC_RMID */
+int cmd_shm2(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   struct shmid_ds ds;
+   pid_t child;
+   char *va;
+   int id, rc;
+
+   id = shmget(IPC_PRIVATE, 2 * page_size, IPC_CREAT | 0600);
+   DEVSHELL_CMD_ASSERT(id >= 0);
+
+   va = shmat(id, NULL, 0);
+   DEVSHELL_CMD_ASSERT(va != (void *)-1);
+
+   rc = shmctl(id, IPC_STAT, &ds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ds.shm_segsz == 2 * page_size);
+   DEVSHELL_CMD_ASSERT(ds.shm_nattch == 1);
+   DEVSHELL_CMD_ASSERT(ds.shm_cpid == getpid());
+
+   strcpy(va + page_size, "parent");
+
+   printf("The child inherits the attachment and shares the memory\n");
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      if (strcmp(va + page_size, "parent"))
+         exit(1);
+
+      if (shmctl(id, IPC_STAT, &ds) || ds.shm_nattch != 2)
+         exit(2);
+
+      strcpy(va, "child");
+      exit(0);
+   }
+
+   shm_wait_child(child);
+   DEVSHELL_CMD_ASSERT(!strcmp(va, "child"));
+
+   rc = shmctl(id, IPC_STAT, &ds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ds.shm_nattch == 1);
+   DEVSHELL_CMD_ASSERT(ds.shm_lpid == child);
+
+   printf("IPC_RMID keeps the segment alive until the last detach\n");
+   rc = shmctl(id, IPC_RMID, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(!strcmp(va, "child"));
+
+   rc = shmdt(va);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = shmdt(va);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = shmctl(id, IPC_STAT, &ds);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   return 0;
+}
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+
+#include "devshell.h"
+
+/* Read blocked signals through a signalfd, including the ignored SIGCHLD */
+int cmd_signalfd1(int argc, char **argv)
+{
+   struct signalfd_siginfo info[2];
+   sigset_t set, old_set;
+   struct pollfd pfd;
+   int sfd, sfd2, rc, wstatus;
+   pid_t child;
+
+   sigemptyset(&set);
+   sigaddset(&set, SIGUSR1);
+   sigaddset(&set, SIGUSR2);
+   sigaddset(&set, SIGCHLD);
+   rc = sigprocmask(SIG_BLOCK, &set, &old_set);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   sigemptyset(&set);
+   sigaddset(&set, SIGUSR1);
+   sfd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(sfd > 0);
+
+   printf("No pending signals: the signalfd is not readable\n");
+   rc = read(sfd, info, sizeof(info));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   rc = read(sfd, info, sizeof(info[0]) - 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   printf("A blocked SIGUSR1 becomes readable\n");
+   rc = kill(getpid(), SIGUSR1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   pfd = (struct pollfd) { .fd = sfd, .events = POLLIN };
+   rc = poll(&pfd, 1, 1000);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents == POLLIN);
+
+   rc = read(sfd, info, sizeof(info));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(info[0]));
+   DEVSHELL_CMD_ASSERT(info[0].ssi_signo == SIGUSR1);
+
+   rc = read(sfd, info, sizeof(info));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   printf("Change the mask and read two signals at once\n");
+   sigaddset(&set, SIGUSR2);
+   rc = signalfd(sfd, &set, 0);
+   DEVSHELL_CMD_ASSERT(rc == sfd);
+
+   raise(SIGUSR2);
+   raise(SIGUSR1);
+
+   rc = read(sfd, info, sizeof(info));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(info));
+   DEVSHELL_CMD_ASSERT(info[0].ssi_signo == SIGUSR1);
+   DEVSHELL_CMD_ASSERT(info[1].ssi_signo == SIGUSR2);
+
+   printf("SIGCHLD is ignored by default, but not when blocked\n");
+   sigemptyset(&set);
+   sigaddset(&set, SIGCHLD);
+   sfd2 = signalfd(-1, &set, 0);
+   DEVSHELL_CMD_ASSERT(sfd2 > 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child)
+      exit(0);
+
+   rc = read(sfd2, info, sizeof(info));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(info[0]));
+   DEVSHELL_CMD_ASSERT(info[0].ssi_signo == SIGCHLD);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+
+   printf("Invalid flags\n");
+   rc = signalfd(sfd, &set, 0x1234);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(sfd2);
+   close(sfd);
+
+   rc = sigprocmask(SIG_SETMASK, &old_set, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
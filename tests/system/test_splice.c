@@ -0,0 +1,338 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static const char splice_src_file[] = "/tmp/splice_src";
+static const char splice_dst_file[] = "/tmp/splice_dst";
+
+static int create_src_file(size_t size)
+{
+   char buf[256];
+   int fd, rc;
+
+   fd = open(splice_src_file, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   for (size_t i = 0; i < sizeof(buf); i++)
+      buf[i] = (char)('a' + i % 26);
+
+   for (size_t written = 0; written < size; written += sizeof(buf)) {
+      rc = write(fd, buf, MIN(sizeof(buf), size - written));
+      DEVSHELL_CMD_ASSERT(rc > 0);
+   }
+
+   return fd;
+}
+
+static void check_dst_file(size_t size, off_t src_off)
+{
+   char buf[256];
+   int fd, rc;
+   size_t tot = 0;
+
+   fd = open(splice_dst_file, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   while ((rc = read(fd, buf, sizeof(buf))) > 0) {
+
+      for (int i = 0; i < rc; i++) {
+         const size_t src_pos = (size_t)src_off + tot + i;
+         DEVSHELL_CMD_ASSERT(buf[i] == (char)('a' + src_pos % 256 % 26));
+      }
+
+      tot += rc;
+   }
+
+   DEVSHELL_CMD_ASSERT(tot == size);
+   close(fd);
+}
+
+/* splice() and sendfile() between files and pipes */
+int cmd_splice1(int argc, char **argv)
+{
+   const size_t size = 10000;
+   int pfd[2], src, dst, rc;
+   size_t tot;
+   loff_t off;
+
+   src = create_src_file(size);
+   dst = open(splice_dst_file, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+   DEVSHELL_CMD_ASSERT(dst > 0);
+
+   rc = pipe(pfd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Copy a file through a pipe with splice()\n");
+
+   for (off = 0, tot = 0; tot < size; tot += rc) {
+
+      rc = splice(src, &off, pfd[1], NULL, size - tot, 0);
+      DEVSHELL_CMD_ASSERT(rc > 0);
+
+      rc = splice(pfd[0], NULL, dst, NULL, rc, 0);
+      DEVSHELL_CMD_ASSERT(rc > 0);
+   }
+
+   DEVSHELL_CMD_ASSERT(off == (loff_t)size);
+   DEVSHELL_CMD_ASSERT(lseek(src, 0, SEEK_CUR) == (off_t)size);
+   check_dst_file(size, 0);
+
+   printf("Both ends being a file is not allowed\n");
+   rc = splice(src, NULL, dst, NULL, 10, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   printf("Offset on a pipe is not allowed\n");
+   off = 0;
+   rc = splice(src, NULL, pfd[1], &off, 10, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ESPIPE);
+
+   printf("Copy part of a file with sendfile()\n");
+   close(dst);
+   dst = open(splice_dst_file, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+   DEVSHELL_CMD_ASSERT(dst > 0);
+
+   lseek(src, 0, SEEK_SET);
+   off = 1000;
+
+   rc = sendfile(dst, src, &off, 5000);
+   DEVSHELL_CMD_ASSERT(rc == 5000);
+   DEVSHELL_CMD_ASSERT(off == 6000);
+   DEVSHELL_CMD_ASSERT(lseek(src, 0, SEEK_CUR) == 0);
+   check_dst_file(5000, 1000);
+
+   printf("sendfile() to a pipe\n");
+   rc = sendfile(pfd[1], src, NULL, 100);
+   DEVSHELL_CMD_ASSERT(rc == 100);
+   DEVSHELL_CMD_ASSERT(lseek(src, 0, SEEK_CUR) == 100);
+
+   close(pfd[0]);
+   close(pfd[1]);
+   close(src);
+   close(dst);
+   unlink(splice_src_file);
+   unlink(splice_dst_file);
+   return 0;
+}
+
+/* tee(), vmsplice() and sendfile() between pipes */
+int cmd_splice2(int argc, char **argv)
+{
+   static const char msg1[] = "hello ";
+   static const char msg2[] = "world";
+   int p1[2], p2[2], rc;
+   struct iovec iov[2];
+   char buf1[32] = {0};
+   char buf2[32] = {0};
+
+   rc = pipe(p1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = pipe(p2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   iov[0] = (struct iovec) { .iov_base = (void *)msg1, .iov_len = 6 };
+   iov[1] = (struct iovec) { .iov_base = (void *)msg2, .iov_len = 5 };
+
+   printf("vmsplice() user buffers into a pipe\n");
+   rc = vmsplice(p1[1], iov, 2, 0);
+   DEVSHELL_CMD_ASSERT(rc == 11);
+
+   printf("tee() the data to another pipe\n");
+   rc = tee(p1[0], p2[1], 100, 0);
+   DEVSHELL_CMD_ASSERT(rc == 11);
+
+   printf("Check both pipes have the data\n");
+   rc = read(p1[0], buf1, sizeof(buf1));
+   DEVSHELL_CMD_ASSERT(rc == 11);
+
+   rc = read(p2[0], buf2, sizeof(buf2));
+   DEVSHELL_CMD_ASSERT(rc == 11);
+
+   DEVSHELL_CMD_ASSERT(!strcmp(buf1, "hello world"));
+   DEVSHELL_CMD_ASSERT(!strcmp(buf2, "hello world"));
+
+   printf("tee() on an empty pipe with SPLICE_F_NONBLOCK\n");
+   rc = tee(p1[0], p2[1], 100, SPLICE_F_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   printf("splice() between two pipes\n");
+   rc = write(p1[1], "abc", 3);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+
+   rc = splice(p1[0], NULL, p2[1], NULL, 100, 0);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+
+   printf("vmsplice() from a pipe into user buffers\n");
+   memset(buf1, 0, sizeof(buf1));
+   iov[0] = (struct iovec) { .iov_base = buf1, .iov_len = 1 };
+   iov[1] = (struct iovec) { .iov_base = buf1 + 1, .iov_len = 10 };
+
+   rc = vmsplice(p2[0], iov, 2, 0);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+   DEVSHELL_CMD_ASSERT(!strcmp(buf1, "abc"));
+
+   printf("sendfile() between two pipes\n");
+   rc = write(p1[1], "xyz", 3);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+
+   rc = sendfile(p2[1], p1[0], NULL, 100);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+
+   memset(buf2, 0, sizeof(buf2));
+   rc = read(p2[0], buf2, sizeof(buf2));
+   DEVSHELL_CMD_ASSERT(rc == 3);
+   DEVSHELL_CMD_ASSERT(!strcmp(buf2, "xyz"));
+
+   printf("sendfile() from a pipe to itself is not allowed\n");
+   rc = write(p1[1], "q", 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = sendfile(p1[1], p1[0], NULL, 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(p1[0]);
+   close(p1[1]);
+   close(p2[0]);
+   close(p2[1]);
+   return 0;
+}
+
+/* copy_file_range(), including whole shared pages with copy-on-write */
+int cmd_splice3(int argc, char **argv)
+{
+   const size_t size = 4 * 4096 + 1000;
+   loff_t off_in, off_out;
+   int src, dst, rc;
+   char c;
+
+   src = create_src_file(size);
+   dst = open(splice_dst_file, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(dst > 0);
+
+   printf("Copy the whole file with copy_file_range()\n");
+   lseek(src, 0, SEEK_SET);
+
+   rc = copy_file_range(src, NULL, dst, NULL, size, 0);
+   DEVSHELL_CMD_ASSERT(rc == (int)size);
+   DEVSHELL_CMD_ASSERT(lseek(src, 0, SEEK_CUR) == (off_t)size);
+   DEVSHELL_CMD_ASSERT(lseek(dst, 0, SEEK_CUR) == (off_t)size);
+   check_dst_file(size, 0);
+
+   printf("Write to the copy and check the source is unchanged\n");
+   rc = pwrite(dst, "X", 1, 4096 + 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = pread(src, &c, 1, 4096 + 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(c == (char)('a' + (4096 + 1) % 256 % 26));
+
+   rc = pread(dst, &c, 1, 4096 + 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(c == 'X');
+
+   printf("Write to the source and check the copy is unchanged\n");
+   rc = pwrite(src, "Y", 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = pread(dst, &c, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(c == 'a');
+
+   printf("Unlink the source, the copy must still be readable\n");
+   close(src);
+   unlink(splice_src_file);
+   ftruncate(dst, 4096);
+   close(dst);
+   check_dst_file(4096, 0);
+
+   printf("Copy with explicit, unaligned, offsets\n");
+   src = create_src_file(size);
+   dst = open(splice_dst_file, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(dst > 0);
+
+   off_in = 100;
+   off_out = 0;
+   rc = copy_file_range(src, &off_in, dst, &off_out, 3 * 4096, 0);
+   DEVSHELL_CMD_ASSERT(rc == 3 * 4096);
+   DEVSHELL_CMD_ASSERT(off_in == 100 + 3 * 4096);
+   DEVSHELL_CMD_ASSERT(off_out == 3 * 4096);
+   DEVSHELL_CMD_ASSERT(lseek(src, 0, SEEK_CUR) == (off_t)size);
+   check_dst_file(3 * 4096, 100);
+
+   printf("Flags must be zero\n");
+   rc = copy_file_range(src, &off_in, dst, &off_out, 10, 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(src);
+   close(dst);
+   unlink(splice_src_file);
+   unlink(splice_dst_file);
+   return 0;
+}
+
+/*
+ * copy_file_range() sharing pages, then mmap() of a part of the source: the
+ * pages still shared outside of the mapping must keep being copied on write.
+ */
+int cmd_splice4(int argc, char **argv)
+{
+   const size_t size = 4 * 4096;
+   int src, dst, rc;
+   char *vaddr;
+   char c;
+
+   src = create_src_file(size);
+   dst = open(splice_dst_file, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(dst > 0);
+
+   printf("Share the pages of the source with copy_file_range()\n");
+   lseek(src, 0, SEEK_SET);
+   rc = copy_file_range(src, NULL, dst, NULL, size, 0);
+   DEVSHELL_CMD_ASSERT(rc == (int)size);
+
+   printf("Map the first page of the source\n");
+   vaddr = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, src, 0);
+   DEVSHELL_CMD_ASSERT(vaddr != MAP_FAILED);
+
+   printf("Write to the mapping and check the copy is unchanged\n");
+   vaddr[1] = 'M';
+
+   rc = pread(dst, &c, 1, 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(c == 'b');
+
+   printf("Write to an unmapped page of the source\n");
+   rc = pwrite(src, "W", 1, 2 * 4096 + 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = pread(src, &c, 1, 2 * 4096 + 1);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(c == 'W');
+
+   printf("Check the copy is unchanged\n");
+   close(dst);
+   check_dst_file(size, 0);
+
+   rc = munmap(vaddr, 4096);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   close(src);
+   unlink(splice_src_file);
+   unlink(splice_dst_file);
+   return 0;
+}
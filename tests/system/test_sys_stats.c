@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static char table_buf[64 * 1024];
+
+static int read_table(void)
+{
+   return read_whole_file("/syst/sys_stats/table",
+                          table_buf, sizeof(table_buf));
+}
+
+/* Returns the calls count of the given syscall or -1 if not found */
+static long get_calls(const char *sys_name)
+{
+   char name[64];
+   char *line;
+   unsigned calls;
+   long ret = -1;
+
+   for (line = strtok(table_buf, "\n"); line; line = strtok(NULL, "\n")) {
+
+      if (sscanf(line, "%*u %63s %u", name, &calls) != 2)
+         return -2;
+
+      if (!strcmp(name, sys_name))
+         ret = calls;
+   }
+
+   return ret;
+}
+
+/* Check that the syscall stats count the calls, when enabled */
+int cmd_sys_stats1(int argc, char **argv)
+{
+   long before, after;
+   int rc;
+
+   rc = read_table();
+   DEVSHELL_CMD_ASSERT(rc >= 0);
+
+   if (!rc) {
+      printf("Syscall stats disabled, skipping\n");
+      return 0;
+   }
+
+   before = get_calls("getppid");
+   DEVSHELL_CMD_ASSERT(before >= -1);
+
+   for (int i = 0; i < 10; i++)
+      getppid();
+
+   DEVSHELL_CMD_ASSERT(read_table() > 0);
+   after = get_calls("getppid");
+
+   printf("getppid() calls: %ld -> %ld\n", before, after);
+   DEVSHELL_CMD_ASSERT(after >= (before > 0 ? before : 0) + 10);
+   return 0;
+}
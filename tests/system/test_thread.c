@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+#define THREADS_COUNT           4
+#define ITERS_PER_THREAD     1000
+
+static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int counter;
+static __thread int tls_var = 1234;
+
+struct thread_data {
+   int index;
+   int tid;
+   int tls_value;
+};
+
+static void *thread_func(void *arg)
+{
+   struct thread_data *d = arg;
+
+   d->tid = syscall(SYS_gettid);
+   tls_var = d->index;
+
+   for (int i = 0; i < ITERS_PER_THREAD; i++) {
+
+      pthread_mutex_lock(&counter_mutex);
+      counter++;
+      pthread_mutex_unlock(&counter_mutex);
+
+      if (!(i % 100))
+         sched_yield();
+   }
+
+   d->tls_value = tls_var;
+   return arg;
+}
+
+static void *thread_exit_func(void *arg)
+{
+   usleep(50 * 1000);
+   exit(42);
+}
+
+/* pthread_create/join, mutexes, per-thread TLS and tids */
+int cmd_thread1(int argc, char **argv)
+{
+   struct thread_data data[THREADS_COUNT];
+   pthread_t threads[THREADS_COUNT];
+   void *retval;
+   int rc;
+
+   counter = 0;
+
+   printf("Create %d threads\n", THREADS_COUNT);
+
+   for (int i = 0; i < THREADS_COUNT; i++) {
+
+      data[i] = (struct thread_data) { .index = i };
+      rc = pthread_create(&threads[i], NULL, thread_func, &data[i]);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   for (int i = 0; i < THREADS_COUNT; i++) {
+
+      rc = pthread_join(threads[i], &retval);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+      DEVSHELL_CMD_ASSERT(retval == &data[i]);
+   }
+
+   printf("Check the counter, the TLS values and the tids\n");
+   DEVSHELL_CMD_ASSERT(counter == THREADS_COUNT * ITERS_PER_THREAD);
+   DEVSHELL_CMD_ASSERT(tls_var == 1234);
+
+   for (int i = 0; i < THREADS_COUNT; i++) {
+
+      DEVSHELL_CMD_ASSERT(data[i].tls_value == i);
+      DEVSHELL_CMD_ASSERT(data[i].tid != getpid());
+
+      for (int j = 0; j < i; j++)
+         DEVSHELL_CMD_ASSERT(data[i].tid != data[j].tid);
+   }
+
+   return 0;
+}
+
+/* exit() from a secondary thread terminates the whole process */
+int cmd_thread2(int argc, char **argv)
+{
+   int rc, wstatus;
+   pthread_t thread;
+   pid_t child;
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      if (pthread_create(&thread, NULL, thread_exit_func, NULL))
+         exit(1);
+
+      pause(); /* The secondary thread will call exit(42) */
+      exit(2);
+   }
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 42);
+   return 0;
+}
@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+
+#include "devshell.h"
+
+static volatile int sigusr1_count;
+static volatile int sigalrm_count;
+
+static void sigusr1_handler(int sig)
+{
+   sigusr1_count++;
+}
+
+static void sigalrm_handler(int sig)
+{
+   sigalrm_count++;
+}
+
+static struct itimerspec ms_to_itimerspec(long value_ms, long interval_ms)
+{
+   return (struct itimerspec) {
+      .it_value = {
+         .tv_sec = value_ms / 1000,
+         .tv_nsec = (value_ms % 1000) * 1000000,
+      },
+      .it_interval = {
+         .tv_sec = interval_ms / 1000,
+         .tv_nsec = (interval_ms % 1000) * 1000000,
+      },
+   };
+}
+
+/* Relative, absolute and periodic timerfds, with poll() and read() */
+int cmd_timerfd1(int argc, char **argv)
+{
+   struct itimerspec its;
+   struct timespec now;
+   struct pollfd pfd;
+   uint64_t val;
+   int fd, rc;
+
+   fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   printf("A disarmed timerfd is never readable\n");
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   rc = timerfd_gettime(fd, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(!its.it_value.tv_sec && !its.it_value.tv_nsec);
+
+   printf("Periodic timer: 50 ms, then every 20 ms\n");
+   its = ms_to_itimerspec(50, 20);
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = timerfd_gettime(fd, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(its.it_value.tv_sec || its.it_value.tv_nsec);
+   DEVSHELL_CMD_ASSERT(its.it_interval.tv_nsec > 0);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+   rc = poll(&pfd, 1, 2000);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents == POLLIN);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val >= 1);
+
+   printf("Expirations accumulate between reads\n");
+   usleep(150 * 1000);
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val >= 3);
+
+   printf("Disarm the timer\n");
+   its = ms_to_itimerspec(0, 0);
+   rc = timerfd_settime(fd, 0, &its, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(its.it_interval.tv_nsec > 0);
+
+   usleep(50 * 1000);
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   printf("Invalid values\n");
+   its = ms_to_itimerspec(10, 0);
+   its.it_value.tv_nsec = 1000000000;
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = read(fd, &val, 4);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   close(fd);
+
+   printf("Absolute one-shot timer on CLOCK_REALTIME, blocking read\n");
+   fd = timerfd_create(CLOCK_REALTIME, 0);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = clock_gettime(CLOCK_REALTIME, &now);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   its = ms_to_itimerspec(0, 0);
+   its.it_value.tv_sec = now.tv_sec;
+   its.it_value.tv_nsec = now.tv_nsec + 30000000;
+
+   if (its.it_value.tv_nsec >= 1000000000) {
+      its.it_value.tv_sec++;
+      its.it_value.tv_nsec -= 1000000000;
+   }
+
+   rc = timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 1);
+
+   printf("An absolute time in the past expires immediately\n");
+   its.it_value.tv_sec -= 10;
+   rc = timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 1);
+
+   close(fd);
+   return 0;
+}
+
+/* POSIX timers with SIGEV_SIGNAL and SIGEV_NONE, setitimer() and alarm() */
+int cmd_ptimer1(int argc, char **argv)
+{
+   struct sigaction sa, old_usr1, old_alrm;
+   struct itimerspec its, its2;
+   struct itimerval itv;
+   struct sigevent sev;
+   timer_t t1, t2;
+   int rc;
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = sigusr1_handler;
+   rc = sigaction(SIGUSR1, &sa, &old_usr1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   sa.sa_handler = sigalrm_handler;
+   rc = sigaction(SIGALRM, &sa, &old_alrm);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Periodic timer delivering SIGUSR1 every 20 ms\n");
+   memset(&sev, 0, sizeof(sev));
+   sev.sigev_notify = SIGEV_SIGNAL;
+   sev.sigev_signo = SIGUSR1;
+
+   rc = timer_create(CLOCK_MONOTONIC, &sev, &t1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   sigusr1_count = 0;
+   its = ms_to_itimerspec(20, 20);
+   rc = timer_settime(t1, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < 200 && sigusr1_count < 3; i++)
+      usleep(10 * 1000);
+
+   DEVSHELL_CMD_ASSERT(sigusr1_count >= 3);
+   DEVSHELL_CMD_ASSERT(timer_getoverrun(t1) >= 0);
+
+   rc = timer_delete(t1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("SIGEV_NONE: the timer just counts down\n");
+   sev.sigev_notify = SIGEV_NONE;
+   rc = timer_create(CLOCK_REALTIME, &sev, &t2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   its = ms_to_itimerspec(5000, 0);
+   rc = timer_settime(t2, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   usleep(50 * 1000);
+   rc = timer_gettime(t2, &its2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(its2.it_value.tv_sec < 5);
+   DEVSHELL_CMD_ASSERT(its2.it_value.tv_sec >= 4);
+
+   rc = timer_delete(t2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = timer_delete(t2);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   printf("setitimer(ITIMER_REAL): one-shot SIGALRM\n");
+   sigalrm_count = 0;
+   memset(&itv, 0, sizeof(itv));
+   itv.it_value.tv_usec = 30 * 1000;
+   rc = setitimer(ITIMER_REAL, &itv, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < 200 && !sigalrm_count; i++)
+      usleep(10 * 1000);
+
+   DEVSHELL_CMD_ASSERT(sigalrm_count == 1);
+
+   rc = getitimer(ITIMER_REAL, &itv);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(!itv.it_value.tv_sec && !itv.it_value.tv_usec);
+
+   printf("alarm() returns the seconds left\n");
+   DEVSHELL_CMD_ASSERT(alarm(10) == 0);
+   DEVSHELL_CMD_ASSERT(alarm(0) == 10);
+   DEVSHELL_CMD_ASSERT(sigalrm_count == 1);
+
+   sigaction(SIGUSR1, &old_usr1, NULL);
+   sigaction(SIGALRM, &old_alrm, NULL);
+   return 0;
+}
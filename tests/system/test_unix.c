@@ -0,0 +1,360 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+#define SOCK_PATH       "/tmp/unix_test_sock"
+
+static void unix_fill_addr(struct sockaddr_un *addr, const char *path)
+{
+   memset(addr, 0, sizeof(*addr));
+   addr->sun_family = AF_UNIX;
+   strcpy(addr->sun_path, path);
+}
+
+static void unix1_child(void)
+{
+   struct sockaddr_un addr;
+   char buf[32];
+   int fd, rc;
+
+   fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+   if (fd < 0)
+      exit(1);
+
+   unix_fill_addr(&addr, SOCK_PATH);
+
+   if (connect(fd, (void *)&addr, sizeof(addr)) < 0)
+      exit(2);
+
+   if (write(fd, "hello", 5) != 5)
+      exit(3);
+
+   rc = read(fd, buf, sizeof(buf));
+
+   if (rc != 5 || memcmp(buf, "world", 5))
+      exit(4);
+
+   close(fd);
+   exit(0);
+}
+
+/* Stream sockets: bind, listen, connect, accept, addresses and EOF */
+int cmd_unix1(int argc, char **argv)
+{
+   struct sockaddr_un addr, addr2;
+   socklen_t addr_len;
+   struct pollfd pfd;
+   struct stat statbuf;
+   int srv, conn, rc, wstatus;
+   char buf[32];
+   pid_t child;
+
+   unlink(SOCK_PATH);
+
+   srv = socket(AF_UNIX, SOCK_STREAM, 0);
+   DEVSHELL_CMD_ASSERT(srv >= 0);
+
+   unix_fill_addr(&addr, SOCK_PATH);
+   rc = bind(srv, (void *)&addr, sizeof(addr));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Check that bind() created a socket inode\n");
+   rc = stat(SOCK_PATH, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(S_ISSOCK(statbuf.st_mode));
+
+   rc = listen(srv, 4);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Binding another socket to the same path fails\n");
+   conn = socket(AF_UNIX, SOCK_STREAM, 0);
+   DEVSHELL_CMD_ASSERT(conn >= 0);
+   rc = bind(conn, (void *)&addr, sizeof(addr));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EADDRINUSE);
+   close(conn);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child)
+      unix1_child();
+
+   printf("Wait for the listening socket to become readable\n");
+   pfd = (struct pollfd) { .fd = srv, .events = POLLIN };
+   rc = poll(&pfd, 1, 5000);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents & POLLIN);
+
+   addr_len = sizeof(addr2);
+   conn = accept(srv, (void *)&addr2, &addr_len);
+   DEVSHELL_CMD_ASSERT(conn >= 0);
+
+   addr_len = sizeof(addr2);
+   rc = getsockname(srv, (void *)&addr2, &addr_len);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(addr2.sun_family == AF_UNIX);
+   DEVSHELL_CMD_ASSERT(!strcmp(addr2.sun_path, SOCK_PATH));
+
+   rc = read(conn, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 5);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "hello", 5));
+
+   rc = write(conn, "world", 5);
+   DEVSHELL_CMD_ASSERT(rc == 5);
+
+   printf("Read EOF after the peer closed its end\n");
+   rc = read(conn, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+
+   close(conn);
+   close(srv);
+
+   printf("Connecting to a path without a listener fails\n");
+   conn = socket(AF_UNIX, SOCK_STREAM, 0);
+   DEVSHELL_CMD_ASSERT(conn >= 0);
+   rc = connect(conn, (void *)&addr, sizeof(addr));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ECONNREFUSED);
+   close(conn);
+
+   rc = unlink(SOCK_PATH);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/* socketpair(), datagram boundaries, MSG_TRUNC and SCM_RIGHTS */
+int cmd_unix2(int argc, char **argv)
+{
+   union {
+      char buf[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr align;
+   } ctrl;
+
+   struct cmsghdr *cmsg;
+   struct msghdr msg;
+   struct iovec iov;
+   int sv[2], pfds[2];
+   char buf[32];
+   int rc, fd;
+
+   printf("Datagram socketpair preserves message boundaries\n");
+   rc = socketpair(AF_UNIX, SOCK_DGRAM, 0, sv);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(send(sv[0], "abc", 3, 0) == 3);
+   DEVSHELL_CMD_ASSERT(send(sv[0], "defgh", 5, 0) == 5);
+
+   rc = recv(sv[1], buf, sizeof(buf), 0);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "abc", 3));
+
+   rc = recv(sv[1], buf, 2, MSG_TRUNC);
+   DEVSHELL_CMD_ASSERT(rc == 5);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "de", 2));
+
+   rc = recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   close(sv[0]);
+   close(sv[1]);
+
+   printf("Pass a pipe's read end over a stream socketpair\n");
+   rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = pipe(pfds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   memset(&ctrl, 0, sizeof(ctrl));
+   iov = (struct iovec) { .iov_base = "x", .iov_len = 1 };
+   msg = (struct msghdr) {
+      .msg_iov = &iov,
+      .msg_iovlen = 1,
+      .msg_control = ctrl.buf,
+      .msg_controllen = sizeof(ctrl.buf),
+   };
+
+   cmsg = CMSG_FIRSTHDR(&msg);
+   cmsg->cmsg_level = SOL_SOCKET;
+   cmsg->cmsg_type = SCM_RIGHTS;
+   cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+   memcpy(CMSG_DATA(cmsg), &pfds[0], sizeof(int));
+
+   rc = sendmsg(sv[0], &msg, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   close(pfds[0]);
+
+   memset(&ctrl, 0, sizeof(ctrl));
+   iov = (struct iovec) { .iov_base = buf, .iov_len = sizeof(buf) };
+   msg = (struct msghdr) {
+      .msg_iov = &iov,
+      .msg_iovlen = 1,
+      .msg_control = ctrl.buf,
+      .msg_controllen = sizeof(ctrl.buf),
+   };
+
+   rc = recvmsg(sv[1], &msg, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(buf[0] == 'x');
+
+   cmsg = CMSG_FIRSTHDR(&msg);
+   DEVSHELL_CMD_ASSERT(cmsg != NULL);
+   DEVSHELL_CMD_ASSERT(cmsg->cmsg_level == SOL_SOCKET);
+   DEVSHELL_CMD_ASSERT(cmsg->cmsg_type == SCM_RIGHTS);
+   memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   printf("The received fd refers to the same pipe\n");
+   DEVSHELL_CMD_ASSERT(write(pfds[1], "pipe", 4) == 4);
+   rc = read(fd, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 4);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "pipe", 4));
+
+   printf("shutdown(SHUT_WR) makes the peer read EOF\n");
+   rc = shutdown(sv[0], SHUT_WR);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = read(sv[1], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   close(fd);
+   close(pfds[1]);
+   close(sv[0]);
+   close(sv[1]);
+   return 0;
+}
+
+/* epoll on a stream socket registered before connect() */
+int cmd_unix3(int argc, char **argv)
+{
+   struct sockaddr_un addr;
+   struct epoll_event ev;
+   int srv, cli, conn, epfd, rc;
+   char buf[256];
+
+   unlink(SOCK_PATH);
+   memset(buf, 'x', sizeof(buf));
+
+   srv = socket(AF_UNIX, SOCK_STREAM, 0);
+   DEVSHELL_CMD_ASSERT(srv >= 0);
+
+   unix_fill_addr(&addr, SOCK_PATH);
+   rc = bind(srv, (void *)&addr, sizeof(addr));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = listen(srv, 4);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   cli = socket(AF_UNIX, SOCK_STREAM, 0);
+   DEVSHELL_CMD_ASSERT(cli >= 0);
+
+   epfd = epoll_create1(0);
+   DEVSHELL_CMD_ASSERT(epfd >= 0);
+
+   ev = (struct epoll_event) { .events = EPOLLOUT, .data.fd = cli };
+   rc = epoll_ctl(epfd, EPOLL_CTL_ADD, cli, &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("An unconnected socket is not writable\n");
+   rc = epoll_wait(epfd, &ev, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("The socket becomes writable after connect()\n");
+   rc = connect(cli, (void *)&addr, sizeof(addr));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = epoll_wait(epfd, &ev, 1, 1000);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(ev.events & EPOLLOUT);
+
+   printf("Fill the peer's receive buffer\n");
+   while (send(cli, buf, sizeof(buf), MSG_DONTWAIT) > 0) { }
+   DEVSHELL_CMD_ASSERT(errno == EAGAIN);
+   rc = epoll_wait(epfd, &ev, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("The socket becomes writable again once the peer reads\n");
+   conn = accept(srv, NULL, NULL);
+   DEVSHELL_CMD_ASSERT(conn >= 0);
+   rc = read(conn, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == (int)sizeof(buf));
+   rc = epoll_wait(epfd, &ev, 1, 1000);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(ev.events & EPOLLOUT);
+
+   close(epfd);
+   close(conn);
+   close(cli);
+   close(srv);
+
+   rc = unlink(SOCK_PATH);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/* POLLOUT wake-up on a full datagram socketpair() end */
+int cmd_unix4(int argc, char **argv)
+{
+   struct pollfd pfd;
+   int sv[2], rc, wstatus;
+   char buf[256];
+   pid_t child;
+
+   memset(buf, 'x', sizeof(buf));
+
+   rc = socketpair(AF_UNIX, SOCK_DGRAM, 0, sv);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Fill the peer's receive queue\n");
+   while (send(sv[0], buf, sizeof(buf), MSG_DONTWAIT) > 0) { }
+   DEVSHELL_CMD_ASSERT(errno == EAGAIN);
+
+   pfd = (struct pollfd) { .fd = sv[0], .events = POLLOUT };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      usleep(100 * 1000);
+
+      if (recv(sv[1], buf, sizeof(buf), 0) != (int)sizeof(buf))
+         exit(1);
+
+      exit(0);
+   }
+
+   printf("The socket becomes writable once the peer receives\n");
+   rc = poll(&pfd, 1, 5000);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents & POLLOUT);
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+
+   close(sv[0]);
+   close(sv[1]);
+   return 0;
+}
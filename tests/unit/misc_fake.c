@@ -100,7 +100,7 @@ void *__wrap_general_kmalloc(size_t *size, u32 flags)
    if (mock_kmalloc)
       return malloc(*size);
 
-   return __real_general_kmalloc(size, 0);
+   return __real_general_kmalloc(size, flags);
 }
 
 void __wrap_general_kfree(void *ptr, size_t *size, u32 flags)
@@ -108,7 +108,7 @@ void __wrap_general_kfree(void *ptr, size_t *size, u32 flags)
    if (mock_kmalloc)
       return free(ptr);
 
-   return __real_general_kfree(ptr, size, 0);
+   return __real_general_kfree(ptr, size, flags);
 }
 
 void *__wrap_kmalloc_get_first_heap(size_t *size)
@@ -146,6 +146,17 @@ ulong get_mapping(pdir_t *, void *vaddrp)
    return mappings[(ulong)vaddrp];
 }
 
+int get_mapping2(pdir_t *, void *vaddrp, ulong *pa_ref)
+{
+   ulong vaddr = (ulong)vaddrp & PAGE_MASK;
+
+   if (mappings.find(vaddr) == mappings.end())
+      return -1;
+
+   *pa_ref = mappings[vaddr] + ((ulong)vaddrp & OFFSET_IN_PAGE_MASK);
+   return 0;
+}
+
 int virtual_read(pdir_t *pdir, void *extern_va, void *dest, size_t len)
 {
    memcpy(dest, extern_va, len);
@@ -248,3 +248,56 @@ TEST(ringbuf, read_write_bytes)
    ASSERT_TRUE(ringbuf_is_empty(&rb));
    ringbuf_destory(&rb);
 }
+
+TEST(ringbuf, in_place_chunks)
+{
+   struct ringbuf rb;
+   char buffer[9] = "--------";
+   u8 *ptr;
+   size_t n;
+
+   ringbuf_init(&rb, 8, 1, buffer);
+
+   n = ringbuf_get_read_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 0U);
+
+   n = ringbuf_get_write_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 8U);
+   ASSERT_EQ((char *)ptr, buffer);
+   memcpy(ptr, "123456", 6);
+   ringbuf_commit_write(&rb, 6);
+
+   n = ringbuf_get_read_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 6U);
+   ringbuf_commit_read(&rb, 4);
+
+   /* The free space wraps around: only the tail is contiguous */
+   n = ringbuf_get_write_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 2U);
+   ASSERT_EQ((char *)ptr, buffer + 6);
+   memcpy(ptr, "78", 2);
+   ringbuf_commit_write(&rb, 2);
+
+   n = ringbuf_get_write_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 4U);
+   ASSERT_EQ((char *)ptr, buffer);
+   memcpy(ptr, "9ABC", 4);
+   ringbuf_commit_write(&rb, 4);
+
+   ASSERT_TRUE(ringbuf_is_full(&rb));
+   ASSERT_EQ(ringbuf_get_write_chunk(&rb, &ptr), 0U);
+   ASSERT_STREQ(buffer, "9ABC5678");
+
+   n = ringbuf_get_read_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 4U);
+   ASSERT_EQ(memcmp(ptr, "5678", 4), 0);
+   ringbuf_commit_read(&rb, 4);
+
+   n = ringbuf_get_read_chunk(&rb, &ptr);
+   ASSERT_EQ(n, 4U);
+   ASSERT_EQ(memcmp(ptr, "9ABC", 4), 0);
+   ringbuf_commit_read(&rb, 4);
+
+   ASSERT_TRUE(ringbuf_is_empty(&rb));
+   ringbuf_destory(&rb);
+}
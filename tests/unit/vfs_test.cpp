@@ -166,24 +166,201 @@ TEST_F(vfs_fat32, fseek)
    close(fd);
 }
 
-TEST_F(vfs_fat32, pread_not_supported)
+TEST_F(vfs_fat32, pread)
 {
    const char *fatpart_file_path = "/bigfile";
+   const char *real_file_path = PROJ_BUILD_DIR "/test_sysroot/bigfile";
+   char buf_tilck[200];
+   char buf_linux[200];
    fs_handle h = NULL;
-   char buf[32];
+   ssize_t tilck_rc, linux_rc;
    int rc;
 
+   int fd = open(real_file_path, O_RDONLY);
+   ASSERT_GE(fd, 0);
+
+   const off_t file_size = lseek(fd, 0, SEEK_END);
+   const off_t offsets[] = {
+      0, 10, 511, 512, 4095, 4096, 4097, file_size / 2,
+      file_size - 1, file_size, file_size + 100,
+   };
+
    rc = vfs_open(fatpart_file_path, &h, 0, O_RDONLY);
    ASSERT_TRUE(rc == 0);
    ASSERT_TRUE(h != NULL);
 
-   rc = vfs_pread(h, buf, sizeof(buf), 0 /* offset */);
-   EXPECT_EQ(rc, -EPERM);
+   /* Move the regular cursor, to check that pread() does not affect it */
+   ASSERT_EQ(vfs_read(h, buf_tilck, 100), 100);
 
-   rc = vfs_pread(h, buf, sizeof(buf), 10 /* offset */);
-   EXPECT_EQ(rc, -EPERM);
+   for (off_t off : offsets) {
+
+      memset(buf_linux, 0, sizeof(buf_linux));
+      memset(buf_tilck, 0, sizeof(buf_tilck));
+
+      linux_rc = pread(fd, buf_linux, sizeof(buf_linux), off);
+      tilck_rc = vfs_pread(h, buf_tilck, sizeof(buf_tilck), off);
+
+      ASSERT_EQ(tilck_rc, linux_rc) << "Offset: " << off;
+      ASSERT_EQ(memcmp(buf_tilck, buf_linux, sizeof(buf_linux)), 0)
+         << "Offset: " << off;
+   }
+
+   EXPECT_EQ(vfs_seek(h, 0, SEEK_CUR), 100);
+   linux_rc = pread(fd, buf_linux, sizeof(buf_linux), 100);
+   tilck_rc = vfs_read(h, buf_tilck, sizeof(buf_tilck));
+   ASSERT_EQ(tilck_rc, (ssize_t)sizeof(buf_tilck));
+   ASSERT_EQ(tilck_rc, linux_rc);
+   EXPECT_EQ(memcmp(buf_tilck, buf_linux, sizeof(buf_linux)), 0);
 
    vfs_close(h);
+   close(fd);
+}
+
+class vfs_fat32_rw : public vfs_test_base {
+
+protected:
+
+   struct mnt_fs *fat_fs;
+   struct fat_hdr *hdr;
+   vector<char> fatpart;
+
+   void SetUp() override {
+
+      size_t fatpart_size;
+      vfs_test_base::SetUp();
+
+      /*
+       * The test partition is truncated to its used bytes: make a writable
+       * copy of it with its full size, in order to have free clusters.
+       */
+      const char *img = load_once_file(TEST_FATPART_FILE, &fatpart_size);
+      hdr = (struct fat_hdr *)img;
+      fatpart.resize(fat_get_TotSec(hdr) * fat_get_sector_size(hdr));
+      ASSERT_GE(fatpart.size(), fatpart_size);
+      memcpy(fatpart.data(), img, fatpart_size);
+
+      hdr = (struct fat_hdr *)fatpart.data();
+      fat_fs = fat_mount_ramdisk(fatpart.data(), fatpart.size(), VFS_FS_RW);
+      ASSERT_TRUE(fat_fs != NULL);
+
+      mp_init(fat_fs);
+   }
+
+   void TearDown() override {
+
+      fat_umount_ramdisk(fat_fs);
+      vfs_test_base::TearDown();
+   }
+
+   u32 free_clusters() {
+      return ((struct fat_fs_device_data *)fat_fs->device_data)->free_count;
+   }
+
+   string read_on_disk(const char *path) {
+
+      struct fat_entry *e;
+      string res;
+
+      e = fat_search_entry(hdr, fat_get_type(hdr), path, NULL);
+
+      if (!e)
+         return "<not found>";
+
+      res.resize(e->DIR_FileSize);
+      fat_read_whole_file(hdr, e, &res[0], res.size());
+      return res;
+   }
+};
+
+TEST_F(vfs_fat32_rw, overwrite_and_extend)
+{
+   const char *path = "/testdir/BBB";
+   const string orig = read_on_disk(path);
+   string data(3000, 0);
+   string expected;
+   struct k_stat64 st;
+   fs_handle h = NULL;
+   ssize_t rc;
+
+   for (size_t i = 0; i < data.size(); i++)
+      data[i] = (char)('a' + i % 26);
+
+   ASSERT_EQ(vfs_open(path, &h, O_RDWR, 0), 0);
+
+   /* Overwrite in place */
+   rc = vfs_write(h, (void *)"hello", 5);
+   ASSERT_EQ(rc, 5);
+
+   /* Extend the file across several clusters */
+   rc = vfs_pwrite(h, &data[0], data.size(), (offt)orig.size());
+   ASSERT_EQ(rc, (ssize_t)data.size());
+
+   expected = "hello" + orig.substr(5) + data;
+
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   EXPECT_EQ(st.st_size, (s64)expected.size());
+
+   string tmp(expected.size() + 10, 0);
+   rc = vfs_pread(h, &tmp[0], tmp.size(), 0);
+   ASSERT_EQ(rc, (ssize_t)expected.size());
+   tmp.resize((size_t)rc);
+   EXPECT_EQ(tmp, expected);
+
+   /* The on-disk metadata is updated only on sync */
+   EXPECT_EQ(read_on_disk(path).size(), orig.size());
+
+   vfs_syncfs(fat_fs);
+   EXPECT_EQ(read_on_disk(path), expected);
+
+   /* O_APPEND */
+   vfs_close(h);
+   ASSERT_EQ(vfs_open(path, &h, O_WRONLY | O_APPEND, 0), 0);
+   rc = vfs_write(h, (void *)"end", 3);
+   ASSERT_EQ(rc, 3);
+   ASSERT_EQ(vfs_fsync(h), 0);
+   vfs_close(h);
+
+   EXPECT_EQ(read_on_disk(path), expected + "end");
+}
+
+TEST_F(vfs_fat32_rw, truncate)
+{
+   const char *path = "/bigfile";
+   const u32 free_clu = free_clusters();
+   const u32 clu_size = fat_get_cluster_size(hdr);
+   string buf(clu_size * 2, 'x');
+   fs_handle h = NULL;
+   ssize_t rc;
+
+   ASSERT_EQ(vfs_open(path, &h, O_RDWR, 0), 0);
+
+   /* Shrink: the clusters must be returned to the free pool */
+   ASSERT_EQ(vfs_ftruncate(h, 10), 0);
+   EXPECT_GT(free_clusters(), free_clu);
+
+   /* Grow: the new part must be zero-filled */
+   ASSERT_EQ(vfs_ftruncate(h, clu_size + 10), 0);
+   rc = vfs_pread(h, &buf[0], buf.size(), 0);
+   ASSERT_EQ(rc, (ssize_t)(clu_size + 10));
+
+   for (size_t i = 10; i < (size_t)rc; i++)
+      ASSERT_EQ(buf[i], 0) << "Offset: " << i;
+
+   vfs_close(h);
+   vfs_syncfs(fat_fs);
+   EXPECT_EQ(read_on_disk(path).size(), clu_size + 10);
+
+   /* Truncate to zero and back via O_TRUNC, then write again */
+   ASSERT_EQ(vfs_open(path, &h, O_RDWR | O_TRUNC, 0), 0);
+   rc = vfs_write(h, (void *)"abc", 3);
+   ASSERT_EQ(rc, 3);
+   vfs_close(h);
+
+   vfs_syncfs(fat_fs);
+   EXPECT_EQ(read_on_disk(path), "abc");
+
+   /* Creating new files is not supported */
+   EXPECT_EQ(vfs_open("/newfile", &h, O_CREAT | O_RDWR, 0644), -EPERM);
 }
 
 class vfs_ramfs : public vfs_test_base {
@@ -425,6 +602,138 @@ TEST_F(vfs_ramfs, seek)
    ASSERT_NO_FATAL_FAILURE({ test_pread_pwrite_seek(true); });
 }
 
+TEST_F(vfs_ramfs, copy_file_range)
+{
+   /*
+    * NOTE: the offsets here are not page-aligned on purpose: page sharing
+    * relies on the pageframe ref-counts, which are not tracked in unit tests.
+    */
+   const size_t data_size = 3 * PAGE_SIZE + 100;
+   vector<char> data(data_size), buf(data_size);
+   fs_handle src, dst;
+   ssize_t rc;
+   offt in_pos, out_pos;
+
+   for (size_t i = 0; i < data_size; i++)
+      data[i] = (char)('a' + i % 26);
+
+   rc = vfs_open("/src", &src, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   rc = vfs_open("/dst", &dst, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   rc = vfs_write(src, data.data(), data_size);
+   ASSERT_EQ(rc, (ssize_t)data_size);
+
+   in_pos = 10;
+   out_pos = 20;
+   rc = vfs_copy_file_range(src, &in_pos, dst, &out_pos, data_size);
+   ASSERT_EQ(rc, (ssize_t)data_size - 10);
+   ASSERT_EQ(in_pos, (offt)data_size);
+   ASSERT_EQ(out_pos, (offt)data_size + 10);
+
+   rc = vfs_pread(dst, buf.data(), data_size, 0);
+   ASSERT_EQ(rc, (ssize_t)data_size);
+
+   for (size_t i = 0; i < 20; i++)
+      ASSERT_EQ(buf[i], 0);
+
+   ASSERT_EQ(memcmp(buf.data() + 20, data.data() + 10, data_size - 20), 0);
+
+   /* Overlapping ranges in the same file are not allowed */
+   in_pos = 0;
+   out_pos = 100;
+   rc = vfs_copy_file_range(src, &in_pos, src, &out_pos, 200);
+   ASSERT_EQ(rc, -EINVAL);
+
+   /* Copying past the end of the source returns 0 */
+   in_pos = (offt)data_size;
+   out_pos = 0;
+   rc = vfs_copy_file_range(src, &in_pos, dst, &out_pos, 100);
+   ASSERT_EQ(rc, 0);
+
+   vfs_close(src);
+   vfs_close(dst);
+   ASSERT_EQ(vfs_unlink("/src"), 0);
+   ASSERT_EQ(vfs_unlink("/dst"), 0);
+}
+
+TEST_F(vfs_ramfs, fallocate)
+{
+   const size_t data_size = 4 * PAGE_SIZE;
+   vector<char> data(data_size, 'x'), buf(data_size);
+   struct k_stat64 st;
+   fs_handle h;
+   int rc;
+
+   rc = vfs_open("/file", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   /* Pre-allocate without changing the size */
+   rc = vfs_fallocate(h, FALLOC_FL_KEEP_SIZE, 0, (offt)data_size);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   EXPECT_EQ(st.st_size, 0);
+   EXPECT_EQ(st.st_blocks, (s64)(data_size / 512));
+
+   /* Pre-allocate and extend the file: the new range reads as zeros */
+   rc = vfs_fallocate(h, 0, 100, (offt)data_size - 100);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   EXPECT_EQ(st.st_size, (s64)data_size);
+   EXPECT_EQ(st.st_blocks, (s64)(data_size / 512));
+
+   ASSERT_EQ(vfs_pread(h, buf.data(), data_size, 0), (ssize_t)data_size);
+
+   for (size_t i = 0; i < data_size; i++)
+      ASSERT_EQ(buf[i], 0);
+
+   ASSERT_EQ(vfs_write(h, data.data(), data_size), (ssize_t)data_size);
+
+   /* Punch a hole: the whole pages get freed, the partial ones zeroed */
+   rc = vfs_fallocate(h, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      PAGE_SIZE - 10, 2 * PAGE_SIZE + 20);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   EXPECT_EQ(st.st_size, (s64)data_size);
+   EXPECT_EQ(st.st_blocks, (s64)(2 * PAGE_SIZE / 512));
+
+   ASSERT_EQ(vfs_pread(h, buf.data(), data_size, 0), (ssize_t)data_size);
+
+   for (size_t i = 0; i < data_size; i++) {
+
+      if (i >= PAGE_SIZE - 10 && i < 3 * PAGE_SIZE + 10)
+         ASSERT_EQ(buf[i], 0) << "Offset: " << i;
+      else
+         ASSERT_EQ(buf[i], 'x') << "Offset: " << i;
+   }
+
+   /* Truncate drops the blocks past EOF, even if the size does not change */
+   rc = vfs_fallocate(h, FALLOC_FL_KEEP_SIZE, (offt)data_size, PAGE_SIZE);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   EXPECT_EQ(st.st_blocks, (s64)(3 * PAGE_SIZE / 512));
+   ASSERT_EQ(vfs_ftruncate(h, (offt)data_size), 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   EXPECT_EQ(st.st_blocks, (s64)(2 * PAGE_SIZE / 512));
+
+   /* Invalid arguments */
+   EXPECT_EQ(vfs_fallocate(h, 0, 0, 0), -EINVAL);
+   EXPECT_EQ(vfs_fallocate(h, 0, -1, 10), -EINVAL);
+   EXPECT_EQ(vfs_fallocate(h, FALLOC_FL_PUNCH_HOLE, 0, 10), -EOPNOTSUPP);
+   EXPECT_EQ(vfs_fallocate(h, 0x100, 0, 10), -EOPNOTSUPP);
+
+   vfs_close(h);
+
+   rc = vfs_open("/file", &h, O_RDONLY, 0);
+   ASSERT_EQ(rc, 0);
+   EXPECT_EQ(vfs_fallocate(h, 0, 0, 10), -EBADF);
+   vfs_close(h);
+
+   ASSERT_EQ(vfs_unlink("/file"), 0);
+}
+
 class compute_abs_path_test :
    public TestWithParam<
       tuple<const char *, const char *, const char *>
@@ -143,6 +143,7 @@ extern const struct fs_ops static_fsops_testfs = {
    .stat                 = nullptr,
    .mkdir                = nullptr,
    .rmdir                = nullptr,
+   .mknod                = nullptr,
    .symlink              = nullptr,
    .readlink             = test_fs_readlink,
    .truncate             = nullptr,
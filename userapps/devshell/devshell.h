@@ -129,3 +129,9 @@ tilck_set_sched_alive_thread_enabled(bool enabled)
                          TILCK_CMD_SET_SAT_ENABLED,
                          enabled);
 }
+
+static inline int
+tilck_prof_cmd(int cmd, long arg)
+{
+   return sysenter_call3(TILCK_CMD_SYSCALL, TILCK_CMD_PROFILER, cmd, arg);
+}
@@ -7,6 +7,16 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include <tilck/common/tracing_dev.h>
+
+static volatile sig_atomic_t capture_stop;
 
 static int tracer_tool(int argc, char **argv)
 {
@@ -38,6 +48,164 @@ static int ps_tool(int argc, char **argv)
    return rc;
 }
 
+/*
+ * Control the kernel's sampling profiler. Its results are available in
+ * /syst/prof/folded, in the input format of flamegraph.pl.
+ */
+static int prof_tool(int argc, char **argv)
+{
+   int rc;
+
+   if (argc < 1) {
+      printf("Usage: dp -p start [hz] | stop | reset\n");
+      return 1;
+   }
+
+   if (!strcmp(argv[0], "start")) {
+
+      rc = syscall(TILCK_CMD_SYSCALL, TILCK_CMD_PROFILER,
+                   TILCK_PROF_START, argc > 1 ? atoi(argv[1]) : 100);
+
+   } else if (!strcmp(argv[0], "stop")) {
+
+      rc = syscall(TILCK_CMD_SYSCALL, TILCK_CMD_PROFILER, TILCK_PROF_STOP);
+
+   } else if (!strcmp(argv[0], "reset")) {
+
+      rc = syscall(TILCK_CMD_SYSCALL, TILCK_CMD_PROFILER, TILCK_PROF_RESET);
+
+   } else {
+
+      printf("ERROR: unknown profiler command '%s'\n", argv[0]);
+      return 1;
+   }
+
+   if (rc < 0)
+      perror("profiler");
+
+   return rc;
+}
+
+static void capture_sig_handler(int sig)
+{
+   capture_stop = 1;
+}
+
+static size_t
+capture_drain(struct trace_dev_hdr *hdr, char *events, int out_fd)
+{
+   const u32 mask = hdr->max_events - 1;
+   u32 head, tail = hdr->tail, n;
+   size_t tot = 0;
+
+   head = hdr->head;
+   atomic_thread_fence(memory_order_acquire);
+
+   while (tail != head) {
+
+      /* Write the largest contiguous run of events at once */
+      n = head - tail;
+
+      if (n > hdr->max_events - (tail & mask))
+         n = hdr->max_events - (tail & mask);
+
+      if (write(out_fd, events + (tail & mask) * hdr->event_size,
+                n * hdr->event_size) < 0)
+      {
+         perror("write");
+         capture_stop = 1;
+         break;
+      }
+
+      tail += n;
+      tot += n;
+   }
+
+   atomic_thread_fence(memory_order_release);
+   hdr->tail = tail;
+   return tot;
+}
+
+/*
+ * Save the binary stream of trace events in a file, to be decoded offline
+ * with scripts/dev/trace_to_json. The file starts with a copy of the header
+ * of /dev/trace, followed by the raw events.
+ */
+static int trace_capture(int argc, char **argv)
+{
+   struct trace_dev_hdr *hdr;
+   const size_t pg_size = (size_t)getpagesize();
+   size_t map_size, tot = 0;
+   struct pollfd pfd;
+   time_t end = 0;
+   int fd, out_fd;
+
+   if (argc < 1) {
+      printf("Usage: dp -c <output file> [seconds]\n");
+      return 1;
+   }
+
+   if (argc > 1)
+      end = time(NULL) + atoi(argv[1]);
+
+   if ((fd = open(TRACE_DEV_PATH, O_RDWR)) < 0) {
+      perror("open " TRACE_DEV_PATH);
+      return 1;
+   }
+
+   hdr = mmap(NULL, TRACE_DEV_HDR_SIZE,
+              PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+   if (hdr == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+   }
+
+   if (hdr->magic != TRACE_DEV_MAGIC || hdr->version != TRACE_DEV_VERSION) {
+      printf("ERROR: unsupported " TRACE_DEV_PATH " format\n");
+      return 1;
+   }
+
+   map_size = hdr->hdr_size + hdr->max_events * hdr->event_size;
+   map_size = (map_size + pg_size - 1) & ~(pg_size - 1);
+   munmap(hdr, TRACE_DEV_HDR_SIZE);
+
+   hdr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+   if (hdr == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+   }
+
+   if ((out_fd = open(argv[0], O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+      perror("open");
+      return 1;
+   }
+
+   if (write(out_fd, hdr, hdr->hdr_size) < 0) {
+      perror("write");
+      return 1;
+   }
+
+   signal(SIGINT, &capture_sig_handler);
+   printf("Capturing trace events in %s. Press Ctrl+C to stop.\n", argv[0]);
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+
+   while (!capture_stop && (!end || time(NULL) < end)) {
+      poll(&pfd, 1, 100);
+      tot += capture_drain(hdr, (char *)hdr + hdr->hdr_size, out_fd);
+   }
+
+   tot += capture_drain(hdr, (char *)hdr + hdr->hdr_size, out_fd);
+   printf("Captured %zu events, dropped: %u (ring), %u (kernel bufs)\n",
+          tot, hdr->dropped, hdr->buf_dropped);
+
+   close(out_fd);
+   munmap(hdr, map_size);
+   close(fd);
+   return 0;
+}
+
 static int debug_panel(int argc, char **argv)
 {
    if (argc > 0) {
@@ -45,6 +213,12 @@ static int debug_panel(int argc, char **argv)
       if (!strcmp(argv[0], "-t"))
          return tracer_tool(argc-1, argv+1);
 
+      if (!strcmp(argv[0], "-c"))
+         return trace_capture(argc-1, argv+1);
+
+      if (!strcmp(argv[0], "-p"))
+         return prof_tool(argc-1, argv+1);
+
       printf("ERROR: unknown option '%s'\n", argv[0]);
       return 1;
    }